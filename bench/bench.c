@@ -0,0 +1,947 @@
+#define _POSIX_C_SOURCE 200809L
+#include "corpus.h"
+#include "session.h"
+#include "clipboard/clipboard_operations.h"
+#include "core/history.h"
+#include "core/line_index.h"
+#include "core/document.h"
+#include "core/piece_table.h"
+#include "io/file_operations.h"
+#include "theme/theme_manager.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file bench.c
+ * @brief Headless benchmarks of the GTK-free modules
+ *
+ * Generates corpora of every shape (see corpus.h) from 1 KB up to
+ * --max-size, writes them to a temporary directory and times file reads
+ * and writes and clipboard round trips, both copied and shared, on each,
+ * plus theme switching. A read fails unless it returns every byte of the
+ * corpus, and a file round trip
+ * through file_operations_write_data() and file_operations_read_data()
+ * fails unless every byte, embedded NULs included, comes back. Every benchmark reports
+ * the best ns/op over its samples, MiB/s, allocations per operation and the
+ * process's peak RSS.
+ *
+ * With --fixtures=DIR, each *.bin file there is checked first: it must
+ * read back as its *.utf8 companion (or as itself when there is none),
+ * survive a write and read through the length-taking functions byte for
+ * byte, and load into a Document only if it holds no NUL byte (Document is
+ * the bench shim, a C string).
+ *
+ * Editing sessions (see session.h) are replayed at full speed against the
+ * piece table, the line index and the undo history: generated
+ * typing, paste, Replace All and undo workloads always, and recorded
+ * traces given with --session=FILE. MiB/s counts bytes inserted and
+ * deleted.
+ *
+ * With --baseline=FILE each result is compared to the stored ns/op and the
+ * run fails if any is slower by more than --tolerance percent. A missing
+ * file only prints a notice, so a fresh checkout still runs every
+ * benchmark; one that exists but cannot be read is an error.
+ * --write-baseline=FILE stores this run's results instead.
+ */
+
+/**
+ * @brief Seed of every corpus, so runs are comparable
+ */
+#define CORPUS_SEED UINT64_C(0x9e3779b97f4a7c15)
+
+/**
+ * @brief Sampling: each sample lasts about SAMPLE_NS; a benchmark takes at
+ *        least MIN_SAMPLES samples and keeps sampling until MIN_TOTAL_NS
+ */
+#define SAMPLE_NS 1000000.0
+#define MIN_SAMPLES 3
+#define MAX_SAMPLES 1000
+#define MIN_TOTAL_NS 200000000.0
+
+#define DEFAULT_MAX_SIZE ((size_t)16 * 1024 * 1024)
+#define DEFAULT_TOLERANCE 20.0
+#define BENCH_NAME_MAX 96
+
+/**
+ * @brief Undo budget of the history replays, as in the main window
+ */
+#define SESSION_HISTORY_BUDGET ((size_t)32 * 1024 * 1024)
+
+static const size_t corpus_sizes[] = {
+    (size_t)1024,
+    (size_t)64 * 1024,
+    (size_t)1024 * 1024,
+    (size_t)16 * 1024 * 1024,
+    (size_t)256 * 1024 * 1024,
+    (size_t)2048 * 1024 * 1024
+};
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+/*
+ * Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc: calls made by
+ * the project's own code land here. Allocations inside libc (strdup, iconv,
+ * stdio) are not seen.
+ */
+static atomic_ullong allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_realloc(pointer, size);
+}
+
+static unsigned long long get_allocations(void) {
+    return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+#else
+static unsigned long long get_allocations(void) {
+    return 0;
+}
+#endif
+
+/**
+ * @brief Runs one operation; returns false if it failed
+ */
+typedef bool (*BenchOp)(void* context);
+
+/**
+ * @brief Stored ns/op of one benchmark
+ */
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    double ns_per_op;
+} BaselineEntry;
+
+/**
+ * @brief Run options and results so far
+ */
+typedef struct {
+    size_t max_size;
+    const char* filter;
+    double tolerance;
+    BaselineEntry* baseline;
+    size_t baseline_count;
+    FILE* baseline_output;
+    size_t regressions;
+    size_t failures;
+} Bench;
+
+/**
+ * @brief State shared by the per-corpus operations
+ */
+typedef struct {
+    const char* data;
+    size_t size;
+    const char* input_path;
+    const char* output_path;
+    ClipboardOperations* clipboard;
+    ClipboardData* shared;       /* The corpus, adopted without a copy */
+    ThemeManager* themes;
+} BenchContext;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static long get_peak_rss_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+/**
+ * @brief Formats a byte count as 1K, 64K, 16M, 2G
+ */
+static void format_size(size_t size, char* text, size_t capacity) {
+    if (size >= (size_t)1024 * 1024 * 1024 && size % ((size_t)1024 * 1024 * 1024) == 0) {
+        snprintf(text, capacity, "%zuG", size / ((size_t)1024 * 1024 * 1024));
+    } else if (size >= (size_t)1024 * 1024 && size % ((size_t)1024 * 1024) == 0) {
+        snprintf(text, capacity, "%zuM", size / ((size_t)1024 * 1024));
+    } else if (size >= 1024 && size % 1024 == 0) {
+        snprintf(text, capacity, "%zuK", size / 1024);
+    } else {
+        snprintf(text, capacity, "%zu", size);
+    }
+}
+
+/**
+ * @brief Parses 512, 64K, 16M or 2G
+ * @return true on success
+ */
+static bool parse_size(const char* text, size_t* size) {
+    char* end;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text) {
+        return false;
+    }
+
+    unsigned long long unit = 1;
+    if (*end == 'K' || *end == 'k') {
+        unit = 1024;
+    } else if (*end == 'M' || *end == 'm') {
+        unit = 1024 * 1024;
+    } else if (*end == 'G' || *end == 'g') {
+        unit = 1024 * 1024 * 1024;
+    }
+    if (unit > 1) {
+        end++;
+    }
+    if (*end != '\0' || value > SIZE_MAX / unit) {
+        return false;
+    }
+
+    *size = (size_t)(value * unit);
+    return true;
+}
+
+static const BaselineEntry* find_baseline(const Bench* bench, const char* name) {
+    for (size_t i = 0; i < bench->baseline_count; i++) {
+        if (strcmp(bench->baseline[i].name, name) == 0) {
+            return &bench->baseline[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Reads "name ns_per_op" lines; '#' starts a comment
+ * @return true on success
+ */
+static bool load_baseline(Bench* bench, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        BaselineEntry entry;
+        char format[32];
+        snprintf(format, sizeof(format), "%%%ds %%lf", BENCH_NAME_MAX - 1);
+        if (sscanf(line, format, entry.name, &entry.ns_per_op) != 2) {
+            continue;
+        }
+
+        BaselineEntry* entries = (BaselineEntry*)realloc(bench->baseline,
+                                                         (bench->baseline_count + 1) * sizeof(BaselineEntry));
+        if (!entries) {
+            fclose(file);
+            return false;
+        }
+        bench->baseline = entries;
+        bench->baseline[bench->baseline_count++] = entry;
+    }
+
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Times an operation, prints its row and checks it against the baseline
+ * @param bytes Bytes processed per operation (0 for no MiB/s column)
+ */
+static void run_benchmark(Bench* bench, const char* name, size_t bytes, BenchOp op, void* context) {
+    if (bench->filter && !strstr(name, bench->filter)) {
+        return;
+    }
+
+    /* A warm-up call, not counted, fills caches and sizes the batches */
+    double start = now_ns();
+    if (!op(context)) {
+        printf("%-36s FAILED\n", name);
+        bench->failures++;
+        return;
+    }
+    double single = now_ns() - start;
+
+    size_t batch = single < SAMPLE_NS ? (size_t)(SAMPLE_NS / (single > 1.0 ? single : 1.0)) + 1 : 1;
+    double best = 0.0;
+    double total = 0.0;
+    size_t operations = 0;
+    unsigned long long allocations_before = get_allocations();
+
+    for (size_t samples = 0; samples < MAX_SAMPLES && (samples < MIN_SAMPLES || total < MIN_TOTAL_NS); samples++) {
+        start = now_ns();
+        for (size_t i = 0; i < batch; i++) {
+            if (!op(context)) {
+                printf("%-36s FAILED\n", name);
+                bench->failures++;
+                return;
+            }
+        }
+        double elapsed = now_ns() - start;
+
+        double per_op = elapsed / (double)batch;
+        if (samples == 0 || per_op < best) {
+            best = per_op;
+        }
+        total += elapsed;
+        operations += batch;
+    }
+
+    double allocations = (double)(get_allocations() - allocations_before) / (double)operations;
+
+    char throughput[32] = "-";
+    if (bytes > 0) {
+        snprintf(throughput, sizeof(throughput), "%.1f", (double)bytes / best * 1e9 / (1024.0 * 1024.0));
+    }
+
+    printf("%-36s %14.1f %10s %10.1f %10.1f", name, best, throughput, allocations,
+           (double)get_peak_rss_kb() / 1024.0);
+
+    const BaselineEntry* baseline = find_baseline(bench, name);
+    if (baseline && baseline->ns_per_op > 0.0) {
+        double change = (best / baseline->ns_per_op - 1.0) * 100.0;
+        bool regressed = change > bench->tolerance;
+        printf(" %+8.1f%%%s", change, regressed ? "  REGRESSED" : "");
+        if (regressed) {
+            bench->regressions++;
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+
+    if (bench->baseline_output) {
+        fprintf(bench->baseline_output, "%s %.1f\n", name, best);
+    }
+}
+
+static bool op_read(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    char* content;
+    size_t length;
+    if (file_operations_read_data(c->input_path, &content, &length) != FILE_OP_SUCCESS) {
+        return false;
+    }
+    free(content);
+
+    return length == c->size;
+}
+
+static bool op_write(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    return file_operations_write_atomic(c->output_path, c->data, c->size, FILE_SYNC_NONE) == FILE_OP_SUCCESS;
+}
+
+/**
+ * @brief Writes the corpus and reads it back, failing unless every byte survives
+ */
+static bool op_round_trip(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    if (file_operations_write_data(c->output_path, c->data, c->size) != FILE_OP_SUCCESS) {
+        return false;
+    }
+
+    char* content;
+    size_t length;
+    if (file_operations_read_data(c->output_path, &content, &length) != FILE_OP_SUCCESS) {
+        return false;
+    }
+
+    bool intact = length == c->size && memcmp(content, c->data, length) == 0;
+    free(content);
+
+    return intact;
+}
+
+static bool op_clipboard(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    if (!clipboard_operations_copy_data(c->clipboard, c->data, c->size)) {
+        return false;
+    }
+
+    size_t length;
+    char* pasted = clipboard_operations_paste_data(c->clipboard, &length);
+    bool complete = pasted != NULL && length == c->size;
+    free(pasted);
+
+    return complete;
+}
+
+/**
+ * @brief Copy and paste of shared content, as the editor does it
+ */
+static bool op_clipboard_shared(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    if (!clipboard_operations_set_data(c->clipboard, c->shared)) {
+        return false;
+    }
+
+    size_t length;
+    ClipboardData* pasted = clipboard_operations_get_data(c->clipboard);
+    bool complete = clipboard_data_get_bytes(pasted, &length) == c->data && length == c->size;
+    clipboard_data_unref(pasted);
+
+    return complete;
+}
+
+static bool op_theme_toggle(void* context) {
+    BenchContext* c = (BenchContext*)context;
+
+    theme_manager_toggle(c->themes);
+    return theme_manager_get_colors(c->themes) != NULL && theme_manager_get_css(c->themes) != NULL;
+}
+
+static bool op_theme_create(void* context) {
+    (void)context;
+
+    ThemeManager* themes = theme_manager_create(THEME_DARK);
+    theme_manager_destroy(themes);
+
+    return themes != NULL;
+}
+
+/**
+ * @brief Replays a session's edits on a piece table
+ */
+static bool op_replay_piece_table(void* context) {
+    const Session* session = (const Session*)context;
+
+    PieceTable* table = piece_table_create("", 0);
+    bool ok = table != NULL;
+
+    for (size_t i = 0; i < session->count && ok; i++) {
+        const EditTraceRecord* r = &session->records[i].record;
+        if (r->type == EDIT_TRACE_SET) {
+            piece_table_destroy(table);
+            table = piece_table_create(r->text, r->length);
+            ok = table != NULL;
+        } else if (r->type == EDIT_TRACE_INSERT) {
+            ok = piece_table_insert(table, (size_t)r->offset, r->text, r->length);
+        } else if (r->type == EDIT_TRACE_DELETE) {
+            ok = piece_table_delete(table, (size_t)r->offset, r->length);
+        }
+    }
+
+    piece_table_destroy(table);
+    return ok;
+}
+
+/**
+ * @brief Replays a session's edits on a line index
+ */
+static bool op_replay_line_index(void* context) {
+    const Session* session = (const Session*)context;
+
+    LineIndex* index = line_index_create();
+    bool ok = index != NULL;
+
+    for (size_t i = 0; i < session->count && ok; i++) {
+        const EditTraceRecord* r = &session->records[i].record;
+        if (r->type == EDIT_TRACE_SET) {
+            line_index_destroy(index);
+            index = line_index_create();
+            ok = index != NULL && (r->length == 0 || line_index_append(index, r->text, r->length));
+        } else if (r->type == EDIT_TRACE_INSERT) {
+            ok = line_index_insert(index, (size_t)r->offset, r->text, r->length);
+        } else if (r->type == EDIT_TRACE_DELETE) {
+            ok = line_index_delete(index, (size_t)r->offset, r->length);
+        }
+    }
+
+    line_index_destroy(index);
+    return ok;
+}
+
+static void apply_nothing(const HistoryChange* change, void* user_data) {
+    (void)change;
+    (void)user_data;
+}
+
+/**
+ * @brief Replays a session's undo steps on a history, as the main window records them
+ *
+ * Edits made by undo and redo are not recorded again; the undo and redo
+ * records step the history instead.
+ */
+static bool op_replay_history(void* context) {
+    const Session* session = (const Session*)context;
+
+    History* history = history_create(SESSION_HISTORY_BUDGET);
+    if (!history) {
+        return false;
+    }
+
+    for (size_t i = 0; i < session->count; i++) {
+        const EditTraceRecord* r = &session->records[i].record;
+        if (r->type == EDIT_TRACE_SET) {
+            history_clear(history);
+        } else if (r->type == EDIT_TRACE_BEGIN_GROUP) {
+            history_begin_group(history);
+        } else if (r->type == EDIT_TRACE_END_GROUP) {
+            history_end_group(history);
+        } else if (r->type == EDIT_TRACE_UNDO) {
+            history_undo(history, apply_nothing, NULL);
+        } else if (r->type == EDIT_TRACE_REDO) {
+            history_redo(history, apply_nothing, NULL);
+        } else if (r->from_history) {
+            continue;
+        } else if (r->type == EDIT_TRACE_INSERT) {
+            HistoryChange change = { (size_t)r->offset, NULL, 0, 0, r->text, r->length, r->length };
+            history_record(history, &change);
+        } else if (r->length > SESSION_HISTORY_BUDGET) {
+            history_discard(history);
+        } else {
+            HistoryChange change = { (size_t)r->offset, r->text, r->length, r->length, NULL, 0, 0 };
+            history_record(history, &change);
+        }
+    }
+
+    history_destroy(history);
+    return true;
+}
+
+static bool write_file(const char* path, const char* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0) {
+        written = false;
+    }
+
+    return written;
+}
+
+/**
+ * @brief Reads a whole file with stdio, independently of file_operations
+ * @return Heap copy of the bytes, or NULL if the file cannot be read
+ */
+static char* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    char* data = (char*)malloc(capacity);
+    while (data) {
+        length += fread(data + length, 1, capacity - length, file);
+        if (length < capacity) {
+            break;
+        }
+        char* grown = (char*)realloc(data, capacity * 2);
+        if (!grown) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        capacity *= 2;
+    }
+
+    if (data && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = length;
+    return data;
+}
+
+static bool same_bytes(const char* a, size_t a_length, const char* b, size_t b_length) {
+    return a_length == b_length && (a_length == 0 || memcmp(a, b, a_length) == 0);
+}
+
+/**
+ * @brief Checks one binary fixture against what it must decode to
+ * @return NULL on success, or what went wrong
+ */
+static const char* check_fixture(const char* path, const char* expected, size_t expected_length,
+                                 const char* output_path) {
+    char* content;
+    size_t length;
+    if (file_operations_read_data(path, &content, &length) != FILE_OP_SUCCESS) {
+        return "file_operations_read_data() failed";
+    }
+    bool decoded = same_bytes(content, length, expected, expected_length);
+    free(content);
+    if (!decoded) {
+        return "read bytes differ from the expected text";
+    }
+
+    if (file_operations_write_data(output_path, expected, expected_length) != FILE_OP_SUCCESS ||
+        file_operations_read_data(output_path, &content, &length) != FILE_OP_SUCCESS) {
+        return "write and read back failed";
+    }
+    bool round_trip = same_bytes(content, length, expected, expected_length);
+    free(content);
+    if (!round_trip) {
+        return "bytes changed in a write and read back";
+    }
+
+    Document* doc = document_create();
+    if (!doc) {
+        return "cannot create a document";
+    }
+
+    const char* failure = NULL;
+    FileOperationResult result = file_operations_read(path, doc);
+    if (memchr(expected, '\0', expected_length)) {
+        if (result != FILE_OP_ERROR_NUL_BYTES || document_get_length(doc) != 0) {
+            failure = "a document took text with NUL bytes";
+        }
+    } else if (result != FILE_OP_SUCCESS ||
+               !same_bytes(document_get_content(doc), document_get_length(doc), expected, expected_length)) {
+        failure = "file_operations_read() differs from the expected text";
+    } else if (file_operations_write(output_path, doc) != FILE_OP_SUCCESS) {
+        failure = "file_operations_write() failed";
+    } else {
+        char* written = read_file(output_path, &length);
+        if (!written || !same_bytes(written, length, expected, expected_length)) {
+            failure = "file_operations_write() wrote different bytes";
+        }
+        free(written);
+    }
+
+    document_destroy(doc);
+    return failure;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @brief Checks every *.bin fixture in a directory, in name order
+ */
+static void run_fixtures(Bench* bench, const char* fixture_directory, const char* directory) {
+    DIR* dir = opendir(fixture_directory);
+    if (!dir) {
+        printf("fixtures: cannot open %s: %s\n", fixture_directory, strerror(errno));
+        bench->failures++;
+        return;
+    }
+
+    char** names = NULL;
+    size_t count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        size_t length = strlen(entry->d_name);
+        if (length <= 4 || strcmp(entry->d_name + length - 4, ".bin") != 0) {
+            continue;
+        }
+        char** grown = (char**)realloc(names, (count + 1) * sizeof(char*));
+        if (grown) {
+            names = grown;
+        }
+        char* name = grown ? (char*)malloc(length + 1) : NULL;
+        if (!name) {
+            printf("fixtures: out of memory\n");
+            bench->failures++;
+            break;
+        }
+        memcpy(name, entry->d_name, length + 1);
+        names[count++] = name;
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(char*), compare_names);
+
+    char output_path[1024];
+    snprintf(output_path, sizeof(output_path), "%s/fixture.out", directory);
+
+    for (size_t i = 0; i < count; i++) {
+        char path[1024];
+        char expected_path[1024];
+        snprintf(path, sizeof(path), "%s/%s", fixture_directory, names[i]);
+        snprintf(expected_path, sizeof(expected_path), "%s/%.*s.utf8", fixture_directory,
+                 (int)(strlen(names[i]) - 4), names[i]);
+
+        size_t expected_length;
+        char* expected = read_file(expected_path, &expected_length);
+        if (!expected) {
+            expected = read_file(path, &expected_length);
+        }
+
+        const char* failure = expected ? check_fixture(path, expected, expected_length, output_path)
+                                       : "cannot read the fixture";
+        if (failure) {
+            printf("fixture/%-28s FAILED: %s\n", names[i], failure);
+            bench->failures++;
+        } else {
+            printf("fixture/%-28s ok\n", names[i]);
+        }
+
+        free(expected);
+        free(names[i]);
+    }
+
+    free(names);
+    unlink(output_path);
+}
+
+/**
+ * @brief Runs the per-corpus benchmarks on one shape and size
+ */
+static void run_corpus(Bench* bench, const char* directory, CorpusShape shape, size_t size) {
+    char size_text[24];
+    format_size(size, size_text, sizeof(size_text));
+    const char* shape_name = corpus_get_shape_name(shape);
+
+    char input_path[1024];
+    char output_path[1024];
+    snprintf(input_path, sizeof(input_path), "%s/%s-%s.txt", directory, shape_name, size_text);
+    snprintf(output_path, sizeof(output_path), "%s/out.txt", directory);
+
+    char* data = corpus_generate(shape, size, CORPUS_SEED);
+    if (!data || !write_file(input_path, data, size)) {
+        printf("%s/%s: cannot generate the corpus\n", shape_name, size_text);
+        bench->failures++;
+        free(data);
+        return;
+    }
+
+    BenchContext context = { data, size, input_path, output_path, clipboard_operations_create(),
+                             clipboard_data_create_adopt(data, size, NULL, NULL), NULL };
+    char name[BENCH_NAME_MAX];
+
+    snprintf(name, sizeof(name), "read/%s/%s", shape_name, size_text);
+    run_benchmark(bench, name, size, op_read, &context);
+
+    snprintf(name, sizeof(name), "write/%s/%s", shape_name, size_text);
+    run_benchmark(bench, name, size, op_write, &context);
+
+    snprintf(name, sizeof(name), "round-trip/%s/%s", shape_name, size_text);
+    run_benchmark(bench, name, size, op_round_trip, &context);
+
+    if (context.clipboard) {
+        snprintf(name, sizeof(name), "clipboard/%s/%s", shape_name, size_text);
+        run_benchmark(bench, name, size, op_clipboard, &context);
+    }
+
+    if (context.clipboard && context.shared) {
+        snprintf(name, sizeof(name), "clipboard-shared/%s/%s", shape_name, size_text);
+        run_benchmark(bench, name, size, op_clipboard_shared, &context);
+    }
+
+    clipboard_operations_destroy(context.clipboard);
+    clipboard_data_unref(context.shared);
+    unlink(output_path);
+    unlink(input_path);
+    free(data);
+}
+
+/**
+ * @brief Replays one session against every target
+ */
+static void run_session(Bench* bench, const char* session_name, const char* path) {
+    Session* session = session_load(path);
+    if (!session) {
+        printf("replay/%s: cannot read the edit trace %s\n", session_name, path);
+        bench->failures++;
+        return;
+    }
+
+    if (session->damaged) {
+        printf("replay/%s: the trace ends in a damaged record; replaying the %zu before it\n",
+               session_name, session->count);
+    }
+
+    static const struct {
+        const char* name;
+        BenchOp op;
+    } targets[] = {
+        { "piece-table", op_replay_piece_table },
+        { "line-index", op_replay_line_index },
+        { "history", op_replay_history }
+    };
+
+    char name[BENCH_NAME_MAX];
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        snprintf(name, sizeof(name), "replay/%s/%s", session_name, targets[i].name);
+        run_benchmark(bench, name, session->edit_bytes, targets[i].op, session);
+    }
+
+    session_free(session);
+}
+
+/**
+ * @brief Replays the generated sessions, then those given with --session=FILE
+ */
+static void run_sessions(Bench* bench, const char* directory, int argc, char* argv[]) {
+    char path[1024];
+    for (int kind = 0; kind < SESSION_KIND_COUNT; kind++) {
+        const char* kind_name = session_get_kind_name((SessionKind)kind);
+        snprintf(path, sizeof(path), "%s/%s.trace", directory, kind_name);
+
+        if (!session_generate((SessionKind)kind, path)) {
+            printf("replay/%s: cannot generate the session\n", kind_name);
+            bench->failures++;
+        } else {
+            run_session(bench, kind_name, path);
+        }
+        unlink(path);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--session=", 10) != 0) {
+            continue;
+        }
+
+        /* Named after the file, without its directory and extension */
+        const char* session_path = argv[i] + 10;
+        const char* base = strrchr(session_path, '/');
+        base = base ? base + 1 : session_path;
+        char session_name[64];
+        snprintf(session_name, sizeof(session_name), "%.*s", (int)strcspn(base, "."), base);
+
+        run_session(bench, session_name, session_path);
+    }
+}
+
+static void run_theme_benchmarks(Bench* bench) {
+    BenchContext context = { 0 };
+    context.themes = theme_manager_create(THEME_DARK);
+    if (!context.themes) {
+        printf("theme: cannot create the theme manager\n");
+        bench->failures++;
+        return;
+    }
+
+    run_benchmark(bench, "theme/toggle", 0, op_theme_toggle, &context);
+    run_benchmark(bench, "theme/create", 0, op_theme_create, &context);
+
+    theme_manager_destroy(context.themes);
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --max-size=SIZE         Largest corpus (e.g. 64K, 16M, 2G; default 16M)\n"
+            "  --filter=TEXT           Only run benchmarks whose name contains TEXT\n"
+            "  --baseline=FILE         Compare against stored results\n"
+            "  --tolerance=PERCENT     Slowdown that counts as a regression (default 20)\n"
+            "  --write-baseline=FILE   Store this run's results\n"
+            "  --session=FILE          Also replay a recorded edit trace (repeatable)\n"
+            "  --fixtures=DIR          Check the binary fixtures in DIR first\n",
+            program);
+}
+
+int main(int argc, char* argv[]) {
+    Bench bench = { DEFAULT_MAX_SIZE, NULL, DEFAULT_TOLERANCE, NULL, 0, NULL, 0, 0 };
+    const char* baseline_path = NULL;
+    const char* output_path = NULL;
+    const char* fixture_directory = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--max-size=", 11) == 0) {
+            if (!parse_size(arg + 11, &bench.max_size)) {
+                print_usage(argv[0]);
+                return 2;
+            }
+        } else if (strncmp(arg, "--filter=", 9) == 0) {
+            bench.filter = arg + 9;
+        } else if (strncmp(arg, "--baseline=", 11) == 0) {
+            baseline_path = arg + 11;
+        } else if (strncmp(arg, "--tolerance=", 12) == 0) {
+            bench.tolerance = strtod(arg + 12, NULL);
+        } else if (strncmp(arg, "--write-baseline=", 17) == 0) {
+            output_path = arg + 17;
+        } else if (strncmp(arg, "--fixtures=", 11) == 0) {
+            fixture_directory = arg + 11;
+        } else if (strncmp(arg, "--session=", 10) == 0) {
+            /* Replayed after the generated sessions */
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (baseline_path && !load_baseline(&bench, baseline_path)) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "Cannot read the baseline %s: %s\n", baseline_path, strerror(errno));
+            return 2;
+        }
+        printf("No baseline at %s; results are not compared (make bench-baseline stores one)\n\n",
+               baseline_path);
+    }
+
+    if (output_path) {
+        bench.baseline_output = fopen(output_path, "w");
+        if (!bench.baseline_output) {
+            fprintf(stderr, "Cannot write %s: %s\n", output_path, strerror(errno));
+            return 2;
+        }
+        fprintf(bench.baseline_output, "# Benchmark baseline: name ns/op (written by make bench-baseline)\n");
+    }
+
+    const char* temp = getenv("TMPDIR");
+    char directory[512];
+    snprintf(directory, sizeof(directory), "%s/notebook-bench-XXXXXX", temp && *temp ? temp : "/tmp");
+    if (!mkdtemp(directory)) {
+        fprintf(stderr, "Cannot create a directory in %s: %s\n", temp && *temp ? temp : "/tmp", strerror(errno));
+        return 2;
+    }
+
+    if (fixture_directory) {
+        run_fixtures(&bench, fixture_directory, directory);
+        printf("\n");
+    }
+
+    printf("%-36s %14s %10s %10s %10s\n", "benchmark", "ns/op", "MiB/s", "allocs/op", "peak MiB");
+
+    for (size_t s = 0; s < sizeof(corpus_sizes) / sizeof(corpus_sizes[0]); s++) {
+        if (corpus_sizes[s] > bench.max_size) {
+            break;
+        }
+        for (int shape = 0; shape < CORPUS_SHAPE_COUNT; shape++) {
+            run_corpus(&bench, directory, (CorpusShape)shape, corpus_sizes[s]);
+        }
+    }
+
+    run_sessions(&bench, directory, argc, argv);
+    run_theme_benchmarks(&bench);
+
+    rmdir(directory);
+    free(bench.baseline);
+    if (bench.baseline_output && fclose(bench.baseline_output) != 0) {
+        fprintf(stderr, "Cannot write %s\n", output_path);
+        bench.failures++;
+    }
+
+    if (bench.failures > 0 || bench.regressions > 0) {
+        printf("\nFAIL: %zu benchmark(s) regressed by more than %.0f%%, %zu failed\n",
+               bench.regressions, bench.tolerance, bench.failures);
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
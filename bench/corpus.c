@@ -0,0 +1,157 @@
+#include "corpus.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Line length of CORPUS_LONG_LINES
+ */
+#define LONG_LINE_LENGTH ((size_t)4 * 1024 * 1024)
+
+/**
+ * @brief One word in this many is followed by a NUL in CORPUS_EMBEDDED_NUL
+ */
+#define NUL_INTERVAL 16
+
+static const char* const ascii_words[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "editor",
+    "buffer", "line", "piece", "table", "search", "replace", "theme", "window",
+    "a", "of", "and", "to", "in", "is", "it", "that", "for", "on", "with",
+    "performance", "latency", "throughput", "allocation", "benchmark", "notebook"
+};
+
+static const char* const unicode_words[] = {
+    "naïve", "café", "Grüße", "façade", "smörgåsbord", "ελληνικά", "λόγος",
+    "текст", "редактор", "日本語", "文字列", "편집기", "مرحبا", "שלום",
+    "😀", "🚀", "∑∫√", "plain", "ascii", "mixed"
+};
+
+static const char* const shape_names[CORPUS_SHAPE_COUNT] = {
+    [CORPUS_PROSE] = "prose",
+    [CORPUS_LONG_LINES] = "long-lines",
+    [CORPUS_SHORT_LINES] = "short-lines",
+    [CORPUS_UNICODE] = "unicode",
+    [CORPUS_EMBEDDED_NUL] = "nul"
+};
+
+/**
+ * @brief Generation state
+ */
+typedef struct {
+    char* data;
+    size_t size;
+    size_t length;
+    size_t line_length;
+    uint64_t state;
+} Corpus;
+
+static uint64_t next_random(Corpus* corpus) {
+    /* xorshift64: fast, and identical everywhere */
+    uint64_t x = corpus->state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    corpus->state = x;
+    return x;
+}
+
+/**
+ * @brief Appends a token if it fits whole
+ * @return false once the corpus is full
+ */
+static bool append(Corpus* corpus, const char* token, size_t length) {
+    if (length > corpus->size - corpus->length) {
+        return false;
+    }
+
+    memcpy(corpus->data + corpus->length, token, length);
+    corpus->length += length;
+    corpus->line_length += length;
+    return true;
+}
+
+static bool append_newline(Corpus* corpus) {
+    if (!append(corpus, "\n", 1)) {
+        return false;
+    }
+
+    corpus->line_length = 0;
+    return true;
+}
+
+/**
+ * @brief Appends words, breaking lines after line_limit bytes
+ */
+static void fill_words(Corpus* corpus, const char* const* words, size_t word_count,
+                       size_t min_line, size_t max_line, bool nul_separators) {
+    size_t line_limit = min_line + (size_t)(next_random(corpus) % (max_line - min_line + 1));
+
+    for (;;) {
+        const char* word = words[next_random(corpus) % word_count];
+        if (!append(corpus, word, strlen(word))) {
+            return;
+        }
+
+        if (corpus->line_length >= line_limit) {
+            if (!append_newline(corpus)) {
+                return;
+            }
+            line_limit = min_line + (size_t)(next_random(corpus) % (max_line - min_line + 1));
+            continue;
+        }
+
+        bool nul = nul_separators && next_random(corpus) % NUL_INTERVAL == 0;
+        if (!append(corpus, nul ? "\0" : " ", 1)) {
+            return;
+        }
+    }
+}
+
+static void fill_short_lines(Corpus* corpus) {
+    char line[9];
+
+    for (;;) {
+        size_t length = (size_t)(next_random(corpus) % 9);
+        for (size_t i = 0; i < length; i++) {
+            line[i] = (char)('a' + next_random(corpus) % 26);
+        }
+        if (!append(corpus, line, length) || !append_newline(corpus)) {
+            return;
+        }
+    }
+}
+
+const char* corpus_get_shape_name(CorpusShape shape) {
+    return (unsigned int)shape < CORPUS_SHAPE_COUNT ? shape_names[shape] : NULL;
+}
+
+char* corpus_generate(CorpusShape shape, size_t size, uint64_t seed) {
+    if ((unsigned int)shape >= CORPUS_SHAPE_COUNT || size == SIZE_MAX) {
+        return NULL;
+    }
+
+    Corpus corpus = { NULL, size, 0, 0, seed ? seed : 1 };
+    corpus.data = (char*)malloc(size + 1);
+    if (!corpus.data) {
+        return NULL;
+    }
+
+    size_t ascii_count = sizeof(ascii_words) / sizeof(ascii_words[0]);
+    size_t unicode_count = sizeof(unicode_words) / sizeof(unicode_words[0]);
+
+    if (shape == CORPUS_SHORT_LINES) {
+        fill_short_lines(&corpus);
+    } else if (shape == CORPUS_LONG_LINES) {
+        fill_words(&corpus, ascii_words, ascii_count, LONG_LINE_LENGTH, LONG_LINE_LENGTH, false);
+    } else if (shape == CORPUS_UNICODE) {
+        fill_words(&corpus, unicode_words, unicode_count, 40, 80, false);
+    } else {
+        fill_words(&corpus, ascii_words, ascii_count, 60, 100, shape == CORPUS_EMBEDDED_NUL);
+    }
+
+    /* Whatever did not fit a whole token */
+    memset(corpus.data + corpus.length, ' ', size - corpus.length);
+    corpus.data[size] = '\0';
+
+    return corpus.data;
+}
\ No newline at end of file
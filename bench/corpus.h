@@ -0,0 +1,47 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file corpus.h
+ * @brief Deterministic generated text for the benchmarks
+ *
+ * The same shape, size and seed always produce the same bytes, so runs on
+ * different days (and the stored baseline) measure the same input.
+ */
+
+/**
+ * @brief Kinds of text a corpus can hold
+ */
+typedef enum {
+    CORPUS_PROSE = 0,        /* ASCII words, lines of 60-100 bytes */
+    CORPUS_LONG_LINES,       /* ASCII words, a newline every 4 MiB */
+    CORPUS_SHORT_LINES,      /* Lines of 0-8 bytes */
+    CORPUS_UNICODE,          /* Multi-byte UTF-8 words (Latin, Greek, Cyrillic, CJK, emoji) */
+    CORPUS_EMBEDDED_NUL,     /* Prose with NUL bytes between some words */
+    CORPUS_SHAPE_COUNT
+} CorpusShape;
+
+/**
+ * @brief Gets a shape's name as used in benchmark names
+ * @param shape Shape identifier
+ * @return Static name, or NULL for an unknown shape
+ */
+const char* corpus_get_shape_name(CorpusShape shape);
+
+/**
+ * @brief Generates a corpus
+ * @param shape Kind of text
+ * @param size Exact number of bytes
+ * @param seed Seed for the word choices
+ * @return Newly allocated buffer of size + 1 bytes, NUL-terminated at
+ *         [size] (caller must free), or NULL on failure
+ *
+ * Multi-byte characters are never cut at the end; the tail is padded with
+ * spaces instead.
+ */
+char* corpus_generate(CorpusShape shape, size_t size, uint64_t seed);
+
+#endif /* CORPUS_H */
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "session.h"
+#include "corpus.h"
+#include "core/piece_table.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Seed of every generated session, so runs are comparable
+ */
+#define SESSION_SEED UINT64_C(0x2545f4914f6cdd1d)
+
+#define TYPING_BASE_SIZE ((size_t)1024 * 1024)
+#define TYPING_BURSTS 1000
+#define PASTE_BASE_SIZE ((size_t)1024 * 1024)
+#define PASTE_SIZE ((size_t)256 * 1024)
+#define PASTE_COUNT 50
+#define PASTE_MAX_SELECTION 4096
+#define REPLACE_BASE_SIZE ((size_t)4 * 1024 * 1024)
+#define UNDO_BASE_SIZE ((size_t)64 * 1024)
+#define UNDO_EDITS 2000
+
+static const char* const kind_names[SESSION_KIND_COUNT] = {
+    [SESSION_TYPING] = "typing",
+    [SESSION_PASTE] = "paste",
+    [SESSION_REPLACE_ALL] = "replace-all",
+    [SESSION_UNDO_STORM] = "undo-storm"
+};
+
+static const char* const typed_words[] = {
+    "the", "buffer", "keeps", "up", "with", "every", "keystroke", "while", "we", "type", "notes"
+};
+
+/**
+ * @brief Generation state: the trace being written and the text it describes
+ */
+typedef struct {
+    EditTraceWriter* writer;
+    PieceTable* text;
+    uint64_t state;
+    bool ok;
+} Generator;
+
+static uint64_t next_random(Generator* generator) {
+    /* xorshift64, as in corpus.c */
+    uint64_t x = generator->state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    generator->state = x;
+    return x;
+}
+
+static size_t random_offset(Generator* generator) {
+    return (size_t)(next_random(generator) % (piece_table_get_length(generator->text) + 1));
+}
+
+static const char* random_word(Generator* generator) {
+    return typed_words[next_random(generator) % (sizeof(typed_words) / sizeof(typed_words[0]))];
+}
+
+static void mark(Generator* generator, EditTraceType type) {
+    if (generator->ok) {
+        generator->ok = edit_trace_writer_append(generator->writer, type, 0, NULL, 0, false);
+    }
+}
+
+static void insert_text(Generator* generator, size_t offset, const char* text, size_t length, bool from_history) {
+    if (generator->ok) {
+        generator->ok = edit_trace_writer_append(generator->writer, EDIT_TRACE_INSERT, offset,
+                                                 text, length, from_history) &&
+                        piece_table_insert(generator->text, offset, text, length);
+    }
+}
+
+static void delete_range(Generator* generator, size_t offset, size_t length, bool from_history) {
+    if (!generator->ok) {
+        return;
+    }
+
+    char* removed = (char*)malloc(length > 0 ? length : 1);
+    generator->ok = removed != NULL &&
+                    piece_table_copy_range(generator->text, offset, length, removed) == length &&
+                    edit_trace_writer_append(generator->writer, EDIT_TRACE_DELETE, offset,
+                                             removed, length, from_history) &&
+                    piece_table_delete(generator->text, offset, length);
+    free(removed);
+}
+
+/**
+ * @brief Types a character, as one user action
+ */
+static void type_character(Generator* generator, size_t offset, char c) {
+    mark(generator, EDIT_TRACE_BEGIN_GROUP);
+    insert_text(generator, offset, &c, 1, false);
+    mark(generator, EDIT_TRACE_END_GROUP);
+}
+
+static void generate_typing(Generator* generator) {
+    for (int burst = 0; burst < TYPING_BURSTS && generator->ok; burst++) {
+        size_t cursor = random_offset(generator);
+
+        int words = 1 + (int)(next_random(generator) % 4);
+        for (int w = 0; w < words; w++) {
+            const char* word = random_word(generator);
+            for (size_t i = 0; word[i]; i++) {
+                type_character(generator, cursor++, word[i]);
+            }
+            type_character(generator, cursor++, ' ');
+        }
+
+        /* Now and then, a few Backspaces */
+        if (next_random(generator) % 4 == 0) {
+            int presses = 1 + (int)(next_random(generator) % 5);
+            for (int i = 0; i < presses && cursor > 0; i++) {
+                mark(generator, EDIT_TRACE_BEGIN_GROUP);
+                delete_range(generator, --cursor, 1, false);
+                mark(generator, EDIT_TRACE_END_GROUP);
+            }
+        }
+    }
+}
+
+static void generate_paste(Generator* generator) {
+    char* clipboard = corpus_generate(CORPUS_PROSE, PASTE_SIZE, SESSION_SEED + 1);
+    if (!clipboard) {
+        generator->ok = false;
+        return;
+    }
+
+    for (int i = 0; i < PASTE_COUNT && generator->ok; i++) {
+        size_t offset = random_offset(generator);
+        size_t available = piece_table_get_length(generator->text) - offset;
+        size_t selection = (size_t)(next_random(generator) % (PASTE_MAX_SELECTION + 1));
+        if (selection > available) {
+            selection = available;
+        }
+
+        mark(generator, EDIT_TRACE_BEGIN_GROUP);
+        delete_range(generator, offset, selection, false);
+        insert_text(generator, offset, clipboard, PASTE_SIZE, false);
+        mark(generator, EDIT_TRACE_END_GROUP);
+    }
+
+    free(clipboard);
+}
+
+/**
+ * @brief Replaces every " the " with " those ", front to back, as one action
+ */
+static void generate_replace_all(Generator* generator, const char* base) {
+    static const char pattern[] = " the ";
+    static const char replacement[] = "those";
+    const size_t word_length = 3;
+
+    mark(generator, EDIT_TRACE_BEGIN_GROUP);
+
+    size_t shift = 0;
+    for (const char* match = strstr(base, pattern); match && generator->ok;
+         match = strstr(match + sizeof(pattern) - 2, pattern)) {
+        size_t offset = (size_t)(match - base) + 1 + shift;
+        delete_range(generator, offset, word_length, false);
+        insert_text(generator, offset, replacement, sizeof(replacement) - 1, false);
+        shift += sizeof(replacement) - 1 - word_length;
+    }
+
+    mark(generator, EDIT_TRACE_END_GROUP);
+}
+
+/**
+ * @brief Makes UNDO_EDITS scattered insertions, undoes them all, redoes them all
+ */
+static void generate_undo_storm(Generator* generator) {
+    size_t* offsets = (size_t*)malloc(UNDO_EDITS * sizeof(size_t));
+    const char** words = (const char**)malloc(UNDO_EDITS * sizeof(const char*));
+    if (!offsets || !words) {
+        free(offsets);
+        free(words);
+        generator->ok = false;
+        return;
+    }
+
+    for (int i = 0; i < UNDO_EDITS; i++) {
+        offsets[i] = random_offset(generator);
+        words[i] = random_word(generator);
+        mark(generator, EDIT_TRACE_BEGIN_GROUP);
+        insert_text(generator, offsets[i], words[i], strlen(words[i]), false);
+        mark(generator, EDIT_TRACE_END_GROUP);
+    }
+
+    for (int i = UNDO_EDITS - 1; i >= 0; i--) {
+        mark(generator, EDIT_TRACE_UNDO);
+        delete_range(generator, offsets[i], strlen(words[i]), true);
+    }
+
+    for (int i = 0; i < UNDO_EDITS; i++) {
+        mark(generator, EDIT_TRACE_REDO);
+        insert_text(generator, offsets[i], words[i], strlen(words[i]), true);
+    }
+
+    free(offsets);
+    free(words);
+}
+
+const char* session_get_kind_name(SessionKind kind) {
+    return (unsigned int)kind < SESSION_KIND_COUNT ? kind_names[kind] : NULL;
+}
+
+bool session_generate(SessionKind kind, const char* path) {
+    if ((unsigned int)kind >= SESSION_KIND_COUNT) {
+        return false;
+    }
+
+    size_t base_size = TYPING_BASE_SIZE;
+    if (kind == SESSION_PASTE) {
+        base_size = PASTE_BASE_SIZE;
+    } else if (kind == SESSION_REPLACE_ALL) {
+        base_size = REPLACE_BASE_SIZE;
+    } else if (kind == SESSION_UNDO_STORM) {
+        base_size = UNDO_BASE_SIZE;
+    }
+
+    char* base = corpus_generate(CORPUS_PROSE, base_size, SESSION_SEED);
+    if (!base) {
+        return false;
+    }
+
+    Generator generator = { edit_trace_writer_open(path), piece_table_create(base, base_size),
+                            SESSION_SEED, true };
+    generator.ok = generator.writer && generator.text &&
+                   edit_trace_writer_append(generator.writer, EDIT_TRACE_SET, 0, base, base_size, false);
+
+    if (kind == SESSION_TYPING) {
+        generate_typing(&generator);
+    } else if (kind == SESSION_PASTE) {
+        generate_paste(&generator);
+    } else if (kind == SESSION_REPLACE_ALL) {
+        generate_replace_all(&generator, base);
+    } else {
+        generate_undo_storm(&generator);
+    }
+
+    bool written = generator.writer && edit_trace_writer_close(generator.writer);
+    piece_table_destroy(generator.text);
+    free(base);
+
+    return generator.ok && written;
+}
+
+Session* session_load(const char* path) {
+    Session* session = (Session*)calloc(1, sizeof(Session));
+    if (!session) {
+        return NULL;
+    }
+
+    session->reader = edit_trace_reader_open(path);
+    if (!session->reader) {
+        free(session);
+        return NULL;
+    }
+
+    size_t capacity = 0;
+    EditTraceRecord record;
+    while (edit_trace_reader_next(session->reader, &record)) {
+        if (session->count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            SessionRecord* records = (SessionRecord*)realloc(session->records, capacity * sizeof(SessionRecord));
+            if (!records) {
+                session_free(session);
+                return NULL;
+            }
+            session->records = records;
+        }
+
+        session->records[session->count++].record = record;
+
+        if (record.type == EDIT_TRACE_INSERT || record.type == EDIT_TRACE_DELETE) {
+            session->edit_bytes += record.length;
+        }
+    }
+
+    session->damaged = edit_trace_reader_is_damaged(session->reader);
+    return session;
+}
+
+void session_free(Session* session) {
+    if (!session) {
+        return;
+    }
+
+    free(session->records);
+    edit_trace_reader_close(session->reader);
+    free(session);
+}
\ No newline at end of file
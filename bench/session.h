@@ -0,0 +1,76 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "io/edit_trace.h"
+
+/**
+ * @file session.h
+ * @brief Editing sessions for the replay benchmarks
+ *
+ * A session is an edit trace (see io/edit_trace.h) decoded into memory, so
+ * replaying it measures the data structures and not the decoding. Traces
+ * come from `notebook --record-edits=FILE` or are generated here, one per
+ * workload the editor has to keep up with.
+ */
+
+/**
+ * @brief Generated workloads
+ */
+typedef enum {
+    SESSION_TYPING = 0,    /* Bursts of typing and backspacing at scattered places in 1 MiB */
+    SESSION_PASTE,         /* 256 KiB pastes over selections in 1 MiB */
+    SESSION_REPLACE_ALL,   /* One Replace All of a common word in 4 MiB */
+    SESSION_UNDO_STORM,    /* 2000 edits, then every one undone and redone */
+    SESSION_KIND_COUNT
+} SessionKind;
+
+/**
+ * @brief One decoded record
+ */
+typedef struct {
+    EditTraceRecord record;
+} SessionRecord;
+
+/**
+ * @brief A decoded session
+ */
+typedef struct {
+    EditTraceReader* reader;  /* Record text points into its mapping */
+    SessionRecord* records;
+    size_t count;
+    size_t edit_bytes;        /* Bytes inserted plus bytes deleted */
+    bool damaged;             /* The trace ended in a damaged record */
+} Session;
+
+/**
+ * @brief Gets a generated workload's name as used in benchmark names
+ * @param kind Workload
+ * @return Static name, or NULL for an unknown workload
+ */
+const char* session_get_kind_name(SessionKind kind);
+
+/**
+ * @brief Writes a generated session as an edit trace
+ * @param kind Workload
+ * @param path Trace file to create
+ * @return true on success
+ */
+bool session_generate(SessionKind kind, const char* path);
+
+/**
+ * @brief Reads and decodes an edit trace
+ * @param path Trace file
+ * @return Newly allocated session (free with session_free), or NULL if the
+ *         file is not a readable edit trace
+ */
+Session* session_load(const char* path);
+
+/**
+ * @brief Frees a session
+ * @param session Session to free
+ */
+void session_free(Session* session);
+
+#endif /* SESSION_H */
\ No newline at end of file
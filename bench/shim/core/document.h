@@ -0,0 +1,30 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file document.h
+ * @brief BENCH SHIM - stand-in for the Document module
+ *
+ * core/document.c and core/document.h are not part of this source tree,
+ * but io/file_operations.h includes this header. The harness builds
+ * against this minimal C-string Document so file operations link; it is
+ * never benchmarked, and its timings say nothing about the real module.
+ */
+
+typedef struct Document Document;
+
+Document* document_create(void);
+void document_destroy(Document* doc);
+bool document_set_content(Document* doc, const char* content);
+const char* document_get_content(const Document* doc);
+size_t document_get_length(const Document* doc);
+bool document_set_file_path(Document* doc, const char* path);
+const char* document_get_file_path(const Document* doc);
+bool document_is_modified(const Document* doc);
+void document_mark_modified(Document* doc);
+void document_mark_saved(Document* doc);
+
+#endif /* DOCUMENT_H */
@@ -0,0 +1,104 @@
+#include "core/document.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * BENCH SHIM - see shim/core/document.h. Only what file_operations.c
+ * needs to link; not the editor's Document.
+ */
+
+struct Document {
+    char* content;
+    size_t length;
+    char* file_path;
+    bool modified;
+};
+
+/**
+ * @brief Copies a C string (strdup() is not in C11)
+ */
+static char* copy_string(const char* text) {
+    size_t length = strlen(text) + 1;
+    char* copy = (char*)malloc(length);
+    if (copy) {
+        memcpy(copy, text, length);
+    }
+    return copy;
+}
+
+Document* document_create(void) {
+    Document* doc = (Document*)calloc(1, sizeof(Document));
+    if (!doc) {
+        return NULL;
+    }
+
+    doc->content = copy_string("");
+    if (!doc->content) {
+        free(doc);
+        return NULL;
+    }
+    return doc;
+}
+
+void document_destroy(Document* doc) {
+    if (!doc) {
+        return;
+    }
+
+    free(doc->content);
+    free(doc->file_path);
+    free(doc);
+}
+
+bool document_set_content(Document* doc, const char* content) {
+    char* copy = copy_string(content ? content : "");
+    if (!doc || !copy) {
+        free(copy);
+        return false;
+    }
+
+    free(doc->content);
+    doc->content = copy;
+    doc->length = strlen(copy);
+    return true;
+}
+
+const char* document_get_content(const Document* doc) {
+    return doc ? doc->content : NULL;
+}
+
+size_t document_get_length(const Document* doc) {
+    return doc ? doc->length : 0;
+}
+
+bool document_set_file_path(Document* doc, const char* path) {
+    char* copy = path ? copy_string(path) : NULL;
+    if (!doc || (path && !copy)) {
+        free(copy);
+        return false;
+    }
+
+    free(doc->file_path);
+    doc->file_path = copy;
+    return true;
+}
+
+const char* document_get_file_path(const Document* doc) {
+    return doc ? doc->file_path : NULL;
+}
+
+bool document_is_modified(const Document* doc) {
+    return doc && doc->modified;
+}
+
+void document_mark_modified(Document* doc) {
+    if (doc) {
+        doc->modified = true;
+    }
+}
+
+void document_mark_saved(Document* doc) {
+    if (doc) {
+        doc->modified = false;
+    }
+}
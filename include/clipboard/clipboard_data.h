@@ -0,0 +1,70 @@
+#ifndef CLIPBOARD_DATA_H
+#define CLIPBOARD_DATA_H
+
+#include <stddef.h>
+
+/**
+ * @file clipboard_data.h
+ * @brief Immutable, reference-counted clipboard content
+ *
+ * Copied text is held once and shared by everything that offers it - the
+ * internal clipboard and the system clipboard - instead of each keeping
+ * its own copy. References can be taken and dropped from any thread; the
+ * bytes never change after creation.
+ */
+
+typedef struct ClipboardData ClipboardData;
+
+/**
+ * @brief Releases an adopted buffer
+ * @param data The buffer passed to clipboard_data_create_adopt()
+ * @param length Its length in bytes
+ * @param user_data User-provided data
+ */
+typedef void (*ClipboardDataRelease)(const char* data, size_t length, void* user_data);
+
+/**
+ * @brief Creates clipboard content holding a copy of the given bytes
+ * @param data Bytes to copy (may be NULL if length is 0)
+ * @param length Number of bytes
+ * @return Content with one reference, or NULL on failure
+ */
+ClipboardData* clipboard_data_create(const char* data, size_t length);
+
+/**
+ * @brief Creates clipboard content that adopts an existing buffer
+ * @param data Content; must stay valid and unchanged until released
+ * @param length Number of bytes
+ * @param release Called once the last reference is dropped (may be NULL)
+ * @param user_data User data passed to release
+ * @return Content with one reference, or NULL on failure
+ *
+ * The bytes are never copied. On failure the buffer is not released and
+ * remains owned by the caller.
+ */
+ClipboardData* clipboard_data_create_adopt(const char* data, size_t length,
+                                           ClipboardDataRelease release, void* user_data);
+
+/**
+ * @brief Takes a reference
+ * @param content Clipboard content
+ * @return content, for convenience
+ */
+ClipboardData* clipboard_data_ref(ClipboardData* content);
+
+/**
+ * @brief Drops a reference; the last one frees the content
+ * @param content Clipboard content (may be NULL)
+ */
+void clipboard_data_unref(ClipboardData* content);
+
+/**
+ * @brief Gets the bytes
+ * @param content Clipboard content
+ * @param length Receives the number of bytes (may be NULL)
+ * @return The bytes (not necessarily NUL-terminated), valid while a
+ *         reference is held
+ */
+const char* clipboard_data_get_bytes(const ClipboardData* content, size_t* length);
+
+#endif /* CLIPBOARD_DATA_H */
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define CLIPBOARD_OPERATIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "clipboard/clipboard_data.h"
 
 /**
  * @file clipboard_operations.h
@@ -39,13 +41,49 @@ void clipboard_operations_destroy(ClipboardOperations* clipboard);
  */
 bool clipboard_operations_copy(ClipboardOperations* clipboard, const char* text);
 
+/**
+ * @brief Copies bytes to the clipboard, NULs included
+ * @param clipboard Clipboard operations instance
+ * @param data Bytes to copy
+ * @param length Number of bytes
+ * @return true on success, false on failure
+ */
+bool clipboard_operations_copy_data(ClipboardOperations* clipboard, const char* data, size_t length);
+
+/**
+ * @brief Puts shared content on the clipboard without copying it
+ * @param clipboard Clipboard operations instance
+ * @param content Content; the clipboard takes its own reference
+ * @return true on success, false on failure
+ */
+bool clipboard_operations_set_data(ClipboardOperations* clipboard, ClipboardData* content);
+
+/**
+ * @brief Gets the clipboard content without copying it
+ * @param clipboard Clipboard operations instance
+ * @return New reference to the content (release with clipboard_data_unref()),
+ *         or NULL if empty
+ */
+ClipboardData* clipboard_operations_get_data(ClipboardOperations* clipboard);
+
 /**
  * @brief Retrieves text from the system clipboard
  * @param clipboard Clipboard operations instance
  * @return Pointer to clipboard text (caller must free), or NULL if empty/error
+ *
+ * Content with embedded NULs is cut short; use clipboard_operations_paste_data().
  */
 char* clipboard_operations_paste(ClipboardOperations* clipboard);
 
+/**
+ * @brief Retrieves the clipboard bytes, NULs included
+ * @param clipboard Clipboard operations instance
+ * @param length Receives the number of bytes
+ * @return NUL-terminated copy of the content (caller must free), or NULL
+ *         if empty/error
+ */
+char* clipboard_operations_paste_data(ClipboardOperations* clipboard, size_t* length);
+
 /**
  * @brief Checks if clipboard has text content
  * @param clipboard Clipboard operations instance
@@ -0,0 +1,98 @@
+#ifndef CHANGE_NOTIFIER_H
+#define CHANGE_NOTIFIER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file change_notifier.h
+ * @brief Change events - tells subscribers what part of the text changed
+ *
+ * Each edit is pushed as a TextChange: at offset, removed_length units were
+ * replaced by inserted_length units. Changes are queued until
+ * change_notifier_flush() (typically once per frame) and then delivered to
+ * every subscriber as one batch, so a consumer can update incrementally
+ * instead of rescanning the whole text.
+ *
+ * Within a batch, a change that touches or overlaps the previous one is
+ * merged into it, so a burst of typing arrives as one change. Each change
+ * in a batch is expressed in the coordinates left by the changes before
+ * it. Offsets and lengths are in the pusher's units.
+ */
+
+typedef struct ChangeNotifier ChangeNotifier;
+
+/**
+ * @brief One change to the text
+ */
+typedef struct {
+    size_t offset;
+    size_t removed_length;
+    size_t inserted_length;
+} TextChange;
+
+/**
+ * @brief Receives a batch of changes
+ * @param changes Changes in the order they were made
+ * @param count Number of changes (at least 1)
+ * @param user_data User-provided data
+ *
+ * May push further changes (delivered in the next batch) and may
+ * subscribe or unsubscribe.
+ */
+typedef void (*ChangeListener)(const TextChange* changes, size_t count, void* user_data);
+
+/**
+ * @brief Creates a notifier with no subscribers
+ * @return Pointer to notifier instance, or NULL on failure
+ */
+ChangeNotifier* change_notifier_create(void);
+
+/**
+ * @brief Destroys a notifier; pending changes are dropped
+ * @param notifier Notifier instance to destroy
+ */
+void change_notifier_destroy(ChangeNotifier* notifier);
+
+/**
+ * @brief Adds a subscriber
+ * @param notifier Notifier instance
+ * @param listener Called with every batch
+ * @param user_data User data passed to listener
+ * @return Subscription id, or 0 on failure
+ *
+ * Subscribers are called in the order they subscribed.
+ */
+unsigned long change_notifier_subscribe(ChangeNotifier* notifier, ChangeListener listener, void* user_data);
+
+/**
+ * @brief Removes a subscriber
+ * @param notifier Notifier instance
+ * @param id Id returned by change_notifier_subscribe()
+ */
+void change_notifier_unsubscribe(ChangeNotifier* notifier, unsigned long id);
+
+/**
+ * @brief Queues a change
+ * @param notifier Notifier instance
+ * @param offset Where the change starts
+ * @param removed_length Length of the text it replaced
+ * @param inserted_length Length of the text it inserted
+ */
+void change_notifier_push(ChangeNotifier* notifier, size_t offset,
+                          size_t removed_length, size_t inserted_length);
+
+/**
+ * @brief Checks whether changes are waiting to be delivered
+ * @param notifier Notifier instance
+ * @return true if change_notifier_flush() would call the subscribers
+ */
+bool change_notifier_has_pending(const ChangeNotifier* notifier);
+
+/**
+ * @brief Delivers the queued changes to every subscriber
+ * @param notifier Notifier instance
+ */
+void change_notifier_flush(ChangeNotifier* notifier);
+
+#endif /* CHANGE_NOTIFIER_H */
\ No newline at end of file
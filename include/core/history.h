@@ -0,0 +1,195 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file history.h
+ * @brief Undo/redo history - a bounded log of text deltas
+ *
+ * Every edit is recorded as one delta: where it happened, the bytes it
+ * removed and the bytes it inserted. Deltas live back to back in a ring
+ * arena, so undo and redo cost O(size of the delta) and the content is
+ * never snapshotted. Consecutive typing (and consecutive Delete or
+ * Backspace presses) is merged into the previous delta.
+ *
+ * Memory is bounded by a budget: the oldest undo steps are evicted to make
+ * room, and a single change larger than the budget empties the history
+ * instead of being stored. A change whose bytes the caller already keeps
+ * in reference-counted storage (a Replace All snapshot, a large paste) is
+ * recorded with history_record_shared(): the history holds references
+ * instead of copies, and only the delta itself counts against the budget.
+ *
+ * Offsets and spans are in the caller's units (bytes for a byte buffer,
+ * characters for a GtkTextBuffer); only the payload is counted in bytes.
+ */
+
+typedef struct History History;
+
+/**
+ * @brief One change to the text
+ *
+ * At offset, removed_span units holding the bytes `removed` were replaced
+ * by the bytes `inserted`, which span inserted_span units.
+ */
+typedef struct {
+    size_t offset;
+    const char* removed;
+    size_t removed_length;
+    size_t removed_span;
+    const char* inserted;
+    size_t inserted_length;
+    size_t inserted_span;
+} HistoryChange;
+
+/**
+ * @brief Applies a change to the text during undo or redo
+ * @param change Change to make; its pointers are only valid during the call
+ * @param user_data User-provided data
+ */
+typedef void (*HistoryApply)(const HistoryChange* change, void* user_data);
+
+/**
+ * @brief Drops a reference the history held on shared bytes
+ * @param owner Reference passed to history_record_shared()
+ */
+typedef void (*HistoryRelease)(void* owner);
+
+/**
+ * @brief Creates an empty history
+ * @param budget Most bytes the recorded deltas may occupy
+ * @return Pointer to history instance, or NULL on failure
+ */
+History* history_create(size_t budget);
+
+/**
+ * @brief Destroys a history and frees resources
+ * @param history History instance to destroy
+ */
+void history_destroy(History* history);
+
+/**
+ * @brief Forgets every undo and redo step and frees the arena
+ * @param history History instance
+ */
+void history_clear(History* history);
+
+/**
+ * @brief Empties the history because a change will not be recorded
+ * @param history History instance
+ *
+ * For changes the caller knows are too large to keep. The remaining
+ * changes of an open group are ignored too, so a half-recorded group can
+ * never be undone.
+ */
+void history_discard(History* history);
+
+/**
+ * @brief Starts a group of changes that undo and redo as one step
+ * @param history History instance
+ *
+ * Groups nest; only the outermost pair counts.
+ */
+void history_begin_group(History* history);
+
+/**
+ * @brief Ends a group started with history_begin_group()
+ * @param history History instance
+ */
+void history_end_group(History* history);
+
+/**
+ * @brief Records a change that was just made (or is about to be made)
+ * @param history History instance
+ * @param change The change
+ * @return true if recorded; false if it did not fit the budget or memory
+ *         ran out, in which case the history was discarded
+ *
+ * Drops every redo step.
+ */
+bool history_record(History* history, const HistoryChange* change);
+
+/**
+ * @brief Records a change without copying its bytes
+ * @param history History instance
+ * @param change The change; `removed` and `inserted` must stay valid while
+ *        their owners are referenced
+ * @param removed_owner Reference keeping `removed` alive, or NULL to copy it
+ * @param inserted_owner Reference keeping `inserted` alive, or NULL to copy it
+ * @param release Drops an owner reference once the step is forgotten
+ * @return true if recorded; false as for history_record()
+ *
+ * Takes over one reference to each non-NULL owner, releasing it right away
+ * if the change is not recorded. Shared changes are never merged.
+ */
+bool history_record_shared(History* history, const HistoryChange* change,
+                           void* removed_owner, void* inserted_owner, HistoryRelease release);
+
+/**
+ * @brief Stops the next change from being merged into the last one
+ * @param history History instance
+ */
+void history_seal(History* history);
+
+/**
+ * @brief Reverts the most recent undo step
+ * @param history History instance
+ * @param apply Called for each inverse change, newest first
+ * @param user_data User data passed to apply
+ * @return true if a step was undone
+ */
+bool history_undo(History* history, HistoryApply apply, void* user_data);
+
+/**
+ * @brief Reapplies the most recently undone step
+ * @param history History instance
+ * @param apply Called for each change, oldest first
+ * @param user_data User data passed to apply
+ * @return true if a step was redone
+ */
+bool history_redo(History* history, HistoryApply apply, void* user_data);
+
+/**
+ * @brief Checks whether there is a step to undo
+ * @param history History instance
+ * @return true if history_undo() would do something
+ */
+bool history_can_undo(const History* history);
+
+/**
+ * @brief Checks whether there is a step to redo
+ * @param history History instance
+ * @return true if history_redo() would do something
+ */
+bool history_can_redo(const History* history);
+
+/**
+ * @brief Gets the memory budget
+ * @param history History instance
+ * @return Budget in bytes
+ */
+size_t history_get_budget(const History* history);
+
+/**
+ * @brief Changes the memory budget, evicting the oldest steps if needed
+ * @param history History instance
+ * @param budget New budget in bytes
+ */
+void history_set_budget(History* history, size_t budget);
+
+/**
+ * @brief Gets the bytes the recorded deltas occupy
+ * @param history History instance
+ * @return Bytes counted against the budget
+ */
+size_t history_get_memory_usage(const History* history);
+
+/**
+ * @brief Gets the number of recorded deltas, undone ones included
+ * @param history History instance
+ * @return Delta count
+ */
+size_t history_get_entry_count(const History* history);
+
+#endif /* HISTORY_H */
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file line_index.h
+ * @brief Line index - maps between line numbers and byte offsets
+ *
+ * Records where every line starts so line counts, go-to-line and
+ * offset/line conversions never have to walk the text. Line starts are
+ * kept in blocks of relative 32-bit offsets whose lengths and line counts
+ * are summed in Fenwick trees, so lookups and edits inside a block are
+ * O(log n). An edit that splits or merges blocks (about once per thousand
+ * lines added, or a deletion spanning blocks) makes the next lookup
+ * rebuild the trees in O(n / 1024).
+ *
+ * Newlines are found with SSE2 or AVX2 when the CPU supports them
+ * (selected at runtime), with a scalar fallback elsewhere.
+ *
+ * Lines and offsets are zero-based; lines end after '\n'.
+ */
+
+typedef struct LineIndex LineIndex;
+
+/**
+ * @brief Creates an index for empty text (one empty line)
+ * @return Pointer to line index instance, or NULL on failure
+ */
+LineIndex* line_index_create(void);
+
+/**
+ * @brief Destroys a line index and frees resources
+ * @param index Line index instance to destroy
+ */
+void line_index_destroy(LineIndex* index);
+
+/**
+ * @brief Extends the index with text appended at the end
+ * @param index Line index instance
+ * @param data Appended bytes
+ * @param length Number of bytes
+ * @return true on success, false on allocation failure
+ *
+ * Meant for building the index while a file is read chunk by chunk.
+ */
+bool line_index_append(LineIndex* index, const char* data, size_t length);
+
+/**
+ * @brief Updates the index for text inserted at an offset
+ * @param index Line index instance
+ * @param offset Byte offset of the insertion
+ * @param data Inserted bytes
+ * @param length Number of bytes
+ * @return true on success, false on invalid offset or allocation failure
+ */
+bool line_index_insert(LineIndex* index, size_t offset, const char* data, size_t length);
+
+/**
+ * @brief Updates the index for a deleted byte range
+ * @param index Line index instance
+ * @param offset Start of the deleted range
+ * @param length Number of bytes deleted
+ * @return true on success, false on invalid range or allocation failure
+ */
+bool line_index_delete(LineIndex* index, size_t offset, size_t length);
+
+/**
+ * @brief Gets the number of lines (always at least 1)
+ * @param index Line index instance
+ * @return Line count
+ */
+size_t line_index_get_line_count(LineIndex* index);
+
+/**
+ * @brief Gets the indexed text length
+ * @param index Line index instance
+ * @return Length in bytes
+ */
+size_t line_index_get_length(LineIndex* index);
+
+/**
+ * @brief Gets the byte offset where a line starts
+ * @param index Line index instance
+ * @param line Zero-based line number (clamped to the last line)
+ * @return Byte offset of the first byte of the line
+ */
+size_t line_index_get_line_start(LineIndex* index, size_t line);
+
+/**
+ * @brief Gets the line containing a byte offset
+ * @param index Line index instance
+ * @param offset Byte offset (clamped to the text length)
+ * @return Zero-based line number
+ */
+size_t line_index_get_line_at_offset(LineIndex* index, size_t offset);
+
+/**
+ * @brief Counts '\n' bytes using the fastest scanner available
+ * @param data Bytes to scan
+ * @param length Number of bytes
+ * @return Number of newlines
+ */
+size_t line_index_count_newlines(const char* data, size_t length);
+
+/**
+ * @brief Names the newline scanner selected for this CPU
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char* line_index_get_scanner_name(void);
+
+#endif /* LINE_INDEX_H */
\ No newline at end of file
@@ -0,0 +1,194 @@
+#ifndef PIECE_TABLE_H
+#define PIECE_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file piece_table.h
+ * @brief Piece table text storage - the editable byte sequence behind a document
+ *
+ * Text is described as a sequence of pieces, each referencing a span of
+ * either the read-only original buffer (the file as loaded) or the
+ * append-only add buffer (everything typed or pasted since). Pieces are
+ * kept in a balanced tree keyed by byte length, so insert, delete and
+ * offset lookup are O(log n) in the number of pieces and never touch the
+ * bytes that did not change.
+ *
+ * Neither buffer is ever modified in place, which makes snapshots cheap:
+ * a snapshot only copies the piece list and holds a reference on the
+ * buffers, and stays valid (and safe to read from another thread) after
+ * the table is edited or destroyed.
+ *
+ * All offsets and lengths are in bytes.
+ */
+
+typedef struct PieceTable PieceTable;
+typedef struct PieceTableSnapshot PieceTableSnapshot;
+
+/**
+ * @brief Releases an adopted original buffer
+ * @param data The buffer passed to piece_table_create_adopt()
+ * @param length Its length in bytes
+ * @param user_data User-provided data
+ */
+typedef void (*PieceTableRelease)(const char* data, size_t length, void* user_data);
+
+/**
+ * @brief Creates a piece table holding a copy of the given text
+ * @param text Initial content (may be NULL if length is 0)
+ * @param length Length of the initial content in bytes
+ * @return Pointer to piece table instance, or NULL on failure
+ */
+PieceTable* piece_table_create(const char* text, size_t length);
+
+/**
+ * @brief Creates a piece table that adopts an existing buffer as its original
+ * @param data Initial content; must stay valid and unchanged until released
+ * @param length Length of the initial content in bytes
+ * @param release Called once the table and all snapshots are gone (may be NULL)
+ * @param user_data User data passed to release
+ * @return Pointer to piece table instance, or NULL on failure
+ *
+ * Intended for file mappings: the content is never copied. On failure the
+ * buffer is not released and remains owned by the caller.
+ */
+PieceTable* piece_table_create_adopt(const char* data, size_t length,
+                                     PieceTableRelease release,
+                                     void* user_data);
+
+/**
+ * @brief Destroys a piece table; outstanding snapshots remain valid
+ * @param table Piece table instance to destroy
+ */
+void piece_table_destroy(PieceTable* table);
+
+/**
+ * @brief Gets the content length
+ * @param table Piece table instance
+ * @return Length in bytes
+ */
+size_t piece_table_get_length(const PieceTable* table);
+
+/**
+ * @brief Gets the number of pieces describing the content
+ * @param table Piece table instance
+ * @return Piece count
+ */
+size_t piece_table_get_piece_count(const PieceTable* table);
+
+/**
+ * @brief Inserts text at an offset
+ * @param table Piece table instance
+ * @param offset Byte offset to insert at (0..length)
+ * @param text Text to insert
+ * @param length Length of text in bytes
+ * @return true on success, false on invalid offset or allocation failure
+ *
+ * Consecutive inserts at the end of the previous insert (typing) extend
+ * the same piece instead of adding a new one.
+ */
+bool piece_table_insert(PieceTable* table, size_t offset,
+                        const char* text, size_t length);
+
+/**
+ * @brief Deletes a byte range
+ * @param table Piece table instance
+ * @param offset Start of the range
+ * @param length Number of bytes to delete
+ * @return true on success, false on invalid range or allocation failure
+ */
+bool piece_table_delete(PieceTable* table, size_t offset, size_t length);
+
+/**
+ * @brief Replaces a byte range with new text
+ * @param table Piece table instance
+ * @param offset Start of the range
+ * @param remove_length Number of bytes to remove
+ * @param text Replacement text
+ * @param length Length of replacement text in bytes
+ * @return true on success, false on invalid range or allocation failure
+ */
+bool piece_table_replace(PieceTable* table, size_t offset, size_t remove_length,
+                         const char* text, size_t length);
+
+/**
+ * @brief Gets the byte at an offset
+ * @param table Piece table instance
+ * @param offset Byte offset
+ * @return Byte value (0-255), or -1 if offset is out of range
+ */
+int piece_table_get_byte(const PieceTable* table, size_t offset);
+
+/**
+ * @brief Copies a byte range into a caller-provided buffer
+ * @param table Piece table instance
+ * @param offset Start of the range
+ * @param length Number of bytes to copy
+ * @param out Destination, at least length bytes
+ * @return Number of bytes copied (less than length if the range is clipped)
+ */
+size_t piece_table_copy_range(const PieceTable* table, size_t offset,
+                              size_t length, char* out);
+
+/**
+ * @brief Materialises the whole content
+ * @param table Piece table instance
+ * @param length Receives the content length (may be NULL)
+ * @return NUL-terminated copy of the content (caller must free), or NULL on failure
+ */
+char* piece_table_to_string(const PieceTable* table, size_t* length);
+
+/**
+ * @brief Takes an immutable snapshot of the current content
+ * @param table Piece table instance
+ * @return Snapshot (destroy with piece_table_snapshot_destroy), or NULL on failure
+ *
+ * Costs O(pieces), not O(bytes).
+ */
+PieceTableSnapshot* piece_table_snapshot(const PieceTable* table);
+
+/**
+ * @brief Destroys a snapshot
+ * @param snapshot Snapshot to destroy
+ */
+void piece_table_snapshot_destroy(PieceTableSnapshot* snapshot);
+
+/**
+ * @brief Gets the content length of a snapshot
+ * @param snapshot Snapshot instance
+ * @return Length in bytes
+ */
+size_t piece_table_snapshot_get_length(const PieceTableSnapshot* snapshot);
+
+/**
+ * @brief Gets the number of pieces in a snapshot
+ * @param snapshot Snapshot instance
+ * @return Piece count
+ */
+size_t piece_table_snapshot_get_piece_count(const PieceTableSnapshot* snapshot);
+
+/**
+ * @brief Gets one piece of a snapshot, in document order
+ * @param snapshot Snapshot instance
+ * @param index Piece index (0..piece count - 1)
+ * @param length Receives the piece length in bytes
+ * @return Pointer to the piece bytes (not NUL-terminated, do not free)
+ *
+ * Lets writers and searchers walk the content without materialising it.
+ */
+const char* piece_table_snapshot_get_piece(const PieceTableSnapshot* snapshot,
+                                           size_t index, size_t* length);
+
+/**
+ * @brief Copies a byte range of a snapshot into a caller-provided buffer
+ * @param snapshot Snapshot instance
+ * @param offset Start of the range
+ * @param length Number of bytes to copy
+ * @param out Destination, at least length bytes
+ * @return Number of bytes copied (less than length if the range is clipped)
+ */
+size_t piece_table_snapshot_copy_range(const PieceTableSnapshot* snapshot,
+                                       size_t offset, size_t length, char* out);
+
+#endif /* PIECE_TABLE_H */
\ No newline at end of file
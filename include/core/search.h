@@ -0,0 +1,140 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file search.h
+ * @brief Literal text search over UTF-8 bytes
+ *
+ * Searches plain byte buffers (document snapshots, mapped files) without
+ * copying them. Candidate positions are found with SSE2 or AVX2 compares
+ * of the pattern's first and last bytes (selected at runtime, scalar
+ * fallback elsewhere) and then verified.
+ *
+ * Case-insensitive matching uses simple one-to-one case folding of ASCII
+ * and the common two-byte letters (Latin-1, Latin Extended-A, Greek,
+ * Cyrillic). Whole-word matching treats ASCII letters, digits, '_' and
+ * all non-ASCII characters as word characters.
+ */
+
+/**
+ * @brief Search options (may be combined)
+ */
+typedef enum {
+    SEARCH_MATCH_CASE = 0,
+    SEARCH_IGNORE_CASE = 1 << 0,
+    SEARCH_WHOLE_WORD = 1 << 1
+} SearchFlags;
+
+/**
+ * @brief Byte range of a match
+ */
+typedef struct {
+    size_t start;
+    size_t end;
+} SearchMatch;
+
+typedef struct SearchPattern SearchPattern;
+
+/**
+ * @brief Prepares a pattern for searching
+ * @param text Pattern bytes (UTF-8)
+ * @param length Pattern length in bytes
+ * @param flags Combination of SearchFlags
+ * @return Pointer to pattern instance, or NULL on empty pattern or failure
+ */
+SearchPattern* search_pattern_create(const char* text, size_t length, unsigned int flags);
+
+/**
+ * @brief Destroys a pattern and frees resources
+ * @param pattern Pattern instance to destroy
+ */
+void search_pattern_destroy(SearchPattern* pattern);
+
+/**
+ * @brief Finds the first match starting at or after an offset
+ * @param pattern Pattern instance
+ * @param text Bytes to search
+ * @param length Number of bytes
+ * @param from Offset to start searching at
+ * @param match Receives the match
+ * @return true if a match was found
+ */
+bool search_find_next(const SearchPattern* pattern, const char* text, size_t length,
+                      size_t from, SearchMatch* match);
+
+/**
+ * @brief Finds the last match ending at or before an offset
+ * @param pattern Pattern instance
+ * @param text Bytes to search
+ * @param length Number of bytes
+ * @param before Offset the match must end by
+ * @param match Receives the match
+ * @return true if a match was found
+ */
+bool search_find_previous(const SearchPattern* pattern, const char* text, size_t length,
+                          size_t before, SearchMatch* match);
+
+/**
+ * @brief Counts non-overlapping matches
+ * @param pattern Pattern instance
+ * @param text Bytes to search
+ * @param length Number of bytes
+ * @param limit Stop counting at this many matches (0 for no limit)
+ * @return Number of matches, at most limit
+ */
+size_t search_count_matches(const SearchPattern* pattern, const char* text, size_t length,
+                            size_t limit);
+
+/**
+ * @brief Counts non-overlapping matches a slice at a time
+ * @param pattern Pattern instance
+ * @param text Bytes to search
+ * @param length Number of bytes
+ * @param position Where counting resumes (0 to begin); advanced past the
+ *        positions this call has settled
+ * @param end Only matches ending by this offset are counted in this call
+ * @return Number of matches counted in this call
+ *
+ * Calls with a growing end, the last one with end equal to length, add up
+ * to search_count_matches() without a limit.
+ */
+size_t search_count_matches_step(const SearchPattern* pattern, const char* text, size_t length,
+                                 size_t* position, size_t end);
+
+/**
+ * @brief Replaces every match in one pass over the text
+ * @param pattern Pattern instance
+ * @param text Bytes to search
+ * @param length Number of bytes
+ * @param replacement Bytes to put in place of each match
+ * @param replacement_length Replacement length in bytes
+ * @param result_length Receives the length of the result
+ * @param count Receives the number of replacements (may be NULL)
+ * @return Newly allocated, NUL-terminated result (caller must free), or
+ *         NULL on failure
+ */
+char* search_replace_all(const SearchPattern* pattern, const char* text, size_t length,
+                         const char* replacement, size_t replacement_length,
+                         size_t* result_length, size_t* count);
+
+/**
+ * @brief Replaces a known set of matches
+ * @param text Bytes the matches refer to
+ * @param length Number of bytes
+ * @param matches Matches in document order, not overlapping
+ * @param match_count Number of matches
+ * @param replacement Bytes to put in place of each match
+ * @param replacement_length Replacement length in bytes
+ * @param result_length Receives the length of the result
+ * @return Newly allocated, NUL-terminated result (caller must free), or
+ *         NULL on failure
+ */
+char* search_replace_matches(const char* text, size_t length,
+                             const SearchMatch* matches, size_t match_count,
+                             const char* replacement, size_t replacement_length,
+                             size_t* result_length);
+
+#endif /* SEARCH_H */
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file trace.h
+ * @brief Monotonic-clock spans written out as Chrome trace-event JSON
+ *
+ * Tracing is off until trace_start() is called (main.c does so for
+ * --trace=FILE). While it is off, trace_begin() is a single atomic load and
+ * trace_end() returns at once, so spans can stay in hot paths.
+ *
+ * Spans are recorded from any thread without locking into a fixed buffer
+ * and written when trace_stop() is called. The file opens in Perfetto or
+ * chrome://tracing, with one track per thread.
+ *
+ * Span names are stored by pointer and must be string literals.
+ */
+
+/**
+ * @brief Starts recording
+ * @param path File trace_stop() writes the trace to
+ * @return true on success, false if tracing already started or on failure
+ *
+ * Call on the main thread before any other thread records.
+ */
+bool trace_start(const char* path);
+
+/**
+ * @brief Stops recording and writes the trace file
+ * @return true if the file was written (or tracing was never started)
+ */
+bool trace_stop(void);
+
+/**
+ * @brief Checks whether spans are being recorded
+ * @return true between trace_start() and trace_stop()
+ */
+bool trace_is_enabled(void);
+
+/**
+ * @brief Opens a span
+ * @return Start time to pass to trace_end(), or 0 while tracing is off
+ */
+uint64_t trace_begin(void);
+
+/**
+ * @brief Closes a span opened by trace_begin()
+ * @param name Span name (a string literal)
+ * @param start Value returned by trace_begin(); 0 records nothing
+ *
+ * The span may be closed on a different thread or main loop iteration
+ * than it was opened on; it is shown on the closing thread's track.
+ */
+void trace_end(const char* name, uint64_t start);
+
+/**
+ * @brief Records a point in time, such as the first frame being drawn
+ * @param name Event name (a string literal)
+ */
+void trace_instant(const char* name);
+
+#endif /* TRACE_H */
\ No newline at end of file
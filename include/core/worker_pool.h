@@ -0,0 +1,166 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file worker_pool.h
+ * @brief Fixed pool of worker threads with results handed back to the owner
+ *
+ * Jobs run on one of a fixed set of threads (one per core by default) in
+ * the order they were submitted. A finished job is passed to a dispatch
+ * function, which forwards it to the owning thread (the UI attaches an
+ * idle source to the main context); the owner calls worker_pool_deliver()
+ * there to run the job's completion. Delivery must never run on the
+ * worker itself.
+ *
+ * The pool keeps a generation counter that the owner advances whenever
+ * the data jobs read from changes (for the editor, on every edit). A job
+ * submitted with WORKER_JOB_DROP_ON_CHANGE is skipped if it has not
+ * started, sees worker_job_is_cancelled() return true while running, and
+ * has its result discarded instead of delivered once the counter moves.
+ *
+ * worker_pool_submit(), worker_pool_cancel(),
+ * worker_pool_advance_generation(), worker_pool_deliver() and
+ * worker_pool_destroy() must be called on the owning thread.
+ */
+
+typedef struct WorkerPool WorkerPool;
+typedef struct WorkerJob WorkerJob;
+
+/**
+ * @brief Job options
+ */
+typedef enum {
+    WORKER_JOB_DEFAULT = 0,
+    WORKER_JOB_DROP_ON_CHANGE = 1 << 0  /* Drop when the generation advances */
+} WorkerJobFlags;
+
+/**
+ * @brief Does a job's work on a worker thread
+ * @param job The job, for worker_job_is_cancelled()
+ * @param data Job data
+ * @return Result passed to the completion, or NULL
+ */
+typedef void* (*WorkerRun)(const WorkerJob* job, void* data);
+
+/**
+ * @brief Receives a job's result on the owning thread
+ * @param result Value returned by the run function; ownership passes to
+ *        the completion
+ * @param data Job data
+ */
+typedef void (*WorkerComplete)(void* result, void* data);
+
+/**
+ * @brief Frees a value (a discarded result, or job data)
+ * @param value Value to free
+ */
+typedef void (*WorkerFree)(void* value);
+
+/**
+ * @brief Hands a finished job to the owning thread
+ * @param job Job to pass to worker_pool_deliver() on the owning thread
+ * @param dispatch_data Value given to worker_pool_create()
+ *
+ * Called on a worker thread. Every job dispatched must be delivered,
+ * unless worker_pool_destroy() withdraws it first.
+ */
+typedef void (*WorkerDispatch)(WorkerJob* job, void* dispatch_data);
+
+/**
+ * @brief Takes back a dispatched job that was never delivered
+ * @param job Job previously passed to the dispatch function
+ * @param dispatch_data Value given to worker_pool_create()
+ *
+ * Called by worker_pool_destroy() on the owning thread, which frees the
+ * job afterwards; worker_pool_deliver() must not be called for it.
+ */
+typedef void (*WorkerWithdraw)(WorkerJob* job, void* dispatch_data);
+
+/**
+ * @brief Counters for tuning and diagnostics
+ */
+typedef struct {
+    size_t threads;
+    size_t queued;           /* Jobs waiting for a thread */
+    size_t running;
+    uint64_t completed;      /* Completions run */
+    uint64_t dropped;        /* Jobs cancelled or made stale, run or not */
+    uint64_t lock_acquired;  /* Queue lock acquisitions */
+    uint64_t lock_contended; /* Acquisitions that found the lock held */
+    uint64_t lock_wait_ns;   /* Time spent waiting for the held lock */
+} WorkerPoolStats;
+
+/**
+ * @brief Creates a pool and starts its threads
+ * @param thread_count Number of threads (0 for one per online core)
+ * @param dispatch Forwards finished jobs to the owning thread
+ * @param withdraw Takes back jobs still in flight to the owning thread
+ * @param dispatch_data User data passed to dispatch and withdraw
+ * @return Pointer to pool instance, or NULL on failure
+ */
+WorkerPool* worker_pool_create(size_t thread_count, WorkerDispatch dispatch,
+                               WorkerWithdraw withdraw, void* dispatch_data);
+
+/**
+ * @brief Cancels every job, waits for the threads and releases the pool
+ * @param pool Pool instance to destroy
+ *
+ * Running jobs are waited for. Every job not yet delivered is freed here
+ * without its completion: queued jobs directly, dispatched ones after
+ * they are withdrawn from the owning thread's queue.
+ */
+void worker_pool_destroy(WorkerPool* pool);
+
+/**
+ * @brief Queues a job
+ * @param pool Pool instance
+ * @param run Called on a worker thread
+ * @param complete Called on the owning thread with the result (may be NULL)
+ * @param free_result Frees a result that is not delivered (may be NULL)
+ * @param data Job data passed to every callback
+ * @param free_data Frees data once the job is over (may be NULL)
+ * @param flags Combination of WorkerJobFlags
+ * @return Job id, or 0 on failure (free_data is then called)
+ */
+uint64_t worker_pool_submit(WorkerPool* pool, WorkerRun run, WorkerComplete complete,
+                            WorkerFree free_result, void* data, WorkerFree free_data,
+                            unsigned int flags);
+
+/**
+ * @brief Cancels a job; its completion will not run
+ * @param pool Pool instance
+ * @param id Id returned by worker_pool_submit(); ignored once delivered
+ */
+void worker_pool_cancel(WorkerPool* pool, uint64_t id);
+
+/**
+ * @brief Marks the data jobs read from as changed
+ * @param pool Pool instance
+ */
+void worker_pool_advance_generation(WorkerPool* pool);
+
+/**
+ * @brief Checks whether a running job's result will be discarded
+ * @param job Job passed to the run function
+ * @return true if the run function may stop early
+ */
+bool worker_job_is_cancelled(const WorkerJob* job);
+
+/**
+ * @brief Runs a finished job's completion, or discards its result
+ * @param job Job passed to the dispatch function
+ */
+void worker_pool_deliver(WorkerJob* job);
+
+/**
+ * @brief Reads the pool counters
+ * @param pool Pool instance
+ * @param stats Receives the counters
+ */
+void worker_pool_get_stats(WorkerPool* pool, WorkerPoolStats* stats);
+
+#endif /* WORKER_POOL_H */
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef EDIT_TRACE_H
+#define EDIT_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file edit_trace.h
+ * @brief Recorded editing sessions for replay benchmarks
+ *
+ * An edit trace is the sequence of changes an editing session made to the
+ * text: the content it started from (and any later wholesale replacement,
+ * such as opening a file), every insertion and deletion with its byte
+ * offset and bytes, undo and redo steps, and the grouping of edits into
+ * user actions. Each record carries the time since the previous one, so a
+ * replay can tell bursts of typing from pauses.
+ *
+ * Records are a type byte followed by LEB128 varints and raw bytes, after
+ * a four-byte magic. The writer appends through a stdio buffer from the
+ * recording thread; the reader maps the file and decodes records in place.
+ */
+
+typedef struct EditTraceWriter EditTraceWriter;
+typedef struct EditTraceReader EditTraceReader;
+
+/**
+ * @brief Kinds of record
+ */
+typedef enum {
+    EDIT_TRACE_SET = 0,      /* Content replaced wholesale; text is the new content */
+    EDIT_TRACE_INSERT,       /* text inserted at offset */
+    EDIT_TRACE_DELETE,       /* text (length bytes) removed at offset */
+    EDIT_TRACE_BEGIN_GROUP,  /* Start of a user action */
+    EDIT_TRACE_END_GROUP,    /* End of a user action */
+    EDIT_TRACE_UNDO,         /* An undo step; the edits it made follow */
+    EDIT_TRACE_REDO,         /* A redo step; the edits it made follow */
+    EDIT_TRACE_TYPE_COUNT
+} EditTraceType;
+
+/**
+ * @brief One record
+ */
+typedef struct {
+    EditTraceType type;
+    uint64_t time_us;        /* Since the recording started */
+    uint64_t offset;         /* Byte offset of an insertion or deletion */
+    const char* text;        /* Inserted, removed or new content (not NUL-terminated) */
+    size_t length;
+    bool from_history;       /* Edit made by undo, redo or recovery, not typed */
+} EditTraceRecord;
+
+/**
+ * @brief Creates a trace file and starts the clock
+ * @param path Trace file to create (truncated if it exists)
+ * @return Pointer to writer instance, or NULL on failure
+ */
+EditTraceWriter* edit_trace_writer_open(const char* path);
+
+/**
+ * @brief Appends a record, timestamped now
+ * @param writer Writer instance
+ * @param type Kind of record
+ * @param offset Byte offset (insertions and deletions only)
+ * @param text Content, inserted or removed bytes, or NULL for none
+ * @param length Number of bytes in text
+ * @param from_history true if undo, redo or recovery made the edit
+ * @return true on success, false once writing has failed
+ */
+bool edit_trace_writer_append(EditTraceWriter* writer, EditTraceType type, uint64_t offset,
+                              const char* text, size_t length, bool from_history);
+
+/**
+ * @brief Flushes and closes a trace file
+ * @param writer Writer instance to close
+ * @return true if every record was written
+ */
+bool edit_trace_writer_close(EditTraceWriter* writer);
+
+/**
+ * @brief Opens a trace file for reading
+ * @param path Trace file
+ * @return Pointer to reader instance, or NULL if the file cannot be read
+ *         or is not an edit trace
+ */
+EditTraceReader* edit_trace_reader_open(const char* path);
+
+/**
+ * @brief Closes a trace file; records read from it become invalid
+ * @param reader Reader instance to close
+ */
+void edit_trace_reader_close(EditTraceReader* reader);
+
+/**
+ * @brief Reads the next record
+ * @param reader Reader instance
+ * @param record Filled in; its text points into the mapped file
+ * @return true if a record was read, false at the end or at a damaged or
+ *         incomplete record
+ */
+bool edit_trace_reader_next(EditTraceReader* reader, EditTraceRecord* record);
+
+/**
+ * @brief Checks whether reading stopped at a damaged record
+ * @param reader Reader instance
+ * @return true if the trace ended in a record that could not be decoded
+ */
+bool edit_trace_reader_is_damaged(const EditTraceReader* reader);
+
+#endif /* EDIT_TRACE_H */
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file encoding.h
+ * @brief Text encoding detection, UTF-8 validation and transcoding
+ *
+ * The editor works on UTF-8 internally. Files in other encodings are
+ * recognised when they are opened (byte order mark, then heuristics),
+ * converted to UTF-8 chunk by chunk while they stream in, and converted
+ * back when they are saved, so a file keeps the encoding it came with.
+ *
+ * UTF-8 validation uses a vectorised AVX2 validator or an SSE2 ASCII fast
+ * path (selected at runtime, scalar fallback elsewhere). Conversion goes
+ * through iconv(3).
+ */
+
+/**
+ * @brief Encodings a file can be read from and written back to
+ */
+typedef enum {
+    TEXT_ENCODING_UTF8 = 0,
+    TEXT_ENCODING_UTF8_BOM,
+    TEXT_ENCODING_UTF16LE,
+    TEXT_ENCODING_UTF16LE_BOM,
+    TEXT_ENCODING_UTF16BE,
+    TEXT_ENCODING_UTF16BE_BOM,
+    TEXT_ENCODING_LATIN1,
+    TEXT_ENCODING_CP1252
+} TextEncoding;
+
+typedef struct EncodingDecoder EncodingDecoder;
+
+/**
+ * @brief Checks whether bytes are well-formed UTF-8
+ * @param data Bytes to check
+ * @param length Number of bytes
+ * @param ascii Set to whether every byte is ASCII (may be NULL)
+ * @return true if valid; a sequence cut off at the end is invalid
+ */
+bool encoding_validate_utf8(const char* data, size_t length, bool* ascii);
+
+/**
+ * @brief Guesses the encoding of the start of a file
+ * @param data First bytes of the file
+ * @param length Number of bytes
+ * @param bom_length Receives the length of the byte order mark to skip
+ * @return Detected encoding; text that is neither UTF-8 nor UTF-16 is
+ *         taken as CP1252, or Latin-1 if it uses bytes CP1252 leaves undefined
+ */
+TextEncoding encoding_detect(const char* data, size_t length, size_t* bom_length);
+
+/**
+ * @brief Gets a display name for an encoding
+ * @param encoding Encoding
+ * @return Name such as "UTF-16LE" (do not free)
+ */
+const char* encoding_get_name(TextEncoding encoding);
+
+/**
+ * @brief Gets the name of the UTF-8 validator selected for this CPU
+ * @return "avx2", "sse2" or "scalar"
+ */
+const char* encoding_get_validator_name(void);
+
+/**
+ * @brief Creates a streaming converter to UTF-8
+ * @param encoding Source encoding; a UTF-8 source is repaired instead
+ * @return Pointer to decoder instance, or NULL on failure
+ */
+EncodingDecoder* encoding_decoder_create(TextEncoding encoding);
+
+/**
+ * @brief Destroys a decoder and frees resources
+ * @param decoder Decoder instance to destroy
+ */
+void encoding_decoder_destroy(EncodingDecoder* decoder);
+
+/**
+ * @brief Converts the next piece of input to UTF-8
+ * @param decoder Decoder instance
+ * @param data Input bytes
+ * @param length Number of input bytes
+ * @param final true for the last piece of input
+ * @param consumed Receives how many input bytes were used; the rest (at
+ *        most 3 bytes of an unfinished character) must be passed again
+ *        in front of the next piece
+ * @param output_length Receives the output length
+ * @return Newly allocated, NUL-terminated UTF-8 (caller must free), or
+ *         NULL on failure
+ *
+ * Bytes that are invalid in the source encoding become U+FFFD.
+ */
+char* encoding_decoder_convert(EncodingDecoder* decoder, const char* data, size_t length,
+                               bool final, size_t* consumed, size_t* output_length);
+
+/**
+ * @brief Checks whether any input had to be replaced with U+FFFD
+ * @param decoder Decoder instance
+ * @return true if the converted text differs from the file's content
+ */
+bool encoding_decoder_is_lossy(const EncodingDecoder* decoder);
+
+/**
+ * @brief Converts UTF-8 text to an encoding, adding its byte order mark
+ * @param encoding Target encoding
+ * @param data UTF-8 text
+ * @param length Number of bytes
+ * @param output_length Receives the output length
+ * @return Newly allocated bytes (caller must free), or NULL on failure;
+ *         errno is EILSEQ when the text cannot be represented
+ */
+char* encoding_encode(TextEncoding encoding, const char* data, size_t length,
+                      size_t* output_length);
+
+#endif /* ENCODING_H */
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef FILE_LOADER_H
+#define FILE_LOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "io/encoding.h"
+#include "io/file_operations.h"
+
+/**
+ * @file file_loader.h
+ * @brief Background file loader - reads a file in chunks on a worker thread
+ *
+ * The loader owns a single worker thread that reads the file and queues
+ * chunks for the consumer. The consumer (normally the UI thread) drains the
+ * queue at its own pace, so a large file never blocks the event loop.
+ * Chunks are always valid UTF-8 and never split a character: the file's
+ * encoding is detected from its first chunk and anything else is
+ * converted as it streams in. The queue is bounded, so a slow consumer
+ * throttles the reader instead of buffering the whole file.
+ */
+
+typedef struct FileLoader FileLoader;
+
+/**
+ * @brief Starts loading a file in the background
+ * @param path Path to the file to read
+ * @return Pointer to loader instance, or NULL on failure to start
+ *
+ * Errors opening or reading the file are reported through
+ * file_loader_get_result() once the loader has finished.
+ */
+FileLoader* file_loader_create(const char* path);
+
+/**
+ * @brief Cancels the load if still running, joins the worker and frees resources
+ * @param loader Loader instance to destroy
+ */
+void file_loader_destroy(FileLoader* loader);
+
+/**
+ * @brief Requests cancellation; the worker stops at the next chunk boundary
+ * @param loader Loader instance
+ */
+void file_loader_cancel(FileLoader* loader);
+
+/**
+ * @brief Takes the next queued chunk, if any
+ * @param loader Loader instance
+ * @param length Receives the chunk length in bytes
+ * @return NUL-terminated chunk (caller must free), or NULL if none is queued
+ */
+char* file_loader_take_chunk(FileLoader* loader, size_t* length);
+
+/**
+ * @brief Checks whether the worker has stopped and the queue is drained
+ * @param loader Loader instance
+ * @return true when no more chunks will become available
+ */
+bool file_loader_is_finished(FileLoader* loader);
+
+/**
+ * @brief Gets the outcome of the load
+ * @param loader Loader instance
+ * @return Result code; only meaningful once file_loader_is_finished() is true
+ */
+FileOperationResult file_loader_get_result(FileLoader* loader);
+
+/**
+ * @brief Gets the number of bytes read from the file so far
+ * @param loader Loader instance
+ * @return Bytes read
+ */
+size_t file_loader_get_bytes_read(FileLoader* loader);
+
+/**
+ * @brief Gets the file size reported when the file was opened
+ * @param loader Loader instance
+ * @return Size in bytes, or 0 if unknown (pipes, /proc entries)
+ */
+size_t file_loader_get_total_size(FileLoader* loader);
+
+/**
+ * @brief Gets the path being loaded
+ * @param loader Loader instance
+ * @return File path (do not free)
+ */
+const char* file_loader_get_path(const FileLoader* loader);
+
+/**
+ * @brief Gets the encoding the file was read as
+ * @param loader Loader instance
+ * @return Encoding; final once file_loader_is_finished() is true
+ */
+TextEncoding file_loader_get_encoding(FileLoader* loader);
+
+/**
+ * @brief Checks whether invalid bytes had to be replaced with U+FFFD
+ * @param loader Loader instance
+ * @return true if saving would not reproduce the original bytes; only
+ *         meaningful once file_loader_is_finished() is true
+ */
+bool file_loader_is_lossy(FileLoader* loader);
+
+#endif /* FILE_LOADER_H */
\ No newline at end of file
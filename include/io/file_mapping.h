@@ -0,0 +1,93 @@
+#ifndef FILE_MAPPING_H
+#define FILE_MAPPING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "io/file_operations.h"
+
+/**
+ * @file file_mapping.h
+ * @brief Read-only file mappings - random access to files larger than RAM
+ *
+ * Maps a whole regular file into the address space without reading it.
+ * Pages are faulted in on access and can be evicted by the kernel at any
+ * time, so resident memory stays proportional to what is being looked at,
+ * not to the file size.
+ *
+ * A file truncated while mapped (logrotate's copytruncate, say) would
+ * raise SIGBUS on the next read past its new end. Mapped ranges are
+ * therefore guarded: a SIGBUS handler puts a page of zeros over the
+ * faulting page and flags the range, so readers on any thread see NUL
+ * bytes instead of the process dying, and the owner finds out through
+ * file_mapping_is_intact() or file_mapping_guard_remove().
+ */
+
+typedef struct FileMapping FileMapping;
+
+/**
+ * @brief Maps a regular file read-only
+ * @param path Path to the file to map
+ * @param result Receives the result code (may be NULL)
+ * @return Pointer to mapping instance, or NULL on failure
+ */
+FileMapping* file_mapping_open(const char* path, FileOperationResult* result);
+
+/**
+ * @brief Unmaps the file and frees resources
+ * @param mapping Mapping instance to close
+ */
+void file_mapping_close(FileMapping* mapping);
+
+/**
+ * @brief Gets the mapped bytes
+ * @param mapping Mapping instance
+ * @return Pointer to the file contents (not NUL-terminated), or NULL if empty
+ */
+const char* file_mapping_get_data(const FileMapping* mapping);
+
+/**
+ * @brief Gets the mapped size
+ * @param mapping Mapping instance
+ * @return File size in bytes
+ */
+size_t file_mapping_get_size(const FileMapping* mapping);
+
+/**
+ * @brief Gets the mapped file's path
+ * @param mapping Mapping instance
+ * @return File path (do not free)
+ */
+const char* file_mapping_get_path(const FileMapping* mapping);
+
+/**
+ * @brief Hints that a byte range is about to be read
+ * @param mapping Mapping instance
+ * @param offset Start of the range
+ * @param length Length of the range
+ */
+void file_mapping_prefetch(const FileMapping* mapping, size_t offset, size_t length);
+
+/**
+ * @brief Checks that the file still holds every mapped byte
+ * @param mapping Mapping instance
+ * @return false once the file is shorter than the mapping or a read past
+ *         its end has been answered with zeros
+ */
+bool file_mapping_is_intact(const FileMapping* mapping);
+
+/**
+ * @brief Guards a mapped range against SIGBUS from a truncated file
+ * @param start Start of the range
+ * @param length Length of the range
+ * @return Guard id, or -1 if every guard slot is taken
+ */
+int file_mapping_guard_add(const void* start, size_t length);
+
+/**
+ * @brief Stops guarding a range; call before unmapping it
+ * @param guard Id returned by file_mapping_guard_add() (-1 is ignored)
+ * @return true if a read in the range faulted and saw zeros
+ */
+bool file_mapping_guard_remove(int guard);
+
+#endif /* FILE_MAPPING_H */
\ No newline at end of file
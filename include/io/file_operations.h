@@ -2,7 +2,9 @@
 #define FILE_OPERATIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "core/document.h"
+#include "io/encoding.h"
 
 /**
  * @file file_operations.h
@@ -22,9 +24,20 @@ typedef enum {
     FILE_OP_ERROR_WRITE,
     FILE_OP_ERROR_MEMORY,
     FILE_OP_ERROR_INVALID_PATH,
-    FILE_OP_ERROR_PERMISSION
+    FILE_OP_ERROR_PERMISSION,
+    FILE_OP_ERROR_ENCODING,
+    FILE_OP_ERROR_NUL_BYTES
 } FileOperationResult;
 
+/**
+ * @brief When file_operations_write_atomic() flushes data to stable storage
+ */
+typedef enum {
+    FILE_SYNC_NONE = 0,   /**< Leave flushing to the OS page cache */
+    FILE_SYNC_DATA,       /**< fdatasync() the file before it replaces the target */
+    FILE_SYNC_FULL        /**< fsync() the file, and the directory after the rename */
+} FileSyncPolicy;
+
 /**
  * @brief Callback for error reporting
  * @param error_code The error code
@@ -35,22 +48,84 @@ typedef void (*FileErrorCallback)(FileOperationResult error_code,
                                    const char* message, 
                                    void* user_data);
 
+/**
+ * @brief Reads a file as UTF-8 text of explicit length
+ * @param path Path to the file to read
+ * @param content Receives the text, NUL-terminated (caller must free); it
+ *        may hold NUL bytes of its own
+ * @param length Receives the text length in bytes
+ * @return Result code indicating success or failure
+ *
+ * Files that are not UTF-8 are detected and converted (see encoding.h).
+ */
+FileOperationResult file_operations_read_data(const char* path, char** content, size_t* length);
+
 /**
  * @brief Reads a file and loads its content into a document
  * @param path Path to the file to read
  * @param doc Document to load content into
  * @return Result code indicating success or failure
+ *
+ * Converts like file_operations_read_data(). A document holds a C string,
+ * so text with NUL bytes is refused with FILE_OP_ERROR_NUL_BYTES (the
+ * document is left as it was) rather than cut short.
  */
 FileOperationResult file_operations_read(const char* path, Document* doc);
 
+/**
+ * @brief Writes bytes to a file in place
+ * @param path Path to the file to write
+ * @param data Bytes to write, NUL bytes included
+ * @param length Number of bytes to write
+ * @return Result code indicating success or failure
+ */
+FileOperationResult file_operations_write_data(const char* path, const char* data, size_t length);
+
 /**
  * @brief Writes document content to a file
  * @param path Path to the file to write
  * @param doc Document to save
  * @return Result code indicating success or failure
+ *
+ * Writes document_get_length() bytes of the document's content, like
+ * file_operations_write_data().
  */
 FileOperationResult file_operations_write(const char* path, const Document* doc);
 
+/**
+ * @brief Writes a buffer to a file through a temporary file and rename()
+ * @param path Path to the file to write
+ * @param data Bytes to write
+ * @param length Number of bytes to write
+ * @param policy How much to fsync before and after the rename
+ * @return Result code indicating success or failure
+ *
+ * The data is written to a temporary file in the same directory, which
+ * then atomically replaces the target, so a crash mid-write never leaves a
+ * truncated file behind. The permissions of an existing target are kept and
+ * symbolic links are written through, not replaced.
+ */
+FileOperationResult file_operations_write_atomic(const char* path,
+                                                 const char* data,
+                                                 size_t length,
+                                                 FileSyncPolicy policy);
+
+/**
+ * @brief Converts UTF-8 text to an encoding and writes it atomically
+ * @param path Path to the file to write
+ * @param data UTF-8 text
+ * @param length Number of bytes
+ * @param encoding Encoding to write, normally the one the file was read as
+ * @param policy How much to fsync before and after the rename
+ * @return Result code; FILE_OP_ERROR_ENCODING if the text has characters
+ *         the encoding cannot represent (the file is then left untouched)
+ */
+FileOperationResult file_operations_write_encoded(const char* path,
+                                                  const char* data,
+                                                  size_t length,
+                                                  TextEncoding encoding,
+                                                  FileSyncPolicy policy);
+
 /**
  * @brief Checks if a file exists
  * @param path Path to check
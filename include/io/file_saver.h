@@ -0,0 +1,86 @@
+#ifndef FILE_SAVER_H
+#define FILE_SAVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "io/file_operations.h"
+
+/**
+ * @file file_saver.h
+ * @brief Background file saver - writes document snapshots on a worker thread
+ *
+ * Saves are queued with a snapshot of the content and written in order by a
+ * single writer thread using file_operations_write_encoded(). The caller
+ * keeps editing while the write runs and collects outcomes with
+ * file_saver_take_result(), typically from a main loop timer.
+ */
+
+typedef struct FileSaver FileSaver;
+
+/**
+ * @brief Frees a snapshot buffer once it has been written
+ * @param data The buffer passed to file_saver_submit()
+ */
+typedef void (*FileSaverRelease)(void* data);
+
+/**
+ * @brief Outcome of one queued save
+ */
+typedef struct {
+    FileOperationResult result;
+    char* path;          /**< Path that was written (caller must free) */
+    unsigned long tag;   /**< Tag passed to file_saver_submit() */
+} FileSaveResult;
+
+/**
+ * @brief Creates a saver and starts its writer thread
+ * @return Pointer to saver instance, or NULL on failure
+ */
+FileSaver* file_saver_create(void);
+
+/**
+ * @brief Writes out every queued save, stops the writer and frees resources
+ * @param saver Saver instance to destroy
+ *
+ * Blocks until pending saves are on disk, so no data is lost on exit.
+ * Results that were not taken are discarded.
+ */
+void file_saver_destroy(FileSaver* saver);
+
+/**
+ * @brief Queues a snapshot to be written
+ * @param saver Saver instance
+ * @param path Destination path
+ * @param data Snapshot bytes; ownership passes to the saver on success
+ * @param length Number of bytes to write
+ * @param release Frees data after writing (may be NULL)
+ * @param policy fsync policy for this write
+ * @param encoding Encoding the UTF-8 snapshot is converted to on the writer thread
+ * @param tag Caller-defined value returned with the result
+ * @return true if queued, false on failure (data is still owned by the caller)
+ */
+bool file_saver_submit(FileSaver* saver,
+                       const char* path,
+                       void* data,
+                       size_t length,
+                       FileSaverRelease release,
+                       FileSyncPolicy policy,
+                       TextEncoding encoding,
+                       unsigned long tag);
+
+/**
+ * @brief Takes the oldest completed save result, if any
+ * @param saver Saver instance
+ * @param result Receives the outcome; free result->path when done
+ * @return true if a result was returned, false if none is ready
+ */
+bool file_saver_take_result(FileSaver* saver, FileSaveResult* result);
+
+/**
+ * @brief Checks whether saves are queued, running or awaiting collection
+ * @param saver Saver instance
+ * @return true if there is nothing left to do or collect
+ */
+bool file_saver_is_idle(FileSaver* saver);
+
+#endif /* FILE_SAVER_H */
\ No newline at end of file
@@ -0,0 +1,187 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file journal.h
+ * @brief Crash-safe edit journal - replays unsaved edits after a crash
+ *
+ * Every edit made since the document was last loaded or saved is appended
+ * to a journal file as a compact binary record (offset, span, inserted
+ * bytes, CRC-32). Recording only encodes the record into a memory buffer
+ * under a mutex; a writer thread appends the buffered records and
+ * fdatasync()s them once per flush interval.
+ *
+ * The journal header names the base the edits apply to: a file, identified
+ * by path, size, inode and modification time, or an empty untitled
+ * document. After a save the journal is rebased onto the saved file,
+ * keeping only the edits made while the save was running.
+ *
+ * A journal left behind by a process that is no longer running is found
+ * with journal_find_orphan() and replayed with the JournalRecovery
+ * functions. Offsets and spans are in the caller's units.
+ */
+
+typedef struct Journal Journal;
+typedef struct JournalRecovery JournalRecovery;
+
+/**
+ * @brief One recorded edit: removed_span units at offset replaced by inserted
+ */
+typedef struct {
+    uint64_t offset;
+    uint64_t removed_span;
+    const char* inserted;
+    size_t inserted_length;
+    uint64_t inserted_span;
+} JournalEdit;
+
+/**
+ * @brief Applies a recovered edit
+ * @param edit The edit; its pointers are only valid during the call
+ * @param user_data User-provided data
+ */
+typedef void (*JournalApply)(const JournalEdit* edit, void* user_data);
+
+/**
+ * @brief Drops a reference the journal held on shared bytes
+ * @param owner Reference passed to journal_record_insert_shared()
+ *
+ * May be called on the writer thread.
+ */
+typedef void (*JournalRelease)(void* owner);
+
+/**
+ * @brief Creates a journal file for an untitled document and starts its writer
+ * @param path Journal file to create (truncated if it exists)
+ * @param flush_interval_ms How often buffered records are written and synced
+ * @return Pointer to journal instance, or NULL on failure
+ */
+Journal* journal_open(const char* path, unsigned int flush_interval_ms);
+
+/**
+ * @brief Writes out buffered records, stops the writer and closes the file
+ * @param journal Journal instance to close
+ * @param remove true to delete the file (clean exit), false to keep it
+ */
+void journal_close(Journal* journal, bool remove);
+
+/**
+ * @brief Records an insertion
+ * @param journal Journal instance
+ * @param offset Where the text was inserted
+ * @param text Inserted bytes
+ * @param length Number of bytes
+ * @param span Extent of the text in offset units
+ */
+void journal_record_insert(Journal* journal, uint64_t offset,
+                           const char* text, size_t length, uint64_t span);
+
+/**
+ * @brief Records an insertion without copying its bytes
+ * @param journal Journal instance
+ * @param offset Where the text was inserted
+ * @param text Inserted bytes; must stay valid while owner is referenced
+ * @param length Number of bytes
+ * @param span Extent of the text in offset units
+ * @param owner Reference keeping text alive; the journal takes it over
+ * @param release Drops owner once the writer has appended the record
+ *
+ * For large insertions: the writer reads the bytes where they are, so the
+ * recording thread only encodes the record's header.
+ */
+void journal_record_insert_shared(Journal* journal, uint64_t offset, const char* text, size_t length,
+                                  uint64_t span, void* owner, JournalRelease release);
+
+/**
+ * @brief Records a deletion
+ * @param journal Journal instance
+ * @param offset Start of the deleted range
+ * @param span Extent of the range in offset units
+ */
+void journal_record_delete(Journal* journal, uint64_t offset, uint64_t span);
+
+/**
+ * @brief Gets the position after the last recorded edit
+ * @param journal Journal instance
+ * @return Position to pass to journal_rebase()
+ */
+uint64_t journal_get_position(const Journal* journal);
+
+/**
+ * @brief Moves the journal onto a new base
+ * @param journal Journal instance
+ * @param document_path File the kept edits apply to, or NULL for an
+ *        empty untitled document
+ * @param position Edits recorded before this position are dropped
+ *
+ * Call after loading a file (with the current position) or after a save
+ * completes (with the position taken when its snapshot was made). The
+ * writer rewrites the file atomically and stats the new base.
+ */
+void journal_rebase(Journal* journal, const char* document_path, uint64_t position);
+
+/**
+ * @brief Checks whether writing the journal has failed
+ * @param journal Journal instance
+ * @return true if records are no longer being written
+ */
+bool journal_has_failed(Journal* journal);
+
+/**
+ * @brief Finds a journal left behind by a process that is no longer running
+ * @param directory Directory holding journals named "<pid>.journal"
+ * @return Path of the journal (caller must free), or NULL if there is none
+ */
+char* journal_find_orphan(const char* directory);
+
+/**
+ * @brief Reads a journal for recovery
+ * @param path Journal file
+ * @return Pointer to recovery instance, or NULL if the file is unreadable
+ *         or its header is damaged
+ *
+ * Records after the first damaged or incomplete one are ignored.
+ */
+JournalRecovery* journal_recovery_open(const char* path);
+
+/**
+ * @brief Frees a recovery instance; the journal file is left in place
+ * @param recovery Recovery instance to close
+ */
+void journal_recovery_close(JournalRecovery* recovery);
+
+/**
+ * @brief Gets the file the edits apply to
+ * @param recovery Recovery instance
+ * @return Path, or NULL if the base is an empty untitled document
+ */
+const char* journal_recovery_get_document_path(const JournalRecovery* recovery);
+
+/**
+ * @brief Gets the number of intact edits
+ * @param recovery Recovery instance
+ * @return Edit count
+ */
+size_t journal_recovery_get_edit_count(const JournalRecovery* recovery);
+
+/**
+ * @brief Checks whether the base file is unchanged since it was journalled
+ * @param recovery Recovery instance
+ * @return true if the edits can be applied to the file as it is now
+ */
+bool journal_recovery_base_matches(const JournalRecovery* recovery);
+
+/**
+ * @brief Replays every intact edit in order
+ * @param recovery Recovery instance
+ * @param apply Called for each edit
+ * @param user_data User data passed to apply
+ * @return Number of edits applied
+ */
+size_t journal_recovery_replay(const JournalRecovery* recovery, JournalApply apply, void* user_data);
+
+#endif /* JOURNAL_H */
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define THEME_MANAGER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @file theme_manager.h
@@ -14,11 +15,16 @@
  */
 
 /**
- * @brief Available theme types
+ * @brief Theme identifiers
+ *
+ * The built-in themes come first; themes loaded with
+ * theme_manager_load_directory() are numbered after them, up to
+ * theme_manager_get_count() - 1.
  */
 typedef enum {
     THEME_DARK,
-    THEME_LIGHT
+    THEME_LIGHT,
+    THEME_BUILTIN_COUNT
 } ThemeType;
 
 /**
@@ -69,15 +75,18 @@ ThemeType theme_manager_get_current(const ThemeManager* manager);
 void theme_manager_set_theme(ThemeManager* manager, ThemeType theme);
 
 /**
- * @brief Toggles between dark and light themes
+ * @brief Switches to the next theme, wrapping around after the last
  * @param manager Theme manager instance
+ *
+ * With only the built-in themes this toggles between dark and light.
  */
 void theme_manager_toggle(ThemeManager* manager);
 
 /**
  * @brief Gets color configuration for current theme
  * @param manager Theme manager instance
- * @return Pointer to theme colors structure
+ * @return Pointer to theme colors structure (the dark colors for themes
+ *         loaded from disk, which only carry CSS and a style scheme)
  */
 const ThemeColors* theme_manager_get_colors(const ThemeManager* manager);
 
@@ -98,4 +107,47 @@ void theme_manager_register_callback(ThemeManager* manager,
  */
 const char* theme_manager_get_css(const ThemeManager* manager);
 
+/**
+ * @brief Loads every theme in a directory
+ * @param manager Theme manager instance
+ * @param directory Directory holding "<id>.css" files, each next to a
+ *        GtkSourceView style scheme "<id>.xml" whose id is <id>
+ * @return Number of themes added
+ *
+ * Files are loaded in name order; an id that is already registered is
+ * skipped.
+ */
+size_t theme_manager_load_directory(ThemeManager* manager, const char* directory);
+
+/**
+ * @brief Gets the number of themes
+ * @param manager Theme manager instance
+ * @return Built-in plus loaded themes
+ */
+size_t theme_manager_get_count(const ThemeManager* manager);
+
+/**
+ * @brief Gets a theme's display name
+ * @param manager Theme manager instance
+ * @param theme Theme identifier
+ * @return Name, or NULL if there is no such theme
+ */
+const char* theme_manager_get_name(const ThemeManager* manager, ThemeType theme);
+
+/**
+ * @brief Gets the CSS of any theme
+ * @param manager Theme manager instance
+ * @param theme Theme identifier
+ * @return CSS string, or NULL if there is no such theme
+ */
+const char* theme_manager_get_theme_css(const ThemeManager* manager, ThemeType theme);
+
+/**
+ * @brief Gets the id of a theme's GtkSourceView style scheme
+ * @param manager Theme manager instance
+ * @param theme Theme identifier
+ * @return Style scheme id, or NULL if there is no such theme
+ */
+const char* theme_manager_get_scheme_id(const ThemeManager* manager, ThemeType theme);
+
 #endif /* THEME_MANAGER_H */
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef BUFFER_TEXT_H
+#define BUFFER_TEXT_H
+
+#include <gtk/gtk.h>
+#include <stddef.h>
+
+/**
+ * @file buffer_text.h
+ * @brief Moves file bytes into and out of a GtkTextBuffer without loss
+ *
+ * GtkTextBuffer only holds valid UTF-8 without NUL bytes. NULs are shown
+ * as U+2400 SYMBOL FOR NULL and marked with a tag, so they can be turned
+ * back into NULs when the buffer is saved while a U+2400 the file really
+ * contained stays as it is.
+ */
+
+/**
+ * @brief UTF-8 encoding of U+2400, which stands in for a NUL byte
+ */
+#define BUFFER_TEXT_NUL_SYMBOL "\xE2\x90\x80"
+
+/**
+ * @brief Inserts bytes at an iterator
+ * @param buffer Text buffer
+ * @param iter Insert position; moved to the end of the inserted text
+ * @param data Bytes to insert
+ * @param length Number of bytes
+ * @param nul_tag Tag applied to NUL stand-ins (may be NULL)
+ *
+ * Invalid UTF-8 is replaced with U+FFFD.
+ */
+void buffer_text_insert(GtkTextBuffer* buffer, GtkTextIter* iter,
+                        const char* data, size_t length, GtkTextTag* nul_tag);
+
+/**
+ * @brief Gets the whole buffer as file bytes
+ * @param buffer Text buffer
+ * @param nul_tag Tag passed to buffer_text_insert() (may be NULL)
+ * @param length Receives the number of bytes
+ * @return NUL-terminated bytes, which may contain further NULs (free
+ *         with g_free)
+ */
+char* buffer_text_get_bytes(GtkTextBuffer* buffer, GtkTextTag* nul_tag, size_t* length);
+
+/**
+ * @brief Checks whether the buffer holds any NUL stand-ins
+ * @param buffer Text buffer
+ * @param nul_tag Tag passed to buffer_text_insert()
+ * @return TRUE if some text carries the tag
+ */
+gboolean buffer_text_has_nuls(GtkTextBuffer* buffer, GtkTextTag* nul_tag);
+
+/**
+ * @brief Marks every U+2400 in a range as a NUL stand-in
+ * @param buffer Text buffer
+ * @param start Start of the range
+ * @param end End of the range
+ * @param nul_tag Tag passed to buffer_text_insert()
+ *
+ * For text rebuilt from buffer contents, where the tags were lost.
+ */
+void buffer_text_mark_nuls(GtkTextBuffer* buffer, const GtkTextIter* start,
+                           const GtkTextIter* end, GtkTextTag* nul_tag);
+
+/**
+ * @brief Counts the characters buffer_text_insert() makes of valid UTF-8
+ * @param data Bytes
+ * @param length Number of bytes
+ * @return Number of characters, each NUL counting as one
+ */
+glong buffer_text_count_chars(const char* data, size_t length);
+
+#endif /* BUFFER_TEXT_H */
\ No newline at end of file
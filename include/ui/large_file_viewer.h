@@ -0,0 +1,121 @@
+#ifndef LARGE_FILE_VIEWER_H
+#define LARGE_FILE_VIEWER_H
+
+#include <gtk/gtk.h>
+#include <stdbool.h>
+#include "core/worker_pool.h"
+#include "io/file_mapping.h"
+
+/**
+ * @file large_file_viewer.h
+ * @brief Read-only paged viewer for files too large for a GtkTextBuffer
+ *
+ * Keeps a sliding window of a few pages of a mapped file in the text
+ * buffer and swaps pages in and out as the user scrolls, so memory use is
+ * flat regardless of the file size. A position slider jumps anywhere in
+ * the file. Page boundaries fall on line starts whenever possible.
+ *
+ * Lines are counted in jobs on the worker pool, which keep only the line
+ * count at every megabyte; line numbers and go-to-line become available
+ * once it finishes and scan at most a megabyte from the nearest
+ * checkpoint.
+ */
+
+typedef struct LargeFileViewer LargeFileViewer;
+
+/**
+ * @brief Creates a viewer showing a mapped file in a text view
+ * @param text_view Text view whose buffer the viewer takes over
+ * @param mapping File mapping to display; ownership passes to the viewer
+ * @param pool Worker pool that counts the lines; must outlive the viewer
+ * @return Pointer to viewer instance, or NULL on failure (mapping is then
+ *         still owned by the caller)
+ *
+ * The text view is made read-only and its buffer is replaced with the
+ * first window of the file. Buffer changes made by the viewer are not
+ * undoable.
+ */
+LargeFileViewer* large_file_viewer_create(GtkTextView* text_view, FileMapping* mapping,
+                                          WorkerPool* pool);
+
+/**
+ * @brief Destroys the viewer, clears the buffer and closes the mapping
+ * @param viewer Viewer instance to destroy
+ *
+ * The text view is made editable again.
+ */
+void large_file_viewer_destroy(LargeFileViewer* viewer);
+
+/**
+ * @brief Gets the navigation bar (position slider and offset label)
+ * @param viewer Viewer instance
+ * @return Widget to pack next to the text view; destroyed with the viewer
+ */
+GtkWidget* large_file_viewer_get_widget(const LargeFileViewer* viewer);
+
+/**
+ * @brief Moves the window so a byte offset is shown at the top of the view
+ * @param viewer Viewer instance
+ * @param offset Byte offset in the file
+ */
+void large_file_viewer_jump_to_offset(LargeFileViewer* viewer, size_t offset);
+
+/**
+ * @brief Gets the file offset of the first byte in the buffer window
+ * @param viewer Viewer instance
+ * @return Byte offset in the file
+ */
+size_t large_file_viewer_get_window_start(const LargeFileViewer* viewer);
+
+/**
+ * @brief Gets the mapped file shown by the viewer
+ * @param viewer Viewer instance
+ * @return File mapping (owned by the viewer)
+ */
+const FileMapping* large_file_viewer_get_mapping(const LargeFileViewer* viewer);
+
+/**
+ * @brief Gets the selected byte range of the file
+ * @param viewer Viewer instance
+ * @param start Receives the offset of the selection start (the cursor if
+ *              nothing is selected)
+ * @param end Receives the offset of the selection end
+ */
+void large_file_viewer_get_selection(const LargeFileViewer* viewer, size_t* start, size_t* end);
+
+/**
+ * @brief Selects a byte range of the file and scrolls it into view
+ * @param viewer Viewer instance
+ * @param start Offset of the first selected byte
+ * @param end Offset one past the last selected byte
+ *
+ * The window is moved if the range is not already in the buffer.
+ */
+void large_file_viewer_select_range(LargeFileViewer* viewer, size_t start, size_t end);
+
+/**
+ * @brief Gets the number of lines in the file
+ * @param viewer Viewer instance
+ * @return Line count, or 0 while the lines are still being counted
+ */
+size_t large_file_viewer_get_line_count(const LargeFileViewer* viewer);
+
+/**
+ * @brief Moves the window so a line is shown at the top of the view
+ * @param viewer Viewer instance
+ * @param line Zero-based line number (clamped to the last line)
+ * @return true on success, false while the lines are still being counted
+ */
+bool large_file_viewer_goto_line(LargeFileViewer* viewer, size_t line);
+
+/**
+ * @brief Gets the cursor position in file coordinates
+ * @param viewer Viewer instance
+ * @param line Receives the zero-based line number
+ * @param column Receives the zero-based character column
+ * @return true on success, false while the lines are still being counted
+ */
+bool large_file_viewer_get_cursor_position(const LargeFileViewer* viewer,
+                                           size_t* line, size_t* column);
+
+#endif /* LARGE_FILE_VIEWER_H */
\ No newline at end of file
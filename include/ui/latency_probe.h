@@ -0,0 +1,52 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "ui/main_window.h"
+
+/**
+ * @file latency_probe.h
+ * @brief Keystroke-to-frame latency measurement
+ *
+ * Types into the main window's text view with synthetic key events and
+ * times each one from the moment it is queued to the end of the first
+ * frame painted after its text reached the buffer (the frame clock's
+ * "after-paint"). That covers event dispatch, the input method, every
+ * buffer handler, layout and painting; the compositor and display scanout
+ * that follow are not included.
+ *
+ * Each scenario replaces the buffer contents, types a fixed number of
+ * keys at an even pace, and prints one line of results to stdout. Once
+ * every scenario has run the GTK main loop is quit. The probe is meant for
+ * a throwaway session (under Xvfb, for instance): it edits, saves to a
+ * temporary file and leaves the document modified.
+ */
+
+typedef struct LatencyProbe LatencyProbe;
+
+/**
+ * @brief Creates a probe and starts it once the window is on screen
+ * @param window Main window to type into
+ * @param scenarios Comma-separated scenario names (empty, large-buffer,
+ *        long-line, during-save), or NULL for all of them
+ * @param keystrokes Keys typed per scenario
+ * @return Pointer to probe instance, or NULL on failure or an unknown
+ *         scenario name
+ */
+LatencyProbe* latency_probe_create(MainWindow* window, const char* scenarios, size_t keystrokes);
+
+/**
+ * @brief Destroys a probe and removes its temporary file
+ * @param probe Probe instance to destroy
+ */
+void latency_probe_destroy(LatencyProbe* probe);
+
+/**
+ * @brief Checks whether every scenario produced measurements
+ * @param probe Probe instance
+ * @return true if all scenarios ran and each timed at least one keystroke
+ */
+bool latency_probe_succeeded(const LatencyProbe* probe);
+
+#endif /* LATENCY_PROBE_H */
\ No newline at end of file
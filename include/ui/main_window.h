@@ -3,6 +3,9 @@
 
 #include <gtk/gtk.h>
 #include "core/application.h"
+#include "core/change_notifier.h"
+#include "core/worker_pool.h"
+#include "io/file_operations.h"
 
 /**
  * @file main_window.h
@@ -48,6 +51,28 @@ GtkWidget* main_window_get_widget(const MainWindow* window);
  */
 GtkWidget* main_window_get_text_view(const MainWindow* window);
 
+/**
+ * @brief Gets the notifier that reports edits to the editor text
+ * @param window Main window instance
+ * @return Change notifier owned by the window
+ *
+ * Every buffer change (typing, loading, undo, viewer paging) is pushed with
+ * offsets and lengths in characters and delivered once per frame.
+ * Subscribers must unsubscribe before the window is destroyed.
+ */
+ChangeNotifier* main_window_get_change_notifier(const MainWindow* window);
+
+/**
+ * @brief Gets the pool that runs work off the UI thread
+ * @param window Main window instance
+ * @return Worker pool owned by the window
+ *
+ * Completions run on the main loop. The pool's generation advances on
+ * every buffer change, so jobs submitted with WORKER_JOB_DROP_ON_CHANGE
+ * never deliver results computed from outdated text.
+ */
+WorkerPool* main_window_get_worker_pool(const MainWindow* window);
+
 /**
  * @brief Updates the window title based on document state
  * @param window Main window instance
@@ -72,6 +97,101 @@ char* main_window_get_text(const MainWindow* window);
  */
 void main_window_set_text(MainWindow* window, const char* text);
 
+/**
+ * @brief Loads a file into the editor in the background
+ * @param window Main window instance
+ * @param path Path to the file to open
+ *
+ * The file is read on a worker thread and inserted in chunks from the main
+ * loop, so the window stays responsive and the first screenful is shown
+ * before the rest of the file has arrived. Files above the large file
+ * threshold open in the read-only paged viewer instead. Any load in
+ * progress is cancelled.
+ */
+void main_window_load_file(MainWindow* window, const char* path);
+
+/**
+ * @brief Cancels a background load and resets the editor to a new document
+ * @param window Main window instance
+ */
+void main_window_cancel_load(MainWindow* window);
+
+/**
+ * @brief Offers to recover the edits of a session that did not exit cleanly
+ * @param window Main window instance
+ *
+ * Looks for an edit journal left by a process that is no longer running.
+ * If the user accepts, its file is loaded and the journalled edits are
+ * replayed on top. Call once at startup, after the window is shown.
+ */
+void main_window_recover(MainWindow* window);
+
+/**
+ * @brief Starts recording the editing session to an edit trace
+ * @param window Main window instance
+ * @param path Trace file to create (see io/edit_trace.h)
+ * @return true if recording started
+ *
+ * The current content is recorded as the base, followed by every edit,
+ * undo step and user action, and a new base whenever the buffer is
+ * replaced (New, Open). Offsets are bytes of the buffer text, in which NUL
+ * bytes appear as U+2400. Any recording in progress is stopped first.
+ */
+bool main_window_record_edits(MainWindow* window, const char* path);
+
+/**
+ * @brief Stops recording the editing session
+ * @param window Main window instance
+ * @return false if recording stopped early because the trace could not be
+ *         written; true otherwise, including when nothing was recorded
+ */
+bool main_window_stop_recording(MainWindow* window);
+
+/**
+ * @brief Checks whether a background load is in progress
+ * @param window Main window instance
+ * @return true while a file is being loaded
+ */
+bool main_window_is_loading(const MainWindow* window);
+
+/**
+ * @brief Checks whether a file is open in the read-only paged viewer
+ * @param window Main window instance
+ * @return true while the large file viewer is active
+ */
+bool main_window_is_viewing(const MainWindow* window);
+
+/**
+ * @brief Sets the size above which files open in the paged viewer
+ * @param window Main window instance
+ * @param bytes Threshold in bytes (default 64 MB), or 0 to always load fully
+ */
+void main_window_set_large_file_threshold(MainWindow* window, size_t bytes);
+
+/**
+ * @brief Sets how saves flush data to disk
+ * @param window Main window instance
+ * @param policy fsync policy used for subsequent saves (default FILE_SYNC_DATA)
+ */
+void main_window_set_sync_policy(MainWindow* window, FileSyncPolicy policy);
+
+/**
+ * @brief Checks whether a background save is queued or running
+ * @param window Main window instance
+ * @return true until every submitted save has completed
+ */
+bool main_window_is_saving(const MainWindow* window);
+
+/**
+ * @brief Saves the buffer to a file in the background
+ * @param window Main window instance
+ * @param path Destination path; becomes the document's path once written
+ *
+ * Save As without the file chooser. Does nothing while the buffer is read
+ * only; failures are reported in an error dialog.
+ */
+void main_window_save_to(MainWindow* window, const char* path);
+
 /**
  * @brief Applies the current theme to the window
  * @param window Main window instance
@@ -0,0 +1,95 @@
+#ifndef REGEX_SEARCH_H
+#define REGEX_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "core/search.h"
+#include "core/worker_pool.h"
+
+/**
+ * @file regex_search.h
+ * @brief Parallel regular expression search over a text snapshot
+ *
+ * Splits an immutable snapshot into line-aligned chunks and scans each
+ * one as a job on the worker pool with GRegex (PCRE syntax: \d, lazy
+ * quantifiers, lookaround, inline flags such as (?i)). Matches are handed
+ * out in document order as soon as every chunk before them is finished,
+ * so the first results arrive long before the whole snapshot has been
+ * scanned. The jobs are dropped when the pool's generation advances.
+ *
+ * '^' and '$' match at line boundaries. A match never crosses a chunk
+ * boundary: chunks end at line ends, except that a line longer than a few
+ * megabytes may be split, and lookbehind does not see past the start of a
+ * chunk. Chunks that are not valid UTF-8 (files in the read-only viewer)
+ * are matched byte by byte.
+ */
+
+/**
+ * @brief Releases the snapshot once the search no longer reads it
+ * @param user_data Value given to regex_search_start()
+ */
+typedef void (*RegexSearchRelease)(void* user_data);
+
+typedef struct RegexSearch RegexSearch;
+
+/**
+ * @brief Compiles a pattern and starts searching a snapshot
+ * @param pool Worker pool that scans the chunks (owning thread only)
+ * @param pattern Perl-compatible regular expression
+ * @param flags SEARCH_IGNORE_CASE and/or SEARCH_WHOLE_WORD
+ * @param text Snapshot to search; must stay valid until released
+ * @param length Snapshot length in bytes
+ * @param release Called when the search is destroyed (may be NULL)
+ * @param release_data Passed to release
+ * @param limit Stop after about this many matches (0 for no limit)
+ * @param error Receives the compiler message on an invalid pattern
+ * @param error_size Size of the error buffer
+ * @return Pointer to search instance, or NULL on failure (the snapshot is
+ *         then still owned by the caller)
+ */
+RegexSearch* regex_search_start(WorkerPool* pool, const char* pattern, unsigned int flags,
+                                const char* text, size_t length,
+                                RegexSearchRelease release, void* release_data,
+                                size_t limit, char* error, size_t error_size);
+
+/**
+ * @brief Stops the scan; matches found so far can still be taken
+ * @param search Search instance
+ */
+void regex_search_cancel(RegexSearch* search);
+
+/**
+ * @brief Cancels the search and releases the snapshot
+ * @param search Search instance to destroy
+ *
+ * Waits for chunks being scanned to stop, so the snapshot may be freed
+ * or unmapped as soon as this returns. The rest of the search is freed
+ * once the pool has delivered its last job.
+ */
+void regex_search_destroy(RegexSearch* search);
+
+/**
+ * @brief Takes the next matches in document order
+ * @param search Search instance
+ * @param matches Receives up to capacity matches
+ * @param capacity Size of the matches array
+ * @return Number of matches stored
+ */
+size_t regex_search_take_matches(RegexSearch* search, SearchMatch* matches, size_t capacity);
+
+/**
+ * @brief Checks whether all matches have been found and taken
+ * @param search Search instance
+ * @return true when no more matches will arrive
+ */
+bool regex_search_is_finished(RegexSearch* search);
+
+/**
+ * @brief Checks whether the search stopped early (limit or cancel)
+ * @param search Search instance
+ * @return true if part of the snapshot was not searched; only meaningful
+ *         once the search is finished
+ */
+bool regex_search_is_truncated(RegexSearch* search);
+
+#endif /* REGEX_SEARCH_H */
\ No newline at end of file
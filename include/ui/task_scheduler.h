@@ -0,0 +1,102 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <gtk/gtk.h>
+#include <stdbool.h>
+
+/**
+ * @file task_scheduler.h
+ * @brief Frame-budgeted background work on the GTK thread
+ *
+ * Runs resumable tasks from a low-priority idle source, below redraws and
+ * input, and stops for the rest of a frame once the work done in it
+ * reaches the frame budget. The next frame clock tick resumes them.
+ *
+ * A task is a step function called repeatedly with a deadline; it does a
+ * slice of work, keeps its progress in its own data, and returns whether
+ * it has more to do. Higher priorities run first; tasks of the same
+ * priority take turns.
+ */
+
+typedef struct TaskScheduler TaskScheduler;
+
+/**
+ * @brief Task priorities, most urgent first
+ */
+typedef enum {
+    TASK_PRIORITY_HIGH,    /* Visible results the user is waiting for */
+    TASK_PRIORITY_NORMAL,  /* Results shown in the view (highlighting, match painting) */
+    TASK_PRIORITY_LOW,     /* Statistics and other results off screen */
+    TASK_PRIORITY_COUNT
+} TaskPriority;
+
+/**
+ * @brief Does one slice of a task
+ * @param deadline Monotonic time (g_get_monotonic_time()) to return by
+ * @param user_data User-provided data
+ * @return true to be called again, false when the task is finished
+ */
+typedef bool (*TaskStep)(gint64 deadline, gpointer user_data);
+
+/**
+ * @brief Time spent on tasks, in microseconds
+ */
+typedef struct {
+    gint64 frame_budget;  /* Task time allowed per frame */
+    gint64 last_frame;    /* Task time in the last frame that ran tasks */
+    gint64 peak_frame;    /* Most task time in any one frame */
+    gint64 total;         /* Task time since the scheduler was created */
+    guint64 frames;       /* Frames that ran tasks */
+    guint pending;        /* Tasks waiting to run */
+} TaskSchedulerStats;
+
+/**
+ * @brief Creates a scheduler paced by a widget's frame clock
+ * @param widget Widget whose frame clock marks frame boundaries; while it
+ *        is not mapped a fixed 60 Hz frame is assumed
+ * @param frame_budget_us Task time allowed per frame
+ * @return Pointer to scheduler instance, or NULL on failure
+ */
+TaskScheduler* task_scheduler_create(GtkWidget* widget, gint64 frame_budget_us);
+
+/**
+ * @brief Destroys a scheduler; pending tasks are cancelled
+ * @param scheduler Scheduler instance to destroy
+ */
+void task_scheduler_destroy(TaskScheduler* scheduler);
+
+/**
+ * @brief Queues a task
+ * @param scheduler Scheduler instance
+ * @param priority Task priority
+ * @param step Called until it returns false
+ * @param user_data User data passed to step
+ * @param destroy Frees user_data once the task is finished or dropped
+ *        (may be NULL)
+ * @param generation Counter the task's inputs depend on, or NULL; the task
+ *        is dropped without another step once it no longer holds the value
+ *        it had when the task was queued
+ * @return Task id, or 0 on failure (destroy is then called)
+ */
+guint task_scheduler_add(TaskScheduler* scheduler, TaskPriority priority,
+                         TaskStep step, gpointer user_data, GDestroyNotify destroy,
+                         const unsigned long* generation);
+
+/**
+ * @brief Cancels a task
+ * @param scheduler Scheduler instance
+ * @param id Id returned by task_scheduler_add(); ignored if the task has
+ *        already finished
+ *
+ * May be called from a step, including the task's own.
+ */
+void task_scheduler_cancel(TaskScheduler* scheduler, guint id);
+
+/**
+ * @brief Gets the time spent on tasks
+ * @param scheduler Scheduler instance
+ * @param stats Receives the figures
+ */
+void task_scheduler_get_stats(const TaskScheduler* scheduler, TaskSchedulerStats* stats);
+
+#endif /* TASK_SCHEDULER_H */
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef THEME_CACHE_H
+#define THEME_CACHE_H
+
+#include <gtk/gtk.h>
+#include <gtksourceview/gtksource.h>
+#include "theme/theme_manager.h"
+
+/**
+ * @file theme_cache.h
+ * @brief Pre-built GTK resources for each theme
+ *
+ * Parses each theme's CSS into its own GtkCssProvider and looks its style
+ * scheme up once. Applying a theme swaps the screen-wide provider for the
+ * theme's and sets its scheme on every registered buffer, so switching
+ * never parses CSS or searches for scheme files again.
+ */
+
+typedef struct ThemeCache ThemeCache;
+
+/**
+ * @brief Builds the providers and schemes of every theme
+ * @param manager Theme manager listing the themes; must outlive the cache
+ * @param scheme_manager Scheme manager the style schemes are looked up in
+ *        (referenced by the cache)
+ * @param screen Screen the active provider is installed on
+ * @return Pointer to cache instance, or NULL on failure
+ *
+ * Themes the manager gains later are built the first time they are
+ * applied.
+ */
+ThemeCache* theme_cache_create(const ThemeManager* manager,
+                               GtkSourceStyleSchemeManager* scheme_manager,
+                               GdkScreen* screen);
+
+/**
+ * @brief Removes the active provider and frees the cache
+ * @param cache Cache instance to destroy
+ */
+void theme_cache_destroy(ThemeCache* cache);
+
+/**
+ * @brief Keeps a buffer's style scheme in step with the applied theme
+ * @param cache Cache instance
+ * @param buffer Buffer to restyle; forgotten when it is finalized
+ */
+void theme_cache_add_buffer(ThemeCache* cache, GtkSourceBuffer* buffer);
+
+/**
+ * @brief Makes a theme the active one
+ * @param cache Cache instance
+ * @param theme Theme identifier
+ */
+void theme_cache_apply(ThemeCache* cache, ThemeType theme);
+
+/**
+ * @brief Gets how long the last theme_cache_apply() took
+ * @param cache Cache instance
+ * @return Microseconds, not counting the restyle GTK does on the next frame
+ */
+gint64 theme_cache_get_last_apply_time(const ThemeCache* cache);
+
+#endif /* THEME_CACHE_H */
\ No newline at end of file
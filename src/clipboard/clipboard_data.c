@@ -0,0 +1,99 @@
+#include "clipboard/clipboard_data.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Clipboard content structure
+ *
+ * Copied content is stored right after the structure, in the same block.
+ */
+struct ClipboardData {
+    atomic_uint references;
+    const char* data;
+    size_t length;
+    ClipboardDataRelease release;
+    void* release_data;
+    char inline_data[];
+};
+
+ClipboardData* clipboard_data_create(const char* data, size_t length) {
+    if ((!data && length > 0) || length > SIZE_MAX - sizeof(ClipboardData) - 1) {
+        return NULL;
+    }
+
+    ClipboardData* content = (ClipboardData*)malloc(sizeof(ClipboardData) + length + 1);
+    if (!content) {
+        return NULL;
+    }
+
+    if (length > 0) {
+        memcpy(content->inline_data, data, length);
+    }
+    content->inline_data[length] = '\0';
+
+    atomic_init(&content->references, 1);
+    content->data = content->inline_data;
+    content->length = length;
+    content->release = NULL;
+    content->release_data = NULL;
+
+    return content;
+}
+
+ClipboardData* clipboard_data_create_adopt(const char* data, size_t length,
+                                           ClipboardDataRelease release, void* user_data) {
+    if (!data && length > 0) {
+        return NULL;
+    }
+
+    ClipboardData* content = (ClipboardData*)malloc(sizeof(ClipboardData));
+    if (!content) {
+        return NULL;
+    }
+
+    atomic_init(&content->references, 1);
+    content->data = data;
+    content->length = length;
+    content->release = release;
+    content->release_data = user_data;
+
+    return content;
+}
+
+ClipboardData* clipboard_data_ref(ClipboardData* content) {
+    if (content) {
+        atomic_fetch_add_explicit(&content->references, 1, memory_order_relaxed);
+    }
+    return content;
+}
+
+void clipboard_data_unref(ClipboardData* content) {
+    if (!content) {
+        return;
+    }
+
+    if (atomic_fetch_sub_explicit(&content->references, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    if (content->release) {
+        content->release(content->data, content->length, content->release_data);
+    }
+    free(content);
+}
+
+const char* clipboard_data_get_bytes(const ClipboardData* content, size_t* length) {
+    if (!content) {
+        if (length) {
+            *length = 0;
+        }
+        return NULL;
+    }
+
+    if (length) {
+        *length = content->length;
+    }
+    return content->data;
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #define _POSIX_C_SOURCE 200809L
 #include "clipboard/clipboard_operations.h"
+#include "clipboard/clipboard_data.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -8,10 +9,11 @@
  * 
  * In a real implementation, this would interface with the system clipboard.
  * For simplicity, we're using an internal buffer that can be extended
- * to use GTK's clipboard API or platform-specific clipboard APIs.
+ * to use GTK's clipboard API or platform-specific clipboard APIs. The
+ * content is shared, not copied, with whoever else offers it.
  */
 struct ClipboardOperations {
-    char* buffer;
+    ClipboardData* content;
     ClipboardCallback callback;
     void* user_data;
 };
@@ -22,7 +24,7 @@ ClipboardOperations* clipboard_operations_create(void) {
         return NULL;
     }
     
-    clipboard->buffer = NULL;
+    clipboard->content = NULL;
     clipboard->callback = NULL;
     clipboard->user_data = NULL;
     
@@ -34,36 +36,83 @@ void clipboard_operations_destroy(ClipboardOperations* clipboard) {
         return;
     }
     
-    free(clipboard->buffer);
+    clipboard_data_unref(clipboard->content);
     free(clipboard);
 }
 
 bool clipboard_operations_copy(ClipboardOperations* clipboard, const char* text) {
-    if (!clipboard || !text) {
+    if (!text) {
         return false;
     }
-    
-    char* new_buffer = strdup(text);
-    if (!new_buffer) {
+
+    return clipboard_operations_copy_data(clipboard, text, strlen(text));
+}
+
+bool clipboard_operations_copy_data(ClipboardOperations* clipboard, const char* data, size_t length) {
+    if (!clipboard || (!data && length > 0)) {
         return false;
     }
     
-    free(clipboard->buffer);
-    clipboard->buffer = new_buffer;
-    
+    ClipboardData* content = clipboard_data_create(data, length);
+    if (!content) {
+        return false;
+    }
+
+    bool stored = clipboard_operations_set_data(clipboard, content);
+    clipboard_data_unref(content);
+
+    return stored;
+}
+
+bool clipboard_operations_set_data(ClipboardOperations* clipboard, ClipboardData* content) {
+    if (!clipboard || !content) {
+        return false;
+    }
+
+    clipboard_data_ref(content);
+    clipboard_data_unref(clipboard->content);
+    clipboard->content = content;
+
     if (clipboard->callback) {
         clipboard->callback(clipboard->user_data);
     }
-    
+
     return true;
 }
 
+ClipboardData* clipboard_operations_get_data(ClipboardOperations* clipboard) {
+    if (!clipboard) {
+        return NULL;
+    }
+
+    return clipboard_data_ref(clipboard->content);
+}
+
 char* clipboard_operations_paste(ClipboardOperations* clipboard) {
-    if (!clipboard || !clipboard->buffer) {
+    return clipboard_operations_paste_data(clipboard, NULL);
+}
+
+char* clipboard_operations_paste_data(ClipboardOperations* clipboard, size_t* length) {
+    if (!clipboard || !clipboard->content) {
         return NULL;
     }
-    
-    return strdup(clipboard->buffer);
+
+    size_t content_length;
+    const char* bytes = clipboard_data_get_bytes(clipboard->content, &content_length);
+
+    char* copy = (char*)malloc(content_length + 1);
+    if (!copy) {
+        return NULL;
+    }
+    if (content_length > 0) {
+        memcpy(copy, bytes, content_length);
+    }
+    copy[content_length] = '\0';
+
+    if (length) {
+        *length = content_length;
+    }
+    return copy;
 }
 
 bool clipboard_operations_has_text(const ClipboardOperations* clipboard) {
@@ -71,7 +120,8 @@ bool clipboard_operations_has_text(const ClipboardOperations* clipboard) {
         return false;
     }
     
-    return clipboard->buffer != NULL && clipboard->buffer[0] != '\0';
+    size_t length;
+    return clipboard_data_get_bytes(clipboard->content, &length) != NULL && length > 0;
 }
 
 void clipboard_operations_clear(ClipboardOperations* clipboard) {
@@ -79,6 +129,6 @@ void clipboard_operations_clear(ClipboardOperations* clipboard) {
         return;
     }
     
-    free(clipboard->buffer);
-    clipboard->buffer = NULL;
+    clipboard_data_unref(clipboard->content);
+    clipboard->content = NULL;
 }
\ No newline at end of file
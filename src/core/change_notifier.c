@@ -0,0 +1,196 @@
+#include "core/change_notifier.h"
+#include <stdlib.h>
+
+/**
+ * @brief Changes queued before new ones are folded into the last
+ *
+ * Keeps a batch small when edits are scattered (e.g. a multi-cursor
+ * replace); the folded change then covers more than what really changed.
+ */
+#define MAX_PENDING_CHANGES 256
+
+/**
+ * @brief One subscriber; a NULL listener marks a slot removed mid-flush
+ */
+typedef struct {
+    unsigned long id;
+    ChangeListener listener;
+    void* user_data;
+} Subscriber;
+
+/**
+ * @brief Change notifier structure
+ */
+struct ChangeNotifier {
+    TextChange* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    Subscriber* subscribers;
+    size_t subscriber_count;
+    size_t subscriber_capacity;
+    unsigned long next_id;
+    bool flushing;
+};
+
+/**
+ * @brief Folds change b, made after a, into a
+ *
+ * The result replaces the smallest range covering both, which is exact
+ * when they touch or overlap.
+ */
+static void merge_change(TextChange* a, const TextChange* b) {
+    size_t a_end = a->offset + a->inserted_length;
+    size_t b_end = b->offset + b->removed_length;
+    size_t start = a->offset < b->offset ? a->offset : b->offset;
+    size_t end = a_end > b_end ? a_end : b_end;
+    size_t span = end - start;
+
+    a->removed_length = span - a->inserted_length + a->removed_length;
+    a->inserted_length = span - b->removed_length + b->inserted_length;
+    a->offset = start;
+}
+
+/**
+ * @brief Drops the slots of subscribers removed during a flush
+ */
+static void compact_subscribers(ChangeNotifier* notifier) {
+    size_t kept = 0;
+    for (size_t i = 0; i < notifier->subscriber_count; i++) {
+        if (notifier->subscribers[i].listener) {
+            notifier->subscribers[kept++] = notifier->subscribers[i];
+        }
+    }
+    notifier->subscriber_count = kept;
+}
+
+ChangeNotifier* change_notifier_create(void) {
+    ChangeNotifier* notifier = (ChangeNotifier*)calloc(1, sizeof(ChangeNotifier));
+    if (!notifier) {
+        return NULL;
+    }
+
+    notifier->next_id = 1;
+    return notifier;
+}
+
+void change_notifier_destroy(ChangeNotifier* notifier) {
+    if (!notifier) {
+        return;
+    }
+
+    free(notifier->pending);
+    free(notifier->subscribers);
+    free(notifier);
+}
+
+unsigned long change_notifier_subscribe(ChangeNotifier* notifier, ChangeListener listener, void* user_data) {
+    if (!notifier || !listener) {
+        return 0;
+    }
+
+    if (notifier->subscriber_count == notifier->subscriber_capacity) {
+        size_t capacity = notifier->subscriber_capacity ? notifier->subscriber_capacity * 2 : 4;
+        Subscriber* subscribers = (Subscriber*)realloc(notifier->subscribers, capacity * sizeof(Subscriber));
+        if (!subscribers) {
+            return 0;
+        }
+        notifier->subscribers = subscribers;
+        notifier->subscriber_capacity = capacity;
+    }
+
+    Subscriber* subscriber = &notifier->subscribers[notifier->subscriber_count++];
+    subscriber->id = notifier->next_id++;
+    subscriber->listener = listener;
+    subscriber->user_data = user_data;
+    return subscriber->id;
+}
+
+void change_notifier_unsubscribe(ChangeNotifier* notifier, unsigned long id) {
+    if (!notifier || id == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < notifier->subscriber_count; i++) {
+        if (notifier->subscribers[i].id == id) {
+            notifier->subscribers[i].listener = NULL;
+            break;
+        }
+    }
+
+    /* A flush in progress is still walking the array */
+    if (!notifier->flushing) {
+        compact_subscribers(notifier);
+    }
+}
+
+void change_notifier_push(ChangeNotifier* notifier, size_t offset,
+                          size_t removed_length, size_t inserted_length) {
+    if (!notifier || (removed_length == 0 && inserted_length == 0)) {
+        return;
+    }
+
+    TextChange change = { offset, removed_length, inserted_length };
+
+    if (notifier->pending_count > 0) {
+        TextChange* last = &notifier->pending[notifier->pending_count - 1];
+        bool touches = change.offset <= last->offset + last->inserted_length &&
+                       change.offset + change.removed_length >= last->offset;
+        if (touches || notifier->pending_count == MAX_PENDING_CHANGES) {
+            merge_change(last, &change);
+            return;
+        }
+    }
+
+    if (notifier->pending_count == notifier->pending_capacity) {
+        size_t capacity = notifier->pending_capacity ? notifier->pending_capacity * 2 : 16;
+        TextChange* pending = (TextChange*)realloc(notifier->pending, capacity * sizeof(TextChange));
+        if (!pending) {
+            /* Still report the change, if less precisely */
+            if (notifier->pending_count > 0) {
+                merge_change(&notifier->pending[notifier->pending_count - 1], &change);
+            }
+            return;
+        }
+        notifier->pending = pending;
+        notifier->pending_capacity = capacity;
+    }
+
+    notifier->pending[notifier->pending_count++] = change;
+}
+
+bool change_notifier_has_pending(const ChangeNotifier* notifier) {
+    return notifier && notifier->pending_count > 0;
+}
+
+void change_notifier_flush(ChangeNotifier* notifier) {
+    if (!notifier || notifier->pending_count == 0 || notifier->flushing) {
+        return;
+    }
+
+    /* Listeners may push again; those changes start the next batch */
+    TextChange* batch = notifier->pending;
+    size_t count = notifier->pending_count;
+    size_t capacity = notifier->pending_capacity;
+    notifier->pending = NULL;
+    notifier->pending_count = 0;
+    notifier->pending_capacity = 0;
+
+    notifier->flushing = true;
+    size_t subscribers = notifier->subscriber_count;
+    for (size_t i = 0; i < subscribers; i++) {
+        Subscriber subscriber = notifier->subscribers[i];
+        if (subscriber.listener) {
+            subscriber.listener(batch, count, subscriber.user_data);
+        }
+    }
+    notifier->flushing = false;
+    compact_subscribers(notifier);
+
+    /* Reuse the batch buffer unless listeners queued into a new one */
+    if (!notifier->pending) {
+        notifier->pending = batch;
+        notifier->pending_capacity = capacity;
+    } else {
+        free(batch);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,647 @@
+#include "core/history.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Smallest arena allocated once something is recorded
+ */
+#define MIN_ARENA_CAPACITY ((size_t)64 * 1024)
+
+/**
+ * @brief Entry slots allocated once something is recorded
+ */
+#define MIN_ENTRY_CAPACITY 64
+
+/**
+ * @brief Largest delta that typing is still merged into
+ */
+#define COALESCE_LIMIT 4096
+
+/**
+ * @brief One recorded delta
+ *
+ * Its payload is the removed bytes followed by the inserted bytes, stored
+ * contiguously at `data` in the arena. A side with an owner is not copied:
+ * its bytes stay in the caller's storage, which the entry holds a
+ * reference to until it is forgotten.
+ */
+typedef struct {
+    size_t offset;
+    size_t removed_length;
+    size_t removed_span;
+    size_t inserted_length;
+    size_t inserted_span;
+    size_t data;
+    unsigned long group;
+    const char* removed_shared;
+    const char* inserted_shared;
+    void* removed_owner;
+    void* inserted_owner;
+    HistoryRelease release;
+} HistoryEntry;
+
+/**
+ * @brief References handed over by history_record_shared()
+ */
+typedef struct {
+    void* removed_owner;
+    void* inserted_owner;
+    HistoryRelease release;
+} SharedPayload;
+
+/**
+ * @brief History structure
+ *
+ * Entries form a ring of `count` slots starting at `first`; the first
+ * `current` of them can be undone, the rest redone. Their payloads are laid
+ * out in the same order in the arena, wrapping to its start when the end
+ * is reached, so the free space is always the gap after the newest payload.
+ */
+struct History {
+    size_t budget;
+    char* arena;
+    size_t arena_capacity;
+    size_t data_bytes;
+    HistoryEntry* entries;
+    size_t entry_capacity;
+    size_t first;
+    size_t count;
+    size_t current;
+    unsigned long next_group;
+    unsigned long group;      /* Group new changes join */
+    int group_depth;
+    size_t group_records;     /* Changes recorded since the outermost group began */
+    bool group_dropped;       /* The open group was discarded */
+    bool coalesce_open;       /* The newest entry may absorb the next change */
+};
+
+/**
+ * @brief Gets the entry at a position counted from the oldest
+ */
+static HistoryEntry* entry_at(const History* history, size_t index) {
+    return &history->entries[(history->first + index) % history->entry_capacity];
+}
+
+/**
+ * @brief Gets the bytes an entry occupies in the arena
+ */
+static size_t entry_size(const HistoryEntry* entry) {
+    return (entry->removed_owner ? 0 : entry->removed_length) +
+           (entry->inserted_owner ? 0 : entry->inserted_length);
+}
+
+/**
+ * @brief Checks whether an entry refers to bytes it did not copy
+ */
+static bool entry_is_shared(const HistoryEntry* entry) {
+    return entry->removed_owner || entry->inserted_owner;
+}
+
+/**
+ * @brief Gets the bytes an entry removed
+ */
+static const char* entry_removed(const History* history, const HistoryEntry* entry) {
+    return entry->removed_owner ? entry->removed_shared : history->arena + entry->data;
+}
+
+/**
+ * @brief Gets the bytes an entry inserted
+ */
+static const char* entry_inserted(const History* history, const HistoryEntry* entry) {
+    if (entry->inserted_owner) {
+        return entry->inserted_shared;
+    }
+    return history->arena + entry->data + (entry->removed_owner ? 0 : entry->removed_length);
+}
+
+/**
+ * @brief Drops the references handed over with a change
+ */
+static void release_shared(const SharedPayload* shared) {
+    if (!shared || !shared->release) {
+        return;
+    }
+    if (shared->removed_owner) {
+        shared->release(shared->removed_owner);
+    }
+    if (shared->inserted_owner) {
+        shared->release(shared->inserted_owner);
+    }
+}
+
+/**
+ * @brief Drops the references an entry holds
+ */
+static void release_entry(HistoryEntry* entry) {
+    SharedPayload shared = {entry->removed_owner, entry->inserted_owner, entry->release};
+    release_shared(&shared);
+    entry->removed_owner = NULL;
+    entry->inserted_owner = NULL;
+}
+
+/**
+ * @brief Gets the bytes counted against the budget
+ */
+static size_t live_bytes(const History* history) {
+    return history->data_bytes + history->count * sizeof(HistoryEntry);
+}
+
+/**
+ * @brief Removes the newest entry
+ */
+static void pop_newest(History* history) {
+    HistoryEntry* entry = entry_at(history, history->count - 1);
+    history->data_bytes -= entry_size(entry);
+    release_entry(entry);
+    history->count--;
+}
+
+/**
+ * @brief Removes every entry of the oldest group
+ */
+static void evict_oldest_group(History* history) {
+    unsigned long group = entry_at(history, 0)->group;
+
+    while (history->count > 0 && entry_at(history, 0)->group == group) {
+        history->data_bytes -= entry_size(entry_at(history, 0));
+        release_entry(entry_at(history, 0));
+        history->first = (history->first + 1) % history->entry_capacity;
+        history->count--;
+        if (history->current > 0) {
+            history->current--;
+        }
+    }
+}
+
+/**
+ * @brief Finds free arena space for a payload without moving anything
+ */
+static bool arena_find(const History* history, size_t length, size_t* position) {
+    if (history->count == 0) {
+        *position = 0;
+        return length <= history->arena_capacity;
+    }
+
+    const HistoryEntry* newest = entry_at(history, history->count - 1);
+    size_t tail = entry_at(history, 0)->data;
+    size_t head = newest->data + entry_size(newest);
+
+    /* Shared entries take no space, so head == tail can also mean empty */
+    if (head > tail || (head == tail && history->data_bytes == 0)) {
+        if (history->arena_capacity - head >= length) {
+            *position = head;
+            return true;
+        }
+        if (tail >= length) {
+            *position = 0;
+            return true;
+        }
+        return false;
+    }
+
+    /* Wrapped: the gap runs from the newest payload to the oldest */
+    if (tail - head >= length) {
+        *position = head;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Moves the payloads into a larger arena, oldest first
+ */
+static bool arena_grow(History* history, size_t length) {
+    size_t needed = history->data_bytes + length;
+    size_t capacity = history->arena_capacity * 2;
+    if (capacity < needed) {
+        capacity = needed;
+    }
+    if (capacity < MIN_ARENA_CAPACITY) {
+        capacity = MIN_ARENA_CAPACITY;
+    }
+    if (capacity > history->budget) {
+        capacity = history->budget;
+    }
+    if (capacity < needed || capacity <= history->arena_capacity) {
+        return false;
+    }
+
+    char* arena = (char*)malloc(capacity);
+    if (!arena) {
+        return false;
+    }
+
+    size_t position = 0;
+    for (size_t i = 0; i < history->count; i++) {
+        HistoryEntry* entry = entry_at(history, i);
+        memcpy(arena + position, history->arena + entry->data, entry_size(entry));
+        entry->data = position;
+        position += entry_size(entry);
+    }
+
+    free(history->arena);
+    history->arena = arena;
+    history->arena_capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Makes room for one more entry slot
+ */
+static bool entries_reserve(History* history) {
+    if (history->count < history->entry_capacity) {
+        return true;
+    }
+
+    size_t capacity = history->entry_capacity ? history->entry_capacity * 2 : MIN_ENTRY_CAPACITY;
+    HistoryEntry* entries = (HistoryEntry*)malloc(capacity * sizeof(HistoryEntry));
+    if (!entries) {
+        return false;
+    }
+
+    for (size_t i = 0; i < history->count; i++) {
+        entries[i] = *entry_at(history, i);
+    }
+
+    free(history->entries);
+    history->entries = entries;
+    history->entry_capacity = capacity;
+    history->first = 0;
+    return true;
+}
+
+/**
+ * @brief Merges a single-character change into the newest entry
+ *
+ * Typing extends an insertion, Delete extends a deletion at the same
+ * offset and Backspace extends one ending where the previous began. The
+ * payload grows in place, so the merge only happens when the arena has
+ * room right after it.
+ */
+static bool try_coalesce(History* history, const HistoryChange* change) {
+    HistoryEntry* newest = entry_at(history, history->count - 1);
+    const char* bytes;
+    size_t length;
+    bool prepend = false;
+
+    /* The bytes of a shared entry cannot grow in place */
+    if (entry_is_shared(newest)) {
+        return false;
+    }
+
+    if (change->removed_length == 0 && change->inserted_span == 1 &&
+        newest->removed_length == 0 && change->offset == newest->offset + newest->inserted_span) {
+        bytes = change->inserted;
+        length = change->inserted_length;
+    } else if (change->inserted_length == 0 && change->removed_span == 1 &&
+               newest->inserted_length == 0 && change->offset == newest->offset) {
+        bytes = change->removed;
+        length = change->removed_length;
+    } else if (change->inserted_length == 0 && change->removed_span == 1 &&
+               newest->inserted_length == 0 && change->offset + 1 == newest->offset) {
+        bytes = change->removed;
+        length = change->removed_length;
+        prepend = true;
+    } else {
+        return false;
+    }
+
+    /* A new line starts a new undo step */
+    if (memchr(bytes, '\n', length) || entry_size(newest) + length > COALESCE_LIMIT ||
+        live_bytes(history) + length > history->budget) {
+        return false;
+    }
+
+    size_t end = newest->data + entry_size(newest);
+    size_t tail = entry_at(history, 0)->data;
+    size_t room = (history->count > 1 && tail > newest->data) ? tail - end : history->arena_capacity - end;
+    if (room < length) {
+        return false;
+    }
+
+    char* data = history->arena + newest->data;
+    if (prepend) {
+        memmove(data + length, data, entry_size(newest));
+        memcpy(data, bytes, length);
+        newest->offset = change->offset;
+    } else {
+        memcpy(data + entry_size(newest), bytes, length);
+    }
+
+    if (change->removed_length > 0) {
+        newest->removed_length += length;
+        newest->removed_span++;
+    } else {
+        newest->inserted_length += length;
+        newest->inserted_span++;
+    }
+    history->data_bytes += length;
+    return true;
+}
+
+/**
+ * @brief Records a change into the open group
+ * @param shared References to keep instead of copies, or NULL; released
+ *        unless the change is stored
+ */
+static bool record_in_group(History* history, const HistoryChange* change, const SharedPayload* shared) {
+    if (history->group_dropped) {
+        release_shared(shared);
+        return false;
+    }
+
+    if (change->removed_length + change->inserted_length == 0) {
+        release_shared(shared);
+        return true;
+    }
+
+    /* Only the copied sides go into the arena */
+    bool copy_removed = !shared || !shared->removed_owner;
+    bool copy_inserted = !shared || !shared->inserted_owner;
+    size_t length = (copy_removed ? change->removed_length : 0) + (copy_inserted ? change->inserted_length : 0);
+    if (length > history->budget || sizeof(HistoryEntry) + length > history->budget) {
+        release_shared(shared);
+        history_discard(history);
+        return false;
+    }
+
+    /* A new change makes the undone steps unreachable */
+    while (history->count > history->current) {
+        pop_newest(history);
+    }
+
+    if (!shared && history->group_records == 0 && history->coalesce_open && history->count > 0 &&
+        try_coalesce(history, change)) {
+        history->group = entry_at(history, history->count - 1)->group;
+        history->group_records = 1;
+        return true;
+    }
+
+    /* Evicting part of the open group would leave a step that cannot be undone */
+    while (live_bytes(history) + sizeof(HistoryEntry) + length > history->budget) {
+        if (entry_at(history, 0)->group == history->group) {
+            release_shared(shared);
+            history_discard(history);
+            return false;
+        }
+        evict_oldest_group(history);
+    }
+
+    if (!entries_reserve(history)) {
+        release_shared(shared);
+        history_discard(history);
+        return false;
+    }
+
+    size_t position;
+    while (!arena_find(history, length, &position)) {
+        if (arena_grow(history, length)) {
+            continue;
+        }
+        if (history->count == 0 || entry_at(history, 0)->group == history->group) {
+            release_shared(shared);
+            history_discard(history);
+            return false;
+        }
+        evict_oldest_group(history);
+    }
+
+    size_t removed_copy = copy_removed ? change->removed_length : 0;
+    if (removed_copy > 0) {
+        memcpy(history->arena + position, change->removed, removed_copy);
+    }
+    if (copy_inserted && change->inserted_length > 0) {
+        memcpy(history->arena + position + removed_copy, change->inserted, change->inserted_length);
+    }
+
+    HistoryEntry* entry = &history->entries[(history->first + history->count) % history->entry_capacity];
+    entry->offset = change->offset;
+    entry->removed_length = change->removed_length;
+    entry->removed_span = change->removed_span;
+    entry->inserted_length = change->inserted_length;
+    entry->inserted_span = change->inserted_span;
+    entry->data = position;
+    entry->group = history->group;
+    entry->removed_shared = copy_removed ? NULL : change->removed;
+    entry->inserted_shared = copy_inserted ? NULL : change->inserted;
+    entry->removed_owner = copy_removed ? NULL : shared->removed_owner;
+    entry->inserted_owner = copy_inserted ? NULL : shared->inserted_owner;
+    entry->release = shared ? shared->release : NULL;
+
+    history->count++;
+    history->current = history->count;
+    history->data_bytes += length;
+    history->group_records++;
+    return true;
+}
+
+History* history_create(size_t budget) {
+    History* history = (History*)calloc(1, sizeof(History));
+    if (!history) {
+        return NULL;
+    }
+
+    history->budget = budget;
+    return history;
+}
+
+void history_destroy(History* history) {
+    if (!history) {
+        return;
+    }
+
+    history_clear(history);
+    free(history);
+}
+
+void history_clear(History* history) {
+    if (!history) {
+        return;
+    }
+
+    for (size_t i = 0; i < history->count; i++) {
+        release_entry(entry_at(history, i));
+    }
+
+    free(history->arena);
+    free(history->entries);
+    history->arena = NULL;
+    history->arena_capacity = 0;
+    history->data_bytes = 0;
+    history->entries = NULL;
+    history->entry_capacity = 0;
+    history->first = 0;
+    history->count = 0;
+    history->current = 0;
+    history->coalesce_open = false;
+}
+
+void history_discard(History* history) {
+    if (!history) {
+        return;
+    }
+
+    history_clear(history);
+    if (history->group_depth > 0) {
+        history->group_dropped = true;
+    }
+}
+
+void history_begin_group(History* history) {
+    if (!history) {
+        return;
+    }
+
+    if (history->group_depth++ == 0) {
+        history->group = ++history->next_group;
+        history->group_records = 0;
+        history->group_dropped = false;
+    }
+}
+
+void history_end_group(History* history) {
+    if (!history || history->group_depth == 0) {
+        return;
+    }
+
+    if (--history->group_depth == 0 && history->group_records > 0) {
+        history->coalesce_open = history->group_records == 1 && !history->group_dropped;
+    }
+}
+
+bool history_record(History* history, const HistoryChange* change) {
+    if (!history || !change) {
+        return false;
+    }
+
+    history_begin_group(history);
+    bool recorded = record_in_group(history, change, NULL);
+    history_end_group(history);
+    return recorded;
+}
+
+bool history_record_shared(History* history, const HistoryChange* change,
+                           void* removed_owner, void* inserted_owner, HistoryRelease release) {
+    SharedPayload shared = {removed_owner, inserted_owner, release};
+    if (!history || !change) {
+        release_shared(&shared);
+        return false;
+    }
+
+    history_begin_group(history);
+    bool recorded = record_in_group(history, change, &shared);
+    history_end_group(history);
+    return recorded;
+}
+
+void history_seal(History* history) {
+    if (!history) {
+        return;
+    }
+
+    history->coalesce_open = false;
+}
+
+bool history_undo(History* history, HistoryApply apply, void* user_data) {
+    if (!history || history->group_depth > 0 || history->current == 0) {
+        return false;
+    }
+
+    history->coalesce_open = false;
+    unsigned long group = entry_at(history, history->current - 1)->group;
+
+    while (history->current > 0 && entry_at(history, history->current - 1)->group == group) {
+        const HistoryEntry* entry = entry_at(history, --history->current);
+
+        HistoryChange inverse = {
+            .offset = entry->offset,
+            .removed = entry_inserted(history, entry),
+            .removed_length = entry->inserted_length,
+            .removed_span = entry->inserted_span,
+            .inserted = entry_removed(history, entry),
+            .inserted_length = entry->removed_length,
+            .inserted_span = entry->removed_span
+        };
+        if (apply) {
+            apply(&inverse, user_data);
+        }
+    }
+
+    return true;
+}
+
+bool history_redo(History* history, HistoryApply apply, void* user_data) {
+    if (!history || history->group_depth > 0 || history->current == history->count) {
+        return false;
+    }
+
+    history->coalesce_open = false;
+    unsigned long group = entry_at(history, history->current)->group;
+
+    while (history->current < history->count && entry_at(history, history->current)->group == group) {
+        const HistoryEntry* entry = entry_at(history, history->current++);
+
+        HistoryChange change = {
+            .offset = entry->offset,
+            .removed = entry_removed(history, entry),
+            .removed_length = entry->removed_length,
+            .removed_span = entry->removed_span,
+            .inserted = entry_inserted(history, entry),
+            .inserted_length = entry->inserted_length,
+            .inserted_span = entry->inserted_span
+        };
+        if (apply) {
+            apply(&change, user_data);
+        }
+    }
+
+    return true;
+}
+
+bool history_can_undo(const History* history) {
+    return history && history->group_depth == 0 && history->current > 0;
+}
+
+bool history_can_redo(const History* history) {
+    return history && history->group_depth == 0 && history->current < history->count;
+}
+
+size_t history_get_budget(const History* history) {
+    if (!history) {
+        return 0;
+    }
+
+    return history->budget;
+}
+
+void history_set_budget(History* history, size_t budget) {
+    if (!history) {
+        return;
+    }
+
+    history->budget = budget;
+    while (history->current > 0 && live_bytes(history) > budget) {
+        evict_oldest_group(history);
+    }
+
+    /* Only redo steps are left and they still do not fit */
+    if (live_bytes(history) > budget) {
+        history_clear(history);
+    }
+}
+
+size_t history_get_memory_usage(const History* history) {
+    if (!history) {
+        return 0;
+    }
+
+    return live_bytes(history);
+}
+
+size_t history_get_entry_count(const History* history) {
+    if (!history) {
+        return 0;
+    }
+
+    return history->count;
+}
\ No newline at end of file
@@ -0,0 +1,812 @@
+#include "core/line_index.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SCANNERS 1
+#else
+#define HAVE_X86_SCANNERS 0
+#endif
+
+/**
+ * @brief Number of lines a rebuilt block is packed with
+ */
+#define BLOCK_LINES 1024
+
+/**
+ * @brief Number of lines a block may grow to before it is repacked
+ */
+#define MAX_BLOCK_LINES (2 * BLOCK_LINES)
+
+/**
+ * @brief Bytes scanned per call into a scanner
+ *
+ * Bounds the scratch buffer of newline positions.
+ */
+#define SCAN_CHUNK (16 * 1024)
+
+/**
+ * @brief Finds newlines in at most SCAN_CHUNK bytes
+ *
+ * Writes the position of every '\n' relative to data and returns how many
+ * were found.
+ */
+typedef size_t (*ScanFunction)(const char* data, size_t length, uint32_t* positions);
+
+/**
+ * @brief Counts newlines in a buffer of any length
+ */
+typedef size_t (*CountFunction)(const char* data, size_t length);
+
+/**
+ * @brief One newline scanner implementation
+ */
+typedef struct {
+    const char* name;
+    ScanFunction scan;
+    CountFunction count;
+} NewlineScanner;
+
+/**
+ * @brief A run of consecutive lines
+ *
+ * Blocks always begin at a line start, so starts[0] is 0. Offsets are
+ * relative to the block so they fit in 32 bits; a new block is started
+ * whenever one would not.
+ */
+typedef struct {
+    uint32_t* starts;
+    uint32_t count;
+    uint32_t capacity;
+    size_t length;
+} LineBlock;
+
+/**
+ * @brief Line index structure
+ *
+ * Block lengths and line counts are summed in two Fenwick trees (1-based,
+ * one node per block), so an edit inside a block and a lookup are both
+ * O(log blocks). Edits that add, split or merge blocks mark the trees
+ * stale; they are rebuilt in O(blocks) by the next lookup.
+ */
+struct LineIndex {
+    LineBlock* blocks;
+    size_t* byte_tree;   /* Fenwick tree of block lengths */
+    size_t* line_tree;   /* Fenwick tree of block line counts */
+    size_t block_count;
+    size_t block_capacity;
+    size_t tree_top;     /* Largest power of two not above block_count */
+    bool tree_valid;
+    size_t length;
+    size_t line_count;
+    uint32_t* scratch;
+};
+
+static size_t scan_scalar(const char* data, size_t length, uint32_t* positions) {
+    size_t count = 0;
+    const char* cursor = data;
+    const char* end = data + length;
+
+    while (cursor < end) {
+        const char* newline = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!newline) {
+            break;
+        }
+        positions[count++] = (uint32_t)(newline - data);
+        cursor = newline + 1;
+    }
+
+    return count;
+}
+
+static size_t count_scalar(const char* data, size_t length) {
+    size_t count = 0;
+    const char* cursor = data;
+    const char* end = data + length;
+
+    while (cursor < end) {
+        const char* newline = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!newline) {
+            break;
+        }
+        count++;
+        cursor = newline + 1;
+    }
+
+    return count;
+}
+
+static const NewlineScanner scalar_scanner = { "scalar", scan_scalar, count_scalar };
+
+#if HAVE_X86_SCANNERS
+
+__attribute__((target("sse2")))
+static size_t scan_sse2(const char* data, size_t length, uint32_t* positions) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+        while (mask) {
+            positions[count++] = (uint32_t)(i + (size_t)__builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < length; i++) {
+        if (data[i] == '\n') {
+            positions[count++] = (uint32_t)i;
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Counting subtracts the compare masks (0 or -1 per byte) into byte
+ * accumulators and folds them with SAD before they can overflow.
+ */
+__attribute__((target("sse2")))
+static size_t count_sse2(const char* data, size_t length) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+
+    while (i + 16 <= length) {
+        __m128i sums = _mm_setzero_si128();
+        size_t rounds = 0;
+        for (; rounds < 255 && i + 16 <= length; rounds++, i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+            sums = _mm_sub_epi8(sums, _mm_cmpeq_epi8(bytes, newline));
+        }
+        __m128i totals = _mm_sad_epu8(sums, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(totals) +
+                 (size_t)_mm_cvtsi128_si32(_mm_srli_si128(totals, 8));
+    }
+
+    return count + count_scalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char* data, size_t length, uint32_t* positions) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline));
+        while (mask) {
+            positions[count++] = (uint32_t)(i + (size_t)__builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i < length; i++) {
+        if (data[i] == '\n') {
+            positions[count++] = (uint32_t)i;
+        }
+    }
+
+    return count;
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const char* data, size_t length) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+
+    while (i + 32 <= length) {
+        __m256i sums = _mm256_setzero_si256();
+        size_t rounds = 0;
+        for (; rounds < 255 && i + 32 <= length; rounds++, i += 32) {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + i));
+            sums = _mm256_sub_epi8(sums, _mm256_cmpeq_epi8(bytes, newline));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, _mm256_sad_epu8(sums, _mm256_setzero_si256()));
+        count += (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+
+    return count + count_sse2(data + i, length - i);
+}
+
+static const NewlineScanner sse2_scanner = { "sse2", scan_sse2, count_sse2 };
+static const NewlineScanner avx2_scanner = { "avx2", scan_avx2, count_avx2 };
+
+#endif
+
+/**
+ * @brief Picks the fastest scanner the CPU supports
+ */
+static const NewlineScanner* select_scanner(void) {
+#if HAVE_X86_SCANNERS
+    if (__builtin_cpu_supports("avx2")) {
+        return &avx2_scanner;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &sse2_scanner;
+    }
+#endif
+    return &scalar_scanner;
+}
+
+size_t line_index_count_newlines(const char* data, size_t length) {
+    if (!data) {
+        return 0;
+    }
+
+    return select_scanner()->count(data, length);
+}
+
+const char* line_index_get_scanner_name(void) {
+    return select_scanner()->name;
+}
+
+/**
+ * @brief Grows a block's start array to hold at least capacity entries
+ */
+static bool block_reserve(LineBlock* block, size_t capacity) {
+    if (capacity <= block->capacity) {
+        return true;
+    }
+
+    size_t new_capacity = block->capacity ? block->capacity : 16;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    uint32_t* starts = (uint32_t*)realloc(block->starts, new_capacity * sizeof(uint32_t));
+    if (!starts) {
+        return false;
+    }
+
+    block->starts = starts;
+    block->capacity = (uint32_t)new_capacity;
+    return true;
+}
+
+/**
+ * @brief Grows the block array (and Fenwick trees) to hold count blocks
+ */
+static bool reserve_blocks(LineIndex* index, size_t count) {
+    if (count <= index->block_capacity) {
+        return true;
+    }
+
+    size_t new_capacity = index->block_capacity ? index->block_capacity * 2 : 16;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+
+    LineBlock* blocks = (LineBlock*)realloc(index->blocks, new_capacity * sizeof(LineBlock));
+    if (!blocks) {
+        return false;
+    }
+    index->blocks = blocks;
+
+    size_t* byte_tree = (size_t*)realloc(index->byte_tree, (new_capacity + 1) * sizeof(size_t));
+    if (!byte_tree) {
+        return false;
+    }
+    index->byte_tree = byte_tree;
+
+    size_t* line_tree = (size_t*)realloc(index->line_tree, (new_capacity + 1) * sizeof(size_t));
+    if (!line_tree) {
+        return false;
+    }
+    index->line_tree = line_tree;
+
+    index->block_capacity = new_capacity;
+    return true;
+}
+
+/**
+ * @brief Rebuilds stale Fenwick trees in O(blocks)
+ */
+static void update_trees(LineIndex* index) {
+    if (index->tree_valid) {
+        return;
+    }
+
+    size_t n = index->block_count;
+    for (size_t i = 1; i <= n; i++) {
+        index->byte_tree[i] = index->blocks[i - 1].length;
+        index->line_tree[i] = index->blocks[i - 1].count;
+    }
+
+    for (size_t i = 1; i <= n; i++) {
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= n) {
+            index->byte_tree[parent] += index->byte_tree[i];
+            index->line_tree[parent] += index->line_tree[i];
+        }
+    }
+
+    index->tree_top = 1;
+    while (index->tree_top * 2 <= n) {
+        index->tree_top *= 2;
+    }
+    index->tree_valid = true;
+}
+
+/**
+ * @brief Marks the Fenwick trees stale after blocks were added or removed
+ */
+static void invalidate_trees(LineIndex* index) {
+    index->tree_valid = false;
+}
+
+/**
+ * @brief Adds to one block's length and line count in O(log blocks)
+ *
+ * Deltas may be negative; the trees wrap modulo SIZE_MAX + 1 like the sums
+ * they hold. Stale trees are left for update_trees().
+ */
+static void tree_add(LineIndex* index, size_t block, ptrdiff_t bytes, ptrdiff_t lines) {
+    if (!index->tree_valid) {
+        return;
+    }
+
+    for (size_t i = block + 1; i <= index->block_count; i += i & (~i + 1)) {
+        index->byte_tree[i] += (size_t)bytes;
+        index->line_tree[i] += (size_t)lines;
+    }
+}
+
+/**
+ * @brief Sums the first count entries of a Fenwick tree (trees must be current)
+ */
+static size_t tree_prefix(const size_t* tree, size_t count) {
+    size_t sum = 0;
+    for (size_t i = count; i > 0; i &= i - 1) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Finds the last block whose first byte or line is at or before a target
+ * @param tree byte_tree or line_tree
+ * @param target Byte offset or line number
+ * @param first Receives the block's first byte or line
+ *
+ * Descends the tree in O(log blocks); trees must be current.
+ */
+static size_t tree_find(const LineIndex* index, const size_t* tree, size_t target, size_t* first) {
+    size_t position = 0;
+    size_t remaining = target;
+
+    for (size_t step = index->tree_top; step > 0; step /= 2) {
+        if (position + step <= index->block_count && tree[position + step] <= remaining) {
+            position += step;
+            remaining -= tree[position];
+        }
+    }
+
+    /* Everything up to the end of the text: the target is in the last block */
+    if (position == index->block_count) {
+        position--;
+        remaining += tree == index->byte_tree ? index->blocks[position].length
+                                              : index->blocks[position].count;
+    }
+
+    *first = target - remaining;
+    return position;
+}
+
+/**
+ * @brief Finds the block containing a byte offset (trees must be current)
+ */
+static size_t find_block_by_offset(const LineIndex* index, size_t offset, size_t* base) {
+    return tree_find(index, index->byte_tree, offset, base);
+}
+
+/**
+ * @brief Finds the block containing a line (trees must be current)
+ */
+static size_t find_block_by_line(const LineIndex* index, size_t line, size_t* first_line) {
+    return tree_find(index, index->line_tree, line, first_line);
+}
+
+/**
+ * @brief Finds the line of a block containing a relative offset
+ */
+static size_t find_line_in_block(const LineBlock* block, size_t relative) {
+    size_t low = 0;
+    size_t high = block->count;
+
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (block->starts[mid] <= relative) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * @brief Records a line start at the current end of the text
+ * @param start Absolute offset of the new line, not before the indexed end
+ *
+ * The text between the indexed end and start joins the last line.
+ */
+static bool push_line_start(LineIndex* index, size_t start) {
+    LineBlock* last = &index->blocks[index->block_count - 1];
+    size_t base = index->length - last->length;
+    size_t relative = start - base;
+
+    if (last->count < BLOCK_LINES && relative <= UINT32_MAX) {
+        if (!block_reserve(last, last->count + 1)) {
+            return false;
+        }
+        last->starts[last->count++] = (uint32_t)relative;
+        tree_add(index, index->block_count - 1, (ptrdiff_t)(relative - last->length), 1);
+    } else {
+        if (!reserve_blocks(index, index->block_count + 1)) {
+            return false;
+        }
+
+        LineBlock block = { NULL, 0, 0, 0 };
+        if (!block_reserve(&block, 1)) {
+            return false;
+        }
+        block.starts[block.count++] = 0;
+
+        last = &index->blocks[index->block_count - 1];
+        index->blocks[index->block_count++] = block;
+        invalidate_trees(index);
+    }
+
+    last->length = relative;
+    index->length = start;
+    index->line_count++;
+    return true;
+}
+
+/**
+ * @brief Replaces blocks first..last with blocks packed from line starts
+ * @param starts Sorted absolute line starts; starts[0] is the first byte
+ * @param count Number of starts
+ * @param end Absolute offset where the replaced range ends
+ */
+static bool repack_blocks(LineIndex* index, size_t first, size_t last,
+                          const size_t* starts, size_t count, size_t end) {
+    size_t packed_count = 0;
+    size_t packed_capacity = count / BLOCK_LINES + 1;
+    LineBlock* packed = (LineBlock*)malloc(packed_capacity * sizeof(LineBlock));
+    if (!packed) {
+        return false;
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        size_t base = starts[i];
+        size_t run = 1;
+        while (i + run < count && run < BLOCK_LINES && starts[i + run] - base <= UINT32_MAX) {
+            run++;
+        }
+
+        if (packed_count == packed_capacity) {
+            LineBlock* grown = (LineBlock*)realloc(packed, packed_capacity * 2 * sizeof(LineBlock));
+            if (!grown) {
+                break;
+            }
+            packed = grown;
+            packed_capacity *= 2;
+        }
+
+        LineBlock* block = &packed[packed_count];
+        block->starts = NULL;
+        block->count = 0;
+        block->capacity = 0;
+        if (!block_reserve(block, run)) {
+            break;
+        }
+        packed_count++;
+
+        for (size_t j = 0; j < run; j++) {
+            block->starts[j] = (uint32_t)(starts[i + j] - base);
+        }
+        block->count = (uint32_t)run;
+        block->length = (i + run < count ? starts[i + run] : end) - base;
+        i += run;
+    }
+
+    size_t replaced = last - first + 1;
+    if (i < count || !reserve_blocks(index, index->block_count - replaced + packed_count)) {
+        for (size_t b = 0; b < packed_count; b++) {
+            free(packed[b].starts);
+        }
+        free(packed);
+        return false;
+    }
+
+    for (size_t b = first; b <= last; b++) {
+        free(index->blocks[b].starts);
+    }
+
+    memmove(&index->blocks[first + packed_count], &index->blocks[last + 1],
+            (index->block_count - last - 1) * sizeof(LineBlock));
+    memcpy(&index->blocks[first], packed, packed_count * sizeof(LineBlock));
+    index->block_count = index->block_count - replaced + packed_count;
+    free(packed);
+
+    invalidate_trees(index);
+    return true;
+}
+
+LineIndex* line_index_create(void) {
+    LineIndex* index = (LineIndex*)calloc(1, sizeof(LineIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    LineBlock block = { NULL, 0, 0, 0 };
+    index->scratch = (uint32_t*)malloc(SCAN_CHUNK * sizeof(uint32_t));
+    if (!index->scratch || !reserve_blocks(index, 1) || !block_reserve(&block, 1)) {
+        line_index_destroy(index);
+        return NULL;
+    }
+
+    block.starts[block.count++] = 0;
+    index->blocks[index->block_count++] = block;
+    index->line_count = 1;
+    return index;
+}
+
+void line_index_destroy(LineIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    for (size_t b = 0; b < index->block_count; b++) {
+        free(index->blocks[b].starts);
+    }
+
+    free(index->blocks);
+    free(index->byte_tree);
+    free(index->line_tree);
+    free(index->scratch);
+    free(index);
+}
+
+bool line_index_append(LineIndex* index, const char* data, size_t length) {
+    if (!index || (!data && length > 0)) {
+        return false;
+    }
+
+    const NewlineScanner* scanner = select_scanner();
+    size_t end = index->length + length;
+    bool ok = true;
+
+    for (size_t done = 0; ok && done < length; done += SCAN_CHUNK) {
+        size_t chunk = length - done < SCAN_CHUNK ? length - done : SCAN_CHUNK;
+        size_t base = end - length + done;
+        size_t found = scanner->scan(data + done, chunk, index->scratch);
+
+        for (size_t i = 0; ok && i < found; i++) {
+            ok = push_line_start(index, base + index->scratch[i] + 1);
+        }
+    }
+
+    /* On failure the text is still covered, just with lines missing */
+    index->blocks[index->block_count - 1].length += end - index->length;
+    tree_add(index, index->block_count - 1, (ptrdiff_t)(end - index->length), 0);
+    index->length = end;
+    return ok;
+}
+
+/**
+ * @brief Inserts text into a single block without repacking
+ */
+static bool insert_in_block(LineIndex* index, size_t b, size_t relative,
+                            const char* data, size_t length, size_t newlines) {
+    LineBlock* block = &index->blocks[b];
+    if (!block_reserve(block, block->count + newlines)) {
+        return false;
+    }
+
+    size_t line = find_line_in_block(block, relative) + 1;
+    memmove(&block->starts[line + newlines], &block->starts[line],
+            (block->count - line) * sizeof(uint32_t));
+    for (size_t i = line + newlines; i < block->count + newlines; i++) {
+        block->starts[i] += (uint32_t)length;
+    }
+
+    const NewlineScanner* scanner = select_scanner();
+    size_t next = line;
+    for (size_t done = 0; done < length; done += SCAN_CHUNK) {
+        size_t chunk = length - done < SCAN_CHUNK ? length - done : SCAN_CHUNK;
+        size_t found = scanner->scan(data + done, chunk, index->scratch);
+        for (size_t i = 0; i < found; i++) {
+            block->starts[next++] = (uint32_t)(relative + done + index->scratch[i] + 1);
+        }
+    }
+
+    block->count += (uint32_t)newlines;
+    block->length += length;
+    tree_add(index, b, (ptrdiff_t)length, (ptrdiff_t)newlines);
+    return true;
+}
+
+bool line_index_insert(LineIndex* index, size_t offset, const char* data, size_t length) {
+    if (!index || (!data && length > 0) || offset > index->length) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    update_trees(index);
+    size_t base;
+    size_t b = find_block_by_offset(index, offset, &base);
+    LineBlock* block = &index->blocks[b];
+    size_t newlines = line_index_count_newlines(data, length);
+
+    if (block->count + newlines <= MAX_BLOCK_LINES && block->length + length <= UINT32_MAX) {
+        if (!insert_in_block(index, b, offset - base, data, length, newlines)) {
+            return false;
+        }
+    } else {
+        /* Gather the block's starts around the new ones and repack */
+        size_t count = block->count + newlines;
+        size_t* starts = (size_t*)malloc(count * sizeof(size_t));
+        if (!starts) {
+            return false;
+        }
+
+        size_t line = find_line_in_block(block, offset - base) + 1;
+        size_t next = 0;
+        for (size_t i = 0; i < line; i++) {
+            starts[next++] = base + block->starts[i];
+        }
+
+        const NewlineScanner* scanner = select_scanner();
+        for (size_t done = 0; done < length; done += SCAN_CHUNK) {
+            size_t chunk = length - done < SCAN_CHUNK ? length - done : SCAN_CHUNK;
+            size_t found = scanner->scan(data + done, chunk, index->scratch);
+            for (size_t i = 0; i < found; i++) {
+                starts[next++] = offset + done + index->scratch[i] + 1;
+            }
+        }
+
+        for (size_t i = line; i < block->count; i++) {
+            starts[next++] = base + block->starts[i] + length;
+        }
+
+        bool ok = repack_blocks(index, b, b, starts, count, base + block->length + length);
+        free(starts);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    index->length += length;
+    index->line_count += newlines;
+    return true;
+}
+
+bool line_index_delete(LineIndex* index, size_t offset, size_t length) {
+    if (!index || offset > index->length || length > index->length - offset) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    /* A line start s is removed when its newline at s - 1 is deleted */
+    size_t end = offset + length;
+    update_trees(index);
+    size_t head_base;
+    size_t tail_base;
+    size_t first = find_block_by_offset(index, offset, &head_base);
+    size_t last = find_block_by_offset(index, end, &tail_base);
+    size_t removed = 0;
+
+    if (first == last) {
+        LineBlock* block = &index->blocks[first];
+        size_t base = head_base;
+        size_t kept = 0;
+
+        for (size_t i = 0; i < block->count; i++) {
+            size_t start = base + block->starts[i];
+            if (start > offset && start <= end) {
+                removed++;
+            } else {
+                block->starts[kept++] = (uint32_t)(start > end ? block->starts[i] - length
+                                                               : block->starts[i]);
+            }
+        }
+
+        block->count = (uint32_t)kept;
+        block->length -= length;
+        tree_add(index, first, -(ptrdiff_t)length, -(ptrdiff_t)removed);
+    } else {
+        /* Only the starts of the outer blocks survive */
+        LineBlock* head = &index->blocks[first];
+        LineBlock* tail = &index->blocks[last];
+        size_t* starts = (size_t*)malloc((head->count + tail->count) * sizeof(size_t));
+        if (!starts) {
+            return false;
+        }
+
+        size_t count = 0;
+        for (size_t i = 0; i < head->count && head_base + head->starts[i] <= offset; i++) {
+            starts[count++] = head_base + head->starts[i];
+        }
+        for (size_t i = 0; i < tail->count; i++) {
+            if (tail_base + tail->starts[i] > end) {
+                starts[count++] = tail_base + tail->starts[i] - length;
+            }
+        }
+
+        removed = tree_prefix(index->line_tree, last + 1) - tree_prefix(index->line_tree, first) - count;
+        bool ok = repack_blocks(index, first, last, starts, count,
+                                tail_base + tail->length - length);
+        free(starts);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    index->length -= length;
+    index->line_count -= removed;
+    return true;
+}
+
+size_t line_index_get_line_count(LineIndex* index) {
+    if (!index) {
+        return 0;
+    }
+
+    return index->line_count;
+}
+
+size_t line_index_get_length(LineIndex* index) {
+    if (!index) {
+        return 0;
+    }
+
+    return index->length;
+}
+
+size_t line_index_get_line_start(LineIndex* index, size_t line) {
+    if (!index) {
+        return 0;
+    }
+
+    if (line >= index->line_count) {
+        line = index->line_count - 1;
+    }
+
+    update_trees(index);
+    size_t first_line;
+    size_t b = find_block_by_line(index, line, &first_line);
+    return tree_prefix(index->byte_tree, b) + index->blocks[b].starts[line - first_line];
+}
+
+size_t line_index_get_line_at_offset(LineIndex* index, size_t offset) {
+    if (!index) {
+        return 0;
+    }
+
+    if (offset > index->length) {
+        offset = index->length;
+    }
+
+    update_trees(index);
+    size_t base;
+    size_t b = find_block_by_offset(index, offset, &base);
+    return tree_prefix(index->line_tree, b) + find_line_in_block(&index->blocks[b], offset - base);
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+#include "core/metrics.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * @brief log2 of the buckets per power of two
+ */
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKET_COUNT (1u << SUB_BUCKET_BITS)
+
+/**
+ * @brief Values at or above 2^VALUE_BITS are recorded as the largest value
+ */
+#define VALUE_BITS 48
+#define VALUE_LIMIT ((UINT64_C(1) << VALUE_BITS) - 1)
+
+/**
+ * @brief Buckets needed to cover [0, 2^VALUE_BITS)
+ */
+#define BUCKET_COUNT ((VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT)
+
+/**
+ * @brief Histogram storage
+ */
+typedef struct {
+    _Atomic uint64_t sum;
+    _Atomic uint64_t min_plus_one;   /* 0 until the first value */
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[BUCKET_COUNT];
+} Histogram;
+
+static _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+static Histogram histograms[METRIC_HISTOGRAM_COUNT];
+
+static const char* const counter_names[METRIC_COUNTER_COUNT] = {
+    [METRIC_FILE_READ_BYTES] = "file_read_bytes",
+    [METRIC_FILE_WRITE_BYTES] = "file_write_bytes"
+};
+
+static const char* const histogram_names[METRIC_HISTOGRAM_COUNT] = {
+    [METRIC_FILE_READ_TIME] = "file_read_ns",
+    [METRIC_FILE_WRITE_TIME] = "file_write_ns",
+    [METRIC_BUFFER_CHANGED_TIME] = "buffer_changed_ns",
+    [METRIC_PASTE_TIME] = "paste_ns",
+    [METRIC_PASTE_SIZE] = "paste_bytes",
+    [METRIC_THEME_SWITCH_TIME] = "theme_switch_ns",
+    [METRIC_FRAME_TIME] = "frame_ns"
+};
+
+/**
+ * @brief Maps a value to its bucket
+ *
+ * Values below SUB_BUCKET_COUNT get a bucket each; above that, each power
+ * of two [2^e, 2^(e+1)) is split into SUB_BUCKET_COUNT equal buckets.
+ */
+static size_t bucket_index(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return (size_t)value;
+    }
+
+    unsigned int exponent = 63u - (unsigned int)__builtin_clzll(value);
+    unsigned int shift = exponent - SUB_BUCKET_BITS;
+    return (size_t)(shift + 1) * SUB_BUCKET_COUNT + (size_t)((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+/**
+ * @brief Gets the largest value that maps to a bucket
+ */
+static uint64_t bucket_top(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    unsigned int shift = (unsigned int)(index / SUB_BUCKET_COUNT) - 1;
+    uint64_t sub_bucket = (uint64_t)(index % SUB_BUCKET_COUNT) + SUB_BUCKET_COUNT;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t metrics_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_add(MetricCounter counter, uint64_t value) {
+    if ((unsigned int)counter >= METRIC_COUNTER_COUNT) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&counters[counter], value, memory_order_relaxed);
+}
+
+uint64_t metrics_get_counter(MetricCounter counter) {
+    if ((unsigned int)counter >= METRIC_COUNTER_COUNT) {
+        return 0;
+    }
+
+    return atomic_load_explicit(&counters[counter], memory_order_relaxed);
+}
+
+void metrics_record(MetricHistogram histogram, uint64_t value) {
+    if ((unsigned int)histogram >= METRIC_HISTOGRAM_COUNT) {
+        return;
+    }
+
+    Histogram* h = &histograms[histogram];
+    if (value > VALUE_LIMIT) {
+        value = VALUE_LIMIT;
+    }
+
+    atomic_fetch_add_explicit(&h->buckets[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+
+    uint64_t min = atomic_load_explicit(&h->min_plus_one, memory_order_relaxed);
+    while ((min == 0 || value + 1 < min) &&
+           !atomic_compare_exchange_weak_explicit(&h->min_plus_one, &min, value + 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max, &max, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+uint64_t metrics_record_since(MetricHistogram histogram, uint64_t start) {
+    uint64_t now = metrics_now();
+    uint64_t elapsed = now > start ? now - start : 0;
+    metrics_record(histogram, elapsed);
+    return elapsed;
+}
+
+void metrics_summarize(MetricHistogram histogram, MetricSummary* summary) {
+    if (!summary) {
+        return;
+    }
+
+    *summary = (MetricSummary){ 0 };
+    if ((unsigned int)histogram >= METRIC_HISTOGRAM_COUNT) {
+        return;
+    }
+
+    Histogram* h = &histograms[histogram];
+
+    /* Count from the buckets so the percentiles agree with each other */
+    uint64_t counts[BUCKET_COUNT];
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    summary->count = total;
+    summary->sum = atomic_load_explicit(&h->sum, memory_order_relaxed);
+    uint64_t min = atomic_load_explicit(&h->min_plus_one, memory_order_relaxed);
+    summary->min = min > 0 ? min - 1 : 0;
+    summary->max = atomic_load_explicit(&h->max, memory_order_relaxed);
+
+    static const unsigned int permille[] = { 500, 900, 990, 999 };
+    uint64_t* targets[] = { &summary->p50, &summary->p90, &summary->p99, &summary->p999 };
+
+    size_t next = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT && next < 4; i++) {
+        seen += counts[i];
+        while (next < 4 && seen * 1000 >= total * permille[next]) {
+            uint64_t top = bucket_top(i);
+            *targets[next++] = top < summary->max ? top : summary->max;
+        }
+    }
+}
+
+const char* metrics_get_counter_name(MetricCounter counter) {
+    return (unsigned int)counter < METRIC_COUNTER_COUNT ? counter_names[counter] : NULL;
+}
+
+const char* metrics_get_histogram_name(MetricHistogram histogram) {
+    return (unsigned int)histogram < METRIC_HISTOGRAM_COUNT ? histogram_names[histogram] : NULL;
+}
+
+/**
+ * @brief Converts bytes moved in a total time to MiB/s
+ */
+static double get_throughput(uint64_t bytes, uint64_t nanoseconds) {
+    return nanoseconds > 0 ? (double)bytes / (1024.0 * 1024.0) / ((double)nanoseconds / 1e9) : 0.0;
+}
+
+char* metrics_to_json(void) {
+    char* json = NULL;
+    size_t length = 0;
+    FILE* stream = open_memstream(&json, &length);
+    if (!stream) {
+        return NULL;
+    }
+
+    fputs("{\n  \"counters\": {", stream);
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        fprintf(stream, "%s\n    \"%s\": %llu", i > 0 ? "," : "", counter_names[i],
+                (unsigned long long)metrics_get_counter((MetricCounter)i));
+    }
+
+    fputs("\n  },\n  \"histograms\": {", stream);
+    MetricSummary summaries[METRIC_HISTOGRAM_COUNT];
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        MetricSummary* s = &summaries[i];
+        metrics_summarize((MetricHistogram)i, s);
+        fprintf(stream,
+                "%s\n    \"%s\": {\"count\": %llu, \"sum\": %llu, \"min\": %llu, \"max\": %llu, "
+                "\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu}",
+                i > 0 ? "," : "", histogram_names[i],
+                (unsigned long long)s->count, (unsigned long long)s->sum,
+                (unsigned long long)s->min, (unsigned long long)s->max,
+                (unsigned long long)s->p50, (unsigned long long)s->p90,
+                (unsigned long long)s->p99, (unsigned long long)s->p999);
+    }
+
+    fprintf(stream, "\n  },\n  \"throughput_mib_per_s\": {\"file_read\": %.2f, \"file_write\": %.2f}\n}\n",
+            get_throughput(metrics_get_counter(METRIC_FILE_READ_BYTES),
+                           summaries[METRIC_FILE_READ_TIME].sum),
+            get_throughput(metrics_get_counter(METRIC_FILE_WRITE_BYTES),
+                           summaries[METRIC_FILE_WRITE_TIME].sum));
+
+    if (fclose(stream) != 0) {
+        free(json);
+        return NULL;
+    }
+
+    return json;
+}
+
+void metrics_reset(void) {
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+    }
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        Histogram* h = &histograms[i];
+        for (size_t b = 0; b < BUCKET_COUNT; b++) {
+            atomic_store_explicit(&h->buckets[b], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&h->sum, 0, memory_order_relaxed);
+        atomic_store_explicit(&h->min_plus_one, 0, memory_order_relaxed);
+        atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+    }
+}
\ No newline at end of file
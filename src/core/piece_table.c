@@ -0,0 +1,745 @@
+#include "core/piece_table.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Minimum size of an add buffer block
+ */
+#define ADD_BLOCK_SIZE (64 * 1024)
+
+/**
+ * @brief One block of the append-only add buffer
+ *
+ * Blocks never move once allocated, so pieces and snapshots can point
+ * straight into them.
+ */
+typedef struct AddBlock {
+    struct AddBlock* next;
+    size_t capacity;
+    size_t used;
+    char data[];
+} AddBlock;
+
+/**
+ * @brief Buffers shared between a table and its snapshots
+ */
+typedef struct PieceStore {
+    atomic_int refs;
+    const char* original;
+    size_t original_length;
+    PieceTableRelease release;
+    void* release_data;
+    AddBlock* blocks; /* Most recent block first */
+} PieceStore;
+
+/**
+ * @brief Tree node describing one piece
+ *
+ * The tree is a treap ordered by document position; each node caches the
+ * byte length of its subtree so offsets can be resolved on the way down.
+ */
+typedef struct PieceNode {
+    struct PieceNode* left;
+    struct PieceNode* right;
+    const char* data;
+    size_t length;
+    size_t subtree_length;
+    uint32_t priority;
+} PieceNode;
+
+/**
+ * @brief Piece table structure
+ */
+struct PieceTable {
+    PieceStore* store;
+    PieceNode* root;
+    PieceNode* free_nodes;
+    size_t piece_count;
+    uint32_t rng_state;
+};
+
+/**
+ * @brief A piece as recorded in a snapshot
+ */
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t start;
+} SnapshotPiece;
+
+/**
+ * @brief Snapshot structure
+ */
+struct PieceTableSnapshot {
+    PieceStore* store;
+    SnapshotPiece* pieces;
+    size_t piece_count;
+    size_t length;
+};
+
+/* Store management */
+
+static void copy_release(const char* data, size_t length, void* user_data) {
+    (void)length;
+    (void)user_data;
+    free((void*)data);
+}
+
+static PieceStore* store_create(const char* original, size_t length,
+                                PieceTableRelease release, void* release_data) {
+    PieceStore* store = (PieceStore*)malloc(sizeof(PieceStore));
+    if (!store) {
+        return NULL;
+    }
+
+    atomic_init(&store->refs, 1);
+    store->original = original;
+    store->original_length = length;
+    store->release = release;
+    store->release_data = release_data;
+    store->blocks = NULL;
+
+    return store;
+}
+
+static void store_retain(PieceStore* store) {
+    atomic_fetch_add_explicit(&store->refs, 1, memory_order_relaxed);
+}
+
+static void store_release(PieceStore* store) {
+    if (atomic_fetch_sub_explicit(&store->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    if (store->release) {
+        store->release(store->original, store->original_length, store->release_data);
+    }
+
+    AddBlock* block = store->blocks;
+    while (block) {
+        AddBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(store);
+}
+
+/**
+ * @brief Appends bytes to the add buffer
+ * @return Stable pointer to the stored copy, or NULL on allocation failure
+ */
+static const char* store_append(PieceStore* store, const char* text, size_t length) {
+    AddBlock* block = store->blocks;
+
+    if (!block || block->capacity - block->used < length) {
+        size_t capacity = length > ADD_BLOCK_SIZE ? length : ADD_BLOCK_SIZE;
+        block = (AddBlock*)malloc(sizeof(AddBlock) + capacity);
+        if (!block) {
+            return NULL;
+        }
+        block->capacity = capacity;
+        block->used = 0;
+        block->next = store->blocks;
+        store->blocks = block;
+    }
+
+    char* destination = block->data + block->used;
+    memcpy(destination, text, length);
+    block->used += length;
+
+    return destination;
+}
+
+/**
+ * @brief Returns the address right after the last appended byte
+ */
+static const char* store_append_point(const PieceStore* store) {
+    const AddBlock* block = store->blocks;
+    return block ? block->data + block->used : NULL;
+}
+
+/**
+ * @brief Checks whether length bytes fit in the current block
+ */
+static bool store_fits_in_current_block(const PieceStore* store, size_t length) {
+    const AddBlock* block = store->blocks;
+    return block && block->capacity - block->used >= length;
+}
+
+/* Tree primitives */
+
+static size_t subtree_length(const PieceNode* node) {
+    return node ? node->subtree_length : 0;
+}
+
+static void update(PieceNode* node) {
+    node->subtree_length = subtree_length(node->left) + node->length +
+                           subtree_length(node->right);
+}
+
+static uint32_t next_priority(PieceTable* table) {
+    /* xorshift32 - only needs to be cheap and well spread */
+    uint32_t x = table->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    table->rng_state = x;
+    return x;
+}
+
+/**
+ * @brief Makes sure at least count nodes can be taken without allocating
+ *
+ * Edits reserve their nodes up front so the tree is never left half
+ * modified by an allocation failure.
+ */
+static bool reserve_nodes(PieceTable* table, size_t count) {
+    size_t available = 0;
+    for (PieceNode* node = table->free_nodes; node && available < count; node = node->left) {
+        available++;
+    }
+
+    while (available < count) {
+        PieceNode* node = (PieceNode*)malloc(sizeof(PieceNode));
+        if (!node) {
+            return false;
+        }
+        node->left = table->free_nodes;
+        table->free_nodes = node;
+        available++;
+    }
+
+    return true;
+}
+
+static PieceNode* take_node(PieceTable* table, const char* data, size_t length) {
+    PieceNode* node = table->free_nodes;
+    table->free_nodes = node->left;
+
+    node->left = NULL;
+    node->right = NULL;
+    node->data = data;
+    node->length = length;
+    node->subtree_length = length;
+    node->priority = next_priority(table);
+    table->piece_count++;
+
+    return node;
+}
+
+static void recycle_subtree(PieceTable* table, PieceNode* node) {
+    while (node) {
+        recycle_subtree(table, node->right);
+        PieceNode* left = node->left;
+        node->left = table->free_nodes;
+        table->free_nodes = node;
+        table->piece_count--;
+        node = left;
+    }
+}
+
+static PieceNode* merge(PieceNode* left, PieceNode* right) {
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+
+    if (left->priority > right->priority) {
+        left->right = merge(left->right, right);
+        update(left);
+        return left;
+    }
+
+    right->left = merge(left, right->left);
+    update(right);
+    return right;
+}
+
+/**
+ * @brief Splits a tree so the first offset bytes end up in *left
+ *
+ * A piece straddling the split point is cut in two, which takes one node
+ * from the reserve.
+ */
+static void split(PieceTable* table, PieceNode* node, size_t offset,
+                  PieceNode** left, PieceNode** right) {
+    if (!node) {
+        *left = NULL;
+        *right = NULL;
+        return;
+    }
+
+    size_t left_length = subtree_length(node->left);
+
+    if (offset <= left_length) {
+        split(table, node->left, offset, left, &node->left);
+        update(node);
+        *right = node;
+    } else if (offset >= left_length + node->length) {
+        split(table, node->right, offset - left_length - node->length, &node->right, right);
+        update(node);
+        *left = node;
+    } else {
+        size_t cut = offset - left_length;
+        PieceNode* tail = take_node(table, node->data + cut, node->length - cut);
+        PieceNode* rest = node->right;
+
+        node->length = cut;
+        node->right = NULL;
+        update(node);
+
+        *left = node;
+        *right = merge(tail, rest);
+    }
+}
+
+static PieceNode* rightmost(PieceNode* node) {
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+/**
+ * @brief Grows the last piece of a tree by length bytes
+ */
+static void extend_rightmost(PieceNode* node, size_t length) {
+    while (node) {
+        node->subtree_length += length;
+        if (!node->right) {
+            node->length += length;
+        }
+        node = node->right;
+    }
+}
+
+/* Construction */
+
+static PieceTable* table_create(PieceStore* store) {
+    PieceTable* table = (PieceTable*)malloc(sizeof(PieceTable));
+    if (!table) {
+        return NULL;
+    }
+
+    table->store = store;
+    table->root = NULL;
+    table->free_nodes = NULL;
+    table->piece_count = 0;
+    table->rng_state = 0x9E3779B9u;
+
+    if (store->original_length > 0) {
+        if (!reserve_nodes(table, 1)) {
+            free(table);
+            return NULL;
+        }
+        table->root = take_node(table, store->original, store->original_length);
+    }
+
+    return table;
+}
+
+PieceTable* piece_table_create(const char* text, size_t length) {
+    if (!text && length > 0) {
+        return NULL;
+    }
+
+    char* copy = NULL;
+    if (length > 0) {
+        copy = (char*)malloc(length);
+        if (!copy) {
+            return NULL;
+        }
+        memcpy(copy, text, length);
+    }
+
+    PieceStore* store = store_create(copy, length, copy_release, NULL);
+    if (!store) {
+        free(copy);
+        return NULL;
+    }
+
+    PieceTable* table = table_create(store);
+    if (!table) {
+        store_release(store);
+        return NULL;
+    }
+
+    return table;
+}
+
+PieceTable* piece_table_create_adopt(const char* data, size_t length,
+                                     PieceTableRelease release,
+                                     void* user_data) {
+    if (!data && length > 0) {
+        return NULL;
+    }
+
+    PieceStore* store = store_create(data, length, NULL, NULL);
+    if (!store) {
+        return NULL;
+    }
+
+    PieceTable* table = table_create(store);
+    if (!table) {
+        store_release(store);
+        return NULL;
+    }
+
+    /* Only take over the buffer once nothing can fail any more */
+    store->release = release;
+    store->release_data = user_data;
+
+    return table;
+}
+
+void piece_table_destroy(PieceTable* table) {
+    if (!table) {
+        return;
+    }
+
+    recycle_subtree(table, table->root);
+
+    PieceNode* node = table->free_nodes;
+    while (node) {
+        PieceNode* next = node->left;
+        free(node);
+        node = next;
+    }
+
+    store_release(table->store);
+    free(table);
+}
+
+/* Queries */
+
+size_t piece_table_get_length(const PieceTable* table) {
+    if (!table) {
+        return 0;
+    }
+
+    return subtree_length(table->root);
+}
+
+size_t piece_table_get_piece_count(const PieceTable* table) {
+    if (!table) {
+        return 0;
+    }
+
+    return table->piece_count;
+}
+
+int piece_table_get_byte(const PieceTable* table, size_t offset) {
+    if (!table) {
+        return -1;
+    }
+
+    const PieceNode* node = table->root;
+    while (node) {
+        size_t left_length = subtree_length(node->left);
+        if (offset < left_length) {
+            node = node->left;
+        } else if (offset < left_length + node->length) {
+            return (unsigned char)node->data[offset - left_length];
+        } else {
+            offset -= left_length + node->length;
+            node = node->right;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Copies [offset, offset + length) of a subtree, skipping untouched branches
+ */
+static size_t copy_subtree(const PieceNode* node, size_t offset, size_t length, char* out) {
+    size_t copied = 0;
+
+    while (node && length > 0) {
+        size_t left_length = subtree_length(node->left);
+
+        if (offset < left_length) {
+            size_t count = copy_subtree(node->left, offset, length, out);
+            copied += count;
+            out += count;
+            length -= count;
+            offset = 0;
+        } else {
+            offset -= left_length;
+        }
+
+        if (length > 0 && offset < node->length) {
+            size_t count = node->length - offset;
+            if (count > length) {
+                count = length;
+            }
+            memcpy(out, node->data + offset, count);
+            copied += count;
+            out += count;
+            length -= count;
+            offset = 0;
+        } else if (offset >= node->length) {
+            offset -= node->length;
+        }
+
+        node = node->right;
+    }
+
+    return copied;
+}
+
+size_t piece_table_copy_range(const PieceTable* table, size_t offset,
+                              size_t length, char* out) {
+    if (!table || !out) {
+        return 0;
+    }
+
+    return copy_subtree(table->root, offset, length, out);
+}
+
+char* piece_table_to_string(const PieceTable* table, size_t* length) {
+    if (!table) {
+        return NULL;
+    }
+
+    size_t total = subtree_length(table->root);
+    char* text = (char*)malloc(total + 1);
+    if (!text) {
+        return NULL;
+    }
+
+    copy_subtree(table->root, 0, total, text);
+    text[total] = '\0';
+
+    if (length) {
+        *length = total;
+    }
+
+    return text;
+}
+
+/* Edits */
+
+bool piece_table_insert(PieceTable* table, size_t offset,
+                        const char* text, size_t length) {
+    if (!table || offset > subtree_length(table->root) || (!text && length > 0)) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (!reserve_nodes(table, 2)) {
+        return false;
+    }
+
+    PieceNode* left;
+    PieceNode* right;
+    split(table, table->root, offset, &left, &right);
+
+    /* Typing: the previous piece ends where the add buffer does - grow it */
+    PieceNode* last = rightmost(left);
+    const char* append_point = store_append_point(table->store);
+    if (last && append_point && last->data + last->length == append_point &&
+        store_fits_in_current_block(table->store, length)) {
+        store_append(table->store, text, length);
+        extend_rightmost(left, length);
+        table->root = merge(left, right);
+        return true;
+    }
+
+    const char* stored = store_append(table->store, text, length);
+    if (!stored) {
+        table->root = merge(left, right);
+        return false;
+    }
+
+    PieceNode* piece = take_node(table, stored, length);
+    table->root = merge(merge(left, piece), right);
+
+    return true;
+}
+
+bool piece_table_delete(PieceTable* table, size_t offset, size_t length) {
+    if (!table) {
+        return false;
+    }
+
+    size_t total = subtree_length(table->root);
+    if (offset > total || length > total - offset) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (!reserve_nodes(table, 2)) {
+        return false;
+    }
+
+    PieceNode* left;
+    PieceNode* middle;
+    PieceNode* right;
+    split(table, table->root, offset, &left, &middle);
+    split(table, middle, length, &middle, &right);
+
+    recycle_subtree(table, middle);
+    table->root = merge(left, right);
+
+    return true;
+}
+
+bool piece_table_replace(PieceTable* table, size_t offset, size_t remove_length,
+                         const char* text, size_t length) {
+    if (!table) {
+        return false;
+    }
+
+    size_t total = subtree_length(table->root);
+    if (offset > total || remove_length > total - offset || (!text && length > 0)) {
+        return false;
+    }
+
+    /* Four nodes cover both edits, so neither can fail half way */
+    if (!reserve_nodes(table, 4)) {
+        return false;
+    }
+
+    /* Store the new text first so a failed append leaves the content intact */
+    if (length > 0 && !store_fits_in_current_block(table->store, length)) {
+        if (!piece_table_insert(table, offset + remove_length, text, length)) {
+            return false;
+        }
+        return piece_table_delete(table, offset, remove_length);
+    }
+
+    if (!piece_table_delete(table, offset, remove_length)) {
+        return false;
+    }
+    return piece_table_insert(table, offset, text, length);
+}
+
+/* Snapshots */
+
+static SnapshotPiece* collect_pieces(const PieceNode* node, SnapshotPiece* out, size_t* position) {
+    while (node) {
+        out = collect_pieces(node->left, out, position);
+        out->data = node->data;
+        out->length = node->length;
+        out->start = *position;
+        *position += node->length;
+        out++;
+        node = node->right;
+    }
+    return out;
+}
+
+PieceTableSnapshot* piece_table_snapshot(const PieceTable* table) {
+    if (!table) {
+        return NULL;
+    }
+
+    PieceTableSnapshot* snapshot = (PieceTableSnapshot*)malloc(sizeof(PieceTableSnapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+
+    snapshot->piece_count = table->piece_count;
+    snapshot->length = 0;
+    snapshot->pieces = NULL;
+
+    if (table->piece_count > 0) {
+        snapshot->pieces = (SnapshotPiece*)malloc(table->piece_count * sizeof(SnapshotPiece));
+        if (!snapshot->pieces) {
+            free(snapshot);
+            return NULL;
+        }
+        collect_pieces(table->root, snapshot->pieces, &snapshot->length);
+    }
+
+    store_retain(table->store);
+    snapshot->store = table->store;
+
+    return snapshot;
+}
+
+void piece_table_snapshot_destroy(PieceTableSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+
+    store_release(snapshot->store);
+    free(snapshot->pieces);
+    free(snapshot);
+}
+
+size_t piece_table_snapshot_get_length(const PieceTableSnapshot* snapshot) {
+    if (!snapshot) {
+        return 0;
+    }
+
+    return snapshot->length;
+}
+
+size_t piece_table_snapshot_get_piece_count(const PieceTableSnapshot* snapshot) {
+    if (!snapshot) {
+        return 0;
+    }
+
+    return snapshot->piece_count;
+}
+
+const char* piece_table_snapshot_get_piece(const PieceTableSnapshot* snapshot,
+                                           size_t index, size_t* length) {
+    if (!snapshot || index >= snapshot->piece_count) {
+        if (length) {
+            *length = 0;
+        }
+        return NULL;
+    }
+
+    if (length) {
+        *length = snapshot->pieces[index].length;
+    }
+    return snapshot->pieces[index].data;
+}
+
+size_t piece_table_snapshot_copy_range(const PieceTableSnapshot* snapshot,
+                                       size_t offset, size_t length, char* out) {
+    if (!snapshot || !out || offset >= snapshot->length) {
+        return 0;
+    }
+
+    /* Binary search for the piece containing offset */
+    size_t low = 0;
+    size_t high = snapshot->piece_count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (snapshot->pieces[mid].start <= offset) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    size_t copied = 0;
+    for (size_t i = low; i < snapshot->piece_count && copied < length; i++) {
+        const SnapshotPiece* piece = &snapshot->pieces[i];
+        size_t skip = offset > piece->start ? offset - piece->start : 0;
+        size_t count = piece->length - skip;
+        if (count > length - copied) {
+            count = length - copied;
+        }
+        memcpy(out + copied, piece->data + skip, count);
+        copied += count;
+    }
+
+    return copied;
+}
\ No newline at end of file
@@ -0,0 +1,649 @@
+#include "core/search.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SCANNERS 1
+#else
+#define HAVE_X86_SCANNERS 0
+#endif
+
+/**
+ * @brief Span of start positions scanned per step of a backward search
+ */
+#define SEARCH_BACKWARD_WINDOW (1024 * 1024)
+
+/**
+ * @brief Code point used for a byte that is not valid UTF-8
+ *
+ * Invalid bytes only match the same byte in the pattern.
+ */
+#define RAW_BYTE_BASE 0x110000u
+
+/**
+ * @brief Search pattern structure
+ */
+struct SearchPattern {
+    char* bytes;
+    size_t length;
+    uint32_t* folded;       /* Lowercased code points, ignore-case only */
+    size_t folded_count;
+    unsigned int flags;
+    unsigned char first[2]; /* Bytes a match may start with */
+    unsigned char last[2];  /* Bytes a match may end with */
+};
+
+/**
+ * @brief Finds the next position whose first and last bytes fit the pattern
+ *
+ * Returns the first candidate start in [from, end), or end if none.
+ */
+typedef size_t (*CandidateFunction)(const SearchPattern* pattern, const char* text,
+                                    size_t from, size_t end);
+
+/**
+ * @brief Decodes one UTF-8 character
+ * @return Number of bytes consumed (1 for invalid bytes)
+ */
+static size_t decode_char(const unsigned char* s, size_t available, uint32_t* code_point) {
+    unsigned char lead = s[0];
+
+    if (lead < 0x80) {
+        *code_point = lead;
+        return 1;
+    }
+
+    size_t length;
+    uint32_t value;
+    unsigned char min_second = 0x80;
+    unsigned char max_second = 0xBF;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        value = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        value = lead & 0x0F;
+        min_second = lead == 0xE0 ? 0xA0 : 0x80;
+        max_second = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        value = lead & 0x07;
+        min_second = lead == 0xF0 ? 0x90 : 0x80;
+        max_second = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        *code_point = RAW_BYTE_BASE + lead;
+        return 1;
+    }
+
+    if (available < length || s[1] < min_second || s[1] > max_second) {
+        *code_point = RAW_BYTE_BASE + lead;
+        return 1;
+    }
+
+    for (size_t i = 1; i < length; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *code_point = RAW_BYTE_BASE + lead;
+            return 1;
+        }
+        value = (value << 6) | (s[i] & 0x3F);
+    }
+
+    *code_point = value;
+    return length;
+}
+
+/**
+ * @brief Encodes a code point produced by decode_char
+ * @return Number of bytes written
+ */
+static size_t encode_char(uint32_t code_point, unsigned char* out) {
+    if (code_point >= RAW_BYTE_BASE) {
+        out[0] = (unsigned char)(code_point - RAW_BYTE_BASE);
+        return 1;
+    }
+    if (code_point < 0x80) {
+        out[0] = (unsigned char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (code_point >> 6));
+        out[1] = (unsigned char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (code_point >> 12));
+        out[1] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (code_point >> 18));
+    out[1] = (unsigned char)(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Checks whether a Latin Extended-A code point is an uppercase letter
+ *
+ * The block alternates upper and lower case, switching parity twice.
+ */
+static bool is_latin_extended_upper(uint32_t c) {
+    if ((c >= 0x100 && c <= 0x12F) || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177)) {
+        return c % 2 == 0;
+    }
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E)) {
+        return c % 2 == 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Maps a code point to lowercase (simple, length-preserving)
+ */
+static uint32_t fold_case(uint32_t c) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+    }
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) {
+        return c + 0x20;
+    }
+    if (is_latin_extended_upper(c)) {
+        return c + 1;
+    }
+    if (c >= 0x391 && c <= 0x3A9 && c != 0x3A2) {
+        return c + 0x20;
+    }
+    if (c >= 0x400 && c <= 0x40F) {
+        return c + 0x50;
+    }
+    if (c >= 0x410 && c <= 0x42F) {
+        return c + 0x20;
+    }
+    return c;
+}
+
+/**
+ * @brief Maps a lowercase code point back to uppercase
+ */
+static uint32_t unfold_case(uint32_t c) {
+    if (c < 0x80) {
+        return c >= 'a' && c <= 'z' ? c - 0x20 : c;
+    }
+    if (c >= 0xE0 && c <= 0xFE && c != 0xF7) {
+        return c - 0x20;
+    }
+    if (c > 0x100 && is_latin_extended_upper(c - 1)) {
+        return c - 1;
+    }
+    if (c >= 0x3B1 && c <= 0x3C9 && c != 0x3C2) {
+        return c - 0x20;
+    }
+    if (c >= 0x450 && c <= 0x45F) {
+        return c - 0x50;
+    }
+    if (c >= 0x430 && c <= 0x44F) {
+        return c - 0x20;
+    }
+    return c;
+}
+
+/**
+ * @brief Checks whether a byte belongs to a word
+ */
+static bool is_word_byte(unsigned char byte) {
+    return byte >= 0x80 || byte == '_' ||
+           (byte >= '0' && byte <= '9') ||
+           (byte >= 'a' && byte <= 'z') ||
+           (byte >= 'A' && byte <= 'Z');
+}
+
+static size_t find_candidate_scalar(const SearchPattern* pattern, const char* text,
+                                    size_t from, size_t end) {
+    const unsigned char* bytes = (const unsigned char*)text;
+    size_t tail = pattern->length - 1;
+
+    for (size_t i = from; i < end; i++) {
+        unsigned char first = bytes[i];
+        unsigned char last = bytes[i + tail];
+        if ((first == pattern->first[0] || first == pattern->first[1]) &&
+            (last == pattern->last[0] || last == pattern->last[1])) {
+            return i;
+        }
+    }
+
+    return end;
+}
+
+#if HAVE_X86_SCANNERS
+
+__attribute__((target("sse2")))
+static size_t find_candidate_sse2(const SearchPattern* pattern, const char* text,
+                                  size_t from, size_t end) {
+    const __m128i first0 = _mm_set1_epi8((char)pattern->first[0]);
+    const __m128i first1 = _mm_set1_epi8((char)pattern->first[1]);
+    const __m128i last0 = _mm_set1_epi8((char)pattern->last[0]);
+    const __m128i last1 = _mm_set1_epi8((char)pattern->last[1]);
+    size_t tail = pattern->length - 1;
+    size_t i = from;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i foot = _mm_loadu_si128((const __m128i*)(text + i + tail));
+        __m128i hits = _mm_and_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(head, first0), _mm_cmpeq_epi8(head, first1)),
+            _mm_or_si128(_mm_cmpeq_epi8(foot, last0), _mm_cmpeq_epi8(foot, last1)));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return find_candidate_scalar(pattern, text, i, end);
+}
+
+__attribute__((target("avx2")))
+static size_t find_candidate_avx2(const SearchPattern* pattern, const char* text,
+                                  size_t from, size_t end) {
+    const __m256i first0 = _mm256_set1_epi8((char)pattern->first[0]);
+    const __m256i first1 = _mm256_set1_epi8((char)pattern->first[1]);
+    const __m256i last0 = _mm256_set1_epi8((char)pattern->last[0]);
+    const __m256i last1 = _mm256_set1_epi8((char)pattern->last[1]);
+    size_t tail = pattern->length - 1;
+    size_t i = from;
+
+    for (; i + 32 <= end; i += 32) {
+        __m256i head = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i foot = _mm256_loadu_si256((const __m256i*)(text + i + tail));
+        __m256i hits = _mm256_and_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(head, first0), _mm256_cmpeq_epi8(head, first1)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(foot, last0), _mm256_cmpeq_epi8(foot, last1)));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return find_candidate_sse2(pattern, text, i, end);
+}
+
+#endif
+
+/**
+ * @brief Picks the fastest candidate filter the CPU supports
+ */
+static CandidateFunction select_candidate_function(void) {
+#if HAVE_X86_SCANNERS
+    if (__builtin_cpu_supports("avx2")) {
+        return find_candidate_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return find_candidate_sse2;
+    }
+#endif
+    return find_candidate_scalar;
+}
+
+/**
+ * @brief Records the possible first and last bytes of an ignore-case match
+ *
+ * Folding never changes a character's encoded length, so both case
+ * variants end at the same byte.
+ */
+static void set_folded_edges(SearchPattern* pattern, uint32_t first, uint32_t last) {
+    unsigned char lower[4];
+    unsigned char upper[4];
+
+    encode_char(first, lower);
+    encode_char(unfold_case(first), upper);
+    pattern->first[0] = lower[0];
+    pattern->first[1] = upper[0];
+
+    size_t length = encode_char(last, lower);
+    encode_char(unfold_case(last), upper);
+    pattern->last[0] = lower[length - 1];
+    pattern->last[1] = upper[length - 1];
+}
+
+SearchPattern* search_pattern_create(const char* text, size_t length, unsigned int flags) {
+    if (!text || length == 0) {
+        return NULL;
+    }
+
+    SearchPattern* pattern = (SearchPattern*)calloc(1, sizeof(SearchPattern));
+    if (!pattern) {
+        return NULL;
+    }
+
+    pattern->bytes = (char*)malloc(length);
+    if (!pattern->bytes) {
+        free(pattern);
+        return NULL;
+    }
+
+    memcpy(pattern->bytes, text, length);
+    pattern->length = length;
+    pattern->flags = flags;
+
+    if (!(flags & SEARCH_IGNORE_CASE)) {
+        pattern->first[0] = pattern->first[1] = (unsigned char)text[0];
+        pattern->last[0] = pattern->last[1] = (unsigned char)text[length - 1];
+        return pattern;
+    }
+
+    pattern->folded = (uint32_t*)malloc(length * sizeof(uint32_t));
+    if (!pattern->folded) {
+        search_pattern_destroy(pattern);
+        return NULL;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)text;
+    for (size_t i = 0; i < length;) {
+        uint32_t code_point;
+        i += decode_char(bytes + i, length - i, &code_point);
+        pattern->folded[pattern->folded_count++] = fold_case(code_point);
+    }
+
+    set_folded_edges(pattern, pattern->folded[0], pattern->folded[pattern->folded_count - 1]);
+    return pattern;
+}
+
+void search_pattern_destroy(SearchPattern* pattern) {
+    if (!pattern) {
+        return;
+    }
+
+    free(pattern->bytes);
+    free(pattern->folded);
+    free(pattern);
+}
+
+/**
+ * @brief Checks whether the pattern matches at a candidate position
+ */
+static bool verify_match(const SearchPattern* pattern, const char* text, size_t limit, size_t start) {
+    if (!(pattern->flags & SEARCH_IGNORE_CASE)) {
+        return memcmp(text + start, pattern->bytes, pattern->length) == 0;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)text;
+    size_t position = start;
+    for (size_t i = 0; i < pattern->folded_count; i++) {
+        if (position >= limit) {
+            return false;
+        }
+
+        uint32_t code_point;
+        position += decode_char(bytes + position, limit - position, &code_point);
+        if (fold_case(code_point) != pattern->folded[i]) {
+            return false;
+        }
+    }
+
+    return position - start == pattern->length;
+}
+
+/**
+ * @brief Checks that a match is not part of a longer word
+ */
+static bool is_whole_word(const char* text, size_t length, size_t start, size_t end) {
+    if (start > 0 && is_word_byte((unsigned char)text[start - 1])) {
+        return false;
+    }
+
+    return end == length || !is_word_byte((unsigned char)text[end]);
+}
+
+/**
+ * @brief Finds the first match starting at or after from and ending by limit
+ */
+static bool find_in_range(const SearchPattern* pattern, const char* text, size_t length,
+                          size_t from, size_t limit, SearchMatch* match) {
+    if (limit > length) {
+        limit = length;
+    }
+
+    if (limit < pattern->length || from > limit - pattern->length) {
+        return false;
+    }
+
+    CandidateFunction find_candidate = select_candidate_function();
+    size_t end = limit - pattern->length + 1;
+
+    for (size_t position = from; position < end; position++) {
+        position = find_candidate(pattern, text, position, end);
+        if (position >= end) {
+            break;
+        }
+
+        size_t match_end = position + pattern->length;
+        if (verify_match(pattern, text, limit, position) &&
+            (!(pattern->flags & SEARCH_WHOLE_WORD) ||
+             is_whole_word(text, length, position, match_end))) {
+            match->start = position;
+            match->end = match_end;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool search_find_next(const SearchPattern* pattern, const char* text, size_t length,
+                      size_t from, SearchMatch* match) {
+    if (!pattern || !text || !match) {
+        return false;
+    }
+
+    return find_in_range(pattern, text, length, from, length, match);
+}
+
+bool search_find_previous(const SearchPattern* pattern, const char* text, size_t length,
+                          size_t before, SearchMatch* match) {
+    if (!pattern || !text || !match) {
+        return false;
+    }
+
+    if (before > length) {
+        before = length;
+    }
+
+    if (before < pattern->length) {
+        return false;
+    }
+
+    /* Scan windows of start positions backwards, keeping each window's last match */
+    size_t high = before - pattern->length + 1;
+    while (true) {
+        size_t low = high > SEARCH_BACKWARD_WINDOW ? high - SEARCH_BACKWARD_WINDOW : 0;
+        size_t limit = high + pattern->length - 1;
+        bool found = false;
+        SearchMatch current;
+
+        for (size_t position = low; find_in_range(pattern, text, length, position, limit, &current);
+             position = current.start + 1) {
+            *match = current;
+            found = true;
+        }
+
+        if (found) {
+            return true;
+        }
+
+        if (low == 0) {
+            return false;
+        }
+
+        high = low;
+    }
+}
+
+size_t search_count_matches(const SearchPattern* pattern, const char* text, size_t length,
+                            size_t limit) {
+    if (!pattern || !text) {
+        return 0;
+    }
+
+    size_t count = 0;
+    SearchMatch match;
+    size_t position = 0;
+
+    while ((limit == 0 || count < limit) &&
+           find_in_range(pattern, text, length, position, length, &match)) {
+        count++;
+        position = match.end;
+    }
+
+    return count;
+}
+
+size_t search_count_matches_step(const SearchPattern* pattern, const char* text, size_t length,
+                                 size_t* position, size_t end) {
+    if (!pattern || !text || !position) {
+        return 0;
+    }
+
+    if (end > length) {
+        end = length;
+    }
+
+    size_t count = 0;
+    SearchMatch match;
+
+    while (find_in_range(pattern, text, length, *position, end, &match)) {
+        count++;
+        *position = match.end;
+    }
+
+    /* A match starting any later would end past end; the next call finds it */
+    if (end >= pattern->length && *position < end - pattern->length + 1) {
+        *position = end - pattern->length + 1;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Grows a result buffer geometrically to hold at least needed bytes
+ */
+static bool reserve_result(char** result, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return true;
+    }
+
+    size_t new_capacity = *capacity * 2;
+    if (new_capacity < needed) {
+        new_capacity = needed;
+    }
+
+    char* grown = (char*)realloc(*result, new_capacity);
+    if (!grown) {
+        return false;
+    }
+
+    *result = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+char* search_replace_all(const SearchPattern* pattern, const char* text, size_t length,
+                         const char* replacement, size_t replacement_length,
+                         size_t* result_length, size_t* count) {
+    if (!pattern || !text || !result_length || (!replacement && replacement_length > 0)) {
+        return NULL;
+    }
+
+    /* Start at the input size; shrinking replacements never reallocate */
+    size_t capacity = length + 1;
+    char* result = (char*)malloc(capacity);
+    if (!result) {
+        return NULL;
+    }
+
+    size_t used = 0;
+    size_t copied = 0;
+    size_t replaced = 0;
+    SearchMatch match;
+
+    while (find_in_range(pattern, text, length, copied, length, &match)) {
+        size_t kept = match.start - copied;
+        if (!reserve_result(&result, &capacity, used + kept + replacement_length + 1)) {
+            free(result);
+            return NULL;
+        }
+
+        memcpy(result + used, text + copied, kept);
+        used += kept;
+        if (replacement_length > 0) {
+            memcpy(result + used, replacement, replacement_length);
+            used += replacement_length;
+        }
+
+        copied = match.end;
+        replaced++;
+    }
+
+    if (!reserve_result(&result, &capacity, used + (length - copied) + 1)) {
+        free(result);
+        return NULL;
+    }
+
+    memcpy(result + used, text + copied, length - copied);
+    used += length - copied;
+    result[used] = '\0';
+
+    *result_length = used;
+    if (count) {
+        *count = replaced;
+    }
+    return result;
+}
+
+char* search_replace_matches(const char* text, size_t length,
+                             const SearchMatch* matches, size_t match_count,
+                             const char* replacement, size_t replacement_length,
+                             size_t* result_length) {
+    if (!text || !result_length || (!matches && match_count > 0) ||
+        (!replacement && replacement_length > 0)) {
+        return NULL;
+    }
+
+    /* Size the result exactly so the copy is a single pass */
+    size_t total = length;
+    size_t previous_end = 0;
+    for (size_t i = 0; i < match_count; i++) {
+        if (matches[i].start < previous_end || matches[i].end < matches[i].start ||
+            matches[i].end > length) {
+            return NULL;
+        }
+        total = total - (matches[i].end - matches[i].start) + replacement_length;
+        previous_end = matches[i].end;
+    }
+
+    char* result = (char*)malloc(total + 1);
+    if (!result) {
+        return NULL;
+    }
+
+    size_t used = 0;
+    size_t copied = 0;
+    for (size_t i = 0; i < match_count; i++) {
+        memcpy(result + used, text + copied, matches[i].start - copied);
+        used += matches[i].start - copied;
+        if (replacement_length > 0) {
+            memcpy(result + used, replacement, replacement_length);
+            used += replacement_length;
+        }
+        copied = matches[i].end;
+    }
+
+    memcpy(result + used, text + copied, length - copied);
+    used += length - copied;
+    result[used] = '\0';
+
+    *result_length = used;
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#define _POSIX_C_SOURCE 200809L
+#include "core/trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Events kept per run; later ones are counted and dropped
+ *
+ * The buffer is static so an untraced run never touches its pages.
+ */
+#define TRACE_CAPACITY 65536
+
+/**
+ * @brief One recorded span or instant
+ */
+typedef struct {
+    atomic_bool ready;       /* Set once the other fields are filled in */
+    const char* name;
+    uint64_t start;          /* Nanoseconds on CLOCK_MONOTONIC */
+    uint64_t duration;       /* UINT64_MAX for an instant */
+    unsigned int thread;
+} TraceEvent;
+
+static TraceEvent events[TRACE_CAPACITY];
+static atomic_size_t next_event;
+static atomic_size_t dropped;
+static atomic_bool enabled;
+static atomic_uint next_thread = 1;
+static _Thread_local unsigned int current_thread;
+static char* trace_path;
+static uint64_t origin;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Gets a small per-thread number, used as the trace track
+ */
+static unsigned int get_thread(void) {
+    if (current_thread == 0) {
+        current_thread = atomic_fetch_add(&next_thread, 1);
+    }
+
+    return current_thread;
+}
+
+static void record(const char* name, uint64_t start, uint64_t duration) {
+    size_t index = atomic_fetch_add_explicit(&next_event, 1, memory_order_relaxed);
+    if (index >= TRACE_CAPACITY) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    TraceEvent* event = &events[index];
+    event->name = name;
+    event->start = start;
+    event->duration = duration;
+    event->thread = get_thread();
+    atomic_store_explicit(&event->ready, true, memory_order_release);
+}
+
+bool trace_start(const char* path) {
+    if (!path || trace_path) {
+        return false;
+    }
+
+    trace_path = strdup(path);
+    if (!trace_path) {
+        return false;
+    }
+
+    get_thread();
+    origin = now_ns();
+    atomic_store(&enabled, true);
+
+    return true;
+}
+
+/**
+ * @brief Writes a JSON string, escaping what JSON requires
+ */
+static void write_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool trace_stop(void) {
+    if (!trace_path || !atomic_exchange(&enabled, false)) {
+        return true;
+    }
+
+    FILE* file = fopen(trace_path, "w");
+    if (!file) {
+        return false;
+    }
+
+    /* Threads still inside record() may miss the file; their slots are never freed */
+    size_t count = atomic_load(&next_event);
+    if (count > TRACE_CAPACITY) {
+        count = TRACE_CAPACITY;
+    }
+
+    long pid = (long)getpid();
+    fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    for (size_t i = 0; i < count; i++) {
+        const TraceEvent* event = &events[i];
+        if (!atomic_load_explicit(&event->ready, memory_order_acquire)) {
+            continue;
+        }
+
+        /* Chrome timestamps are microseconds; spans opened before the start are clamped */
+        uint64_t start = event->start > origin ? event->start - origin : 0;
+        fputs(first ? "\n" : ",\n", file);
+        first = false;
+        fputs("{\"name\":", file);
+        write_string(file, event->name);
+        if (event->duration == UINT64_MAX) {
+            fprintf(file, ",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f", start / 1000.0);
+        } else {
+            fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f",
+                    start / 1000.0, event->duration / 1000.0);
+        }
+        fprintf(file, ",\"pid\":%ld,\"tid\":%u}", pid, event->thread);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%zu}}\n",
+            atomic_load(&dropped));
+
+    bool written = !ferror(file);
+    if (fclose(file) != 0) {
+        written = false;
+    }
+
+    return written;
+}
+
+bool trace_is_enabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+uint64_t trace_begin(void) {
+    if (!atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return 0;
+    }
+
+    return now_ns();
+}
+
+void trace_end(const char* name, uint64_t start) {
+    if (start == 0 || !name || !atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    uint64_t end = now_ns();
+    record(name, start, end > start ? end - start : 0);
+}
+
+void trace_instant(const char* name) {
+    if (!name || !atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        return;
+    }
+
+    record(name, now_ns(), UINT64_MAX);
+}
\ No newline at end of file
@@ -0,0 +1,386 @@
+#define _POSIX_C_SOURCE 200809L
+#include "core/worker_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Upper bound on worker threads
+ */
+#define WORKER_POOL_MAX_THREADS 64
+
+/**
+ * @brief Worker job structure
+ */
+struct WorkerJob {
+    WorkerJob* next;         /* Queue link */
+    WorkerPool* pool;
+    uint64_t id;
+    size_t active_index;     /* Slot in pool->active */
+    WorkerRun run;
+    WorkerComplete complete;
+    WorkerFree free_result;
+    void* data;
+    WorkerFree free_data;
+    unsigned int flags;
+    uint64_t generation;     /* Pool generation at submission */
+    atomic_bool cancelled;
+    void* result;
+};
+
+/**
+ * @brief Worker pool structure
+ */
+struct WorkerPool {
+    pthread_mutex_t lock;    /* Guards the queue, stopping and the lock counters */
+    pthread_cond_t available;
+    WorkerJob* head;
+    WorkerJob* tail;
+    size_t queued;
+    bool stopping;
+    uint64_t lock_acquired;
+    uint64_t lock_contended;
+    uint64_t lock_wait_ns;
+
+    pthread_t threads[WORKER_POOL_MAX_THREADS];
+    size_t thread_count;
+    atomic_size_t running;
+    _Atomic uint64_t generation;
+
+    WorkerDispatch dispatch;
+    WorkerWithdraw withdraw;
+    void* dispatch_data;
+
+    /* Owning thread only */
+    WorkerJob** active;      /* Submitted and not yet delivered or freed */
+    size_t active_count;
+    size_t active_capacity;
+    size_t refs;             /* The owner's plus one per job */
+    uint64_t next_id;
+    uint64_t completed;
+    uint64_t dropped;
+};
+
+static uint64_t elapsed_ns(const struct timespec* start, const struct timespec* end) {
+    return (uint64_t)(end->tv_sec - start->tv_sec) * 1000000000u +
+           (uint64_t)end->tv_nsec - (uint64_t)start->tv_nsec;
+}
+
+/**
+ * @brief Takes the queue lock, recording whether it had to wait
+ */
+static void lock_queue(WorkerPool* pool) {
+    if (pthread_mutex_trylock(&pool->lock) != 0) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        pthread_mutex_lock(&pool->lock);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        pool->lock_contended++;
+        pool->lock_wait_ns += elapsed_ns(&start, &end);
+    }
+    pool->lock_acquired++;
+}
+
+static bool is_stale(const WorkerJob* job) {
+    return atomic_load(&job->cancelled) ||
+           ((job->flags & WORKER_JOB_DROP_ON_CHANGE) &&
+            atomic_load(&job->pool->generation) != job->generation);
+}
+
+/**
+ * @brief Releases one reference; the last frees the pool
+ */
+static void unref_pool(WorkerPool* pool) {
+    if (--pool->refs > 0) {
+        return;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->available);
+    free(pool->active);
+    free(pool);
+}
+
+/**
+ * @brief Frees a job that is over, on the owning thread
+ */
+static void free_job(WorkerJob* job) {
+    WorkerPool* pool = job->pool;
+
+    WorkerJob* last = pool->active[--pool->active_count];
+    pool->active[job->active_index] = last;
+    last->active_index = job->active_index;
+
+    if (job->free_data) {
+        job->free_data(job->data);
+    }
+    free(job);
+    unref_pool(pool);
+}
+
+static void* worker_main(void* arg) {
+    WorkerPool* pool = (WorkerPool*)arg;
+
+    for (;;) {
+        lock_queue(pool);
+        while (!pool->head && !pool->stopping) {
+            pthread_cond_wait(&pool->available, &pool->lock);
+        }
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        WorkerJob* job = pool->head;
+        pool->head = job->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+
+        /* A stale job still goes back, so its data is freed by the owner */
+        atomic_fetch_add(&pool->running, 1);
+        if (!is_stale(job)) {
+            job->result = job->run(job, job->data);
+        }
+        atomic_fetch_sub(&pool->running, 1);
+
+        pool->dispatch(job, pool->dispatch_data);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Stops and joins the threads; queued jobs stay in the queue
+ */
+static void stop_threads(WorkerPool* pool) {
+    lock_queue(pool);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->thread_count = 0;
+}
+
+WorkerPool* worker_pool_create(size_t thread_count, WorkerDispatch dispatch,
+                               WorkerWithdraw withdraw, void* dispatch_data) {
+    if (!dispatch || !withdraw) {
+        return NULL;
+    }
+
+    if (thread_count == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (size_t)cores : 1;
+    }
+    if (thread_count > WORKER_POOL_MAX_THREADS) {
+        thread_count = WORKER_POOL_MAX_THREADS;
+    }
+
+    WorkerPool* pool = (WorkerPool*)calloc(1, sizeof(WorkerPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+    if (pthread_cond_init(&pool->available, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    atomic_init(&pool->running, 0);
+    atomic_init(&pool->generation, 0);
+    pool->dispatch = dispatch;
+    pool->withdraw = withdraw;
+    pool->dispatch_data = dispatch_data;
+    pool->refs = 1;
+    pool->next_id = 1;
+
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        unref_pool(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void worker_pool_destroy(WorkerPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (size_t i = 0; i < pool->active_count; i++) {
+        atomic_store(&pool->active[i]->cancelled, true);
+    }
+
+    /* Running jobs finish (they see the cancellation) and are dispatched */
+    stop_threads(pool);
+
+    WorkerJob* job = pool->head;
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->queued = 0;
+    while (job) {
+        WorkerJob* next = job->next;
+        pool->dropped++;
+        free_job(job);
+        job = next;
+    }
+
+    /* The rest were dispatched; the owner's loop may never deliver them */
+    while (pool->active_count > 0) {
+        job = pool->active[pool->active_count - 1];
+        pool->withdraw(job, pool->dispatch_data);
+        if (job->result && job->free_result) {
+            job->free_result(job->result);
+        }
+        pool->dropped++;
+        free_job(job);
+    }
+
+    unref_pool(pool);
+}
+
+uint64_t worker_pool_submit(WorkerPool* pool, WorkerRun run, WorkerComplete complete,
+                            WorkerFree free_result, void* data, WorkerFree free_data,
+                            unsigned int flags) {
+    WorkerJob* job = NULL;
+    if (pool && run) {
+        job = (WorkerJob*)malloc(sizeof(WorkerJob));
+    }
+
+    if (job && pool->active_count == pool->active_capacity) {
+        size_t capacity = pool->active_capacity ? pool->active_capacity * 2 : 16;
+        WorkerJob** active = (WorkerJob**)realloc(pool->active, capacity * sizeof(WorkerJob*));
+        if (active) {
+            pool->active = active;
+            pool->active_capacity = capacity;
+        } else {
+            free(job);
+            job = NULL;
+        }
+    }
+
+    if (!job) {
+        if (free_data) {
+            free_data(data);
+        }
+        return 0;
+    }
+
+    job->next = NULL;
+    job->pool = pool;
+    job->id = pool->next_id++;
+    job->active_index = pool->active_count;
+    job->run = run;
+    job->complete = complete;
+    job->free_result = free_result;
+    job->data = data;
+    job->free_data = free_data;
+    job->flags = flags;
+    job->generation = atomic_load(&pool->generation);
+    atomic_init(&job->cancelled, false);
+    job->result = NULL;
+
+    pool->active[pool->active_count++] = job;
+    pool->refs++;
+
+    lock_queue(pool);
+    if (pool->tail) {
+        pool->tail->next = job;
+    } else {
+        pool->head = job;
+    }
+    pool->tail = job;
+    pool->queued++;
+    pthread_cond_signal(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return job->id;
+}
+
+void worker_pool_cancel(WorkerPool* pool, uint64_t id) {
+    if (!pool || id == 0) {
+        return;
+    }
+
+    /* Queued jobs are skipped by the worker that dequeues them */
+    for (size_t i = 0; i < pool->active_count; i++) {
+        if (pool->active[i]->id == id) {
+            atomic_store(&pool->active[i]->cancelled, true);
+            return;
+        }
+    }
+}
+
+void worker_pool_advance_generation(WorkerPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    atomic_fetch_add(&pool->generation, 1);
+}
+
+bool worker_job_is_cancelled(const WorkerJob* job) {
+    return !job || is_stale(job);
+}
+
+void worker_pool_deliver(WorkerJob* job) {
+    if (!job) {
+        return;
+    }
+
+    WorkerPool* pool = job->pool;
+
+    if (is_stale(job) || !job->complete) {
+        if (job->result && job->free_result) {
+            job->free_result(job->result);
+        }
+        if (is_stale(job)) {
+            pool->dropped++;
+        } else {
+            pool->completed++;
+        }
+    } else {
+        job->complete(job->result, job->data);
+        pool->completed++;
+    }
+
+    free_job(job);
+}
+
+void worker_pool_get_stats(WorkerPool* pool, WorkerPoolStats* stats) {
+    if (!pool || !stats) {
+        return;
+    }
+
+    lock_queue(pool);
+    stats->queued = pool->queued;
+    stats->lock_acquired = pool->lock_acquired;
+    stats->lock_contended = pool->lock_contended;
+    stats->lock_wait_ns = pool->lock_wait_ns;
+    pthread_mutex_unlock(&pool->lock);
+
+    stats->threads = pool->thread_count;
+    stats->running = atomic_load(&pool->running);
+    stats->completed = pool->completed;
+    stats->dropped = pool->dropped;
+}
\ No newline at end of file
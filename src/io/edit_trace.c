@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+#include "io/edit_trace.h"
+#include "io/file_mapping.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief First bytes of every trace file
+ */
+#define EDIT_TRACE_MAGIC "NBE1"
+#define MAGIC_LENGTH 4
+
+/**
+ * @brief Set in the type byte of edits made by undo, redo or recovery
+ */
+#define FROM_HISTORY_FLAG 0x80
+
+/**
+ * @brief Longest LEB128 encoding of a 64-bit value
+ */
+#define VARINT_MAX 10
+
+/**
+ * @brief stdio buffer of the writer; typing produces many tiny records
+ */
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Trace writer structure
+ */
+struct EditTraceWriter {
+    FILE* file;
+    uint64_t start_us;
+    uint64_t last_us;
+    bool failed;
+};
+
+/**
+ * @brief Trace reader structure
+ */
+struct EditTraceReader {
+    FileMapping* mapping;
+    const char* data;
+    size_t length;
+    size_t position;
+    uint64_t time_us;
+    bool damaged;
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static size_t put_varint(char* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (char)value;
+    return length;
+}
+
+static bool get_varint(const char* data, size_t length, size_t* position, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *position < length; shift += 7) {
+        unsigned char byte = (unsigned char)data[(*position)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether a record type carries an offset and bytes
+ */
+static bool has_payload(EditTraceType type) {
+    return type == EDIT_TRACE_SET || type == EDIT_TRACE_INSERT || type == EDIT_TRACE_DELETE;
+}
+
+EditTraceWriter* edit_trace_writer_open(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    EditTraceWriter* writer = (EditTraceWriter*)calloc(1, sizeof(EditTraceWriter));
+    if (!writer) {
+        return NULL;
+    }
+
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        free(writer);
+        return NULL;
+    }
+
+    setvbuf(writer->file, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+    if (fwrite(EDIT_TRACE_MAGIC, 1, MAGIC_LENGTH, writer->file) != MAGIC_LENGTH) {
+        fclose(writer->file);
+        free(writer);
+        return NULL;
+    }
+
+    writer->start_us = now_us();
+    writer->last_us = writer->start_us;
+
+    return writer;
+}
+
+bool edit_trace_writer_append(EditTraceWriter* writer, EditTraceType type, uint64_t offset,
+                              const char* text, size_t length, bool from_history) {
+    if (!writer || writer->failed) {
+        return false;
+    }
+
+    if ((unsigned int)type >= EDIT_TRACE_TYPE_COUNT || (length > 0 && !text)) {
+        return false;
+    }
+
+    uint64_t now = now_us();
+    uint64_t delta = now > writer->last_us ? now - writer->last_us : 0;
+    writer->last_us = now;
+
+    char header[1 + 3 * VARINT_MAX];
+    size_t header_length = 0;
+    header[header_length++] = (char)(type | (from_history ? FROM_HISTORY_FLAG : 0));
+    header_length += put_varint(header + header_length, delta);
+
+    if (has_payload(type)) {
+        header_length += put_varint(header + header_length, offset);
+        header_length += put_varint(header + header_length, length);
+    }
+
+    if (fwrite(header, 1, header_length, writer->file) != header_length ||
+        (has_payload(type) && length > 0 && fwrite(text, 1, length, writer->file) != length)) {
+        writer->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool edit_trace_writer_close(EditTraceWriter* writer) {
+    if (!writer) {
+        return false;
+    }
+
+    bool written = !writer->failed;
+    if (fclose(writer->file) != 0) {
+        written = false;
+    }
+    free(writer);
+
+    return written;
+}
+
+EditTraceReader* edit_trace_reader_open(const char* path) {
+    FileMapping* mapping = file_mapping_open(path, NULL);
+    if (!mapping) {
+        return NULL;
+    }
+
+    const char* data = file_mapping_get_data(mapping);
+    size_t length = file_mapping_get_size(mapping);
+    if (!data || length < MAGIC_LENGTH || memcmp(data, EDIT_TRACE_MAGIC, MAGIC_LENGTH) != 0) {
+        file_mapping_close(mapping);
+        return NULL;
+    }
+
+    EditTraceReader* reader = (EditTraceReader*)calloc(1, sizeof(EditTraceReader));
+    if (!reader) {
+        file_mapping_close(mapping);
+        return NULL;
+    }
+
+    reader->mapping = mapping;
+    reader->data = data;
+    reader->length = length;
+    reader->position = MAGIC_LENGTH;
+
+    return reader;
+}
+
+void edit_trace_reader_close(EditTraceReader* reader) {
+    if (!reader) {
+        return;
+    }
+
+    file_mapping_close(reader->mapping);
+    free(reader);
+}
+
+bool edit_trace_reader_next(EditTraceReader* reader, EditTraceRecord* record) {
+    if (!reader || !record || reader->damaged || reader->position >= reader->length) {
+        return false;
+    }
+
+    size_t position = reader->position;
+    unsigned char type_byte = (unsigned char)reader->data[position++];
+    EditTraceType type = (EditTraceType)(type_byte & ~FROM_HISTORY_FLAG);
+
+    uint64_t delta;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    bool valid = (unsigned int)type < EDIT_TRACE_TYPE_COUNT &&
+                 get_varint(reader->data, reader->length, &position, &delta);
+
+    if (valid && has_payload(type)) {
+        valid = get_varint(reader->data, reader->length, &position, &offset) &&
+                get_varint(reader->data, reader->length, &position, &length) &&
+                length <= reader->length - position;
+    }
+
+    if (!valid) {
+        reader->damaged = true;
+        return false;
+    }
+
+    reader->time_us += delta;
+    *record = (EditTraceRecord){
+        .type = type,
+        .time_us = reader->time_us,
+        .offset = offset,
+        .text = length > 0 ? reader->data + position : NULL,
+        .length = (size_t)length,
+        .from_history = (type_byte & FROM_HISTORY_FLAG) != 0
+    };
+    reader->position = position + (size_t)length;
+
+    return true;
+}
+
+bool edit_trace_reader_is_damaged(const EditTraceReader* reader) {
+    return reader && reader->damaged;
+}
\ No newline at end of file
@@ -0,0 +1,707 @@
+#define _POSIX_C_SOURCE 200809L
+#include "io/encoding.h"
+#include <errno.h>
+#include <iconv.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_VALIDATORS 1
+#else
+#define HAVE_X86_VALIDATORS 0
+#endif
+
+/**
+ * @brief Bytes inspected when guessing whether a file is UTF-16
+ */
+#define DETECT_SAMPLE_SIZE (64 * 1024)
+
+/**
+ * @brief UTF-8 encoding of U+FFFD REPLACEMENT CHARACTER
+ */
+static const char replacement_character[] = "\xEF\xBF\xBD";
+
+/**
+ * @brief Validates a whole buffer, reporting whether it is pure ASCII
+ */
+typedef bool (*ValidateFunction)(const unsigned char* data, size_t length, bool* ascii);
+
+/**
+ * @brief A UTF-8 validator implementation
+ */
+typedef struct {
+    const char* name;
+    ValidateFunction validate;
+} Utf8Validator;
+
+/**
+ * @brief Static description of each encoding
+ */
+typedef struct {
+    const char* name;        /* Display name */
+    const char* iconv_name;  /* Name for iconv_open(), without byte order mark */
+    const char* bom;
+    size_t bom_length;
+} EncodingInfo;
+
+static const EncodingInfo encodings[] = {
+    [TEXT_ENCODING_UTF8] = { "UTF-8", "UTF-8", "", 0 },
+    [TEXT_ENCODING_UTF8_BOM] = { "UTF-8 with BOM", "UTF-8", "\xEF\xBB\xBF", 3 },
+    [TEXT_ENCODING_UTF16LE] = { "UTF-16LE", "UTF-16LE", "", 0 },
+    [TEXT_ENCODING_UTF16LE_BOM] = { "UTF-16LE with BOM", "UTF-16LE", "\xFF\xFE", 2 },
+    [TEXT_ENCODING_UTF16BE] = { "UTF-16BE", "UTF-16BE", "", 0 },
+    [TEXT_ENCODING_UTF16BE_BOM] = { "UTF-16BE with BOM", "UTF-16BE", "\xFE\xFF", 2 },
+    [TEXT_ENCODING_LATIN1] = { "ISO-8859-1", "ISO-8859-1", "", 0 },
+    [TEXT_ENCODING_CP1252] = { "Windows-1252", "CP1252", "", 0 }
+};
+
+/**
+ * @brief Decoder structure
+ */
+struct EncodingDecoder {
+    TextEncoding encoding;
+    iconv_t converter;   /* (iconv_t)-1 when repairing UTF-8 */
+    size_t unit_size;    /* Bytes skipped past an invalid sequence */
+    bool lossy;
+};
+
+static bool is_valid_encoding(TextEncoding encoding) {
+    return (unsigned int)encoding <= TEXT_ENCODING_CP1252;
+}
+
+static bool is_utf8_encoding(TextEncoding encoding) {
+    return encoding == TEXT_ENCODING_UTF8 || encoding == TEXT_ENCODING_UTF8_BOM;
+}
+
+/**
+ * @brief Returns the length of the well-formed UTF-8 sequence at data
+ * @return 1 to 4, or 0 if the bytes are not a complete valid sequence
+ */
+static size_t utf8_sequence_length(const unsigned char* data, size_t available) {
+    unsigned char lead = data[0];
+    if (lead < 0x80) {
+        return 1;
+    }
+
+    size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) {
+            low = 0xA0;         /* Overlong */
+        } else if (lead == 0xED) {
+            high = 0x9F;        /* Surrogates */
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) {
+            low = 0x90;         /* Overlong */
+        } else if (lead == 0xF4) {
+            high = 0x8F;        /* Above U+10FFFF */
+        }
+    } else {
+        return 0;
+    }
+
+    if (available < length || data[1] < low || data[1] > high) {
+        return 0;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if ((data[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+
+    return length;
+}
+
+/**
+ * @brief Checks whether the bytes at data could still become a valid sequence
+ */
+static bool is_utf8_prefix(const unsigned char* data, size_t available) {
+    unsigned char padded[4] = { 0 };
+    memcpy(padded, data, available);
+
+    /* Complete the sequence with the smallest continuation bytes that fit */
+    for (size_t i = available; i < 4; i++) {
+        padded[i] = 0x80;
+    }
+    if (available == 1 && padded[0] == 0xE0) {
+        padded[1] = 0xA0;
+    } else if (available == 1 && padded[0] == 0xF0) {
+        padded[1] = 0x90;
+    }
+
+    size_t length = utf8_sequence_length(padded, 4);
+    return length > available;
+}
+
+static bool validate_scalar(const unsigned char* data, size_t length, bool* ascii) {
+    bool all_ascii = true;
+    size_t i = 0;
+
+    while (i < length) {
+        if (data[i] < 0x80) {
+            i++;
+            continue;
+        }
+
+        size_t sequence = utf8_sequence_length(data + i, length - i);
+        if (sequence == 0) {
+            return false;
+        }
+        all_ascii = false;
+        i += sequence;
+    }
+
+    *ascii = all_ascii;
+    return true;
+}
+
+static const Utf8Validator scalar_validator = { "scalar", validate_scalar };
+
+#if HAVE_X86_VALIDATORS
+
+/*
+ * The SSE2 validator only skips ASCII in 16-byte blocks and checks the
+ * rest sequence by sequence; plain text is mostly ASCII.
+ */
+__attribute__((target("sse2")))
+static bool validate_sse2(const unsigned char* data, size_t length, bool* ascii) {
+    bool all_ascii = true;
+    size_t i = 0;
+
+    while (i < length) {
+        if (i + 16 <= length &&
+            _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i))) == 0) {
+            i += 16;
+            continue;
+        }
+
+        if (data[i] < 0x80) {
+            i++;
+            continue;
+        }
+
+        size_t sequence = utf8_sequence_length(data + i, length - i);
+        if (sequence == 0) {
+            return false;
+        }
+        all_ascii = false;
+        i += sequence;
+    }
+
+    *ascii = all_ascii;
+    return true;
+}
+
+/*
+ * The AVX2 validator classifies every byte pair with three nibble lookup
+ * tables (Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction
+ * Per Byte"). Each table maps a nibble to the set of errors it allows; an
+ * error is present where all three agree. Missing or extra continuation
+ * bytes of 3 and 4 byte sequences are caught by comparing where they must
+ * appear with where they do.
+ */
+#define TOO_SHORT (1 << 0)      /* Lead byte not followed by a continuation */
+#define TOO_LONG (1 << 1)       /* Continuation after ASCII */
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)      /* Continuation after continuation */
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const unsigned char byte_1_high_table[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const unsigned char byte_1_low_table[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+};
+
+static const unsigned char byte_2_high_table[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+/* Per byte, the largest value that does not start a sequence running past
+ * the end of the block: any lead in the last three bytes needs more input */
+static const unsigned char incomplete_limits[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+};
+
+/**
+ * @brief Accumulated state of the AVX2 validator
+ */
+typedef struct {
+    __m256i error;
+    __m256i previous;
+    __m256i previous_incomplete;
+    __m256i high_bits;
+} Avx2State;
+
+__attribute__((target("avx2")))
+static inline __m256i nibble_lookup(const unsigned char* table, __m256i nibbles) {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table)),
+                               nibbles);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i high_nibbles(__m256i bytes) {
+    return _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+}
+
+/**
+ * @brief Returns the block shifted right by n bytes, filled from the previous block
+ */
+#define PREVIOUS_BYTES(input, previous, n) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((previous), (input), 0x21), 16 - (n))
+
+__attribute__((target("avx2")))
+static inline void check_block_avx2(Avx2State* state, __m256i input) {
+    state->high_bits = _mm256_or_si256(state->high_bits, input);
+
+    if (_mm256_movemask_epi8(input) == 0) {
+        /* ASCII cannot finish a sequence the previous block started */
+        state->error = _mm256_or_si256(state->error, state->previous_incomplete);
+        state->previous = input;
+        return;
+    }
+
+    __m256i previous1 = PREVIOUS_BYTES(input, state->previous, 1);
+    __m256i special_cases = _mm256_and_si256(
+        _mm256_and_si256(nibble_lookup(byte_1_high_table, high_nibbles(previous1)),
+                         nibble_lookup(byte_1_low_table,
+                                       _mm256_and_si256(previous1, _mm256_set1_epi8(0x0F)))),
+        nibble_lookup(byte_2_high_table, high_nibbles(input)));
+
+    /* Bytes two after a 3 or 4 byte lead, or three after a 4 byte lead,
+     * must be continuations; there TWO_CONTS is expected, not an error */
+    __m256i previous2 = PREVIOUS_BYTES(input, state->previous, 2);
+    __m256i previous3 = PREVIOUS_BYTES(input, state->previous, 3);
+    __m256i third_byte = _mm256_subs_epu8(previous2, _mm256_set1_epi8(0xE0 - 0x80));
+    __m256i fourth_byte = _mm256_subs_epu8(previous3, _mm256_set1_epi8(0xF0 - 0x80));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third_byte, fourth_byte),
+                                             _mm256_set1_epi8((char)0x80));
+
+    state->error = _mm256_or_si256(state->error, _mm256_xor_si256(must_continue, special_cases));
+    state->previous_incomplete = _mm256_subs_epu8(
+        input, _mm256_loadu_si256((const __m256i*)incomplete_limits));
+    state->previous = input;
+}
+
+__attribute__((target("avx2")))
+static bool validate_avx2(const unsigned char* data, size_t length, bool* ascii) {
+    Avx2State state;
+    state.error = _mm256_setzero_si256();
+    state.previous = _mm256_setzero_si256();
+    state.previous_incomplete = _mm256_setzero_si256();
+    state.high_bits = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        check_block_avx2(&state, _mm256_loadu_si256((const __m256i*)(data + i)));
+    }
+
+    if (i < length) {
+        /* Zero padding is ASCII, so a sequence cut off by the end is caught */
+        unsigned char tail[32] = { 0 };
+        memcpy(tail, data + i, length - i);
+        check_block_avx2(&state, _mm256_loadu_si256((const __m256i*)tail));
+    }
+
+    state.error = _mm256_or_si256(state.error, state.previous_incomplete);
+
+    *ascii = _mm256_movemask_epi8(state.high_bits) == 0;
+    return _mm256_testz_si256(state.error, state.error);
+}
+
+static const Utf8Validator sse2_validator = { "sse2", validate_sse2 };
+static const Utf8Validator avx2_validator = { "avx2", validate_avx2 };
+
+#endif
+
+/**
+ * @brief Picks the fastest validator the CPU supports
+ */
+static const Utf8Validator* select_validator(void) {
+#if HAVE_X86_VALIDATORS
+    if (__builtin_cpu_supports("avx2")) {
+        return &avx2_validator;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &sse2_validator;
+    }
+#endif
+    return &scalar_validator;
+}
+
+bool encoding_validate_utf8(const char* data, size_t length, bool* ascii) {
+    bool all_ascii = true;
+
+    if (!data && length > 0) {
+        return false;
+    }
+
+    bool valid = length == 0 || select_validator()->validate((const unsigned char*)data, length, &all_ascii);
+    if (ascii) {
+        *ascii = valid && all_ascii;
+    }
+
+    return valid;
+}
+
+const char* encoding_get_validator_name(void) {
+    return select_validator()->name;
+}
+
+/**
+ * @brief Guesses UTF-16 from the pattern of zero bytes in a sample
+ *
+ * Text in UTF-16 is mostly ASCII or Latin characters, whose high byte is
+ * zero, while real zero bytes are rare in 8-bit text.
+ */
+static bool detect_utf16(const unsigned char* data, size_t length, TextEncoding* encoding) {
+    size_t sample = length < DETECT_SAMPLE_SIZE ? length : DETECT_SAMPLE_SIZE;
+    sample &= ~(size_t)1;
+    if (sample < 4) {
+        return false;
+    }
+
+    size_t even_zeros = 0;
+    size_t odd_zeros = 0;
+    for (size_t i = 0; i < sample; i += 2) {
+        even_zeros += data[i] == 0;
+        odd_zeros += data[i + 1] == 0;
+    }
+
+    size_t units = sample / 2;
+    if (odd_zeros * 3 >= units && even_zeros * 10 < odd_zeros) {
+        *encoding = TEXT_ENCODING_UTF16LE;
+        return true;
+    }
+    if (even_zeros * 3 >= units && odd_zeros * 10 < even_zeros) {
+        *encoding = TEXT_ENCODING_UTF16BE;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Chooses between CP1252 and Latin-1 for 8-bit text
+ *
+ * They agree outside 0x80-0x9F, where CP1252 has printable characters
+ * but for five unassigned bytes.
+ */
+static TextEncoding detect_single_byte(const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char byte = data[i];
+        if (byte == 0x81 || byte == 0x8D || byte == 0x8F || byte == 0x90 || byte == 0x9D) {
+            return TEXT_ENCODING_LATIN1;
+        }
+    }
+
+    return TEXT_ENCODING_CP1252;
+}
+
+TextEncoding encoding_detect(const char* data, size_t length, size_t* bom_length) {
+    if (bom_length) {
+        *bom_length = 0;
+    }
+    if (!data || length == 0) {
+        return TEXT_ENCODING_UTF8;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    static const TextEncoding bom_encodings[] = {
+        TEXT_ENCODING_UTF8_BOM, TEXT_ENCODING_UTF16LE_BOM, TEXT_ENCODING_UTF16BE_BOM
+    };
+    for (size_t i = 0; i < sizeof(bom_encodings) / sizeof(bom_encodings[0]); i++) {
+        const EncodingInfo* info = &encodings[bom_encodings[i]];
+        if (length >= info->bom_length && memcmp(data, info->bom, info->bom_length) == 0) {
+            if (bom_length) {
+                *bom_length = info->bom_length;
+            }
+            return bom_encodings[i];
+        }
+    }
+
+    TextEncoding encoding;
+    if (detect_utf16(bytes, length, &encoding)) {
+        return encoding;
+    }
+
+    /* The sample may end inside a character */
+    size_t complete = length;
+    for (size_t back = 1; back <= 3 && back <= length; back++) {
+        if (bytes[length - back] >= 0xC0) {
+            if (is_utf8_prefix(bytes + length - back, back)) {
+                complete = length - back;
+            }
+            break;
+        }
+        if (bytes[length - back] < 0x80) {
+            break;
+        }
+    }
+
+    if (encoding_validate_utf8(data, complete, NULL)) {
+        return TEXT_ENCODING_UTF8;
+    }
+
+    return detect_single_byte(bytes, length);
+}
+
+const char* encoding_get_name(TextEncoding encoding) {
+    if (!is_valid_encoding(encoding)) {
+        return "Unknown";
+    }
+
+    return encodings[encoding].name;
+}
+
+EncodingDecoder* encoding_decoder_create(TextEncoding encoding) {
+    if (!is_valid_encoding(encoding)) {
+        return NULL;
+    }
+
+    EncodingDecoder* decoder = (EncodingDecoder*)malloc(sizeof(EncodingDecoder));
+    if (!decoder) {
+        return NULL;
+    }
+
+    decoder->encoding = encoding;
+    decoder->converter = (iconv_t)-1;
+    decoder->unit_size = 1;
+    decoder->lossy = false;
+
+    if (!is_utf8_encoding(encoding)) {
+        decoder->converter = iconv_open("UTF-8", encodings[encoding].iconv_name);
+        if (decoder->converter == (iconv_t)-1) {
+            free(decoder);
+            return NULL;
+        }
+    }
+
+    if (encoding >= TEXT_ENCODING_UTF16LE && encoding <= TEXT_ENCODING_UTF16BE_BOM) {
+        decoder->unit_size = 2;
+    }
+
+    return decoder;
+}
+
+void encoding_decoder_destroy(EncodingDecoder* decoder) {
+    if (!decoder) {
+        return;
+    }
+
+    if (decoder->converter != (iconv_t)-1) {
+        iconv_close(decoder->converter);
+    }
+    free(decoder);
+}
+
+/**
+ * @brief Copies UTF-8, replacing every invalid byte with U+FFFD
+ */
+static size_t repair_utf8(EncodingDecoder* decoder, const unsigned char* data, size_t length,
+                          bool final, char* output, size_t* consumed) {
+    size_t used = 0;
+    size_t i = 0;
+
+    while (i < length) {
+        size_t sequence = data[i] < 0x80 ? 1 : utf8_sequence_length(data + i, length - i);
+        if (sequence > 0) {
+            memcpy(output + used, data + i, sequence);
+            used += sequence;
+            i += sequence;
+            continue;
+        }
+
+        /* A character split by the end of this piece is finished by the next */
+        if (!final && length - i < 4 && is_utf8_prefix(data + i, length - i)) {
+            break;
+        }
+
+        memcpy(output + used, replacement_character, 3);
+        used += 3;
+        decoder->lossy = true;
+        i++;
+    }
+
+    *consumed = i;
+    return used;
+}
+
+/**
+ * @brief Converts through iconv, replacing invalid input with U+FFFD
+ */
+static size_t convert_iconv(EncodingDecoder* decoder, const char* data, size_t length,
+                            bool final, char* output, size_t capacity, size_t* consumed) {
+    char* input = (char*)data;
+    size_t input_left = length;
+    char* out = output;
+    size_t out_left = capacity;
+
+    while (input_left > 0) {
+        if (iconv(decoder->converter, &input, &input_left, &out, &out_left) != (size_t)-1) {
+            break;
+        }
+
+        if (errno == EINVAL && !final) {
+            break; /* Unfinished character; the caller carries it over */
+        }
+        if (errno != EILSEQ && errno != EINVAL) {
+            return (size_t)-1;
+        }
+
+        /* Invalid (or, at the very end, truncated) input */
+        size_t skip = input_left < decoder->unit_size ? input_left : decoder->unit_size;
+        input += skip;
+        input_left -= skip;
+        memcpy(out, replacement_character, 3);
+        out += 3;
+        out_left -= 3;
+        decoder->lossy = true;
+    }
+
+    /* Flush any shift state (none for the supported encodings) */
+    if (final) {
+        iconv(decoder->converter, NULL, NULL, &out, &out_left);
+    }
+
+    *consumed = length - input_left;
+    return capacity - out_left;
+}
+
+char* encoding_decoder_convert(EncodingDecoder* decoder, const char* data, size_t length,
+                               bool final, size_t* consumed, size_t* output_length) {
+    if (!decoder || (!data && length > 0) || !consumed || !output_length) {
+        return NULL;
+    }
+
+    /* Every input byte produces at most three output bytes (U+FFFD, or a
+     * BMP character from a single byte) */
+    if (length > (SIZE_MAX - 1) / 3) {
+        return NULL;
+    }
+    size_t capacity = length * 3;
+    char* output = (char*)malloc(capacity + 1);
+    if (!output) {
+        return NULL;
+    }
+
+    size_t used;
+    if (decoder->converter == (iconv_t)-1) {
+        used = repair_utf8(decoder, (const unsigned char*)data, length, final, output, consumed);
+    } else {
+        used = convert_iconv(decoder, data, length, final, output, capacity, consumed);
+        if (used == (size_t)-1) {
+            free(output);
+            return NULL;
+        }
+    }
+
+    output[used] = '\0';
+    *output_length = used;
+    return output;
+}
+
+bool encoding_decoder_is_lossy(const EncodingDecoder* decoder) {
+    return decoder && decoder->lossy;
+}
+
+char* encoding_encode(TextEncoding encoding, const char* data, size_t length,
+                      size_t* output_length) {
+    if (!is_valid_encoding(encoding) || (!data && length > 0) || !output_length) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    const EncodingInfo* info = &encodings[encoding];
+
+    /* UTF-16 needs at most two bytes per UTF-8 byte, the others at most one */
+    size_t factor = (encoding >= TEXT_ENCODING_UTF16LE && encoding <= TEXT_ENCODING_UTF16BE_BOM) ? 2 : 1;
+    if (length > (SIZE_MAX - info->bom_length) / factor) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t capacity = info->bom_length + length * factor;
+    char* output = (char*)malloc(capacity > 0 ? capacity : 1);
+    if (!output) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(output, info->bom, info->bom_length);
+
+    if (is_utf8_encoding(encoding)) {
+        if (length > 0) {
+            memcpy(output + info->bom_length, data, length);
+        }
+        *output_length = info->bom_length + length;
+        return output;
+    }
+
+    iconv_t converter = iconv_open(info->iconv_name, "UTF-8");
+    if (converter == (iconv_t)-1) {
+        free(output);
+        return NULL;
+    }
+
+    char* input = (char*)data;
+    size_t input_left = length;
+    char* out = output + info->bom_length;
+    size_t out_left = capacity - info->bom_length;
+
+    size_t converted = input_left > 0 ? iconv(converter, &input, &input_left, &out, &out_left) : 0;
+    int error = errno;
+    iconv_close(converter);
+
+    /* Characters the target cannot represent fail rather than being dropped */
+    if (converted == (size_t)-1 || input_left > 0) {
+        free(output);
+        errno = error == E2BIG ? ENOMEM : EILSEQ;
+        return NULL;
+    }
+
+    *output_length = capacity - out_left;
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,518 @@
+#define _POSIX_C_SOURCE 200809L
+#include "io/file_loader.h"
+#include "io/encoding.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Size of the first chunk - small so the first screenful arrives quickly
+ */
+#define FIRST_CHUNK_SIZE (64 * 1024)
+
+/**
+ * @brief Size of every following chunk
+ */
+#define CHUNK_SIZE (1024 * 1024)
+
+/**
+ * @brief Upper bound on bytes queued but not yet taken by the consumer
+ */
+#define MAX_QUEUED_BYTES (16 * 1024 * 1024)
+
+/**
+ * @brief A chunk waiting in the loader queue
+ */
+typedef struct LoaderChunk {
+    struct LoaderChunk* next;
+    char* data;
+    size_t length;
+} LoaderChunk;
+
+/**
+ * @brief File loader structure
+ *
+ * Everything below the lock is shared between the worker and the consumer.
+ */
+struct FileLoader {
+    char* path;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    pthread_cond_t space_available;
+    LoaderChunk* head;
+    LoaderChunk* tail;
+    size_t queued_bytes;
+    size_t bytes_read;
+    size_t total_size;
+    bool cancelled;
+    bool done;
+    FileOperationResult result;
+    TextEncoding encoding;
+    bool lossy;
+};
+
+/**
+ * @brief How the worker turns file bytes into UTF-8 chunks
+ */
+typedef struct {
+    bool detected;
+    TextEncoding encoding;
+    EncodingDecoder* decoder;  /* NULL while the file reads as valid UTF-8 */
+    bool ascii_only;           /* Everything passed through so far was ASCII */
+} LoadDecoding;
+
+/**
+ * @brief Returns how many trailing bytes form an incomplete UTF-8 sequence
+ */
+static size_t utf8_incomplete_tail(const char* data, size_t length) {
+    size_t limit = length < 4 ? length : 4;
+
+    for (size_t back = 1; back <= limit; back++) {
+        unsigned char byte = (unsigned char)data[length - back];
+        if ((byte & 0xC0) == 0x80) {
+            continue; /* Continuation byte, keep looking for the lead */
+        }
+
+        size_t expected = 1;
+        if ((byte & 0xE0) == 0xC0) {
+            expected = 2;
+        } else if ((byte & 0xF0) == 0xE0) {
+            expected = 3;
+        } else if ((byte & 0xF8) == 0xF0) {
+            expected = 4;
+        }
+
+        return back < expected ? back : 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Appends a chunk to the queue, taking ownership of data
+ */
+static bool enqueue_chunk(FileLoader* loader, char* data, size_t length) {
+    LoaderChunk* chunk = (LoaderChunk*)malloc(sizeof(LoaderChunk));
+    if (!chunk) {
+        return false;
+    }
+
+    chunk->next = NULL;
+    chunk->data = data;
+    chunk->length = length;
+
+    pthread_mutex_lock(&loader->lock);
+    if (loader->tail) {
+        loader->tail->next = chunk;
+    } else {
+        loader->head = chunk;
+    }
+    loader->tail = chunk;
+    loader->queued_bytes += length;
+    pthread_mutex_unlock(&loader->lock);
+
+    return true;
+}
+
+/**
+ * @brief Blocks while the queue is full; returns false if cancelled
+ */
+static bool wait_for_space(FileLoader* loader) {
+    pthread_mutex_lock(&loader->lock);
+    while (loader->queued_bytes >= MAX_QUEUED_BYTES && !loader->cancelled) {
+        pthread_cond_wait(&loader->space_available, &loader->lock);
+    }
+    bool cancelled = loader->cancelled;
+    pthread_mutex_unlock(&loader->lock);
+
+    return !cancelled;
+}
+
+/**
+ * @brief Records the encoding the file is being read as
+ */
+static void set_encoding(FileLoader* loader, LoadDecoding* decoding, TextEncoding encoding) {
+    decoding->encoding = encoding;
+
+    pthread_mutex_lock(&loader->lock);
+    loader->encoding = encoding;
+    pthread_mutex_unlock(&loader->lock);
+}
+
+/**
+ * @brief Turns bytes read from the file into a queued UTF-8 chunk
+ * @param buffer Bytes, with room for a terminator; ownership is taken
+ * @param length Number of bytes
+ * @param final true at EOF
+ * @param carry Receives the bytes of an unfinished character
+ * @param carry_length Receives the number of carried bytes
+ *
+ * Valid UTF-8 is queued as it is. The first chunk decides the encoding;
+ * a file that turns out not to be UTF-8 after only ASCII is re-read as
+ * 8-bit text from that point, otherwise invalid bytes become U+FFFD.
+ */
+static FileOperationResult decode_chunk(FileLoader* loader, LoadDecoding* decoding,
+                                        char* buffer, size_t length, bool final,
+                                        char* carry, size_t* carry_length) {
+    size_t skip = 0;
+
+    if (!decoding->detected) {
+        set_encoding(loader, decoding, encoding_detect(buffer, length, &skip));
+        decoding->detected = true;
+
+        if (decoding->encoding != TEXT_ENCODING_UTF8 && decoding->encoding != TEXT_ENCODING_UTF8_BOM) {
+            decoding->decoder = encoding_decoder_create(decoding->encoding);
+            if (!decoding->decoder) {
+                free(buffer);
+                return FILE_OP_ERROR_MEMORY;
+            }
+        }
+    }
+
+    if (!decoding->decoder) {
+        size_t tail = final ? 0 : utf8_incomplete_tail(buffer + skip, length - skip);
+        size_t complete = length - tail;
+        bool ascii;
+
+        if (encoding_validate_utf8(buffer + skip, complete - skip, &ascii)) {
+            decoding->ascii_only = decoding->ascii_only && ascii;
+            *carry_length = tail;
+            memcpy(carry, buffer + complete, tail);
+
+            if (complete == skip) {
+                free(buffer);
+                return FILE_OP_SUCCESS;
+            }
+
+            memmove(buffer, buffer + skip, complete - skip);
+            buffer[complete - skip] = '\0';
+            if (!enqueue_chunk(loader, buffer, complete - skip)) {
+                free(buffer);
+                return FILE_OP_ERROR_MEMORY;
+            }
+            return FILE_OP_SUCCESS;
+        }
+
+        /* Not UTF-8 after all */
+        if (decoding->ascii_only && decoding->encoding == TEXT_ENCODING_UTF8) {
+            TextEncoding legacy = encoding_detect(buffer + skip, complete - skip, NULL);
+            if (legacy != TEXT_ENCODING_LATIN1) {
+                legacy = TEXT_ENCODING_CP1252;
+            }
+            set_encoding(loader, decoding, legacy);
+        }
+
+        decoding->decoder = encoding_decoder_create(decoding->encoding);
+        if (!decoding->decoder) {
+            free(buffer);
+            return FILE_OP_ERROR_MEMORY;
+        }
+    }
+
+    size_t consumed = 0;
+    size_t output_length = 0;
+    char* output = encoding_decoder_convert(decoding->decoder, buffer + skip, length - skip,
+                                            final, &consumed, &output_length);
+    if (!output) {
+        free(buffer);
+        return FILE_OP_ERROR_MEMORY;
+    }
+
+    *carry_length = length - skip - consumed;
+    memcpy(carry, buffer + skip + consumed, *carry_length);
+    free(buffer);
+
+    if (output_length == 0) {
+        free(output);
+        return FILE_OP_SUCCESS;
+    }
+    if (!enqueue_chunk(loader, output, output_length)) {
+        free(output);
+        return FILE_OP_ERROR_MEMORY;
+    }
+    return FILE_OP_SUCCESS;
+}
+
+/**
+ * @brief Reads the file and feeds the queue until EOF, error or cancellation
+ */
+static FileOperationResult load_file(FileLoader* loader) {
+    int fd = open(loader->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == EACCES ? FILE_OP_ERROR_PERMISSION : FILE_OP_ERROR_OPEN;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        pthread_mutex_lock(&loader->lock);
+        loader->total_size = (size_t)st.st_size;
+        pthread_mutex_unlock(&loader->lock);
+    }
+
+    /* Bytes of a character cut by the previous chunk boundary */
+    char carry[4];
+    size_t carry_length = 0;
+    size_t chunk_size = FIRST_CHUNK_SIZE;
+    FileOperationResult result = FILE_OP_SUCCESS;
+    LoadDecoding decoding = { false, TEXT_ENCODING_UTF8, NULL, true };
+
+    while (wait_for_space(loader)) {
+        char* buffer = (char*)malloc(carry_length + chunk_size + 1);
+        if (!buffer) {
+            result = FILE_OP_ERROR_MEMORY;
+            break;
+        }
+        memcpy(buffer, carry, carry_length);
+
+        ssize_t count;
+        do {
+            count = read(fd, buffer + carry_length, chunk_size);
+        } while (count < 0 && errno == EINTR);
+
+        if (count < 0) {
+            free(buffer);
+            result = FILE_OP_ERROR_READ;
+            break;
+        }
+
+        size_t length = carry_length + (size_t)count;
+        if (count == 0) {
+            /* EOF: flush whatever is left, even a truncated character */
+            if (length > 0) {
+                result = decode_chunk(loader, &decoding, buffer, length, true, carry, &carry_length);
+            } else {
+                free(buffer);
+            }
+            break;
+        }
+
+        pthread_mutex_lock(&loader->lock);
+        loader->bytes_read += (size_t)count;
+        pthread_mutex_unlock(&loader->lock);
+
+        result = decode_chunk(loader, &decoding, buffer, length, false, carry, &carry_length);
+        if (result != FILE_OP_SUCCESS) {
+            break;
+        }
+
+        chunk_size = CHUNK_SIZE;
+    }
+
+    close(fd);
+
+    if (encoding_decoder_is_lossy(decoding.decoder)) {
+        pthread_mutex_lock(&loader->lock);
+        loader->lossy = true;
+        pthread_mutex_unlock(&loader->lock);
+    }
+    encoding_decoder_destroy(decoding.decoder);
+
+    return result;
+}
+
+static void* loader_thread(void* user_data) {
+    FileLoader* loader = (FileLoader*)user_data;
+
+    uint64_t span = trace_begin();
+    uint64_t start = metrics_now();
+
+    FileOperationResult result = load_file(loader);
+
+    pthread_mutex_lock(&loader->lock);
+    bool complete = result == FILE_OP_SUCCESS && !loader->cancelled;
+    size_t bytes_read = loader->bytes_read;
+    loader->result = result;
+    loader->done = true;
+    pthread_mutex_unlock(&loader->lock);
+
+    /* Includes time spent waiting for the UI to take chunks */
+    if (complete) {
+        metrics_record_since(METRIC_FILE_READ_TIME, start);
+        metrics_add(METRIC_FILE_READ_BYTES, bytes_read);
+    }
+    trace_end("file_loader", span);
+
+    return NULL;
+}
+
+FileLoader* file_loader_create(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    FileLoader* loader = (FileLoader*)calloc(1, sizeof(FileLoader));
+    if (!loader) {
+        return NULL;
+    }
+
+    loader->path = strdup(path);
+    if (!loader->path) {
+        free(loader);
+        return NULL;
+    }
+
+    loader->result = FILE_OP_SUCCESS;
+    loader->encoding = TEXT_ENCODING_UTF8;
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->space_available, NULL);
+
+    if (pthread_create(&loader->thread, NULL, loader_thread, loader) != 0) {
+        pthread_cond_destroy(&loader->space_available);
+        pthread_mutex_destroy(&loader->lock);
+        free(loader->path);
+        free(loader);
+        return NULL;
+    }
+
+    return loader;
+}
+
+void file_loader_destroy(FileLoader* loader) {
+    if (!loader) {
+        return;
+    }
+
+    file_loader_cancel(loader);
+    pthread_join(loader->thread, NULL);
+
+    LoaderChunk* chunk = loader->head;
+    while (chunk) {
+        LoaderChunk* next = chunk->next;
+        free(chunk->data);
+        free(chunk);
+        chunk = next;
+    }
+
+    pthread_cond_destroy(&loader->space_available);
+    pthread_mutex_destroy(&loader->lock);
+    free(loader->path);
+    free(loader);
+}
+
+void file_loader_cancel(FileLoader* loader) {
+    if (!loader) {
+        return;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    loader->cancelled = true;
+    pthread_cond_signal(&loader->space_available);
+    pthread_mutex_unlock(&loader->lock);
+}
+
+char* file_loader_take_chunk(FileLoader* loader, size_t* length) {
+    if (!loader) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    LoaderChunk* chunk = loader->head;
+    if (chunk) {
+        loader->head = chunk->next;
+        if (!loader->head) {
+            loader->tail = NULL;
+        }
+        loader->queued_bytes -= chunk->length;
+        pthread_cond_signal(&loader->space_available);
+    }
+    pthread_mutex_unlock(&loader->lock);
+
+    if (!chunk) {
+        return NULL;
+    }
+
+    char* data = chunk->data;
+    if (length) {
+        *length = chunk->length;
+    }
+    free(chunk);
+
+    return data;
+}
+
+bool file_loader_is_finished(FileLoader* loader) {
+    if (!loader) {
+        return true;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    bool finished = loader->done && !loader->head;
+    pthread_mutex_unlock(&loader->lock);
+
+    return finished;
+}
+
+FileOperationResult file_loader_get_result(FileLoader* loader) {
+    if (!loader) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    FileOperationResult result = loader->result;
+    pthread_mutex_unlock(&loader->lock);
+
+    return result;
+}
+
+size_t file_loader_get_bytes_read(FileLoader* loader) {
+    if (!loader) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    size_t bytes_read = loader->bytes_read;
+    pthread_mutex_unlock(&loader->lock);
+
+    return bytes_read;
+}
+
+size_t file_loader_get_total_size(FileLoader* loader) {
+    if (!loader) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    size_t total_size = loader->total_size;
+    pthread_mutex_unlock(&loader->lock);
+
+    return total_size;
+}
+
+const char* file_loader_get_path(const FileLoader* loader) {
+    if (!loader) {
+        return NULL;
+    }
+
+    return loader->path;
+}
+
+TextEncoding file_loader_get_encoding(FileLoader* loader) {
+    if (!loader) {
+        return TEXT_ENCODING_UTF8;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    TextEncoding encoding = loader->encoding;
+    pthread_mutex_unlock(&loader->lock);
+
+    return encoding;
+}
+
+bool file_loader_is_lossy(FileLoader* loader) {
+    if (!loader) {
+        return false;
+    }
+
+    pthread_mutex_lock(&loader->lock);
+    bool lossy = loader->lossy;
+    pthread_mutex_unlock(&loader->lock);
+
+    return lossy;
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE /* MAP_ANONYMOUS */
+#include "io/file_mapping.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Most ranges guarded at once
+ */
+#define FILE_MAPPING_MAX_GUARDS 32
+
+/**
+ * @brief File mapping structure
+ */
+struct FileMapping {
+    char* path;
+    void* data;
+    size_t size;
+    int fd;                  /* Kept open to check the file's size */
+    int guard;
+};
+
+/**
+ * @brief A guarded range, read by the SIGBUS handler
+ */
+typedef struct {
+    atomic_bool used;
+    _Atomic uintptr_t start; /* 0 while the slot is being filled or emptied */
+    atomic_size_t length;
+    atomic_bool faulted;
+} GuardSlot;
+
+static GuardSlot guards[FILE_MAPPING_MAX_GUARDS];
+static pthread_once_t guard_once = PTHREAD_ONCE_INIT;
+static bool guard_installed;
+static size_t guard_page_size;
+static struct sigaction previous_sigbus;
+
+/**
+ * @brief Answers a fault in a guarded range with a page of zeros
+ *
+ * Anything else goes to the disposition that was there before.
+ */
+static void on_sigbus(int signal_number, siginfo_t* info, void* context) {
+    uintptr_t address = (uintptr_t)info->si_addr;
+
+    for (size_t i = 0; i < FILE_MAPPING_MAX_GUARDS; i++) {
+        uintptr_t start = atomic_load(&guards[i].start);
+        if (start == 0 || address < start || address - start >= atomic_load(&guards[i].length)) {
+            continue;
+        }
+
+        void* page = (void*)(address - address % guard_page_size);
+        if (mmap(page, guard_page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                 -1, 0) != MAP_FAILED) {
+            atomic_store(&guards[i].faulted, true);
+            return;
+        }
+        break;
+    }
+
+    if (previous_sigbus.sa_flags & SA_SIGINFO) {
+        previous_sigbus.sa_sigaction(signal_number, info, context);
+        return;
+    }
+    if (previous_sigbus.sa_handler != SIG_DFL && previous_sigbus.sa_handler != SIG_IGN) {
+        previous_sigbus.sa_handler(signal_number);
+        return;
+    }
+
+    /* A real fault runs again on return and now terminates */
+    sigaction(SIGBUS, &previous_sigbus, NULL);
+    if (info->si_code <= 0) {
+        raise(signal_number);
+    }
+}
+
+static void install_guard_handler(void) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) {
+        return;
+    }
+    guard_page_size = (size_t)page_size;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_sigbus;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    guard_installed = sigaction(SIGBUS, &action, &previous_sigbus) == 0;
+}
+
+int file_mapping_guard_add(const void* start, size_t length) {
+    pthread_once(&guard_once, install_guard_handler);
+    if (!guard_installed || !start || length == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < FILE_MAPPING_MAX_GUARDS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&guards[i].used, &expected, true)) {
+            atomic_store(&guards[i].faulted, false);
+            atomic_store(&guards[i].length, length);
+            atomic_store(&guards[i].start, (uintptr_t)start);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool file_mapping_guard_remove(int guard) {
+    if (guard < 0 || guard >= FILE_MAPPING_MAX_GUARDS) {
+        return false;
+    }
+
+    atomic_store(&guards[guard].start, 0);
+    bool faulted = atomic_load(&guards[guard].faulted);
+    atomic_store(&guards[guard].used, false);
+    return faulted;
+}
+
+/**
+ * @brief Stores a result code if the caller asked for it
+ */
+static void set_result(FileOperationResult* result, FileOperationResult value) {
+    if (result) {
+        *result = value;
+    }
+}
+
+FileMapping* file_mapping_open(const char* path, FileOperationResult* result) {
+    if (!path) {
+        set_result(result, FILE_OP_ERROR_INVALID_PATH);
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        set_result(result, errno == EACCES ? FILE_OP_ERROR_PERMISSION : FILE_OP_ERROR_OPEN);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uintmax_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        set_result(result, FILE_OP_ERROR_READ);
+        return NULL;
+    }
+
+    FileMapping* mapping = (FileMapping*)malloc(sizeof(FileMapping));
+    char* path_copy = strdup(path);
+    if (!mapping || !path_copy) {
+        close(fd);
+        free(mapping);
+        free(path_copy);
+        set_result(result, FILE_OP_ERROR_MEMORY);
+        return NULL;
+    }
+
+    mapping->path = path_copy;
+    mapping->size = (size_t)st.st_size;
+    mapping->data = NULL;
+    mapping->fd = fd;
+    mapping->guard = -1;
+
+    if (mapping->size > 0) {
+        mapping->data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    if (mapping->data == MAP_FAILED) {
+        close(fd);
+        free(mapping->path);
+        free(mapping);
+        set_result(result, FILE_OP_ERROR_READ);
+        return NULL;
+    }
+
+    if (mapping->data) {
+        mapping->guard = file_mapping_guard_add(mapping->data, mapping->size);
+        if (mapping->guard < 0) {
+            munmap(mapping->data, mapping->size);
+            close(fd);
+            free(mapping->path);
+            free(mapping);
+            set_result(result, FILE_OP_ERROR_MEMORY);
+            return NULL;
+        }
+    }
+
+    set_result(result, FILE_OP_SUCCESS);
+    return mapping;
+}
+
+void file_mapping_close(FileMapping* mapping) {
+    if (!mapping) {
+        return;
+    }
+
+    file_mapping_guard_remove(mapping->guard);
+    if (mapping->data) {
+        munmap(mapping->data, mapping->size);
+    }
+    close(mapping->fd);
+
+    free(mapping->path);
+    free(mapping);
+}
+
+const char* file_mapping_get_data(const FileMapping* mapping) {
+    if (!mapping) {
+        return NULL;
+    }
+
+    return (const char*)mapping->data;
+}
+
+size_t file_mapping_get_size(const FileMapping* mapping) {
+    if (!mapping) {
+        return 0;
+    }
+
+    return mapping->size;
+}
+
+const char* file_mapping_get_path(const FileMapping* mapping) {
+    if (!mapping) {
+        return NULL;
+    }
+
+    return mapping->path;
+}
+
+void file_mapping_prefetch(const FileMapping* mapping, size_t offset, size_t length) {
+    if (!mapping || !mapping->data || offset >= mapping->size) {
+        return;
+    }
+
+    if (length > mapping->size - offset) {
+        length = mapping->size - offset;
+    }
+
+    /* posix_madvise needs a page-aligned start */
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t aligned = page_size > 0 ? offset - offset % (size_t)page_size : offset;
+
+    posix_madvise((char*)mapping->data + aligned, length + (offset - aligned),
+                  POSIX_MADV_WILLNEED);
+}
+
+bool file_mapping_is_intact(const FileMapping* mapping) {
+    if (!mapping) {
+        return false;
+    }
+
+    if (mapping->guard >= 0 && atomic_load(&guards[mapping->guard].faulted)) {
+        return false;
+    }
+
+    struct stat st;
+    return fstat(mapping->fd, &st) == 0 && (uintmax_t)st.st_size >= mapping->size;
+}
\ No newline at end of file
@@ -1,10 +1,16 @@
-#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE /* MAP_ANONYMOUS */
 #include "io/file_operations.h"
+#include "io/file_mapping.h"
+#include "core/metrics.h"
+#include "core/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 /**
@@ -17,76 +23,326 @@ static const char* error_messages[] = {
     [FILE_OP_ERROR_WRITE] = "Failed to write file",
     [FILE_OP_ERROR_MEMORY] = "Memory allocation failed",
     [FILE_OP_ERROR_INVALID_PATH] = "Invalid file path",
-    [FILE_OP_ERROR_PERMISSION] = "Permission denied"
+    [FILE_OP_ERROR_PERMISSION] = "Permission denied",
+    [FILE_OP_ERROR_ENCODING] = "The text contains characters the file's encoding cannot represent",
+    [FILE_OP_ERROR_NUL_BYTES] = "The file contains NUL bytes, which a document cannot hold"
 };
 
-FileOperationResult file_operations_read(const char* path, Document* doc) {
-    if (!path || !doc) {
-        return FILE_OP_ERROR_INVALID_PATH;
+/**
+ * @brief Bytes looked at to guess a file's encoding
+ */
+#define ENCODING_SAMPLE_SIZE (64 * 1024)
+
+/**
+ * @brief Maps an errno value from open()/fopen() to a result code
+ */
+static FileOperationResult open_error_from_errno(int error) {
+    if (error == EACCES) {
+        return FILE_OP_ERROR_PERMISSION;
     }
-    
-    FILE* file = fopen(path, "rb");
-    if (!file) {
-        if (errno == EACCES) {
-            return FILE_OP_ERROR_PERMISSION;
+    return FILE_OP_ERROR_OPEN;
+}
+
+/**
+ * @brief Where a read delivers its UTF-8 text
+ */
+typedef struct {
+    Document* doc;    /* Stores the text in this document when set */
+    char* content;    /* Otherwise the text is handed back here */
+    size_t length;
+} ReadTarget;
+
+/**
+ * @brief Hands NUL-terminated UTF-8 text to a read's target
+ * @param owned Heap buffer the text lies in, which the target takes over,
+ *        or NULL if the text must be copied
+ */
+static FileOperationResult deliver_text(ReadTarget* target, const char* text, size_t length, char* owned) {
+    if (target->doc) {
+        /* A C string would silently end at the first NUL */
+        bool stored = !memchr(text, '\0', length);
+        if (stored && !document_set_content(target->doc, text)) {
+            free(owned);
+            return FILE_OP_ERROR_MEMORY;
         }
-        return FILE_OP_ERROR_OPEN;
+        free(owned);
+        return stored ? FILE_OP_SUCCESS : FILE_OP_ERROR_NUL_BYTES;
     }
-    
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    if (file_size < 0) {
-        fclose(file);
+
+    if (owned) {
+        if (text != owned) {
+            memmove(owned, text, length);
+            owned[length] = '\0';
+        }
+        target->content = owned;
+        target->length = length;
+        return FILE_OP_SUCCESS;
+    }
+
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        return FILE_OP_ERROR_MEMORY;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+
+    target->content = copy;
+    target->length = length;
+    return FILE_OP_SUCCESS;
+}
+
+/**
+ * @brief Delivers NUL-terminated file bytes to a read's target as UTF-8
+ * @param owned Heap buffer holding data, which is taken over, or NULL
+ *
+ * Valid UTF-8 is delivered as it is; anything else is converted from the
+ * encoding guessed from the start of the file.
+ */
+static FileOperationResult store_content(ReadTarget* target, const char* data, size_t length, char* owned) {
+    size_t bom_length;
+    TextEncoding encoding = encoding_detect(data, length < ENCODING_SAMPLE_SIZE ? length : ENCODING_SAMPLE_SIZE,
+                                            &bom_length);
+
+    if ((encoding == TEXT_ENCODING_UTF8 || encoding == TEXT_ENCODING_UTF8_BOM) &&
+        encoding_validate_utf8(data + bom_length, length - bom_length, NULL)) {
+        return deliver_text(target, data + bom_length, length - bom_length, owned);
+    }
+
+    if (encoding == TEXT_ENCODING_UTF8) {
+        encoding = TEXT_ENCODING_CP1252;
+    }
+
+    EncodingDecoder* decoder = encoding_decoder_create(encoding);
+    if (!decoder) {
+        free(owned);
+        return FILE_OP_ERROR_MEMORY;
+    }
+
+    size_t consumed;
+    size_t converted_length;
+    char* converted = encoding_decoder_convert(decoder, data + bom_length, length - bom_length,
+                                               true, &consumed, &converted_length);
+    encoding_decoder_destroy(decoder);
+    free(owned);
+    if (!converted) {
+        return FILE_OP_ERROR_MEMORY;
+    }
+
+    return deliver_text(target, converted, converted_length, converted);
+}
+
+/**
+ * @brief Loads a regular file through a read-only private mapping
+ *
+ * The file is mapped over a reservation one byte longer than the file, so
+ * the byte after the content is a zero from either the kernel-filled tail
+ * of the last file page or the anonymous page behind it. The bytes are
+ * thus NUL-terminated whatever the file size, and valid UTF-8 reaches the
+ * document with no staging buffer; the document's own copy is the only
+ * one made. Returns FILE_OP_ERROR_READ when the file cannot be mapped, or
+ * was truncated while it was copied, so the caller can fall back to
+ * streaming.
+ */
+static FileOperationResult read_mapped(int fd, size_t file_size, ReadTarget* target) {
+    size_t reserved = file_size + 1;
+    char* mapping = (char*)mmap(NULL, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
         return FILE_OP_ERROR_READ;
     }
-    
-    // Allocate buffer
-    char* buffer = (char*)malloc(file_size + 1);
+    if (mmap(mapping, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(mapping, reserved);
+        return FILE_OP_ERROR_READ;
+    }
+
+    int guard = file_mapping_guard_add(mapping, file_size);
+    if (guard < 0) {
+        munmap(mapping, reserved);
+        return FILE_OP_ERROR_READ;
+    }
+
+    /* Document copies the content front to back; let readahead run ahead */
+    posix_madvise(mapping, file_size, POSIX_MADV_SEQUENTIAL);
+
+    FileOperationResult result = store_content(target, mapping, file_size, NULL);
+    bool truncated = file_mapping_guard_remove(guard);
+    munmap(mapping, reserved);
+
+    /* Part of what was stored read as zeros; the stream reads what is there now */
+    if (truncated && result == FILE_OP_SUCCESS) {
+        free(target->content);
+        target->content = NULL;
+        target->length = 0;
+        return FILE_OP_ERROR_READ;
+    }
+
+    if (result == FILE_OP_SUCCESS) {
+        metrics_add(METRIC_FILE_READ_BYTES, file_size);
+    }
+
+    return result;
+}
+
+/**
+ * @brief Loads a file by reading until EOF into a growing buffer
+ *
+ * Used for pipes, character devices, /proc entries (which report a size
+ * of zero) and any regular file that could not be mapped.
+ */
+static FileOperationResult read_stream(int fd, size_t size_hint, ReadTarget* target) {
+    size_t capacity = size_hint > 0 ? size_hint + 1 : 64 * 1024;
+    size_t length = 0;
+
+    char* buffer = (char*)malloc(capacity);
     if (!buffer) {
-        fclose(file);
         return FILE_OP_ERROR_MEMORY;
     }
+
+    for (;;) {
+        /* A full buffer is usually the whole file; only grow if EOF is not next */
+        if (length + 1 >= capacity) {
+            char probe[4096];
+            ssize_t count = read(fd, probe, sizeof(probe));
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                free(buffer);
+                return FILE_OP_ERROR_READ;
+            }
+            if (count == 0) {
+                break;
+            }
+
+            size_t needed = length + (size_t)count + 1;
+            size_t grown_capacity = capacity * 2 > needed ? capacity * 2 : needed;
+            char* grown = (char*)realloc(buffer, grown_capacity);
+            if (!grown) {
+                free(buffer);
+                return FILE_OP_ERROR_MEMORY;
+            }
+            buffer = grown;
+            capacity = grown_capacity;
+            memcpy(buffer + length, probe, (size_t)count);
+            length += (size_t)count;
+            continue;
+        }
+
+        ssize_t count = read(fd, buffer + length, capacity - length - 1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(buffer);
+            return FILE_OP_ERROR_READ;
+        }
+        if (count == 0) {
+            break;
+        }
+        length += (size_t)count;
+    }
+
+    buffer[length] = '\0';
+
+    FileOperationResult result = store_content(target, buffer, length, buffer);
+
+    if (result == FILE_OP_SUCCESS) {
+        metrics_add(METRIC_FILE_READ_BYTES, length);
+    }
+
+    return result;
+}
+
+static FileOperationResult read_file(const char* path, ReadTarget* target) {
+    if (!path) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
     
-    // Read file content
-    size_t bytes_read = fread(buffer, 1, file_size, file);
-    fclose(file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return open_error_from_errno(errno);
+    }
     
-    if (bytes_read != (size_t)file_size) {
-        free(buffer);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
         return FILE_OP_ERROR_READ;
     }
     
-    buffer[file_size] = '\0';
+    /* Regular files with a known size are mapped; everything else streams */
+    FileOperationResult result = FILE_OP_ERROR_READ;
+    size_t size_hint = 0;
     
-    // Update document
-    if (!document_set_content(doc, buffer)) {
-        free(buffer);
-        return FILE_OP_ERROR_MEMORY;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_hint = (size_t)st.st_size;
+        result = read_mapped(fd, size_hint, target);
     }
     
-    if (!document_set_file_path(doc, path)) {
-        free(buffer);
-        return FILE_OP_ERROR_MEMORY;
+    if (result == FILE_OP_ERROR_READ) {
+        result = read_stream(fd, size_hint, target);
     }
     
-    document_mark_saved(doc);
-    free(buffer);
+    close(fd);
     
-    return FILE_OP_SUCCESS;
+    return result;
 }
 
-FileOperationResult file_operations_write(const char* path, const Document* doc) {
-    if (!path || !doc) {
+/**
+ * @brief Runs a read with timing and tracing
+ */
+static FileOperationResult read_timed(const char* path, ReadTarget* target) {
+    uint64_t span = trace_begin();
+    uint64_t start = metrics_now();
+
+    FileOperationResult result = read_file(path, target);
+
+    /* Failures are left out so they do not skew the throughput */
+    if (result == FILE_OP_SUCCESS) {
+        metrics_record_since(METRIC_FILE_READ_TIME, start);
+    }
+    trace_end("file_operations_read", span);
+
+    return result;
+}
+
+FileOperationResult file_operations_read_data(const char* path, char** content, size_t* length) {
+    if (!content || !length) {
         return FILE_OP_ERROR_INVALID_PATH;
     }
-    
-    const char* content = document_get_content(doc);
-    if (!content) {
+
+    ReadTarget target = {0};
+    FileOperationResult result = read_timed(path, &target);
+    if (result == FILE_OP_SUCCESS) {
+        *content = target.content;
+        *length = target.length;
+    }
+
+    return result;
+}
+
+FileOperationResult file_operations_read(const char* path, Document* doc) {
+    if (!doc) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
+
+    ReadTarget target = {.doc = doc};
+    FileOperationResult result = read_timed(path, &target);
+    if (result != FILE_OP_SUCCESS) {
+        return result;
+    }
+
+    if (!document_set_file_path(doc, path)) {
         return FILE_OP_ERROR_MEMORY;
     }
+
+    document_mark_saved(doc);
+
+    return FILE_OP_SUCCESS;
+}
+
+static FileOperationResult write_data(const char* path, const char* data, size_t length) {
+    if (!path || (!data && length > 0)) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
     
     FILE* file = fopen(path, "wb");
     if (!file) {
@@ -96,10 +352,9 @@ FileOperationResult file_operations_write(const char* path, const Document* doc)
         return FILE_OP_ERROR_OPEN;
     }
     
-    size_t content_len = strlen(content);
-    size_t bytes_written = fwrite(content, 1, content_len, file);
+    size_t bytes_written = length > 0 ? fwrite(data, 1, length, file) : 0;
     
-    if (bytes_written != content_len) {
+    if (bytes_written != length) {
         fclose(file);
         return FILE_OP_ERROR_WRITE;
     }
@@ -108,9 +363,214 @@ FileOperationResult file_operations_write(const char* path, const Document* doc)
         return FILE_OP_ERROR_WRITE;
     }
     
+    metrics_add(METRIC_FILE_WRITE_BYTES, length);
+    
     return FILE_OP_SUCCESS;
 }
 
+FileOperationResult file_operations_write_data(const char* path, const char* data, size_t length) {
+    uint64_t span = trace_begin();
+    uint64_t start = metrics_now();
+
+    FileOperationResult result = write_data(path, data, length);
+
+    if (result == FILE_OP_SUCCESS) {
+        metrics_record_since(METRIC_FILE_WRITE_TIME, start);
+    }
+    trace_end("file_operations_write", span);
+
+    return result;
+}
+
+FileOperationResult file_operations_write(const char* path, const Document* doc) {
+    if (!path || !doc) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
+
+    const char* content = document_get_content(doc);
+    if (!content) {
+        return FILE_OP_ERROR_MEMORY;
+    }
+
+    return file_operations_write_data(path, content, document_get_length(doc));
+}
+
+/**
+ * @brief Writes all bytes, retrying on short writes and EINTR
+ */
+static bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t count = write(fd, data, length);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        length -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * @brief fsyncs the directory containing path so a rename is durable
+ */
+static bool sync_parent_directory(const char* path) {
+    char* directory = strdup(path);
+    if (!directory) {
+        return false;
+    }
+
+    char* last_slash = strrchr(directory, '/');
+    if (last_slash == directory) {
+        last_slash[1] = '\0';
+    } else if (last_slash) {
+        *last_slash = '\0';
+    } else {
+        strcpy(directory, ".");
+    }
+
+    int fd = open(directory, O_RDONLY | O_CLOEXEC);
+    free(directory);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+static FileOperationResult write_atomic(const char* path,
+                                        const char* data,
+                                        size_t length,
+                                        FileSyncPolicy policy) {
+    if (!path || (!data && length > 0)) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
+
+    /* Write through symlinks: replace the file they point to */
+    char* target = realpath(path, NULL);
+    if (!target) {
+        if (errno != ENOENT) {
+            return open_error_from_errno(errno);
+        }
+        target = strdup(path);
+        if (!target) {
+            return FILE_OP_ERROR_MEMORY;
+        }
+    }
+
+    /* The temporary file must live next to the target for rename() */
+    size_t target_length = strlen(target);
+    char* temp_path = (char*)malloc(target_length + sizeof(".XXXXXX") + 1);
+    if (!temp_path) {
+        free(target);
+        return FILE_OP_ERROR_MEMORY;
+    }
+
+    const char* last_slash = strrchr(target, '/');
+    size_t directory_length = last_slash ? (size_t)(last_slash - target) + 1 : 0;
+    memcpy(temp_path, target, directory_length);
+    temp_path[directory_length] = '.';
+    strcpy(temp_path + directory_length + 1, target + directory_length);
+    strcat(temp_path, ".XXXXXX");
+
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        FileOperationResult result = open_error_from_errno(errno);
+        free(temp_path);
+        free(target);
+        return result;
+    }
+
+    /* mkstemp() creates 0600; keep the mode of the file being replaced */
+    struct stat st;
+    mode_t mode;
+    if (stat(target, &st) == 0) {
+        mode = st.st_mode & 07777;
+    } else {
+        mode_t mask = umask(0);
+        umask(mask);
+        mode = 0666 & ~mask;
+    }
+
+    FileOperationResult result = FILE_OP_SUCCESS;
+
+    if (fchmod(fd, mode) != 0) {
+        result = errno == EPERM ? FILE_OP_ERROR_PERMISSION : FILE_OP_ERROR_WRITE;
+    } else if (!write_all(fd, data, length)) {
+        result = FILE_OP_ERROR_WRITE;
+    } else if (policy == FILE_SYNC_DATA && fdatasync(fd) != 0) {
+        result = FILE_OP_ERROR_WRITE;
+    } else if (policy == FILE_SYNC_FULL && fsync(fd) != 0) {
+        result = FILE_OP_ERROR_WRITE;
+    }
+
+    if (close(fd) != 0 && result == FILE_OP_SUCCESS) {
+        result = FILE_OP_ERROR_WRITE;
+    }
+
+    if (result == FILE_OP_SUCCESS && rename(temp_path, target) != 0) {
+        result = errno == EACCES ? FILE_OP_ERROR_PERMISSION : FILE_OP_ERROR_WRITE;
+    }
+
+    if (result != FILE_OP_SUCCESS) {
+        unlink(temp_path);
+    } else if (policy == FILE_SYNC_FULL && !sync_parent_directory(target)) {
+        result = FILE_OP_ERROR_WRITE;
+    }
+
+    free(temp_path);
+    free(target);
+    return result;
+}
+
+FileOperationResult file_operations_write_atomic(const char* path,
+                                                 const char* data,
+                                                 size_t length,
+                                                 FileSyncPolicy policy) {
+    uint64_t span = trace_begin();
+    uint64_t start = metrics_now();
+
+    FileOperationResult result = write_atomic(path, data, length, policy);
+
+    if (result == FILE_OP_SUCCESS) {
+        metrics_record_since(METRIC_FILE_WRITE_TIME, start);
+        metrics_add(METRIC_FILE_WRITE_BYTES, length);
+    }
+    trace_end("file_operations_write_atomic", span);
+
+    return result;
+}
+
+FileOperationResult file_operations_write_encoded(const char* path,
+                                                  const char* data,
+                                                  size_t length,
+                                                  TextEncoding encoding,
+                                                  FileSyncPolicy policy) {
+    if (!path || (!data && length > 0)) {
+        return FILE_OP_ERROR_INVALID_PATH;
+    }
+
+    /* Plain UTF-8 is written without a converted copy */
+    if (encoding == TEXT_ENCODING_UTF8) {
+        return file_operations_write_atomic(path, data, length, policy);
+    }
+
+    size_t encoded_length;
+    char* encoded = encoding_encode(encoding, data, length, &encoded_length);
+    if (!encoded) {
+        return errno == EILSEQ ? FILE_OP_ERROR_ENCODING : FILE_OP_ERROR_MEMORY;
+    }
+
+    FileOperationResult result = file_operations_write_atomic(path, encoded, encoded_length, policy);
+    free(encoded);
+
+    return result;
+}
+
 bool file_operations_exists(const char* path) {
     if (!path) {
         return false;
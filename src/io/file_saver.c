@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+#include "io/file_saver.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A queued save, reused to carry its result back
+ */
+typedef struct SaveJob {
+    struct SaveJob* next;
+    char* path;
+    void* data;
+    size_t length;
+    FileSaverRelease release;
+    FileSyncPolicy policy;
+    TextEncoding encoding;
+    unsigned long tag;
+    FileOperationResult result;
+} SaveJob;
+
+/**
+ * @brief Singly linked FIFO of jobs
+ */
+typedef struct {
+    SaveJob* head;
+    SaveJob* tail;
+} JobQueue;
+
+/**
+ * @brief File saver structure
+ */
+struct FileSaver {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;
+    JobQueue pending;
+    JobQueue completed;
+    bool writing;
+    bool stopping;
+};
+
+static void queue_push(JobQueue* queue, SaveJob* job) {
+    job->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+}
+
+static SaveJob* queue_pop(JobQueue* queue) {
+    SaveJob* job = queue->head;
+    if (job) {
+        queue->head = job->next;
+        if (!queue->head) {
+            queue->tail = NULL;
+        }
+    }
+    return job;
+}
+
+static void release_job_data(SaveJob* job) {
+    if (job->release) {
+        job->release(job->data);
+    }
+    job->data = NULL;
+}
+
+static void* saver_thread(void* user_data) {
+    FileSaver* saver = (FileSaver*)user_data;
+
+    pthread_mutex_lock(&saver->lock);
+    for (;;) {
+        while (!saver->pending.head && !saver->stopping) {
+            pthread_cond_wait(&saver->work_available, &saver->lock);
+        }
+
+        SaveJob* job = queue_pop(&saver->pending);
+        if (!job) {
+            break; /* Stopping and nothing left to write */
+        }
+        saver->writing = true;
+        pthread_mutex_unlock(&saver->lock);
+
+        job->result = file_operations_write_encoded(job->path, (const char*)job->data,
+                                                    job->length, job->encoding, job->policy);
+        release_job_data(job);
+
+        pthread_mutex_lock(&saver->lock);
+        saver->writing = false;
+        queue_push(&saver->completed, job);
+    }
+    pthread_mutex_unlock(&saver->lock);
+
+    return NULL;
+}
+
+FileSaver* file_saver_create(void) {
+    FileSaver* saver = (FileSaver*)calloc(1, sizeof(FileSaver));
+    if (!saver) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_cond_init(&saver->work_available, NULL);
+
+    if (pthread_create(&saver->thread, NULL, saver_thread, saver) != 0) {
+        pthread_cond_destroy(&saver->work_available);
+        pthread_mutex_destroy(&saver->lock);
+        free(saver);
+        return NULL;
+    }
+
+    return saver;
+}
+
+void file_saver_destroy(FileSaver* saver) {
+    if (!saver) {
+        return;
+    }
+
+    pthread_mutex_lock(&saver->lock);
+    saver->stopping = true;
+    pthread_cond_signal(&saver->work_available);
+    pthread_mutex_unlock(&saver->lock);
+
+    pthread_join(saver->thread, NULL);
+
+    SaveJob* job;
+    while ((job = queue_pop(&saver->completed)) != NULL) {
+        free(job->path);
+        free(job);
+    }
+
+    pthread_cond_destroy(&saver->work_available);
+    pthread_mutex_destroy(&saver->lock);
+    free(saver);
+}
+
+bool file_saver_submit(FileSaver* saver,
+                       const char* path,
+                       void* data,
+                       size_t length,
+                       FileSaverRelease release,
+                       FileSyncPolicy policy,
+                       TextEncoding encoding,
+                       unsigned long tag) {
+    if (!saver || !path || (!data && length > 0)) {
+        return false;
+    }
+
+    SaveJob* job = (SaveJob*)malloc(sizeof(SaveJob));
+    if (!job) {
+        return false;
+    }
+
+    job->path = strdup(path);
+    if (!job->path) {
+        free(job);
+        return false;
+    }
+
+    job->data = data;
+    job->length = length;
+    job->release = release;
+    job->policy = policy;
+    job->encoding = encoding;
+    job->tag = tag;
+    job->result = FILE_OP_SUCCESS;
+
+    pthread_mutex_lock(&saver->lock);
+    queue_push(&saver->pending, job);
+    pthread_cond_signal(&saver->work_available);
+    pthread_mutex_unlock(&saver->lock);
+
+    return true;
+}
+
+bool file_saver_take_result(FileSaver* saver, FileSaveResult* result) {
+    if (!saver || !result) {
+        return false;
+    }
+
+    pthread_mutex_lock(&saver->lock);
+    SaveJob* job = queue_pop(&saver->completed);
+    pthread_mutex_unlock(&saver->lock);
+
+    if (!job) {
+        return false;
+    }
+
+    result->result = job->result;
+    result->path = job->path;
+    result->tag = job->tag;
+    free(job);
+
+    return true;
+}
+
+bool file_saver_is_idle(FileSaver* saver) {
+    if (!saver) {
+        return true;
+    }
+
+    pthread_mutex_lock(&saver->lock);
+    bool idle = !saver->pending.head && !saver->writing && !saver->completed.head;
+    pthread_mutex_unlock(&saver->lock);
+
+    return idle;
+}
\ No newline at end of file
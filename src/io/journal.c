@@ -0,0 +1,923 @@
+#define _XOPEN_SOURCE 700
+#include "io/journal.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief First bytes of every journal file
+ */
+#define JOURNAL_MAGIC "NBJ1"
+#define MAGIC_LENGTH 4
+
+#define RECORD_INSERT 'i'
+#define RECORD_DELETE 'd'
+
+#define CRC_LENGTH 4
+
+/**
+ * @brief Longest LEB128 encoding of a 64-bit value
+ */
+#define VARINT_MAX 10
+
+/**
+ * @brief Bytes copied at a time when a journal is rebased
+ */
+#define COPY_CHUNK (64 * 1024)
+
+/**
+ * @brief Growable byte buffer
+ */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} ByteBuffer;
+
+/**
+ * @brief Inserted bytes a record refers to instead of holding
+ *
+ * In the batch the record's header runs from `record` to `split`, where
+ * the bytes belong, and its CRC follows at `split`.
+ */
+typedef struct {
+    size_t record;
+    size_t split;
+    const char* data;
+    size_t length;
+    void* owner;
+    JournalRelease release;
+} SharedBytes;
+
+/**
+ * @brief Shared bytes of one batch, in record order
+ */
+typedef struct {
+    SharedBytes* items;
+    size_t count;
+    size_t capacity;
+} SharedList;
+
+/**
+ * @brief What the journalled edits apply to
+ */
+typedef struct {
+    char* path;           /* NULL for an empty untitled document */
+    uint64_t size;
+    uint64_t inode;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+} JournalBase;
+
+/**
+ * @brief Journal structure
+ *
+ * Records are encoded into `pending` by the recording thread. The writer
+ * swaps it with `writing`, fills in the CRCs and appends the batch.
+ * Positions count record bytes since the journal was opened; the file
+ * holds the header followed by the records from `file_start` to `written`.
+ */
+struct Journal {
+    char* path;
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned int flush_interval_ms;
+    ByteBuffer pending;
+    SharedList pending_shared;
+    uint64_t position;        /* Recording thread only */
+    bool rebase_requested;
+    char* rebase_path;
+    uint64_t rebase_position;
+    bool stopping;
+    bool failed;
+    /* Writer thread only */
+    ByteBuffer writing;
+    SharedList writing_shared;
+    size_t header_length;
+    uint64_t file_start;
+    uint64_t written;
+};
+
+/**
+ * @brief Journal read back for recovery
+ */
+struct JournalRecovery {
+    char* data;
+    size_t records_start;
+    size_t records_end;
+    size_t edit_count;
+    JournalBase base;
+};
+
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+static uint32_t crc_table[256];
+
+static void init_crc_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        crc_table[i] = crc;
+    }
+}
+
+/**
+ * @brief Continues a CRC-32 (IEEE 802.3) over more bytes
+ */
+static uint32_t extend_crc(uint32_t crc, const char* data, size_t length) {
+    pthread_once(&crc_once, init_crc_table);
+
+    crc ^= 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = crc_table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * @brief CRC-32 (IEEE 802.3)
+ */
+static uint32_t compute_crc(const char* data, size_t length) {
+    return extend_crc(0, data, length);
+}
+
+static void put_u32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (char)(value >> (8 * i));
+    }
+}
+
+static void put_u64(char* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (char)(value >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)(unsigned char)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)(unsigned char)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static size_t put_varint(char* out, uint64_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (char)value;
+    return length;
+}
+
+static bool get_varint(const char* data, size_t length, size_t* position, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *position < length; shift += 7) {
+        unsigned char byte = (unsigned char)data[(*position)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool buffer_reserve(ByteBuffer* buffer, size_t extra) {
+    if (buffer->capacity - buffer->length >= extra) {
+        return true;
+    }
+
+    size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+    while (capacity - buffer->length < extra) {
+        capacity *= 2;
+    }
+
+    char* data = (char*)realloc(buffer->data, capacity);
+    if (!data) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Drops the references a list holds and empties it
+ */
+static void release_shared(SharedList* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->items[i].release) {
+            list->items[i].release(list->items[i].owner);
+        }
+    }
+    list->count = 0;
+}
+
+static bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t count = write(fd, data, length);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        length -= (size_t)count;
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes one record, without checking its CRC
+ * @return false if the bytes do not hold a complete, well-formed record
+ */
+static bool parse_record(const char* data, size_t length, size_t* record_length, JournalEdit* edit) {
+    if (length == 0 || (data[0] != RECORD_INSERT && data[0] != RECORD_DELETE)) {
+        return false;
+    }
+
+    size_t position = 1;
+    uint64_t span;
+    memset(edit, 0, sizeof(*edit));
+    if (!get_varint(data, length, &position, &edit->offset) || !get_varint(data, length, &position, &span)) {
+        return false;
+    }
+
+    if (data[0] == RECORD_INSERT) {
+        uint64_t bytes;
+        if (!get_varint(data, length, &position, &bytes) || bytes > length - position) {
+            return false;
+        }
+        edit->inserted = data + position;
+        edit->inserted_length = (size_t)bytes;
+        edit->inserted_span = span;
+        position += (size_t)bytes;
+    } else {
+        edit->removed_span = span;
+    }
+
+    if (length - position < CRC_LENGTH) {
+        return false;
+    }
+    *record_length = position + CRC_LENGTH;
+    return true;
+}
+
+/**
+ * @brief Encodes the header for a base, stat()ing its file
+ */
+static bool encode_header(ByteBuffer* header, const char* document_path) {
+    size_t path_length = document_path ? strlen(document_path) : 0;
+    if (!buffer_reserve(header, MAGIC_LENGTH + 1 + 4 + path_length + 4 * 8 + CRC_LENGTH)) {
+        return false;
+    }
+
+    struct stat st;
+    memset(&st, 0, sizeof(st));
+    if (document_path && stat(document_path, &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+
+    char* out = header->data;
+    memcpy(out, JOURNAL_MAGIC, MAGIC_LENGTH);
+    size_t length = MAGIC_LENGTH;
+    out[length++] = document_path ? 1 : 0;
+    put_u32(out + length, (uint32_t)path_length);
+    length += 4;
+    if (path_length > 0) {
+        memcpy(out + length, document_path, path_length);
+        length += path_length;
+    }
+    put_u64(out + length, (uint64_t)st.st_size);
+    put_u64(out + length + 8, (uint64_t)st.st_ino);
+    put_u64(out + length + 16, (uint64_t)(int64_t)st.st_mtim.tv_sec);
+    put_u64(out + length + 24, (uint64_t)(int64_t)st.st_mtim.tv_nsec);
+    length += 4 * 8;
+    put_u32(out + length, compute_crc(out, length));
+    header->length = length + CRC_LENGTH;
+    return true;
+}
+
+/**
+ * @brief Decodes a header
+ * @return Header length, or 0 if it is damaged
+ */
+static size_t decode_header(const char* data, size_t length, JournalBase* base) {
+    const size_t fixed = MAGIC_LENGTH + 1 + 4;
+    if (length < fixed || memcmp(data, JOURNAL_MAGIC, MAGIC_LENGTH) != 0) {
+        return 0;
+    }
+
+    uint32_t path_length = get_u32(data + MAGIC_LENGTH + 1);
+    if (path_length > length - fixed || length - fixed - path_length < 4 * 8 + CRC_LENGTH) {
+        return 0;
+    }
+
+    size_t header_length = fixed + path_length + 4 * 8;
+    if (get_u32(data + header_length) != compute_crc(data, header_length)) {
+        return 0;
+    }
+
+    memset(base, 0, sizeof(*base));
+    if (data[MAGIC_LENGTH]) {
+        base->path = (char*)malloc((size_t)path_length + 1);
+        if (!base->path) {
+            return 0;
+        }
+        memcpy(base->path, data + fixed, path_length);
+        base->path[path_length] = '\0';
+    }
+
+    const char* identity = data + fixed + path_length;
+    base->size = get_u64(identity);
+    base->inode = get_u64(identity + 8);
+    base->mtime_sec = (int64_t)get_u64(identity + 16);
+    base->mtime_nsec = (int64_t)get_u64(identity + 24);
+    return header_length + CRC_LENGTH;
+}
+
+/**
+ * @brief Fills in the CRC of every record in a run of whole records
+ */
+static void seal_records(char* data, size_t length) {
+    size_t position = 0;
+    while (position < length) {
+        size_t record_length;
+        JournalEdit edit;
+        if (!parse_record(data + position, length - position, &record_length, &edit)) {
+            return;
+        }
+
+        char* record = data + position;
+        put_u32(record + record_length - CRC_LENGTH, compute_crc(record, record_length - CRC_LENGTH));
+        position += record_length;
+    }
+}
+
+/**
+ * @brief Seals and appends a batch, splicing in its shared bytes
+ * @return Bytes appended, or 0 with *ok set to false on a write error
+ */
+static uint64_t write_batch(Journal* journal, bool* ok) {
+    ByteBuffer* batch = &journal->writing;
+    uint64_t written = 0;
+    size_t position = 0;
+    size_t sealed = 0;
+
+    for (size_t i = 0; i < journal->writing_shared.count; i++) {
+        const SharedBytes* bytes = &journal->writing_shared.items[i];
+        seal_records(batch->data + sealed, bytes->record - sealed);
+
+        uint32_t crc = compute_crc(batch->data + bytes->record, bytes->split - bytes->record);
+        put_u32(batch->data + bytes->split, extend_crc(crc, bytes->data, bytes->length));
+
+        if (!write_all(journal->fd, batch->data + position, bytes->split - position) ||
+            !write_all(journal->fd, bytes->data, bytes->length)) {
+            *ok = false;
+            return 0;
+        }
+        written += (bytes->split - position) + bytes->length;
+        position = bytes->split;
+        sealed = bytes->split + CRC_LENGTH;
+    }
+
+    seal_records(batch->data + sealed, batch->length - sealed);
+    if (!write_all(journal->fd, batch->data + position, batch->length - position)) {
+        *ok = false;
+        return 0;
+    }
+    return written + (batch->length - position);
+}
+
+/**
+ * @brief Rewrites the journal as a new header plus the records from position on
+ *
+ * The new file is written next to the journal and renamed over it, so a
+ * crash leaves either the old journal or the new one.
+ */
+static bool rebase_file(Journal* journal, const char* document_path, uint64_t position) {
+    if (position < journal->file_start) {
+        position = journal->file_start;
+    }
+    if (position > journal->written) {
+        position = journal->written;
+    }
+
+    ByteBuffer header = {0};
+    if (!encode_header(&header, document_path)) {
+        return false;
+    }
+
+    size_t temp_length = strlen(journal->path) + 5;
+    char* temp_path = (char*)malloc(temp_length);
+    char* chunk = (char*)malloc(COPY_CHUNK);
+    if (!temp_path || !chunk) {
+        free(temp_path);
+        free(chunk);
+        free(header.data);
+        return false;
+    }
+    snprintf(temp_path, temp_length, "%s.tmp", journal->path);
+
+    bool ok = false;
+    int fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd >= 0 && write_all(fd, header.data, header.length)) {
+        /* Keep the records made after position */
+        off_t source = (off_t)(journal->header_length + (position - journal->file_start));
+        uint64_t remaining = journal->written - position;
+        ok = true;
+        while (ok && remaining > 0) {
+            size_t want = remaining < COPY_CHUNK ? (size_t)remaining : COPY_CHUNK;
+            ssize_t count = pread(journal->fd, chunk, want, source);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = count > 0 && write_all(fd, chunk, (size_t)count);
+            if (ok) {
+                source += count;
+                remaining -= (uint64_t)count;
+            }
+        }
+        ok = ok && fdatasync(fd) == 0 && rename(temp_path, journal->path) == 0;
+    }
+
+    if (ok) {
+        close(journal->fd);
+        journal->fd = fd;
+        journal->header_length = header.length;
+        journal->file_start = position;
+    } else if (fd >= 0) {
+        close(fd);
+        unlink(temp_path);
+    }
+
+    free(temp_path);
+    free(chunk);
+    free(header.data);
+    return ok;
+}
+
+static void* journal_thread(void* user_data) {
+    Journal* journal = (Journal*)user_data;
+
+    pthread_mutex_lock(&journal->lock);
+    for (;;) {
+        if (!journal->stopping && !journal->rebase_requested) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += journal->flush_interval_ms / 1000;
+            deadline.tv_nsec += (long)(journal->flush_interval_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&journal->wake, &journal->lock, &deadline);
+        }
+
+        /* Take the whole batch; recording continues into the other buffer */
+        ByteBuffer batch = journal->pending;
+        journal->pending = journal->writing;
+        journal->pending.length = 0;
+        journal->writing = batch;
+
+        SharedList shared = journal->pending_shared;
+        journal->pending_shared = journal->writing_shared;
+        journal->writing_shared = shared;
+
+        bool rebase = journal->rebase_requested;
+        char* rebase_path = journal->rebase_path;
+        uint64_t rebase_position = journal->rebase_position;
+        journal->rebase_requested = false;
+        journal->rebase_path = NULL;
+        bool stopping = journal->stopping;
+        bool failed = journal->failed;
+        pthread_mutex_unlock(&journal->lock);
+
+        bool ok = true;
+        if (!failed && batch.length > 0) {
+            uint64_t written = write_batch(journal, &ok);
+            if (ok) {
+                journal->written += written;
+                /* A rebase syncs the file it writes */
+                ok = rebase || fdatasync(journal->fd) == 0;
+            }
+        }
+        release_shared(&journal->writing_shared);
+        if (!failed && ok && rebase) {
+            ok = rebase_file(journal, rebase_path, rebase_position);
+        }
+        free(rebase_path);
+
+        pthread_mutex_lock(&journal->lock);
+        if (!ok) {
+            journal->failed = true;
+            journal->pending.length = 0;
+            release_shared(&journal->pending_shared);
+        }
+        if (stopping) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    return NULL;
+}
+
+Journal* journal_open(const char* path, unsigned int flush_interval_ms) {
+    if (!path) {
+        return NULL;
+    }
+
+    Journal* journal = (Journal*)calloc(1, sizeof(Journal));
+    if (!journal) {
+        return NULL;
+    }
+
+    journal->path = strdup(path);
+    journal->flush_interval_ms = flush_interval_ms;
+    journal->fd = -1;
+    if (!journal->path) {
+        free(journal);
+        return NULL;
+    }
+
+    ByteBuffer header = {0};
+    journal->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (journal->fd < 0 || !encode_header(&header, NULL) || !write_all(journal->fd, header.data, header.length)) {
+        if (journal->fd >= 0) {
+            close(journal->fd);
+            unlink(path);
+        }
+        free(header.data);
+        free(journal->path);
+        free(journal);
+        return NULL;
+    }
+    journal->header_length = header.length;
+    free(header.data);
+
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->wake, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    if (pthread_create(&journal->thread, NULL, journal_thread, journal) != 0) {
+        pthread_cond_destroy(&journal->wake);
+        pthread_mutex_destroy(&journal->lock);
+        close(journal->fd);
+        unlink(path);
+        free(journal->path);
+        free(journal);
+        return NULL;
+    }
+
+    return journal;
+}
+
+void journal_close(Journal* journal, bool remove) {
+    if (!journal) {
+        return;
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    journal->stopping = true;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+    pthread_join(journal->thread, NULL);
+
+    close(journal->fd);
+    if (remove) {
+        unlink(journal->path);
+    }
+
+    pthread_cond_destroy(&journal->wake);
+    pthread_mutex_destroy(&journal->lock);
+    free(journal->rebase_path);
+    release_shared(&journal->pending_shared);
+    release_shared(&journal->writing_shared);
+    free(journal->pending_shared.items);
+    free(journal->writing_shared.items);
+    free(journal->pending.data);
+    free(journal->writing.data);
+    free(journal->path);
+    free(journal);
+}
+
+void journal_record_insert(Journal* journal, uint64_t offset,
+                           const char* text, size_t length, uint64_t span) {
+    if (!journal || (!text && length > 0)) {
+        return;
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    if (!journal->failed && buffer_reserve(&journal->pending, 1 + 3 * VARINT_MAX + length + CRC_LENGTH)) {
+        char* out = journal->pending.data + journal->pending.length;
+        size_t size = 0;
+        out[size++] = RECORD_INSERT;
+        size += put_varint(out + size, offset);
+        size += put_varint(out + size, span);
+        size += put_varint(out + size, length);
+        if (length > 0) {
+            memcpy(out + size, text, length);
+            size += length;
+        }
+        memset(out + size, 0, CRC_LENGTH);  /* Filled in by the writer */
+        size += CRC_LENGTH;
+
+        journal->pending.length += size;
+        journal->position += size;
+    }
+    pthread_mutex_unlock(&journal->lock);
+}
+
+void journal_record_insert_shared(Journal* journal, uint64_t offset, const char* text, size_t length,
+                                  uint64_t span, void* owner, JournalRelease release) {
+    if (!journal || (!text && length > 0)) {
+        if (release) {
+            release(owner);
+        }
+        return;
+    }
+
+    bool kept = false;
+    pthread_mutex_lock(&journal->lock);
+    SharedList* list = &journal->pending_shared;
+    if (!journal->failed && list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 4;
+        SharedBytes* items = (SharedBytes*)realloc(list->items, capacity * sizeof(SharedBytes));
+        if (items) {
+            list->items = items;
+            list->capacity = capacity;
+        }
+    }
+    if (!journal->failed && list->count < list->capacity &&
+        buffer_reserve(&journal->pending, 1 + 3 * VARINT_MAX + CRC_LENGTH)) {
+        char* out = journal->pending.data + journal->pending.length;
+        size_t size = 0;
+        out[size++] = RECORD_INSERT;
+        size += put_varint(out + size, offset);
+        size += put_varint(out + size, span);
+        size += put_varint(out + size, length);
+
+        SharedBytes* bytes = &list->items[list->count++];
+        bytes->record = journal->pending.length;
+        bytes->split = journal->pending.length + size;
+        bytes->data = text;
+        bytes->length = length;
+        bytes->owner = owner;
+        bytes->release = release;
+        kept = true;
+
+        memset(out + size, 0, CRC_LENGTH);
+        size += CRC_LENGTH;
+
+        journal->pending.length += size;
+        journal->position += size + length;
+    }
+    pthread_mutex_unlock(&journal->lock);
+
+    if (!kept && release) {
+        release(owner);
+    }
+}
+
+void journal_record_delete(Journal* journal, uint64_t offset, uint64_t span) {
+    if (!journal) {
+        return;
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    if (!journal->failed && buffer_reserve(&journal->pending, 1 + 2 * VARINT_MAX + CRC_LENGTH)) {
+        char* out = journal->pending.data + journal->pending.length;
+        size_t size = 0;
+        out[size++] = RECORD_DELETE;
+        size += put_varint(out + size, offset);
+        size += put_varint(out + size, span);
+        memset(out + size, 0, CRC_LENGTH);
+        size += CRC_LENGTH;
+
+        journal->pending.length += size;
+        journal->position += size;
+    }
+    pthread_mutex_unlock(&journal->lock);
+}
+
+uint64_t journal_get_position(const Journal* journal) {
+    if (!journal) {
+        return 0;
+    }
+
+    return journal->position;
+}
+
+void journal_rebase(Journal* journal, const char* document_path, uint64_t position) {
+    if (!journal) {
+        return;
+    }
+
+    char* path = document_path ? strdup(document_path) : NULL;
+    if (document_path && !path) {
+        return;
+    }
+
+    /* A later rebase supersedes one the writer has not reached yet */
+    pthread_mutex_lock(&journal->lock);
+    free(journal->rebase_path);
+    journal->rebase_path = path;
+    journal->rebase_position = position;
+    journal->rebase_requested = true;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+}
+
+bool journal_has_failed(Journal* journal) {
+    if (!journal) {
+        return true;
+    }
+
+    pthread_mutex_lock(&journal->lock);
+    bool failed = journal->failed;
+    pthread_mutex_unlock(&journal->lock);
+    return failed;
+}
+
+char* journal_find_orphan(const char* directory) {
+    if (!directory) {
+        return NULL;
+    }
+
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return NULL;
+    }
+
+    char* found = NULL;
+    struct dirent* entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        char* end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || strcmp(end, ".journal") != 0 || pid <= 0 || pid == (long)getpid()) {
+            continue;
+        }
+
+        /* Still being written by a running instance */
+        if (kill((pid_t)pid, 0) == 0 || errno != ESRCH) {
+            continue;
+        }
+
+        size_t length = strlen(directory) + strlen(entry->d_name) + 2;
+        found = (char*)malloc(length);
+        if (found) {
+            snprintf(found, length, "%s/%s", directory, entry->d_name);
+        }
+    }
+
+    closedir(dir);
+    return found;
+}
+
+JournalRecovery* journal_recovery_open(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    JournalRecovery* recovery = NULL;
+    char* data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (data = (char*)malloc((size_t)st.st_size)) != NULL) {
+        size_t length = 0;
+        while (length < (size_t)st.st_size) {
+            ssize_t count = read(fd, data + length, (size_t)st.st_size - length);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                break;
+            }
+            length += (size_t)count;
+        }
+
+        recovery = (JournalRecovery*)calloc(1, sizeof(JournalRecovery));
+        if (recovery) {
+            recovery->data = data;
+            recovery->records_start = decode_header(data, length, &recovery->base);
+            if (recovery->records_start == 0) {
+                free(recovery);
+                recovery = NULL;
+            }
+        }
+
+        /* Keep the intact prefix of the records */
+        if (recovery) {
+            size_t position = recovery->records_start;
+            size_t record_length;
+            JournalEdit edit;
+            while (parse_record(data + position, length - position, &record_length, &edit) &&
+                   get_u32(data + position + record_length - CRC_LENGTH) ==
+                       compute_crc(data + position, record_length - CRC_LENGTH)) {
+                position += record_length;
+                recovery->edit_count++;
+            }
+            recovery->records_end = position;
+        }
+    }
+    close(fd);
+
+    if (!recovery) {
+        free(data);
+    }
+    return recovery;
+}
+
+void journal_recovery_close(JournalRecovery* recovery) {
+    if (!recovery) {
+        return;
+    }
+
+    free(recovery->base.path);
+    free(recovery->data);
+    free(recovery);
+}
+
+const char* journal_recovery_get_document_path(const JournalRecovery* recovery) {
+    if (!recovery) {
+        return NULL;
+    }
+
+    return recovery->base.path;
+}
+
+size_t journal_recovery_get_edit_count(const JournalRecovery* recovery) {
+    if (!recovery) {
+        return 0;
+    }
+
+    return recovery->edit_count;
+}
+
+bool journal_recovery_base_matches(const JournalRecovery* recovery) {
+    if (!recovery) {
+        return false;
+    }
+    if (!recovery->base.path) {
+        return true;
+    }
+
+    struct stat st;
+    return stat(recovery->base.path, &st) == 0 &&
+           (uint64_t)st.st_size == recovery->base.size &&
+           (uint64_t)st.st_ino == recovery->base.inode &&
+           (int64_t)st.st_mtim.tv_sec == recovery->base.mtime_sec &&
+           (int64_t)st.st_mtim.tv_nsec == recovery->base.mtime_nsec;
+}
+
+size_t journal_recovery_replay(const JournalRecovery* recovery, JournalApply apply, void* user_data) {
+    if (!recovery || !apply) {
+        return 0;
+    }
+
+    size_t applied = 0;
+    size_t position = recovery->records_start;
+    while (position < recovery->records_end) {
+        size_t record_length;
+        JournalEdit edit;
+        if (!parse_record(recovery->data + position, recovery->records_end - position, &record_length, &edit)) {
+            break;
+        }
+
+        apply(&edit, user_data);
+        position += record_length;
+        applied++;
+    }
+
+    return applied;
+}
\ No newline at end of file
@@ -1,41 +1,229 @@
 #include <gtk/gtk.h>
+#include <glib-unix.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "core/application.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "ui/latency_probe.h"
 #include "ui/main_window.h"
 
 /**
  * @file main.c
  * @brief Application entry point
- * 
+ *
  * Initializes GTK, creates the application and main window,
  * and runs the main event loop.
+ *
+ * --trace=FILE records startup and hot-path spans and writes them to FILE
+ * as Chrome trace-event JSON on exit. SIGUSR1 writes the runtime metrics
+ * to $XDG_CACHE_HOME/notebook/metrics-<pid>.json.
+ *
+ * --latency-test[=SCENARIOS] types into the window, prints keystroke-to-
+ * frame latencies and exits; the exit status is non-zero if a scenario
+ * produced no measurements.
+ *
+ * --record-edits=FILE records the editing session as an edit trace for
+ * the replay benchmarks (make bench BENCH_SESSIONS=FILE).
  */
 
+#define TRACE_OPTION "--trace="
+#define RECORD_OPTION "--record-edits="
+#define LATENCY_OPTION "--latency-test"
+
+/**
+ * @brief Keys typed per latency scenario
+ */
+#define LATENCY_KEYSTROKES 200
+
+/**
+ * @brief Removes argv[index] from the arguments
+ */
+static void remove_argument(int* argc, char** argv, int index) {
+    memmove(&argv[index], &argv[index + 1], (size_t)(*argc - index) * sizeof(char*));
+    (*argc)--;
+}
+
+/**
+ * @brief Removes --trace=FILE from the arguments and starts tracing
+ */
+static void parse_trace_option(int* argc, char** argv) {
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], TRACE_OPTION, strlen(TRACE_OPTION)) != 0) {
+            continue;
+        }
+
+        const char* path = argv[i] + strlen(TRACE_OPTION);
+        if (*path == '\0' || !trace_start(path)) {
+            g_printerr("Cannot trace to '%s'\n", path);
+        }
+
+        remove_argument(argc, argv, i);
+        i--;
+    }
+}
+
+/**
+ * @brief Removes --record-edits=FILE from the arguments
+ * @return The trace file, or NULL if the option was not given
+ */
+static const char* parse_record_option(int* argc, char** argv) {
+    const char* path = NULL;
+
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], RECORD_OPTION, strlen(RECORD_OPTION)) != 0) {
+            continue;
+        }
+
+        path = argv[i] + strlen(RECORD_OPTION);
+        remove_argument(argc, argv, i);
+        i--;
+    }
+
+    return path;
+}
+
+/**
+ * @brief Removes --latency-test[=SCENARIOS] from the arguments
+ * @param scenarios Set to the scenario list, or NULL to run them all
+ * @return true if the option was given
+ */
+static bool parse_latency_option(int* argc, char** argv, const char** scenarios) {
+    bool found = false;
+    size_t length = strlen(LATENCY_OPTION);
+
+    for (int i = 1; i < *argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, LATENCY_OPTION, length) != 0 ||
+            (arg[length] != '\0' && arg[length] != '=')) {
+            continue;
+        }
+
+        found = true;
+        *scenarios = arg[length] == '=' ? arg + length + 1 : NULL;
+
+        remove_argument(argc, argv, i);
+        i--;
+    }
+
+    return found;
+}
+
+/**
+ * @brief Writes the metrics dump (runs on the main loop, not in the handler)
+ */
+static gboolean on_dump_metrics(gpointer user_data) {
+    (void)user_data;
+
+    char* json = metrics_to_json();
+    if (!json) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    gchar* directory = g_build_filename(g_get_user_cache_dir(), "notebook", NULL);
+    gchar* name = g_strdup_printf("metrics-%d.json", (int)getpid());
+    gchar* path = g_build_filename(directory, name, NULL);
+
+    GError* error = NULL;
+    if (g_mkdir_with_parents(directory, 0700) == 0 &&
+        g_file_set_contents(path, json, -1, &error)) {
+        g_printerr("Metrics written to %s\n", path);
+    } else {
+        g_printerr("Failed to write metrics to %s: %s\n", path,
+                   error ? error->message : g_strerror(errno));
+        g_clear_error(&error);
+    }
+
+    g_free(path);
+    g_free(name);
+    g_free(directory);
+    free(json);
+
+    return G_SOURCE_CONTINUE;
+}
+
 int main(int argc, char* argv[]) {
+    parse_trace_option(&argc, argv);
+
+    const char* latency_scenarios = NULL;
+    bool latency_test = parse_latency_option(&argc, argv, &latency_scenarios);
+    const char* record_path = parse_record_option(&argc, argv);
+
     /* Initialize GTK */
+    uint64_t span = trace_begin();
     gtk_init(&argc, &argv);
-    
+    trace_end("gtk_init", span);
+
     /* Create application controller */
+    span = trace_begin();
     Application* app = application_create();
+    trace_end("application_create", span);
     if (!app) {
         g_printerr("Failed to create application\n");
+        trace_stop();
         return 1;
     }
-    
+
     /* Create main window */
+    span = trace_begin();
     MainWindow* window = main_window_create(app);
+    trace_end("main_window_create", span);
     if (!window) {
         g_printerr("Failed to create main window\n");
         application_destroy(app);
+        trace_stop();
         return 1;
     }
-    
+
+    g_unix_signal_add(SIGUSR1, on_dump_metrics, NULL);
+
+    if (record_path && !main_window_record_edits(window, record_path)) {
+        g_printerr("Cannot record edits to '%s'\n", record_path);
+    }
+
     /* Show window and run main loop */
+    span = trace_begin();
     main_window_show(window);
+    if (!latency_test) {
+        main_window_recover(window);
+    }
+    trace_end("main_window_show", span);
+
+    LatencyProbe* probe = NULL;
+    if (latency_test) {
+        probe = latency_probe_create(window, latency_scenarios, LATENCY_KEYSTROKES);
+        if (!probe) {
+            g_printerr("Cannot run latency scenarios '%s'\n",
+                       latency_scenarios ? latency_scenarios : "all");
+            main_window_destroy(window);
+            application_destroy(app);
+            trace_stop();
+            return 1;
+        }
+    }
+
     gtk_main();
-    
+
     /* Cleanup */
+    int status = 0;
+    if (probe) {
+        status = latency_probe_succeeded(probe) ? 0 : 1;
+        latency_probe_destroy(probe);
+    }
+
+    if (record_path && !main_window_stop_recording(window)) {
+        g_printerr("The edit trace '%s' is incomplete: a record could not be written\n", record_path);
+    }
+
     main_window_destroy(window);
     application_destroy(app);
-    
-    return 0;
+
+    if (!trace_stop()) {
+        g_printerr("Failed to write the trace file\n");
+    }
+
+    return status;
 }
\ No newline at end of file
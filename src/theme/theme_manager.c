@@ -1,7 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
 #include "theme/theme_manager.h"
+#include <dirent.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/**
+ * @brief Largest theme CSS file that is loaded
+ */
+#define THEME_MAX_CSS_SIZE (256 * 1024)
+
 /**
  * @brief Dark theme colors
  */
@@ -84,6 +92,16 @@ static const char* light_theme_css =
     "  background-color: #f2f2f2;"
     "}";
 
+/**
+ * @brief One registered theme
+ */
+typedef struct {
+    char* name;
+    char* scheme_id;
+    char* css;
+    const ThemeColors* colors;
+} Theme;
+
 /**
  * @brief Theme manager structure
  */
@@ -91,15 +109,64 @@ struct ThemeManager {
     ThemeType current_theme;
     ThemeChangeCallback callback;
     void* user_data;
+    Theme* themes;
+    size_t theme_count;
+    size_t theme_capacity;
 };
 
+/**
+ * @brief Adds a theme, copying its strings
+ * @return true on success
+ */
+static bool add_theme(ThemeManager* manager, const char* name, const char* scheme_id,
+                      const char* css, const ThemeColors* colors) {
+    if (manager->theme_count == manager->theme_capacity) {
+        size_t capacity = manager->theme_capacity ? manager->theme_capacity * 2 : 4;
+        Theme* themes = (Theme*)realloc(manager->themes, capacity * sizeof(Theme));
+        if (!themes) {
+            return false;
+        }
+        manager->themes = themes;
+        manager->theme_capacity = capacity;
+    }
+
+    Theme* theme = &manager->themes[manager->theme_count];
+    theme->name = strdup(name);
+    theme->scheme_id = strdup(scheme_id);
+    theme->css = strdup(css);
+    theme->colors = colors;
+    if (!theme->name || !theme->scheme_id || !theme->css) {
+        free(theme->name);
+        free(theme->scheme_id);
+        free(theme->css);
+        return false;
+    }
+
+    manager->theme_count++;
+    return true;
+}
+
+static const Theme* find_theme(const ThemeManager* manager, ThemeType theme) {
+    if (!manager || (size_t)theme >= manager->theme_count) {
+        return NULL;
+    }
+
+    return &manager->themes[theme];
+}
+
 ThemeManager* theme_manager_create(ThemeType default_theme) {
-    ThemeManager* manager = (ThemeManager*)malloc(sizeof(ThemeManager));
+    ThemeManager* manager = (ThemeManager*)calloc(1, sizeof(ThemeManager));
     if (!manager) {
         return NULL;
     }
+
+    if (!add_theme(manager, "Dark", "notebook-dark", dark_theme_css, &dark_theme) ||
+        !add_theme(manager, "Light", "notebook-light", light_theme_css, &light_theme)) {
+        theme_manager_destroy(manager);
+        return NULL;
+    }
     
-    manager->current_theme = default_theme;
+    manager->current_theme = (size_t)default_theme < manager->theme_count ? default_theme : THEME_DARK;
     manager->callback = NULL;
     manager->user_data = NULL;
     
@@ -110,7 +177,13 @@ void theme_manager_destroy(ThemeManager* manager) {
     if (!manager) {
         return;
     }
-    
+
+    for (size_t i = 0; i < manager->theme_count; i++) {
+        free(manager->themes[i].name);
+        free(manager->themes[i].scheme_id);
+        free(manager->themes[i].css);
+    }
+    free(manager->themes);
     free(manager);
 }
 
@@ -127,7 +200,7 @@ void theme_manager_set_theme(ThemeManager* manager, ThemeType theme) {
         return;
     }
     
-    if (manager->current_theme != theme) {
+    if (manager->current_theme != theme && (size_t)theme < manager->theme_count) {
         manager->current_theme = theme;
         
         if (manager->callback) {
@@ -141,9 +214,7 @@ void theme_manager_toggle(ThemeManager* manager) {
         return;
     }
     
-    ThemeType new_theme = (manager->current_theme == THEME_DARK) 
-                          ? THEME_LIGHT 
-                          : THEME_DARK;
+    ThemeType new_theme = (ThemeType)(((size_t)manager->current_theme + 1) % manager->theme_count);
     
     theme_manager_set_theme(manager, new_theme);
 }
@@ -153,9 +224,8 @@ const ThemeColors* theme_manager_get_colors(const ThemeManager* manager) {
         return &dark_theme;
     }
     
-    return (manager->current_theme == THEME_DARK) 
-           ? &dark_theme 
-           : &light_theme;
+    const ThemeColors* colors = manager->themes[manager->current_theme].colors;
+    return colors ? colors : &dark_theme;
 }
 
 void theme_manager_register_callback(ThemeManager* manager, 
@@ -174,7 +244,134 @@ const char* theme_manager_get_css(const ThemeManager* manager) {
         return dark_theme_css;
     }
     
-    return (manager->current_theme == THEME_DARK) 
-           ? dark_theme_css 
-           : light_theme_css;
+    return manager->themes[manager->current_theme].css;
+}
+
+/**
+ * @brief Reads a theme CSS file into a NUL-terminated string
+ * @return String (caller must free), or NULL if unreadable or too large
+ */
+static char* read_css_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    char* css = (char*)malloc(THEME_MAX_CSS_SIZE + 1);
+    size_t length = css ? fread(css, 1, THEME_MAX_CSS_SIZE + 1, file) : 0;
+    bool failed = !css || ferror(file) || length > THEME_MAX_CSS_SIZE;
+    fclose(file);
+
+    if (failed) {
+        free(css);
+        return NULL;
+    }
+
+    css[length] = '\0';
+    return css;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * @brief Checks whether a theme with a style scheme id is registered
+ */
+static bool has_scheme_id(const ThemeManager* manager, const char* scheme_id) {
+    for (size_t i = 0; i < manager->theme_count; i++) {
+        if (strcmp(manager->themes[i].scheme_id, scheme_id) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t theme_manager_load_directory(ThemeManager* manager, const char* directory) {
+    if (!manager || !directory) {
+        return 0;
+    }
+
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return 0;
+    }
+
+    /* Collect the ids first so themes are numbered in name order */
+    char** ids = NULL;
+    size_t id_count = 0;
+    size_t id_capacity = 0;
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || length <= 4 ||
+            strcmp(entry->d_name + length - 4, ".css") != 0) {
+            continue;
+        }
+
+        if (id_count == id_capacity) {
+            size_t capacity = id_capacity ? id_capacity * 2 : 8;
+            char** grown = (char**)realloc(ids, capacity * sizeof(char*));
+            if (!grown) {
+                break;
+            }
+            ids = grown;
+            id_capacity = capacity;
+        }
+
+        char* id = strndup(entry->d_name, length - 4);
+        if (!id) {
+            break;
+        }
+        ids[id_count++] = id;
+    }
+    closedir(dir);
+
+    if (id_count > 1) {
+        qsort(ids, id_count, sizeof(char*), compare_names);
+    }
+
+    size_t loaded = 0;
+    for (size_t i = 0; i < id_count; i++) {
+        if (!has_scheme_id(manager, ids[i])) {
+            size_t path_size = strlen(directory) + strlen(ids[i]) + 6;
+            char* path = (char*)malloc(path_size);
+            char* css = NULL;
+            if (path) {
+                snprintf(path, path_size, "%s/%s.css", directory, ids[i]);
+                css = read_css_file(path);
+            }
+
+            if (css && add_theme(manager, ids[i], ids[i], css, NULL)) {
+                loaded++;
+            }
+            free(css);
+            free(path);
+        }
+        free(ids[i]);
+    }
+    free(ids);
+
+    return loaded;
+}
+
+size_t theme_manager_get_count(const ThemeManager* manager) {
+    return manager ? manager->theme_count : 0;
+}
+
+const char* theme_manager_get_name(const ThemeManager* manager, ThemeType theme) {
+    const Theme* entry = find_theme(manager, theme);
+    return entry ? entry->name : NULL;
+}
+
+const char* theme_manager_get_theme_css(const ThemeManager* manager, ThemeType theme) {
+    const Theme* entry = find_theme(manager, theme);
+    return entry ? entry->css : NULL;
+}
+
+const char* theme_manager_get_scheme_id(const ThemeManager* manager, ThemeType theme) {
+    const Theme* entry = find_theme(manager, theme);
+    return entry ? entry->scheme_id : NULL;
 }
\ No newline at end of file
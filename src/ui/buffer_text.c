@@ -0,0 +1,163 @@
+#include "ui/buffer_text.h"
+#include <string.h>
+
+/**
+ * @brief Inserts NUL-free bytes, repairing invalid UTF-8
+ */
+static void insert_valid(GtkTextBuffer* buffer, GtkTextIter* iter, const char* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    if (g_utf8_validate(data, (gssize)length, NULL)) {
+        gtk_text_buffer_insert(buffer, iter, data, (gint)length);
+        return;
+    }
+
+    gchar* valid = g_utf8_make_valid(data, (gssize)length);
+    gtk_text_buffer_insert(buffer, iter, valid, -1);
+    g_free(valid);
+}
+
+void buffer_text_insert(GtkTextBuffer* buffer, GtkTextIter* iter,
+                        const char* data, size_t length, GtkTextTag* nul_tag) {
+    if (!buffer || !iter || !data) {
+        return;
+    }
+
+    const char* end = data + length;
+    while (data < end) {
+        const char* nul = (const char*)memchr(data, '\0', (size_t)(end - data));
+        if (!nul) {
+            insert_valid(buffer, iter, data, (size_t)(end - data));
+            return;
+        }
+
+        insert_valid(buffer, iter, data, (size_t)(nul - data));
+
+        /* Insert a run of NULs at once */
+        size_t run = 1;
+        while (nul + run < end && nul[run] == '\0') {
+            run++;
+        }
+
+        GString* symbols = g_string_sized_new(run * (sizeof(BUFFER_TEXT_NUL_SYMBOL) - 1));
+        for (size_t i = 0; i < run; i++) {
+            g_string_append_len(symbols, BUFFER_TEXT_NUL_SYMBOL, sizeof(BUFFER_TEXT_NUL_SYMBOL) - 1);
+        }
+        if (nul_tag) {
+            gtk_text_buffer_insert_with_tags(buffer, iter, symbols->str, (gint)symbols->len, nul_tag, NULL);
+        } else {
+            gtk_text_buffer_insert(buffer, iter, symbols->str, (gint)symbols->len);
+        }
+        g_string_free(symbols, TRUE);
+
+        data = nul + run;
+    }
+}
+
+/**
+ * @brief Appends text, turning U+2400 back into NUL bytes
+ */
+static void append_restoring_nuls(GString* bytes, const char* text) {
+    const size_t symbol_length = sizeof(BUFFER_TEXT_NUL_SYMBOL) - 1;
+
+    for (;;) {
+        const char* symbol = strstr(text, BUFFER_TEXT_NUL_SYMBOL);
+        if (!symbol) {
+            g_string_append(bytes, text);
+            return;
+        }
+
+        g_string_append_len(bytes, text, symbol - text);
+        g_string_append_c(bytes, '\0');
+        text = symbol + symbol_length;
+    }
+}
+
+char* buffer_text_get_bytes(GtkTextBuffer* buffer, GtkTextTag* nul_tag, size_t* length) {
+    if (!buffer || !length) {
+        return NULL;
+    }
+
+    GtkTextIter start, end;
+    gtk_text_buffer_get_bounds(buffer, &start, &end);
+
+    /* Common case: no NUL stand-ins anywhere */
+    if (!nul_tag || !buffer_text_has_nuls(buffer, nul_tag)) {
+        char* text = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+        *length = strlen(text);
+        return text;
+    }
+
+    GString* bytes = g_string_new(NULL);
+    GtkTextIter position = start;
+
+    while (!gtk_text_iter_equal(&position, &end)) {
+        GtkTextIter next = position;
+        gtk_text_iter_forward_to_tag_toggle(&next, nul_tag);
+
+        gchar* text = gtk_text_buffer_get_text(buffer, &position, &next, FALSE);
+        if (gtk_text_iter_has_tag(&position, nul_tag)) {
+            append_restoring_nuls(bytes, text);
+        } else {
+            g_string_append(bytes, text);
+        }
+        g_free(text);
+
+        position = next;
+    }
+
+    *length = bytes->len;
+    return g_string_free(bytes, FALSE);
+}
+
+gboolean buffer_text_has_nuls(GtkTextBuffer* buffer, GtkTextTag* nul_tag) {
+    if (!buffer || !nul_tag) {
+        return FALSE;
+    }
+
+    GtkTextIter start;
+    gtk_text_buffer_get_start_iter(buffer, &start);
+
+    return gtk_text_iter_has_tag(&start, nul_tag) || gtk_text_iter_forward_to_tag_toggle(&start, nul_tag);
+}
+
+void buffer_text_mark_nuls(GtkTextBuffer* buffer, const GtkTextIter* start,
+                           const GtkTextIter* end, GtkTextTag* nul_tag) {
+    if (!buffer || !start || !end || !nul_tag) {
+        return;
+    }
+
+    GtkTextIter position = *start;
+    GtkTextIter match_start, match_end;
+    while (gtk_text_iter_forward_search(&position, BUFFER_TEXT_NUL_SYMBOL, GTK_TEXT_SEARCH_TEXT_ONLY,
+                                        &match_start, &match_end, end)) {
+        gtk_text_buffer_apply_tag(buffer, nul_tag, &match_start, &match_end);
+        position = match_end;
+    }
+}
+
+glong buffer_text_count_chars(const char* data, size_t length) {
+    if (!data) {
+        return 0;
+    }
+
+    glong chars = 0;
+    const char* end = data + length;
+
+    while (data < end) {
+        const char* nul = (const char*)memchr(data, '\0', (size_t)(end - data));
+        const char* stop = nul ? nul : end;
+
+        chars += g_utf8_strlen(data, stop - data);
+        if (!nul) {
+            break;
+        }
+
+        chars++;
+        data = nul + 1;
+    }
+
+    return chars;
+}
\ No newline at end of file
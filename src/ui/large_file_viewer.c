@@ -0,0 +1,934 @@
+#include "ui/large_file_viewer.h"
+#include "core/line_index.h"
+#include "ui/buffer_text.h"
+#include <gtksourceview/gtksource.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Nominal size of one page of the window
+ */
+#define VIEWER_PAGE_SIZE (1024 * 1024)
+
+/**
+ * @brief Number of pages kept in the text buffer at once
+ */
+#define VIEWER_WINDOW_PAGES 3
+
+/**
+ * @brief How far past a nominal boundary to look for a line start
+ */
+#define VIEWER_MAX_SNAP_DISTANCE (64 * 1024)
+
+/**
+ * @brief Bytes between line checkpoints
+ *
+ * Also the most a lookup scans, and what an indexing job counts between
+ * cancellation checks.
+ */
+#define VIEWER_CHECKPOINT_INTERVAL (1024 * 1024)
+
+/**
+ * @brief Checkpoints counted by one worker pool job
+ */
+#define VIEWER_INDEX_RANGE_CHECKPOINTS 16
+
+/**
+ * @brief Indexing jobs queued at once
+ *
+ * The next range is submitted as one finishes, so other pool work (a
+ * regex search of the file) never waits behind the whole file.
+ */
+#define VIEWER_INDEX_JOBS_IN_FLIGHT 4
+
+/**
+ * @brief One page of the file currently held in the buffer
+ */
+typedef struct {
+    size_t start;  /* File offset of the first byte */
+    size_t end;    /* File offset one past the last byte */
+    gint chars;    /* Characters the page occupies in the buffer */
+} ViewerPage;
+
+/**
+ * @brief Line counts at fixed intervals of the file
+ *
+ * Memory grows with the file size divided by VIEWER_CHECKPOINT_INTERVAL
+ * (8 KB per GB), not with the number of lines.
+ */
+typedef struct {
+    size_t* newlines;   /* Newlines before offset i * VIEWER_CHECKPOINT_INTERVAL */
+    size_t count;
+    size_t line_count;
+} ViewerLineMap;
+
+typedef struct ViewerIndex ViewerIndex;
+
+/**
+ * @brief A run of checkpoints counted by one pool job
+ */
+typedef struct {
+    ViewerIndex* index;
+    size_t first;
+    size_t count;
+    uint64_t job;          /* Pool job id until the job is over */
+} ViewerIndexRange;
+
+/**
+ * @brief Line counting shared with the pool jobs
+ *
+ * Outlives the viewer until its last job is over. Jobs register as
+ * running before they read the mapping, so the viewer can wait for them
+ * before unmapping it.
+ */
+struct ViewerIndex {
+    LargeFileViewer* viewer;   /* NULL once the viewer is destroyed */
+    WorkerPool* pool;
+    const char* data;
+    size_t size;
+    size_t* newlines;          /* Newlines inside each checkpoint's bytes */
+    size_t checkpoint_count;
+    ViewerIndexRange* ranges;
+    size_t range_count;
+    gint cancelled;
+
+    GMutex lock;               /* Guards running */
+    GCond idle;                /* Signalled when running drops to zero */
+    size_t running;
+
+    /* Owning thread only */
+    size_t submitted;          /* Ranges handed to the pool */
+    size_t counted;
+    size_t jobs;               /* Submitted and not yet over */
+};
+
+/**
+ * @brief Large file viewer structure
+ */
+struct LargeFileViewer {
+    GtkTextView* text_view;
+    GtkTextBuffer* buffer;
+    GtkAdjustment* vadjustment;
+    FileMapping* mapping;
+
+    ViewerPage pages[VIEWER_WINDOW_PAGES + 1];
+    int page_count;
+
+    GtkWidget* bar;
+    GtkWidget* slider;
+    GtkWidget* position_label;
+    GtkTextMark* anchor;
+
+    gulong scroll_handler;
+    guint shift_source;
+    guint jump_source;
+    size_t pending_jump;
+
+    ViewerIndex* index;
+    ViewerLineMap* line_map;  /* Set once every checkpoint is counted */
+};
+
+/* Forward declarations for callbacks */
+static void on_scroll_changed(GtkAdjustment* adjustment, gpointer user_data);
+static gboolean on_slider_change_value(GtkRange* range, GtkScrollType scroll,
+                                       gdouble value, gpointer user_data);
+static gboolean on_shift_idle(gpointer user_data);
+static gboolean on_jump_idle(gpointer user_data);
+static void update_position(LargeFileViewer* viewer);
+
+/**
+ * @brief Moves an offset forward to the next line start (or UTF-8 boundary)
+ */
+static size_t snap_to_line_start(const LargeFileViewer* viewer, size_t offset) {
+    const char* data = file_mapping_get_data(viewer->mapping);
+    size_t size = file_mapping_get_size(viewer->mapping);
+
+    if (offset == 0 || offset >= size) {
+        return offset >= size ? size : 0;
+    }
+
+    /* Already at a line start */
+    if (data[offset - 1] == '\n') {
+        return offset;
+    }
+
+    size_t limit = size - offset < VIEWER_MAX_SNAP_DISTANCE
+                   ? size - offset
+                   : VIEWER_MAX_SNAP_DISTANCE;
+    const char* newline = memchr(data + offset, '\n', limit);
+    if (newline) {
+        return (size_t)(newline - data) + 1;
+    }
+
+    /* Very long line: settle for a character boundary */
+    while (offset < size && ((unsigned char)data[offset] & 0xC0) == 0x80) {
+        offset++;
+    }
+    return offset;
+}
+
+/**
+ * @brief Inserts the bytes of a file range at an iterator
+ *
+ * NUL bytes show as U+2400 (one character each, so offsets still map)
+ * and invalid UTF-8 as U+FFFD; the file itself is never modified.
+ */
+static void insert_range(LargeFileViewer* viewer, GtkTextIter* iter, size_t start, size_t end) {
+    const char* data = file_mapping_get_data(viewer->mapping) + start;
+    buffer_text_insert(viewer->buffer, iter, data, end - start, NULL);
+}
+
+static void append_page(LargeFileViewer* viewer, size_t start, size_t end) {
+    GtkTextIter iter;
+    gtk_text_buffer_get_end_iter(viewer->buffer, &iter);
+    gint before = gtk_text_iter_get_offset(&iter);
+
+    insert_range(viewer, &iter, start, end);
+
+    ViewerPage* page = &viewer->pages[viewer->page_count++];
+    page->start = start;
+    page->end = end;
+    page->chars = gtk_text_iter_get_offset(&iter) - before;
+}
+
+static void prepend_page(LargeFileViewer* viewer, size_t start, size_t end) {
+    GtkTextIter iter;
+    gtk_text_buffer_get_start_iter(viewer->buffer, &iter);
+
+    insert_range(viewer, &iter, start, end);
+
+    memmove(&viewer->pages[1], &viewer->pages[0], (size_t)viewer->page_count * sizeof(ViewerPage));
+    viewer->page_count++;
+    viewer->pages[0].start = start;
+    viewer->pages[0].end = end;
+    viewer->pages[0].chars = gtk_text_iter_get_offset(&iter);
+}
+
+static void drop_first_page(LargeFileViewer* viewer) {
+    GtkTextIter start, end;
+    gtk_text_buffer_get_start_iter(viewer->buffer, &start);
+    gtk_text_buffer_get_iter_at_offset(viewer->buffer, &end, viewer->pages[0].chars);
+    gtk_text_buffer_delete(viewer->buffer, &start, &end);
+
+    viewer->page_count--;
+    memmove(&viewer->pages[0], &viewer->pages[1], (size_t)viewer->page_count * sizeof(ViewerPage));
+}
+
+static void drop_last_page(LargeFileViewer* viewer) {
+    GtkTextIter start, end;
+    gtk_text_buffer_get_end_iter(viewer->buffer, &end);
+    gint total = gtk_text_iter_get_offset(&end);
+    gtk_text_buffer_get_iter_at_offset(viewer->buffer, &start,
+                                       total - viewer->pages[viewer->page_count - 1].chars);
+    gtk_text_buffer_delete(viewer->buffer, &start, &end);
+
+    viewer->page_count--;
+}
+
+/**
+ * @brief Remembers the first visible character so it can be restored
+ */
+static void save_anchor(LargeFileViewer* viewer) {
+    GdkRectangle visible;
+    GtkTextIter iter;
+    gtk_text_view_get_visible_rect(viewer->text_view, &visible);
+    gtk_text_view_get_iter_at_location(viewer->text_view, &iter, visible.x, visible.y);
+    gtk_text_buffer_move_mark(viewer->buffer, viewer->anchor, &iter);
+}
+
+static void restore_anchor(LargeFileViewer* viewer) {
+    gtk_text_view_scroll_to_mark(viewer->text_view, viewer->anchor, 0.0, TRUE, 0.0, 0.0);
+}
+
+static void begin_update(LargeFileViewer* viewer) {
+    g_signal_handler_block(viewer->vadjustment, viewer->scroll_handler);
+    gtk_source_buffer_begin_not_undoable_action(GTK_SOURCE_BUFFER(viewer->buffer));
+}
+
+static void end_update(LargeFileViewer* viewer) {
+    gtk_source_buffer_end_not_undoable_action(GTK_SOURCE_BUFFER(viewer->buffer));
+    g_signal_handler_unblock(viewer->vadjustment, viewer->scroll_handler);
+}
+
+/**
+ * @brief Slides the window one page towards the end of the file
+ */
+static void shift_forward(LargeFileViewer* viewer) {
+    size_t size = file_mapping_get_size(viewer->mapping);
+    size_t start = viewer->pages[viewer->page_count - 1].end;
+    if (start >= size) {
+        return;
+    }
+
+    size_t end = snap_to_line_start(viewer, start + VIEWER_PAGE_SIZE);
+    if (end <= start) {
+        end = size;
+    }
+
+    file_mapping_prefetch(viewer->mapping, start, end - start);
+
+    begin_update(viewer);
+    save_anchor(viewer);
+    append_page(viewer, start, end);
+    if (viewer->page_count > VIEWER_WINDOW_PAGES) {
+        drop_first_page(viewer);
+    }
+    restore_anchor(viewer);
+    end_update(viewer);
+}
+
+/**
+ * @brief Slides the window one page towards the start of the file
+ */
+static void shift_backward(LargeFileViewer* viewer) {
+    size_t end = viewer->pages[0].start;
+    if (end == 0) {
+        return;
+    }
+
+    size_t start = end > VIEWER_PAGE_SIZE ? snap_to_line_start(viewer, end - VIEWER_PAGE_SIZE) : 0;
+    if (start >= end) {
+        start = 0;
+    }
+
+    file_mapping_prefetch(viewer->mapping, start, end - start);
+
+    begin_update(viewer);
+    save_anchor(viewer);
+    prepend_page(viewer, start, end);
+    if (viewer->page_count > VIEWER_WINDOW_PAGES) {
+        drop_last_page(viewer);
+    }
+    restore_anchor(viewer);
+    end_update(viewer);
+}
+
+/**
+ * @brief Converts a file offset to a character offset in the buffer
+ *
+ * Offsets outside the window are clamped to its ends.
+ */
+static gint offset_to_chars(const LargeFileViewer* viewer, size_t offset) {
+    const char* data = file_mapping_get_data(viewer->mapping);
+    gint chars = 0;
+
+    for (int i = 0; i < viewer->page_count; i++) {
+        const ViewerPage* page = &viewer->pages[i];
+        if (offset < page->end || i == viewer->page_count - 1) {
+            size_t within = offset > page->start ? offset - page->start : 0;
+            if (within > page->end - page->start) {
+                within = page->end - page->start;
+            }
+            glong partial = data ? buffer_text_count_chars(data + page->start, within) : 0;
+            chars += MIN((gint)partial, page->chars);
+            break;
+        }
+        chars += page->chars;
+    }
+
+    return chars;
+}
+
+/**
+ * @brief Converts a buffer position to a file offset
+ *
+ * Exact for valid UTF-8; pages where invalid bytes were replaced map
+ * approximately.
+ */
+static size_t iter_to_offset(const LargeFileViewer* viewer, const GtkTextIter* iter) {
+    const char* data = file_mapping_get_data(viewer->mapping);
+    gint chars = gtk_text_iter_get_offset(iter);
+
+    if (!data) {
+        return 0;
+    }
+
+    for (int i = 0; i < viewer->page_count; i++) {
+        const ViewerPage* page = &viewer->pages[i];
+        if (chars < page->chars || i == viewer->page_count - 1) {
+            const char* cursor = data + page->start;
+            const char* end = data + page->end;
+            for (gint c = MIN(chars, page->chars); c > 0 && cursor < end; c--) {
+                cursor = g_utf8_next_char(cursor);
+            }
+            return (size_t)(MIN(cursor, end) - data);
+        }
+        chars -= page->chars;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Gets the line checkpoints if indexing has finished
+ */
+static ViewerLineMap* get_ready_map(const LargeFileViewer* viewer) {
+    return viewer->line_map;
+}
+
+static void line_map_free(ViewerLineMap* map) {
+    if (!map) {
+        return;
+    }
+
+    free(map->newlines);
+    free(map);
+}
+
+/**
+ * @brief Gets the line containing a byte offset
+ *
+ * Counts newlines from the checkpoint at or before the offset.
+ */
+static size_t line_map_line_at(const LargeFileViewer* viewer, const ViewerLineMap* map, size_t offset) {
+    const char* data = file_mapping_get_data(viewer->mapping);
+    size_t size = file_mapping_get_size(viewer->mapping);
+    if (offset > size) {
+        offset = size;
+    }
+
+    size_t checkpoint = MIN(offset / VIEWER_CHECKPOINT_INTERVAL, map->count - 1);
+    size_t base = checkpoint * VIEWER_CHECKPOINT_INTERVAL;
+    return map->newlines[checkpoint] + line_index_count_newlines(data + base, offset - base);
+}
+
+/**
+ * @brief Gets the byte offset where a line starts
+ *
+ * Scans forward from the last checkpoint before the line's newline.
+ */
+static size_t line_map_line_start(const LargeFileViewer* viewer, const ViewerLineMap* map, size_t line) {
+    const char* data = file_mapping_get_data(viewer->mapping);
+    size_t size = file_mapping_get_size(viewer->mapping);
+
+    if (line >= map->line_count) {
+        line = map->line_count - 1;
+    }
+    if (line == 0) {
+        return 0;
+    }
+
+    /* The last checkpoint with fewer than line newlines before it */
+    size_t low = 0;
+    size_t high = map->count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (map->newlines[mid] < line) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    const char* cursor = data + low * VIEWER_CHECKPOINT_INTERVAL;
+    const char* end = data + size;
+    for (size_t remaining = line - map->newlines[low]; remaining > 0 && cursor < end; remaining--) {
+        const char* newline = (const char*)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (!newline) {
+            return size;
+        }
+        cursor = newline + 1;
+    }
+
+    return (size_t)(cursor - data);
+}
+
+/**
+ * @brief Pool job: counts the newlines of a run of checkpoints
+ */
+static void* run_index_range(const WorkerJob* job, void* data) {
+    ViewerIndexRange* range = (ViewerIndexRange*)data;
+    ViewerIndex* index = range->index;
+
+    g_mutex_lock(&index->lock);
+    bool cancelled = g_atomic_int_get(&index->cancelled);
+    if (!cancelled) {
+        index->running++;
+    }
+    g_mutex_unlock(&index->lock);
+
+    if (cancelled) {
+        return NULL;
+    }
+
+    for (size_t i = range->first; i < range->first + range->count; i++) {
+        if (g_atomic_int_get(&index->cancelled) || worker_job_is_cancelled(job)) {
+            break;
+        }
+
+        size_t start = i * VIEWER_CHECKPOINT_INTERVAL;
+        size_t length = MIN(index->size - start, (size_t)VIEWER_CHECKPOINT_INTERVAL);
+        index->newlines[i] = line_index_count_newlines(index->data + start, length);
+    }
+
+    g_mutex_lock(&index->lock);
+    if (--index->running == 0) {
+        g_cond_broadcast(&index->idle);
+    }
+    g_mutex_unlock(&index->lock);
+
+    return NULL;
+}
+
+static void index_free(ViewerIndex* index) {
+    g_cond_clear(&index->idle);
+    g_mutex_clear(&index->lock);
+    free(index->ranges);
+    free(index->newlines);
+    free(index);
+}
+
+/**
+ * @brief Ends a range's job on the owning thread, run or dropped
+ */
+static void finish_index_range(void* data) {
+    ViewerIndexRange* range = (ViewerIndexRange*)data;
+    ViewerIndex* index = range->index;
+
+    range->job = 0;
+    index->jobs--;
+    if (!index->viewer && index->jobs == 0) {
+        index_free(index);
+    }
+}
+
+static void complete_index_range(void* result, void* data);
+
+/**
+ * @brief Queues ranges until VIEWER_INDEX_JOBS_IN_FLIGHT are outstanding
+ */
+static void index_submit_ranges(ViewerIndex* index) {
+    while (index->jobs < VIEWER_INDEX_JOBS_IN_FLIGHT && index->submitted < index->range_count &&
+           !g_atomic_int_get(&index->cancelled)) {
+        ViewerIndexRange* range = &index->ranges[index->submitted++];
+        index->jobs++;
+        range->job = worker_pool_submit(index->pool, run_index_range, complete_index_range, NULL,
+                                        range, finish_index_range, WORKER_JOB_DEFAULT);
+        if (range->job == 0) {
+            /* finish_index_range() has run; line numbers stay unavailable */
+            g_atomic_int_set(&index->cancelled, 1);
+        }
+    }
+}
+
+/**
+ * @brief Turns the per-checkpoint counts into the viewer's line map
+ */
+static void index_publish(ViewerIndex* index) {
+    ViewerLineMap* map = (ViewerLineMap*)calloc(1, sizeof(ViewerLineMap));
+    if (!map) {
+        return;
+    }
+
+    size_t newlines = 0;
+    for (size_t i = 0; i < index->checkpoint_count; i++) {
+        size_t count = index->newlines[i];
+        index->newlines[i] = newlines;
+        newlines += count;
+    }
+
+    map->newlines = index->newlines;
+    map->count = index->checkpoint_count;
+    map->line_count = newlines + 1;
+    index->newlines = NULL;
+
+    index->viewer->line_map = map;
+    update_position(index->viewer);
+}
+
+/**
+ * @brief Records a counted range; publishes the map after the last one
+ */
+static void complete_index_range(void* result, void* data) {
+    (void)result;
+    ViewerIndexRange* range = (ViewerIndexRange*)data;
+    ViewerIndex* index = range->index;
+
+    if (!index->viewer || g_atomic_int_get(&index->cancelled)) {
+        return;
+    }
+
+    if (++index->counted == index->range_count) {
+        index_publish(index);
+    } else {
+        index_submit_ranges(index);
+    }
+}
+
+/**
+ * @brief Starts counting the lines of the mapping on the worker pool
+ */
+static ViewerIndex* index_start(LargeFileViewer* viewer, WorkerPool* pool) {
+    ViewerIndex* index = (ViewerIndex*)calloc(1, sizeof(ViewerIndex));
+    if (!index) {
+        return NULL;
+    }
+
+    index->viewer = viewer;
+    index->pool = pool;
+    index->data = file_mapping_get_data(viewer->mapping);
+    index->size = file_mapping_get_size(viewer->mapping);
+    index->checkpoint_count = index->size / VIEWER_CHECKPOINT_INTERVAL + 1;
+    index->range_count = (index->checkpoint_count + VIEWER_INDEX_RANGE_CHECKPOINTS - 1) /
+                         VIEWER_INDEX_RANGE_CHECKPOINTS;
+    index->newlines = (size_t*)calloc(index->checkpoint_count, sizeof(size_t));
+    index->ranges = (ViewerIndexRange*)calloc(index->range_count, sizeof(ViewerIndexRange));
+    g_mutex_init(&index->lock);
+    g_cond_init(&index->idle);
+
+    if (!index->newlines || !index->ranges) {
+        index_free(index);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < index->range_count; i++) {
+        index->ranges[i].index = index;
+        index->ranges[i].first = i * VIEWER_INDEX_RANGE_CHECKPOINTS;
+        index->ranges[i].count = MIN((size_t)VIEWER_INDEX_RANGE_CHECKPOINTS,
+                                     index->checkpoint_count - index->ranges[i].first);
+    }
+
+    index_submit_ranges(index);
+    return index;
+}
+
+/**
+ * @brief Stops the indexing jobs; none reads the mapping once this returns
+ */
+static void index_stop(ViewerIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    g_atomic_int_set(&index->cancelled, 1);
+    for (size_t i = 0; i < index->submitted; i++) {
+        if (index->ranges[i].job != 0) {
+            worker_pool_cancel(index->pool, index->ranges[i].job);
+        }
+    }
+
+    g_mutex_lock(&index->lock);
+    while (index->running > 0) {
+        g_cond_wait(&index->idle, &index->lock);
+    }
+    g_mutex_unlock(&index->lock);
+
+    index->viewer = NULL;
+    if (index->jobs == 0) {
+        index_free(index);
+    }
+}
+
+/**
+ * @brief Refreshes the slider and label from the scroll position
+ */
+static void update_position(LargeFileViewer* viewer) {
+    size_t size = file_mapping_get_size(viewer->mapping);
+    size_t window_start = viewer->pages[0].start;
+    size_t window_end = viewer->pages[viewer->page_count - 1].end;
+
+    /* Interpolate the top of the view within the window */
+    double upper = gtk_adjustment_get_upper(viewer->vadjustment);
+    double value = gtk_adjustment_get_value(viewer->vadjustment);
+    double fraction = upper > 0.0 ? value / upper : 0.0;
+    size_t top = window_start + (size_t)(fraction * (double)(window_end - window_start));
+
+    gtk_range_set_value(GTK_RANGE(viewer->slider), (gdouble)top);
+
+    gchar* total = g_format_size(size);
+    gchar* lines;
+    ViewerLineMap* map = get_ready_map(viewer);
+    if (map) {
+        lines = g_strdup_printf("Line %zu of %zu",
+                                line_map_line_at(viewer, map, top) + 1,
+                                map->line_count);
+    } else {
+        lines = g_strdup("Indexing lines...");
+    }
+
+    gchar* text = g_strdup_printf("Read-only  %s  %.1f%% of %s", lines,
+                                  size > 0 ? 100.0 * (double)top / (double)size : 100.0,
+                                  total);
+    gtk_label_set_text(GTK_LABEL(viewer->position_label), text);
+    g_free(text);
+    g_free(lines);
+    g_free(total);
+}
+
+static GtkWidget* create_bar(LargeFileViewer* viewer) {
+    GtkWidget* bar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_container_set_border_width(GTK_CONTAINER(bar), 4);
+
+    viewer->slider = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.0,
+                                              (gdouble)file_mapping_get_size(viewer->mapping) + 1.0,
+                                              (gdouble)VIEWER_PAGE_SIZE);
+    gtk_scale_set_draw_value(GTK_SCALE(viewer->slider), FALSE);
+    gtk_box_pack_start(GTK_BOX(bar), viewer->slider, TRUE, TRUE, 0);
+    g_signal_connect(viewer->slider, "change-value", G_CALLBACK(on_slider_change_value), viewer);
+
+    viewer->position_label = gtk_label_new(NULL);
+    gtk_box_pack_start(GTK_BOX(bar), viewer->position_label, FALSE, FALSE, 0);
+
+    gtk_widget_show_all(bar);
+    return bar;
+}
+
+LargeFileViewer* large_file_viewer_create(GtkTextView* text_view, FileMapping* mapping,
+                                          WorkerPool* pool) {
+    if (!text_view || !mapping || !pool) {
+        return NULL;
+    }
+
+    LargeFileViewer* viewer = (LargeFileViewer*)calloc(1, sizeof(LargeFileViewer));
+    if (!viewer) {
+        return NULL;
+    }
+
+    viewer->text_view = text_view;
+    viewer->buffer = gtk_text_view_get_buffer(text_view);
+    viewer->vadjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(text_view));
+    viewer->mapping = mapping;
+
+    GtkTextIter start;
+    gtk_text_buffer_get_start_iter(viewer->buffer, &start);
+    viewer->anchor = gtk_text_buffer_create_mark(viewer->buffer, NULL, &start, FALSE);
+
+    viewer->bar = create_bar(viewer);
+    viewer->scroll_handler = g_signal_connect(viewer->vadjustment, "value-changed",
+                                              G_CALLBACK(on_scroll_changed), viewer);
+
+    gtk_text_view_set_editable(text_view, FALSE);
+    large_file_viewer_jump_to_offset(viewer, 0);
+
+    /* Line counts need a full pass over the file; do it on the pool */
+    viewer->index = index_start(viewer, pool);
+
+    return viewer;
+}
+
+void large_file_viewer_destroy(LargeFileViewer* viewer) {
+    if (!viewer) {
+        return;
+    }
+
+    if (viewer->shift_source) {
+        g_source_remove(viewer->shift_source);
+    }
+    if (viewer->jump_source) {
+        g_source_remove(viewer->jump_source);
+    }
+
+    /* The jobs read the mapping, so they must stop before the unmap */
+    index_stop(viewer->index);
+    line_map_free(viewer->line_map);
+
+    g_signal_handler_disconnect(viewer->vadjustment, viewer->scroll_handler);
+
+    gtk_source_buffer_begin_not_undoable_action(GTK_SOURCE_BUFFER(viewer->buffer));
+    gtk_text_buffer_set_text(viewer->buffer, "", 0);
+    gtk_source_buffer_end_not_undoable_action(GTK_SOURCE_BUFFER(viewer->buffer));
+    gtk_text_buffer_delete_mark(viewer->buffer, viewer->anchor);
+    gtk_text_view_set_editable(viewer->text_view, TRUE);
+
+    gtk_widget_destroy(viewer->bar);
+    file_mapping_close(viewer->mapping);
+    free(viewer);
+}
+
+GtkWidget* large_file_viewer_get_widget(const LargeFileViewer* viewer) {
+    if (!viewer) {
+        return NULL;
+    }
+
+    return viewer->bar;
+}
+
+void large_file_viewer_jump_to_offset(LargeFileViewer* viewer, size_t offset) {
+    if (!viewer) {
+        return;
+    }
+
+    size_t size = file_mapping_get_size(viewer->mapping);
+    if (offset > size) {
+        offset = size;
+    }
+
+    /* Start one page early so there is room to scroll up */
+    size_t start = offset > VIEWER_PAGE_SIZE ? snap_to_line_start(viewer, offset - VIEWER_PAGE_SIZE) : 0;
+    if (start > offset) {
+        start = 0;
+    }
+
+    begin_update(viewer);
+    gtk_text_buffer_set_text(viewer->buffer, "", 0);
+    viewer->page_count = 0;
+
+    size_t page_start = start;
+    do {
+        size_t page_end = snap_to_line_start(viewer, page_start + VIEWER_PAGE_SIZE);
+        if (page_end <= page_start) {
+            page_end = size;
+        }
+        append_page(viewer, page_start, page_end);
+        page_start = page_end;
+    } while (viewer->page_count < VIEWER_WINDOW_PAGES && page_start < size);
+
+    /* Place the view on the character at offset */
+    GtkTextIter iter;
+    gtk_text_buffer_get_iter_at_offset(viewer->buffer, &iter, offset_to_chars(viewer, offset));
+    gtk_text_buffer_place_cursor(viewer->buffer, &iter);
+    gtk_text_buffer_move_mark(viewer->buffer, viewer->anchor, &iter);
+    restore_anchor(viewer);
+    end_update(viewer);
+
+    update_position(viewer);
+}
+
+size_t large_file_viewer_get_window_start(const LargeFileViewer* viewer) {
+    if (!viewer || viewer->page_count == 0) {
+        return 0;
+    }
+
+    return viewer->pages[0].start;
+}
+
+const FileMapping* large_file_viewer_get_mapping(const LargeFileViewer* viewer) {
+    if (!viewer) {
+        return NULL;
+    }
+
+    return viewer->mapping;
+}
+
+size_t large_file_viewer_get_line_count(const LargeFileViewer* viewer) {
+    if (!viewer) {
+        return 0;
+    }
+
+    ViewerLineMap* map = get_ready_map(viewer);
+    return map ? map->line_count : 0;
+}
+
+bool large_file_viewer_goto_line(LargeFileViewer* viewer, size_t line) {
+    if (!viewer) {
+        return false;
+    }
+
+    ViewerLineMap* map = get_ready_map(viewer);
+    if (!map) {
+        return false;
+    }
+
+    large_file_viewer_jump_to_offset(viewer, line_map_line_start(viewer, map, line));
+    return true;
+}
+
+void large_file_viewer_get_selection(const LargeFileViewer* viewer, size_t* start, size_t* end) {
+    if (!viewer || !start || !end) {
+        return;
+    }
+
+    GtkTextIter first, last;
+    gtk_text_buffer_get_selection_bounds(viewer->buffer, &first, &last);
+    *start = iter_to_offset(viewer, &first);
+    *end = iter_to_offset(viewer, &last);
+}
+
+void large_file_viewer_select_range(LargeFileViewer* viewer, size_t start, size_t end) {
+    if (!viewer || start > end) {
+        return;
+    }
+
+    if (start < viewer->pages[0].start || end > viewer->pages[viewer->page_count - 1].end) {
+        large_file_viewer_jump_to_offset(viewer, start);
+    }
+
+    GtkTextIter first, last;
+    gtk_text_buffer_get_iter_at_offset(viewer->buffer, &first, offset_to_chars(viewer, start));
+    gtk_text_buffer_get_iter_at_offset(viewer->buffer, &last, offset_to_chars(viewer, end));
+    gtk_text_buffer_select_range(viewer->buffer, &last, &first);
+    gtk_text_view_scroll_to_mark(viewer->text_view, gtk_text_buffer_get_insert(viewer->buffer),
+                                 0.0, TRUE, 0.0, 0.5);
+}
+
+bool large_file_viewer_get_cursor_position(const LargeFileViewer* viewer,
+                                           size_t* line, size_t* column) {
+    if (!viewer || !line || !column) {
+        return false;
+    }
+
+    ViewerLineMap* map = get_ready_map(viewer);
+    if (!map) {
+        return false;
+    }
+
+    /* The window starts on a line start, so buffer lines map one to one */
+    GtkTextIter iter;
+    gtk_text_buffer_get_iter_at_mark(viewer->buffer, &iter, gtk_text_buffer_get_insert(viewer->buffer));
+    *line = line_map_line_at(viewer, map, large_file_viewer_get_window_start(viewer)) +
+            (size_t)gtk_text_iter_get_line(&iter);
+    *column = (size_t)gtk_text_iter_get_line_offset(&iter);
+    return true;
+}
+
+/* Callback implementations */
+
+static void on_scroll_changed(GtkAdjustment* adjustment, gpointer user_data) {
+    LargeFileViewer* viewer = (LargeFileViewer*)user_data;
+
+    update_position(viewer);
+
+    double value = gtk_adjustment_get_value(adjustment);
+    double page = gtk_adjustment_get_page_size(adjustment);
+    double upper = gtk_adjustment_get_upper(adjustment);
+
+    bool near_top = value < page && viewer->pages[0].start > 0;
+    bool near_bottom = value + 2.0 * page > upper &&
+                       viewer->pages[viewer->page_count - 1].end < file_mapping_get_size(viewer->mapping);
+
+    /* Swap pages outside the scroll handler to avoid re-entrancy */
+    if ((near_top || near_bottom) && !viewer->shift_source) {
+        viewer->shift_source = g_idle_add(on_shift_idle, viewer);
+    }
+}
+
+static gboolean on_shift_idle(gpointer user_data) {
+    LargeFileViewer* viewer = (LargeFileViewer*)user_data;
+    viewer->shift_source = 0;
+
+    double value = gtk_adjustment_get_value(viewer->vadjustment);
+    double page = gtk_adjustment_get_page_size(viewer->vadjustment);
+    double upper = gtk_adjustment_get_upper(viewer->vadjustment);
+
+    if (value < page) {
+        shift_backward(viewer);
+    } else if (value + 2.0 * page > upper) {
+        shift_forward(viewer);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_slider_change_value(GtkRange* range, GtkScrollType scroll,
+                                       gdouble value, gpointer user_data) {
+    (void)range;
+    (void)scroll;
+    LargeFileViewer* viewer = (LargeFileViewer*)user_data;
+
+    /* Dragging emits many values; only jump to the latest one */
+    viewer->pending_jump = value > 0.0 ? (size_t)value : 0;
+    if (!viewer->jump_source) {
+        viewer->jump_source = g_idle_add(on_jump_idle, viewer);
+    }
+
+    return FALSE;
+}
+
+static gboolean on_jump_idle(gpointer user_data) {
+    LargeFileViewer* viewer = (LargeFileViewer*)user_data;
+    viewer->jump_source = 0;
+
+    large_file_viewer_jump_to_offset(viewer, viewer->pending_jump);
+
+    return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,487 @@
+#include "ui/latency_probe.h"
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Buffer sizes of the scenarios that start with text
+ */
+#define LARGE_BUFFER_BYTES ((size_t)100 * 1024 * 1024)
+#define LONG_LINE_BYTES ((size_t)1024 * 1024)
+#define SAVE_BUFFER_BYTES ((size_t)32 * 1024 * 1024)
+
+/**
+ * @brief Pause between keystrokes (a fast typist)
+ */
+#define KEY_INTERVAL_MS 50
+
+/**
+ * @brief Time given to a scenario's initial layout before typing starts
+ */
+#define SETTLE_MS 1000
+
+/**
+ * @brief A keystroke not on screen after this long is counted as lost
+ */
+#define KEY_TIMEOUT_MS 5000
+
+/**
+ * @brief How often to check whether the window is up or a save is done
+ */
+#define POLL_INTERVAL_MS 50
+
+typedef enum {
+    SCENARIO_EMPTY = 0,
+    SCENARIO_LARGE_BUFFER,
+    SCENARIO_LONG_LINE,
+    SCENARIO_DURING_SAVE,
+    SCENARIO_COUNT
+} Scenario;
+
+static const char* const scenario_names[SCENARIO_COUNT] = {
+    [SCENARIO_EMPTY] = "empty",
+    [SCENARIO_LARGE_BUFFER] = "large-buffer",
+    [SCENARIO_LONG_LINE] = "long-line",
+    [SCENARIO_DURING_SAVE] = "during-save"
+};
+
+/**
+ * @brief Latency probe structure
+ */
+struct LatencyProbe {
+    MainWindow* window;
+    GtkTextView* text_view;      /* Referenced, as are the buffer and frame clock, */
+    GtkTextBuffer* buffer;       /* so the handlers can be disconnected safely     */
+    GdkFrameClock* frame_clock;  /* even if the window goes first                  */
+    gulong insert_handler;
+    gulong after_paint_handler;
+    GtkWrapMode wrap_mode;       /* Restored after each scenario */
+    guint source;                /* Start poll, next keystroke, key timeout or save wait */
+
+    bool selected[SCENARIO_COUNT];
+    int scenario;                /* Running scenario, -1 before the first */
+    size_t keystrokes;
+    gchar* save_path;
+    bool completed;
+    bool failed;
+
+    gint64* samples;             /* Latencies of this scenario, in microseconds */
+    size_t sample_count;
+    size_t sent;
+    size_t timeouts;
+    size_t saving_keys;          /* Keystrokes typed while a save was running */
+
+    bool pending;                /* A keystroke is waiting for its frame */
+    bool inserted;               /* ...and its text has reached the buffer */
+    gint64 sent_at;
+};
+
+static void start_next_scenario(LatencyProbe* probe);
+
+/**
+ * @brief Selects the scenarios named in a comma-separated list
+ * @return false on an unknown name or an empty selection
+ */
+static bool select_scenarios(LatencyProbe* probe, const char* list) {
+    if (!list) {
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            probe->selected[i] = true;
+        }
+        return true;
+    }
+
+    bool any = false;
+    gchar** names = g_strsplit(list, ",", -1);
+    for (gchar** name = names; *name; name++) {
+        g_strstrip(*name);
+        if (**name == '\0') {
+            continue;
+        }
+
+        int i = 0;
+        while (i < SCENARIO_COUNT && strcmp(*name, scenario_names[i]) != 0) {
+            i++;
+        }
+        if (i == SCENARIO_COUNT) {
+            g_strfreev(names);
+            return false;
+        }
+
+        probe->selected[i] = true;
+        any = true;
+    }
+    g_strfreev(names);
+
+    return any;
+}
+
+/**
+ * @brief Generates ASCII prose
+ * @param size Exact number of bytes
+ * @param single_line Use spaces where the lines would break
+ * @return Newly allocated text (free with g_free), or NULL if out of memory
+ */
+static gchar* generate_text(size_t size, bool single_line) {
+    static const char sentence[] = "The quick brown fox jumps over the lazy dog, and the editor keeps up.\n";
+    const size_t sentence_length = sizeof(sentence) - 1;
+
+    gchar* text = g_try_malloc(size + 1);
+    if (!text) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        char c = sentence[i % sentence_length];
+        text[i] = single_line && c == '\n' ? ' ' : c;
+    }
+    text[size] = '\0';
+
+    return text;
+}
+
+/**
+ * @brief Queues a key event for the window, as if typed on the keyboard
+ */
+static void put_key_event(LatencyProbe* probe, GdkEventType type, guint keyval) {
+    GtkWidget* toplevel = gtk_widget_get_toplevel(GTK_WIDGET(probe->text_view));
+    GdkWindow* gdk_window = gtk_widget_get_window(toplevel);
+    if (!gdk_window) {
+        return;
+    }
+
+    GdkDisplay* display = gdk_window_get_display(gdk_window);
+    GdkEvent* event = gdk_event_new(type);
+    event->key.window = g_object_ref(gdk_window);
+    event->key.send_event = TRUE;
+    event->key.time = GDK_CURRENT_TIME;
+    event->key.keyval = keyval;
+
+    /* Input methods look at the keycode, not just the keyval */
+    GdkKeymapKey* keys = NULL;
+    gint key_count = 0;
+    if (gdk_keymap_get_entries_for_keyval(gdk_keymap_get_for_display(display), keyval,
+                                          &keys, &key_count) && key_count > 0) {
+        event->key.hardware_keycode = (guint16)keys[0].keycode;
+        event->key.group = (guint8)keys[0].group;
+    }
+    g_free(keys);
+
+    GdkSeat* seat = gdk_display_get_default_seat(display);
+    GdkDevice* keyboard = seat ? gdk_seat_get_keyboard(seat) : NULL;
+    if (keyboard) {
+        gdk_event_set_device(event, keyboard);
+    }
+
+    gdk_event_put(event);
+    gdk_event_free(event);
+}
+
+static int compare_samples(const void* a, const void* b) {
+    gint64 x = *(const gint64*)a;
+    gint64 y = *(const gint64*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Gets a percentile of sorted samples (nearest rank)
+ */
+static double get_percentile_ms(const gint64* sorted, size_t count, unsigned int permille) {
+    size_t rank = (count * permille + 999) / 1000;
+    return (double)sorted[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+/**
+ * @brief Prints the results of the scenario that just finished
+ */
+static void report_scenario(LatencyProbe* probe) {
+    const char* name = scenario_names[probe->scenario];
+
+    if (probe->sample_count == 0) {
+        printf("%-13s no keystroke reached the screen (%zu lost)\n", name, probe->timeouts);
+        fflush(stdout);
+        probe->failed = true;
+        return;
+    }
+
+    qsort(probe->samples, probe->sample_count, sizeof(gint64), compare_samples);
+
+    printf("%-13s %6zu %8zu %6zu %8.2f %8.2f %8.2f %8.2f\n", name, probe->sample_count,
+           probe->saving_keys, probe->timeouts,
+           get_percentile_ms(probe->samples, probe->sample_count, 500),
+           get_percentile_ms(probe->samples, probe->sample_count, 900),
+           get_percentile_ms(probe->samples, probe->sample_count, 990),
+           (double)probe->samples[probe->sample_count - 1] / 1000.0);
+    fflush(stdout);
+}
+
+/**
+ * @brief Waits for the last scenario's saves before starting the next one
+ */
+static gboolean on_save_wait(gpointer user_data) {
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+
+    if (main_window_is_saving(probe->window)) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    probe->source = 0;
+    start_next_scenario(probe);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_send_key(gpointer user_data);
+
+/**
+ * @brief Schedules the next keystroke, or ends the scenario after the last
+ */
+static void continue_scenario(LatencyProbe* probe) {
+    if (probe->sent < probe->keystrokes) {
+        probe->source = g_timeout_add(KEY_INTERVAL_MS, on_send_key, probe);
+        return;
+    }
+
+    report_scenario(probe);
+    gtk_text_view_set_wrap_mode(probe->text_view, probe->wrap_mode);
+
+    if (main_window_is_saving(probe->window)) {
+        probe->source = g_timeout_add(POLL_INTERVAL_MS, on_save_wait, probe);
+        return;
+    }
+
+    start_next_scenario(probe);
+}
+
+static gboolean on_key_timeout(gpointer user_data) {
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+
+    probe->source = 0;
+    probe->pending = false;
+    probe->timeouts++;
+    continue_scenario(probe);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_send_key(gpointer user_data) {
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+
+    /* Keep a save running the whole time; its snapshot is taken before the key goes in */
+    if (probe->scenario == SCENARIO_DURING_SAVE && !main_window_is_saving(probe->window)) {
+        main_window_save_to(probe->window, probe->save_path);
+    }
+    if (main_window_is_saving(probe->window)) {
+        probe->saving_keys++;
+    }
+
+    probe->pending = true;
+    probe->inserted = false;
+    probe->sent_at = g_get_monotonic_time();
+    put_key_event(probe, GDK_KEY_PRESS, GDK_KEY_a);
+    put_key_event(probe, GDK_KEY_RELEASE, GDK_KEY_a);
+    probe->sent++;
+
+    probe->source = g_timeout_add(KEY_TIMEOUT_MS, on_key_timeout, probe);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_insert_text(GtkTextBuffer* buffer, GtkTextIter* location,
+                           gchar* text, gint length, gpointer user_data) {
+    (void)buffer;
+    (void)location;
+    (void)text;
+    (void)length;
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+
+    if (probe->pending) {
+        probe->inserted = true;
+    }
+}
+
+/**
+ * @brief Takes the sample once a frame has been painted with the new text
+ */
+static void on_after_paint(GdkFrameClock* clock, gpointer user_data) {
+    (void)clock;
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+
+    if (!probe->pending || !probe->inserted) {
+        return;
+    }
+
+    probe->samples[probe->sample_count++] = g_get_monotonic_time() - probe->sent_at;
+    probe->pending = false;
+
+    g_source_remove(probe->source);
+    probe->source = 0;
+    continue_scenario(probe);
+}
+
+/**
+ * @brief Replaces the buffer with the scenario's text and places the cursor
+ * @return false if the text could not be generated
+ */
+static bool prepare_scenario(LatencyProbe* probe) {
+    if (probe->scenario == SCENARIO_EMPTY) {
+        main_window_set_text(probe->window, "");
+    } else {
+        size_t size = SAVE_BUFFER_BYTES;
+        if (probe->scenario == SCENARIO_LARGE_BUFFER) {
+            size = LARGE_BUFFER_BYTES;
+        } else if (probe->scenario == SCENARIO_LONG_LINE) {
+            size = LONG_LINE_BYTES;
+        }
+
+        gchar* text = generate_text(size, probe->scenario == SCENARIO_LONG_LINE);
+        if (!text) {
+            return false;
+        }
+        main_window_set_text(probe->window, text);
+        g_free(text);
+    }
+
+    GtkTextIter cursor;
+    if (probe->scenario == SCENARIO_LONG_LINE) {
+        /* Typing at the end of the line rewraps all of it */
+        gtk_text_view_set_wrap_mode(probe->text_view, GTK_WRAP_WORD_CHAR);
+        gtk_text_buffer_get_end_iter(probe->buffer, &cursor);
+    } else {
+        gtk_text_buffer_get_start_iter(probe->buffer, &cursor);
+    }
+
+    gtk_text_buffer_place_cursor(probe->buffer, &cursor);
+    gtk_text_view_scroll_to_mark(probe->text_view, gtk_text_buffer_get_insert(probe->buffer),
+                                 0.0, FALSE, 0.0, 0.0);
+    gtk_widget_grab_focus(GTK_WIDGET(probe->text_view));
+
+    return true;
+}
+
+static void start_next_scenario(LatencyProbe* probe) {
+    do {
+        probe->scenario++;
+    } while (probe->scenario < SCENARIO_COUNT && !probe->selected[probe->scenario]);
+
+    if (probe->scenario == SCENARIO_COUNT) {
+        probe->completed = true;
+        gtk_main_quit();
+        return;
+    }
+
+    probe->sample_count = 0;
+    probe->sent = 0;
+    probe->timeouts = 0;
+    probe->saving_keys = 0;
+    probe->pending = false;
+
+    if (!prepare_scenario(probe)) {
+        printf("%-13s out of memory\n", scenario_names[probe->scenario]);
+        probe->failed = true;
+        start_next_scenario(probe);
+        return;
+    }
+
+    probe->source = g_timeout_add(SETTLE_MS, on_send_key, probe);
+}
+
+/**
+ * @brief Starts the first scenario once the text view is on screen
+ */
+static gboolean on_start_poll(gpointer user_data) {
+    LatencyProbe* probe = (LatencyProbe*)user_data;
+    GtkWidget* widget = GTK_WIDGET(probe->text_view);
+
+    GdkFrameClock* clock = gtk_widget_get_mapped(widget) ? gtk_widget_get_frame_clock(widget) : NULL;
+    if (!clock) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    probe->frame_clock = g_object_ref(clock);
+    probe->after_paint_handler = g_signal_connect(clock, "after-paint",
+                                                  G_CALLBACK(on_after_paint), probe);
+    probe->wrap_mode = gtk_text_view_get_wrap_mode(probe->text_view);
+
+    printf("%-13s %6s %8s %6s %8s %8s %8s %8s\n", "scenario", "keys", "in save", "lost",
+           "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    probe->source = 0;
+    start_next_scenario(probe);
+    return G_SOURCE_REMOVE;
+}
+
+LatencyProbe* latency_probe_create(MainWindow* window, const char* scenarios, size_t keystrokes) {
+    GtkWidget* text_view = window ? main_window_get_text_view(window) : NULL;
+    if (!text_view || keystrokes == 0) {
+        return NULL;
+    }
+
+    LatencyProbe* probe = (LatencyProbe*)calloc(1, sizeof(LatencyProbe));
+    if (!probe) {
+        return NULL;
+    }
+
+    probe->window = window;
+    probe->scenario = -1;
+    probe->keystrokes = keystrokes;
+
+    if (!select_scenarios(probe, scenarios)) {
+        free(probe);
+        return NULL;
+    }
+
+    probe->samples = (gint64*)malloc(keystrokes * sizeof(gint64));
+    if (!probe->samples) {
+        free(probe);
+        return NULL;
+    }
+
+    if (probe->selected[SCENARIO_DURING_SAVE]) {
+        gint fd = g_file_open_tmp("notebook-latency-XXXXXX.txt", &probe->save_path, NULL);
+        if (fd < 0) {
+            free(probe->samples);
+            free(probe);
+            return NULL;
+        }
+        close(fd);
+    }
+
+    probe->text_view = GTK_TEXT_VIEW(g_object_ref(text_view));
+    probe->buffer = g_object_ref(gtk_text_view_get_buffer(probe->text_view));
+    probe->insert_handler = g_signal_connect_after(probe->buffer, "insert-text",
+                                                   G_CALLBACK(on_insert_text), probe);
+    probe->source = g_timeout_add(POLL_INTERVAL_MS, on_start_poll, probe);
+
+    return probe;
+}
+
+void latency_probe_destroy(LatencyProbe* probe) {
+    if (!probe) {
+        return;
+    }
+
+    if (probe->source) {
+        g_source_remove(probe->source);
+    }
+
+    if (probe->frame_clock) {
+        g_signal_handler_disconnect(probe->frame_clock, probe->after_paint_handler);
+        g_object_unref(probe->frame_clock);
+    }
+
+    g_signal_handler_disconnect(probe->buffer, probe->insert_handler);
+    g_object_unref(probe->buffer);
+    g_object_unref(probe->text_view);
+
+    if (probe->save_path) {
+        g_unlink(probe->save_path);
+        g_free(probe->save_path);
+    }
+
+    free(probe->samples);
+    free(probe);
+}
+
+bool latency_probe_succeeded(const LatencyProbe* probe) {
+    return probe && probe->completed && !probe->failed;
+}
\ No newline at end of file
@@ -1,8 +1,154 @@
 #include "ui/main_window.h"
+#include "clipboard/clipboard_data.h"
 #include "theme/theme_manager.h"
+#include "core/change_notifier.h"
+#include "core/history.h"
+#include "core/line_index.h"
+#include "core/metrics.h"
+#include "core/search.h"
+#include "core/trace.h"
+#include "core/worker_pool.h"
+#include "io/edit_trace.h"
+#include "io/file_loader.h"
+#include "io/file_saver.h"
+#include "io/journal.h"
+#include "ui/buffer_text.h"
+#include "ui/large_file_viewer.h"
+#include "ui/regex_search.h"
+#include "ui/task_scheduler.h"
+#include "ui/theme_cache.h"
 #include <gtksourceview/gtksource.h>
+#include <glib/gstdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Time the loader may spend inserting chunks per main loop iteration
+ */
+#define LOADER_FRAME_BUDGET_US 8000
+
+/**
+ * @brief Time background tasks may take out of each frame
+ */
+#define TASK_FRAME_BUDGET_US 4000
+
+/**
+ * @brief Poll interval while the loader has no chunk ready
+ */
+#define LOADER_POLL_INTERVAL_MS 5
+
+/**
+ * @brief How often completed background saves are collected
+ */
+#define SAVE_POLL_INTERVAL_MS 50
+
+/**
+ * @brief How often journalled edits are written and synced
+ */
+#define JOURNAL_FLUSH_INTERVAL_MS 200
+
+/**
+ * @brief Default size above which files open in the read-only paged viewer
+ */
+#define DEFAULT_LARGE_FILE_THRESHOLD ((size_t)64 * 1024 * 1024)
+
+/**
+ * @brief Where styles/notebook.gresource.xml puts the built-in style schemes
+ */
+#define STYLE_SCHEME_RESOURCE_PATH "resource:///com/luizparente/notebook/styles"
+
+/**
+ * @brief How often the debug overlay re-reads the metrics
+ */
+#define DEBUG_OVERLAY_INTERVAL_MS 500
+
+/**
+ * @brief Memory the undo history may use
+ */
+#define HISTORY_BUDGET ((size_t)32 * 1024 * 1024)
+
+/**
+ * @brief Match count at which the find bar stops counting
+ */
+#define FIND_COUNT_LIMIT 100000
+
+/**
+ * @brief Bytes the match count scans between deadline checks
+ */
+#define FIND_COUNT_SLICE (256 * 1024)
+
+/**
+ * @brief Longest selection used to prefill the find bar
+ */
+#define FIND_PREFILL_MAX 256
+
+/**
+ * @brief Regex matches kept before a search stops
+ */
+#define REGEX_MATCH_LIMIT 1000000
+
+/**
+ * @brief How often streamed regex matches are collected
+ */
+#define REGEX_POLL_INTERVAL_MS 30
+
+/**
+ * @brief Matches copied out of a regex search per call
+ */
+#define REGEX_TAKE_BATCH 1024
+
+/**
+ * @brief How often the viewer's file is checked for truncation
+ */
+#define VIEWER_CHECK_INTERVAL_MS 1000
+
+/**
+ * @brief Pastes up to this size are inserted at once; larger ones a slice at a time
+ */
+#define PASTE_SYNC_MAX ((size_t)256 * 1024)
+
+/**
+ * @brief Bytes per buffer insert of a sliced paste
+ */
+#define PASTE_SLICE_SIZE ((size_t)64 * 1024)
+
+/**
+ * @brief Find request waiting for regex matches that have not arrived yet
+ */
+typedef enum {
+    FIND_PENDING_NONE,
+    FIND_PENDING_FORWARD,
+    FIND_PENDING_BACKWARD,
+    FIND_PENDING_REPLACE_ALL
+} FindPending;
+
+/**
+ * @brief Large paste being inserted over several frames, as one user action
+ */
+typedef struct {
+    ClipboardData* content;
+    size_t inserted;        /* Bytes of content in the buffer so far */
+    size_t inserted_chars;  /* Characters of content in the buffer so far */
+    GtkTextMark* selection; /* Start of the replaced selection, deleted after the last slice */
+    GtkTextMark* start;     /* Before the pasted text, at the end of the selection */
+    GtkTextMark* end;       /* After the pasted text, where the next slice goes */
+    guint task;
+    uint64_t span;          /* Trace span, from the clipboard read to the last slice */
+    uint64_t start_time;
+} PasteJob;
+
+/**
+ * @brief System clipboard read in flight
+ *
+ * Freed by the reply, which may arrive after the window is gone.
+ */
+typedef struct {
+    MainWindow* window;     /* NULL once the window no longer wants the text */
+    uint64_t span;
+    uint64_t start_time;
+} PasteRequest;
 
 /**
  * @brief Main window structure - holds all GTK widgets and state
@@ -10,11 +156,73 @@
 struct MainWindow {
     Application* app;
     GtkWidget* window;
+    GtkWidget* content_box;
     GtkWidget* text_view;
     GtkTextBuffer* text_buffer;
-    GtkCssProvider* css_provider;
+    ThemeCache* theme_cache;
     GtkAccelGroup* accel_group;
+    GtkWidget* progress_box;
+    GtkWidget* progress_bar;
+    GtkWidget* status_label;
+    GtkWidget* find_bar;
+    GtkWidget* find_entry;
+    GtkWidget* find_case_check;
+    GtkWidget* find_word_check;
+    GtkWidget* find_regex_check;
+    GtkWidget* replace_entry;
+    GtkWidget* find_status_label;
+    SearchPattern* find_pattern;
+    bool find_count_stale;
+    guint count_task;       /* Scheduler task counting literal matches */
+    GBytes* search_bytes;   /* Buffer snapshot shared by find queries until the next edit */
+    LineIndex* search_lines;
+    RegexSearch* regex_search;
+    guint regex_poll_source;
+    GArray* regex_matches;  /* SearchMatch, in document order */
+    FindPending regex_pending;
+    size_t regex_pending_offset;
+    FileLoader* loader;
+    guint loader_source;
+    bool loader_starved;
+    bool loader_placed_cursor;
+    FileSaver* saver;
+    guint save_poll_source;
+    FileSyncPolicy sync_policy;
+    unsigned long edit_generation;
+    LargeFileViewer* viewer;
+    guint viewer_check_source;   /* Watches the viewer's file for truncation */
+    size_t large_file_threshold;
+    TextEncoding file_encoding;  /* Encoding the next save is written in */
+    GtkTextTag* nul_tag;         /* Marks U+2400 characters that stand for NUL bytes */
+    GtkWidget* encoding_label;
+    History* history;
+    WorkerPool* workers;
+    uint64_t replace_job;        /* Replace All being computed on the pool */
+    TaskScheduler* scheduler;
+    ChangeNotifier* change_notifier;
+    guint change_tick;           /* Tick callback that flushes change_notifier */
+    glong char_count;            /* Buffer length in characters after the last change */
+    Journal* journal;            /* Edits since the last load or save, for crash recovery */
+    GArray* save_journal_marks;  /* guint64 journal position per queued save, oldest first */
+    JournalRecovery* recovery;   /* Journal to replay once its file has loaded */
+    char* recovery_path;
+    EditTraceWriter* edit_trace; /* Session being recorded for replay, if any */
+    LineIndex* edit_trace_lines; /* Byte offset of each buffer line, while recording */
+    bool edit_trace_failed;      /* Recording stopped early on an error */
+    bool applying_history;       /* Undo/redo is editing the buffer; do not record */
+    bool recording_shared;       /* Replace All or a paste slice records its own history and journal entries */
     bool ignore_buffer_changes;
+    ClipboardData* clipboard_data; /* What we offer on the system clipboard, while we own it */
+    PasteRequest* paste_request;
+    PasteJob* paste;
+    GtkWidget* debug_overlay;    /* Metrics summary drawn over the editor */
+    guint debug_overlay_source;
+    GdkFrameClock* frame_clock;  /* Timed for METRIC_FRAME_TIME while realized */
+    gulong before_paint_handler;
+    gulong after_paint_handler;
+    uint64_t paint_start;
+    bool first_frame_drawn;
+    uint64_t open_span;          /* Trace span of the load in progress */
 };
 
 /* Forward declarations for callbacks */
@@ -27,10 +235,46 @@ static void on_cut_activated(GtkWidget* widget, gpointer user_data);
 static void on_copy_activated(GtkWidget* widget, gpointer user_data);
 static void on_paste_activated(GtkWidget* widget, gpointer user_data);
 static void on_select_all_activated(GtkWidget* widget, gpointer user_data);
+static void on_undo_activated(GtkWidget* widget, gpointer user_data);
+static void on_redo_activated(GtkWidget* widget, gpointer user_data);
+static void on_goto_line_activated(GtkWidget* widget, gpointer user_data);
+static void on_find_activated(GtkWidget* widget, gpointer user_data);
+static void on_replace_activated(GtkWidget* widget, gpointer user_data);
+static void on_replace_all_clicked(GtkWidget* widget, gpointer user_data);
+static void on_find_next_activated(GtkWidget* widget, gpointer user_data);
+static void on_find_previous_activated(GtkWidget* widget, gpointer user_data);
+static void on_find_changed(GtkWidget* widget, gpointer user_data);
+static void on_find_close(GtkWidget* widget, gpointer user_data);
+static gboolean on_regex_poll(gpointer user_data);
+static gboolean on_viewer_check(gpointer user_data);
+static void dispatch_worker_job(WorkerJob* job, void* dispatch_data);
+static void withdraw_worker_job(WorkerJob* job, void* dispatch_data);
+static void stop_paste(MainWindow* window, bool remove_text);
 static void on_toggle_theme_activated(GtkWidget* widget, gpointer user_data);
+static void on_debug_overlay_toggled(GtkCheckMenuItem* item, gpointer user_data);
 static void on_about_activated(GtkWidget* widget, gpointer user_data);
 static void on_buffer_changed(GtkTextBuffer* buffer, gpointer user_data);
+static void on_mark_set(GtkTextBuffer* buffer, GtkTextIter* location,
+                        GtkTextMark* mark, gpointer user_data);
+static void on_insert_text(GtkTextBuffer* buffer, GtkTextIter* location,
+                           gchar* text, gint length, gpointer user_data);
+static void on_delete_range(GtkTextBuffer* buffer, GtkTextIter* start,
+                            GtkTextIter* end, gpointer user_data);
+static void on_text_inserted(GtkTextBuffer* buffer, GtkTextIter* location,
+                             gchar* text, gint length, gpointer user_data);
+static void on_range_deleted(GtkTextBuffer* buffer, GtkTextIter* start,
+                             GtkTextIter* end, gpointer user_data);
+static void on_text_changes(const TextChange* changes, size_t count, void* user_data);
+static gboolean on_change_tick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data);
+static void on_begin_user_action(GtkTextBuffer* buffer, gpointer user_data);
+static void on_end_user_action(GtkTextBuffer* buffer, gpointer user_data);
+static void on_cancel_progress_clicked(GtkWidget* widget, gpointer user_data);
+static gboolean on_loader_tick(gpointer user_data);
+static gboolean on_save_poll(gpointer user_data);
 static gboolean on_window_delete(GtkWidget* widget, GdkEvent* event, gpointer user_data);
+static void on_window_destroy(GtkWidget* widget, gpointer user_data);
+static void on_window_realize(GtkWidget* widget, gpointer user_data);
+static void on_window_unrealize(GtkWidget* widget, gpointer user_data);
 static void on_theme_changed(ThemeType theme, void* user_data);
 static void on_document_modified(void* user_data);
 static void on_document_saved(void* user_data);
@@ -38,6 +282,95 @@ static void on_new_document(void* user_data);
 static void on_document_loaded(void* user_data);
 static void on_error(const char* message, void* user_data);
 
+/**
+ * @brief Gets the directory edit journals are kept in (free with g_free)
+ */
+static gchar* get_journal_directory(void) {
+    return g_build_filename(g_get_user_data_dir(), "notebook", "journal", NULL);
+}
+
+/**
+ * @brief Starts journalling against a freshly loaded, saved or new document
+ */
+static void rebase_journal(MainWindow* window, const char* path) {
+    journal_rebase(window->journal, path, journal_get_position(window->journal));
+}
+
+/**
+ * @brief Stops recording edits; the trace ends with the last record written
+ * @return false if a record could not be written
+ */
+static bool close_edit_trace(MainWindow* window) {
+    bool written = edit_trace_writer_close(window->edit_trace);
+    window->edit_trace = NULL;
+    line_index_destroy(window->edit_trace_lines);
+    window->edit_trace_lines = NULL;
+    return written;
+}
+
+/**
+ * @brief Stops recording after an error, leaving the records written so far
+ */
+static void abandon_edit_trace(MainWindow* window) {
+    window->edit_trace_failed = true;
+    close_edit_trace(window);
+}
+
+/**
+ * @brief Appends a record to the edit trace, if one is being recorded
+ */
+static void record_edit(MainWindow* window, EditTraceType type, size_t offset,
+                        const char* text, size_t length) {
+    if (!window->edit_trace) {
+        return;
+    }
+
+    if (!edit_trace_writer_append(window->edit_trace, type, offset, text, length,
+                                  window->applying_history)) {
+        abandon_edit_trace(window);
+    }
+}
+
+/**
+ * @brief Gets the byte offset of an iterator for the edit trace
+ */
+static size_t get_edit_trace_offset(MainWindow* window, const GtkTextIter* iter) {
+    return line_index_get_line_start(window->edit_trace_lines, (size_t)gtk_text_iter_get_line(iter)) +
+           (size_t)gtk_text_iter_get_line_index(iter);
+}
+
+/**
+ * @brief Records the buffer's whole content as the base of the edits that follow
+ */
+static void record_edit_base(MainWindow* window) {
+    if (!window->edit_trace) {
+        return;
+    }
+
+    /* The viewer's pages are not a document; edits cannot happen until it closes */
+    gchar* text = NULL;
+    size_t length = 0;
+    if (!window->viewer) {
+        GtkTextIter start, end;
+        gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
+        text = gtk_text_buffer_get_slice(window->text_buffer, &start, &end, TRUE);
+        length = strlen(text);
+    }
+
+    LineIndex* lines = line_index_create();
+    if (!lines || (length > 0 && !line_index_append(lines, text, length))) {
+        line_index_destroy(lines);
+        g_free(text);
+        abandon_edit_trace(window);
+        return;
+    }
+
+    line_index_destroy(window->edit_trace_lines);
+    window->edit_trace_lines = lines;
+    record_edit(window, EDIT_TRACE_SET, 0, text, length);
+    g_free(text);
+}
+
 /**
  * @brief Creates the menu bar
  */
@@ -87,41 +420,85 @@ static GtkWidget* create_menu_bar(MainWindow* window) {
     GtkWidget* edit_menu = gtk_menu_new();
     GtkWidget* edit_item = gtk_menu_item_new_with_label("Edit");
 
+    GtkWidget* undo_item = gtk_menu_item_new_with_label("Undo");
+    GtkWidget* redo_item = gtk_menu_item_new_with_label("Redo");
     GtkWidget* cut_item = gtk_menu_item_new_with_label("Cut");
     GtkWidget* copy_item = gtk_menu_item_new_with_label("Copy");
     GtkWidget* paste_item = gtk_menu_item_new_with_label("Paste");
     GtkWidget* select_all_item = gtk_menu_item_new_with_label("Select All");
-
+    GtkWidget* find_item = gtk_menu_item_new_with_label("Find...");
+    GtkWidget* find_next_item = gtk_menu_item_new_with_label("Find Next");
+    GtkWidget* find_previous_item = gtk_menu_item_new_with_label("Find Previous");
+    GtkWidget* replace_item = gtk_menu_item_new_with_label("Replace...");
+    GtkWidget* goto_line_item = gtk_menu_item_new_with_label("Go to Line...");
+
+    gtk_widget_add_accelerator(undo_item, "activate", window->accel_group,
+                               GDK_KEY_z, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(redo_item, "activate", window->accel_group,
+                               GDK_KEY_z, GDK_CONTROL_MASK | GDK_SHIFT_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(find_item, "activate", window->accel_group,
+                               GDK_KEY_f, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(find_next_item, "activate", window->accel_group,
+                               GDK_KEY_g, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(find_previous_item, "activate", window->accel_group,
+                               GDK_KEY_g, GDK_CONTROL_MASK | GDK_SHIFT_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(replace_item, "activate", window->accel_group,
+                               GDK_KEY_h, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(goto_line_item, "activate", window->accel_group,
+                               GDK_KEY_l, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), undo_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), redo_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), gtk_separator_menu_item_new());
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), cut_item);
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), copy_item);
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), paste_item);
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), gtk_separator_menu_item_new());
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), select_all_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), gtk_separator_menu_item_new());
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), find_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), find_next_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), find_previous_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), replace_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), goto_line_item);
 
     gtk_menu_item_set_submenu(GTK_MENU_ITEM(edit_item), edit_menu);
     gtk_menu_shell_append(GTK_MENU_SHELL(menu_bar), edit_item);
 
+    g_signal_connect(undo_item, "activate", G_CALLBACK(on_undo_activated), window);
+    g_signal_connect(redo_item, "activate", G_CALLBACK(on_redo_activated), window);
     g_signal_connect(cut_item, "activate", G_CALLBACK(on_cut_activated), window);
     g_signal_connect(copy_item, "activate", G_CALLBACK(on_copy_activated), window);
     g_signal_connect(paste_item, "activate", G_CALLBACK(on_paste_activated), window);
     g_signal_connect(select_all_item, "activate", G_CALLBACK(on_select_all_activated), window);
+    g_signal_connect(find_item, "activate", G_CALLBACK(on_find_activated), window);
+    g_signal_connect(find_next_item, "activate", G_CALLBACK(on_find_next_activated), window);
+    g_signal_connect(find_previous_item, "activate", G_CALLBACK(on_find_previous_activated), window);
+    g_signal_connect(replace_item, "activate", G_CALLBACK(on_replace_activated), window);
+    g_signal_connect(goto_line_item, "activate", G_CALLBACK(on_goto_line_activated), window);
 
     /* View menu */
     GtkWidget* view_menu = gtk_menu_new();
     GtkWidget* view_item = gtk_menu_item_new_with_label("View");
 
     GtkWidget* toggle_theme_item = gtk_menu_item_new_with_label("Toggle Theme");
+    GtkWidget* debug_overlay_item = gtk_check_menu_item_new_with_label("Debug Overlay");
 
-    /* Add keyboard shortcut */
+    /* Add keyboard shortcuts */
     gtk_widget_add_accelerator(toggle_theme_item, "activate", window->accel_group,
                                GDK_KEY_t, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+    gtk_widget_add_accelerator(debug_overlay_item, "activate", window->accel_group,
+                               GDK_KEY_d, GDK_CONTROL_MASK | GDK_SHIFT_MASK, GTK_ACCEL_VISIBLE);
 
     gtk_menu_shell_append(GTK_MENU_SHELL(view_menu), toggle_theme_item);
+    gtk_menu_shell_append(GTK_MENU_SHELL(view_menu), gtk_separator_menu_item_new());
+    gtk_menu_shell_append(GTK_MENU_SHELL(view_menu), debug_overlay_item);
 
     gtk_menu_item_set_submenu(GTK_MENU_ITEM(view_item), view_menu);
     gtk_menu_shell_append(GTK_MENU_SHELL(menu_bar), view_item);
 
     g_signal_connect(toggle_theme_item, "activate", G_CALLBACK(on_toggle_theme_activated), window);
+    g_signal_connect(debug_overlay_item, "toggled", G_CALLBACK(on_debug_overlay_toggled), window);
 
     /* Help menu */
     GtkWidget* help_menu = gtk_menu_new();
@@ -139,6 +516,136 @@ static GtkWidget* create_menu_bar(MainWindow* window) {
     return menu_bar;
 }
 
+/**
+ * @brief Creates the progress bar of loads and large pastes, hidden until one starts
+ */
+static GtkWidget* create_progress_box(MainWindow* window) {
+    GtkWidget* box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_container_set_border_width(GTK_CONTAINER(box), 4);
+
+    window->progress_bar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(window->progress_bar), TRUE);
+    gtk_widget_set_valign(window->progress_bar, GTK_ALIGN_CENTER);
+    gtk_box_pack_start(GTK_BOX(box), window->progress_bar, TRUE, TRUE, 0);
+
+    GtkWidget* cancel_button = gtk_button_new_with_label("Cancel");
+    gtk_box_pack_start(GTK_BOX(box), cancel_button, FALSE, FALSE, 0);
+    g_signal_connect(cancel_button, "clicked", G_CALLBACK(on_cancel_progress_clicked), window);
+
+    /* Keep it out of gtk_widget_show_all(); shown only while loading or pasting */
+    gtk_widget_show_all(box);
+    gtk_widget_set_no_show_all(box, TRUE);
+    gtk_widget_hide(box);
+
+    return box;
+}
+
+/**
+ * @brief Creates the status bar showing the cursor position
+ */
+static GtkWidget* create_status_bar(MainWindow* window) {
+    GtkWidget* box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_container_set_border_width(GTK_CONTAINER(box), 2);
+
+    window->status_label = gtk_label_new("Ln 1, Col 1");
+    gtk_box_pack_end(GTK_BOX(box), window->status_label, FALSE, FALSE, 6);
+
+    window->encoding_label = gtk_label_new(encoding_get_name(TEXT_ENCODING_UTF8));
+    gtk_box_pack_end(GTK_BOX(box), window->encoding_label, FALSE, FALSE, 6);
+
+    return box;
+}
+
+/**
+ * @brief Sets the encoding saves are written in and shows it
+ */
+static void set_file_encoding(MainWindow* window, TextEncoding encoding) {
+    window->file_encoding = encoding;
+    gtk_label_set_text(GTK_LABEL(window->encoding_label), encoding_get_name(encoding));
+}
+
+/**
+ * @brief Shows the cursor line and column in the status bar
+ */
+static void update_cursor_position(MainWindow* window) {
+    size_t line;
+    size_t column;
+
+    if (window->viewer) {
+        if (!large_file_viewer_get_cursor_position(window->viewer, &line, &column)) {
+            gtk_label_set_text(GTK_LABEL(window->status_label), "Ln ?, Col ?");
+            return;
+        }
+    } else {
+        GtkTextIter iter;
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &iter,
+                                         gtk_text_buffer_get_insert(window->text_buffer));
+        line = (size_t)gtk_text_iter_get_line(&iter);
+        column = (size_t)gtk_text_iter_get_line_offset(&iter);
+    }
+
+    gchar* text = g_strdup_printf("Ln %zu, Col %zu", line + 1, column + 1);
+    gtk_label_set_text(GTK_LABEL(window->status_label), text);
+    g_free(text);
+}
+
+/**
+ * @brief Creates the find bar, hidden until Find is chosen
+ */
+static GtkWidget* create_find_bar(MainWindow* window) {
+    GtkWidget* box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_container_set_border_width(GTK_CONTAINER(box), 4);
+
+    window->find_entry = gtk_search_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(window->find_entry), "Find");
+    gtk_box_pack_start(GTK_BOX(box), window->find_entry, TRUE, TRUE, 0);
+
+    GtkWidget* previous_button = gtk_button_new_with_label("Previous");
+    GtkWidget* next_button = gtk_button_new_with_label("Next");
+    gtk_box_pack_start(GTK_BOX(box), previous_button, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(box), next_button, FALSE, FALSE, 0);
+
+    window->replace_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(window->replace_entry), "Replace with");
+    gtk_box_pack_start(GTK_BOX(box), window->replace_entry, TRUE, TRUE, 0);
+
+    GtkWidget* replace_all_button = gtk_button_new_with_label("Replace All");
+    gtk_box_pack_start(GTK_BOX(box), replace_all_button, FALSE, FALSE, 0);
+
+    window->find_case_check = gtk_check_button_new_with_label("Match case");
+    window->find_word_check = gtk_check_button_new_with_label("Whole word");
+    window->find_regex_check = gtk_check_button_new_with_label("Regex");
+    gtk_box_pack_start(GTK_BOX(box), window->find_case_check, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(box), window->find_word_check, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(box), window->find_regex_check, FALSE, FALSE, 0);
+
+    window->find_status_label = gtk_label_new(NULL);
+    gtk_box_pack_start(GTK_BOX(box), window->find_status_label, FALSE, FALSE, 0);
+
+    GtkWidget* close_button = gtk_button_new_from_icon_name("window-close-symbolic", GTK_ICON_SIZE_MENU);
+    gtk_button_set_relief(GTK_BUTTON(close_button), GTK_RELIEF_NONE);
+    gtk_box_pack_end(GTK_BOX(box), close_button, FALSE, FALSE, 0);
+
+    g_signal_connect(window->find_entry, "search-changed", G_CALLBACK(on_find_changed), window);
+    g_signal_connect(window->find_entry, "activate", G_CALLBACK(on_find_next_activated), window);
+    g_signal_connect(window->find_entry, "next-match", G_CALLBACK(on_find_next_activated), window);
+    g_signal_connect(window->find_entry, "previous-match", G_CALLBACK(on_find_previous_activated), window);
+    g_signal_connect(window->find_entry, "stop-search", G_CALLBACK(on_find_close), window);
+    g_signal_connect(window->find_case_check, "toggled", G_CALLBACK(on_find_changed), window);
+    g_signal_connect(window->find_word_check, "toggled", G_CALLBACK(on_find_changed), window);
+    g_signal_connect(window->find_regex_check, "toggled", G_CALLBACK(on_find_changed), window);
+    g_signal_connect(previous_button, "clicked", G_CALLBACK(on_find_previous_activated), window);
+    g_signal_connect(next_button, "clicked", G_CALLBACK(on_find_next_activated), window);
+    g_signal_connect(replace_all_button, "clicked", G_CALLBACK(on_replace_all_clicked), window);
+    g_signal_connect(close_button, "clicked", G_CALLBACK(on_find_close), window);
+
+    gtk_widget_show_all(box);
+    gtk_widget_set_no_show_all(box, TRUE);
+    gtk_widget_hide(box);
+
+    return box;
+}
+
 MainWindow* main_window_create(Application* app) {
     if (!app) {
         return NULL;
@@ -150,13 +657,105 @@ MainWindow* main_window_create(Application* app) {
     }
 
     window->app = app;
+    window->loader = NULL;
+    window->loader_source = 0;
+    window->loader_starved = false;
+    window->loader_placed_cursor = false;
+    window->save_poll_source = 0;
+    window->sync_policy = FILE_SYNC_DATA;
+    window->edit_generation = 0;
+    window->viewer = NULL;
+    window->viewer_check_source = 0;
+    window->large_file_threshold = DEFAULT_LARGE_FILE_THRESHOLD;
+    window->file_encoding = TEXT_ENCODING_UTF8;
     window->ignore_buffer_changes = false;
+    window->clipboard_data = NULL;
+    window->paste_request = NULL;
+    window->paste = NULL;
+    window->find_pattern = NULL;
+    window->find_count_stale = false;
+    window->count_task = 0;
+    window->search_bytes = NULL;
+    window->search_lines = NULL;
+    window->regex_search = NULL;
+    window->regex_poll_source = 0;
+    window->regex_matches = NULL;
+    window->regex_pending = FIND_PENDING_NONE;
+    window->regex_pending_offset = 0;
+    window->applying_history = false;
+    window->recovery = NULL;
+    window->recovery_path = NULL;
+    window->edit_trace = NULL;
+    window->edit_trace_lines = NULL;
+    window->edit_trace_failed = false;
+    window->change_tick = 0;
+    window->char_count = 0;
+    window->replace_job = 0;
+    window->debug_overlay_source = 0;
+    window->frame_clock = NULL;
+    window->before_paint_handler = 0;
+    window->after_paint_handler = 0;
+    window->paint_start = 0;
+    window->first_frame_drawn = false;
+    window->open_span = 0;
+
+    window->saver = file_saver_create();
+    if (!window->saver) {
+        free(window);
+        return NULL;
+    }
+
+    window->history = history_create(HISTORY_BUDGET);
+    if (!window->history) {
+        file_saver_destroy(window->saver);
+        free(window);
+        return NULL;
+    }
+
+    window->change_notifier = change_notifier_create();
+    if (!window->change_notifier) {
+        history_destroy(window->history);
+        file_saver_destroy(window->saver);
+        free(window);
+        return NULL;
+    }
+
+    window->workers = worker_pool_create(0, dispatch_worker_job, withdraw_worker_job, NULL);
+    if (!window->workers) {
+        change_notifier_destroy(window->change_notifier);
+        history_destroy(window->history);
+        file_saver_destroy(window->saver);
+        free(window);
+        return NULL;
+    }
+
+    /* Without a journal the editor still works, it just cannot recover */
+    gchar* journal_directory = get_journal_directory();
+    gchar* journal_path = g_strdup_printf("%s/%d.journal", journal_directory, (int)getpid());
+    window->journal = g_mkdir_with_parents(journal_directory, 0700) == 0 ?
+                      journal_open(journal_path, JOURNAL_FLUSH_INTERVAL_MS) : NULL;
+    window->save_journal_marks = g_array_new(FALSE, FALSE, sizeof(guint64));
+    g_free(journal_path);
+    g_free(journal_directory);
 
     /* Create main window */
     window->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_title(GTK_WINDOW(window->window), "Notebook - Untitled");
     gtk_window_set_default_size(GTK_WINDOW(window->window), 800, 600);
 
+    window->scheduler = task_scheduler_create(window->window, TASK_FRAME_BUDGET_US);
+    if (!window->scheduler) {
+        gtk_widget_destroy(window->window);
+        journal_close(window->journal, true);
+        g_array_free(window->save_journal_marks, TRUE);
+        worker_pool_destroy(window->workers);
+        change_notifier_destroy(window->change_notifier);
+        history_destroy(window->history);
+        file_saver_destroy(window->saver);
+        free(window);
+        return NULL;
+    }
+
     /* Create and attach accelerator group */
     window->accel_group = gtk_accel_group_new();
     gtk_window_add_accel_group(GTK_WINDOW(window->window), window->accel_group);
@@ -164,17 +763,35 @@ MainWindow* main_window_create(Application* app) {
     /* Create main container */
     GtkWidget* vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
     gtk_container_add(GTK_CONTAINER(window->window), vbox);
+    window->content_box = vbox;
 
     /* Create menu bar */
+    uint64_t span = trace_begin();
     GtkWidget* menu_bar = create_menu_bar(window);
     gtk_box_pack_start(GTK_BOX(vbox), menu_bar, FALSE, FALSE, 0);
+    trace_end("create_menu_bar", span);
+
+    /* The debug overlay floats over the editor's top right corner */
+    GtkWidget* overlay = gtk_overlay_new();
+    gtk_box_pack_start(GTK_BOX(vbox), overlay, TRUE, TRUE, 0);
+
+    window->debug_overlay = gtk_label_new(NULL);
+    gtk_widget_set_halign(window->debug_overlay, GTK_ALIGN_END);
+    gtk_widget_set_valign(window->debug_overlay, GTK_ALIGN_START);
+    gtk_widget_set_margin_top(window->debug_overlay, 6);
+    gtk_widget_set_margin_end(window->debug_overlay, 18);
+    gtk_style_context_add_class(gtk_widget_get_style_context(window->debug_overlay),
+                                GTK_STYLE_CLASS_OSD);
+    gtk_widget_set_no_show_all(window->debug_overlay, TRUE);
+    gtk_overlay_add_overlay(GTK_OVERLAY(overlay), window->debug_overlay);
+    gtk_overlay_set_overlay_pass_through(GTK_OVERLAY(overlay), window->debug_overlay, TRUE);
 
     /* Create scrolled window for text view */
     GtkWidget* scrolled = gtk_scrolled_window_new(NULL, NULL);
     gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scrolled),
                                    GTK_POLICY_AUTOMATIC,
                                    GTK_POLICY_AUTOMATIC);
-    gtk_box_pack_start(GTK_BOX(vbox), scrolled, TRUE, TRUE, 0);
+    gtk_container_add(GTK_CONTAINER(overlay), scrolled);
 
     /* Create source view with line numbers */
     window->text_view = gtk_source_view_new();
@@ -185,39 +802,55 @@ MainWindow* main_window_create(Application* app) {
     gtk_text_view_set_monospace(GTK_TEXT_VIEW(window->text_view), TRUE);
     gtk_container_add(GTK_CONTAINER(scrolled), window->text_view);
 
+    /* Create status bar and load progress bar below the editor */
+    gtk_box_pack_end(GTK_BOX(vbox), create_status_bar(window), FALSE, FALSE, 0);
+    window->find_bar = create_find_bar(window);
+    gtk_box_pack_end(GTK_BOX(vbox), window->find_bar, FALSE, FALSE, 0);
+    window->progress_box = create_progress_box(window);
+    gtk_box_pack_end(GTK_BOX(vbox), window->progress_box, FALSE, FALSE, 0);
+
     /* Get text buffer */
     window->text_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(window->text_view));
+    window->nul_tag = gtk_text_buffer_create_tag(window->text_buffer, NULL, NULL);
 
-    /* Add custom style scheme directory */
-    GtkSourceStyleSchemeManager* scheme_manager = gtk_source_style_scheme_manager_get_default();
-    const gchar* const* search_paths = gtk_source_style_scheme_manager_get_search_path(scheme_manager);
-    gchar** new_paths = g_new(gchar*, g_strv_length((gchar**)search_paths) + 2);
-    gint i;
-    for (i = 0; search_paths[i] != NULL; i++) {
-        new_paths[i] = g_strdup(search_paths[i]);
-    }
-    new_paths[i] = g_strdup("styles");
-    new_paths[i + 1] = NULL;
-    gtk_source_style_scheme_manager_set_search_path(scheme_manager, new_paths);
-    g_strfreev(new_paths);
-    gtk_source_style_scheme_manager_force_rescan(scheme_manager);
+    /* Undo is kept by the history module, not GtkSourceBuffer */
+    gtk_source_buffer_set_max_undo_levels(GTK_SOURCE_BUFFER(window->text_buffer), 0);
 
-    /* Load custom dark theme */
-    GtkSourceStyleScheme* scheme = gtk_source_style_scheme_manager_get_scheme(scheme_manager, "notebook-dark");
-    if (scheme) {
-        gtk_source_buffer_set_style_scheme(GTK_SOURCE_BUFFER(window->text_buffer), scheme);
-    }
+    /* Themes installed by the user carry a CSS file and a style scheme */
+    span = trace_begin();
+    ThemeManager* theme_manager = application_get_theme_manager(app);
+    gchar* theme_directory = g_build_filename(g_get_user_data_dir(), "notebook", "themes", NULL);
+    theme_manager_load_directory(theme_manager, theme_directory);
+
+    /*
+     * A private scheme manager sees only the built-in schemes, compiled in
+     * as a GResource, and the user's themes; the system scheme directories
+     * are never scanned and nothing depends on the working directory.
+     */
+    gchar* scheme_paths[] = { STYLE_SCHEME_RESOURCE_PATH, theme_directory, NULL };
+    GtkSourceStyleSchemeManager* scheme_manager = gtk_source_style_scheme_manager_new();
+    gtk_source_style_scheme_manager_set_search_path(scheme_manager, scheme_paths);
+    g_free(theme_directory);
+
+    /* Parse every theme's CSS and look up its scheme once; switching only swaps them */
+    window->theme_cache = theme_cache_create(theme_manager, scheme_manager, gdk_screen_get_default());
+    g_object_unref(scheme_manager);
+    theme_cache_add_buffer(window->theme_cache, GTK_SOURCE_BUFFER(window->text_buffer));
+    trace_end("theme setup", span);
 
     /* Connect signals */
     g_signal_connect(window->window, "delete-event", G_CALLBACK(on_window_delete), window);
+    g_signal_connect(window->window, "destroy", G_CALLBACK(on_window_destroy), window);
+    g_signal_connect(window->window, "realize", G_CALLBACK(on_window_realize), window);
+    g_signal_connect(window->window, "unrealize", G_CALLBACK(on_window_unrealize), window);
     g_signal_connect(window->text_buffer, "changed", G_CALLBACK(on_buffer_changed), window);
-
-    /* Setup CSS provider */
-    window->css_provider = gtk_css_provider_new();
-    GdkScreen* screen = gdk_screen_get_default();
-    gtk_style_context_add_provider_for_screen(screen,
-                                              GTK_STYLE_PROVIDER(window->css_provider),
-                                              GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+    g_signal_connect(window->text_buffer, "mark-set", G_CALLBACK(on_mark_set), window);
+    g_signal_connect(window->text_buffer, "insert-text", G_CALLBACK(on_insert_text), window);
+    g_signal_connect(window->text_buffer, "delete-range", G_CALLBACK(on_delete_range), window);
+    g_signal_connect_after(window->text_buffer, "insert-text", G_CALLBACK(on_text_inserted), window);
+    g_signal_connect_after(window->text_buffer, "delete-range", G_CALLBACK(on_range_deleted), window);
+    g_signal_connect(window->text_buffer, "begin-user-action", G_CALLBACK(on_begin_user_action), window);
+    g_signal_connect(window->text_buffer, "end-user-action", G_CALLBACK(on_end_user_action), window);
 
     /* Register application callbacks */
     ApplicationCallbacks callbacks = {
@@ -229,8 +862,10 @@ MainWindow* main_window_create(Application* app) {
     };
     application_register_callbacks(app, &callbacks, window);
 
+    /* The cursor position label only needs refreshing once per frame */
+    change_notifier_subscribe(window->change_notifier, on_text_changes, window);
+
     /* Register theme change callback */
-    ThemeManager* theme_manager = application_get_theme_manager(app);
     theme_manager_register_callback(theme_manager, on_theme_changed, window);
 
     /* Apply initial theme */
@@ -244,6 +879,68 @@ void main_window_destroy(MainWindow* window) {
         return;
     }
 
+    if (window->loader_source) {
+        g_source_remove(window->loader_source);
+    }
+    file_loader_destroy(window->loader);
+
+    /* Blocks until queued saves are on disk */
+    if (window->save_poll_source) {
+        g_source_remove(window->save_poll_source);
+    }
+    file_saver_destroy(window->saver);
+
+    /* A regex search may be reading the viewer's mapping */
+    if (window->regex_poll_source) {
+        g_source_remove(window->regex_poll_source);
+    }
+    regex_search_destroy(window->regex_search);
+    if (window->regex_matches) {
+        g_array_free(window->regex_matches, TRUE);
+    }
+
+    /* Normally closed from on_window_destroy while widgets still exist;
+     * its line counting jobs are cancelled on the pool */
+    if (window->viewer_check_source) {
+        g_source_remove(window->viewer_check_source);
+    }
+    large_file_viewer_destroy(window->viewer);
+
+    /* Waits for running jobs; their results are dropped */
+    worker_pool_destroy(window->workers);
+
+    task_scheduler_destroy(window->scheduler);
+    search_pattern_destroy(window->find_pattern);
+    if (window->search_bytes) {
+        g_bytes_unref(window->search_bytes);
+    }
+    line_index_destroy(window->search_lines);
+    history_destroy(window->history);
+    change_notifier_destroy(window->change_notifier);
+    theme_cache_destroy(window->theme_cache);
+
+    /* A clean exit leaves nothing to recover */
+    journal_close(window->journal, true);
+    g_array_free(window->save_journal_marks, TRUE);
+    journal_recovery_close(window->recovery);
+    g_free(window->recovery_path);
+    main_window_stop_recording(window);
+
+    /* A clipboard reply still to come finds no window */
+    if (window->paste_request) {
+        window->paste_request->window = NULL;
+    }
+    if (window->paste) {
+        clipboard_data_unref(window->paste->content);
+        g_free(window->paste);
+    }
+
+    /* The clipboard would otherwise call back into the freed window;
+     * gtk_main() has already handed our content to a clipboard manager */
+    if (window->clipboard_data) {
+        gtk_clipboard_clear(gtk_clipboard_get(GDK_SELECTION_CLIPBOARD));
+    }
+
     /* GTK widgets are destroyed with the window */
     free(window);
 }
@@ -272,6 +969,22 @@ GtkWidget* main_window_get_text_view(const MainWindow* window) {
     return window->text_view;
 }
 
+WorkerPool* main_window_get_worker_pool(const MainWindow* window) {
+    if (!window) {
+        return NULL;
+    }
+
+    return window->workers;
+}
+
+ChangeNotifier* main_window_get_change_notifier(const MainWindow* window) {
+    if (!window) {
+        return NULL;
+    }
+
+    return window->change_notifier;
+}
+
 void main_window_update_title(MainWindow* window, const char* file_path, bool modified) {
     if (!window) {
         return;
@@ -309,293 +1022,2382 @@ void main_window_set_text(MainWindow* window, const char* text) {
         return;
     }
 
+    stop_paste(window, false);
+
     window->ignore_buffer_changes = true;
     gtk_text_buffer_set_text(window->text_buffer, text, -1);
     window->ignore_buffer_changes = false;
+
+    history_clear(window->history);
+    record_edit_base(window);
 }
 
-void main_window_apply_theme(MainWindow* window) {
-    if (!window) {
-        return;
-    }
+/**
+ * @brief Makes one change recorded in the history
+ */
+static void apply_history_change(const HistoryChange* change, void* user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+    bool had_nuls = buffer_text_has_nuls(window->text_buffer, window->nul_tag);
 
-    ThemeManager* theme_manager = application_get_theme_manager(window->app);
-    const char* css = theme_manager_get_css(theme_manager);
-    ThemeType current_theme = theme_manager_get_current(theme_manager);
+    GtkTextIter start, end;
+    gtk_text_buffer_get_iter_at_offset(window->text_buffer, &start, (gint)change->offset);
+    end = start;
+    gtk_text_iter_forward_chars(&end, (gint)change->removed_span);
+    gtk_text_buffer_delete(window->text_buffer, &start, &end);
+    gtk_text_buffer_insert(window->text_buffer, &start, change->inserted, (gint)change->inserted_length);
+
+    /* Restored text comes back untagged, like Replace All's */
+    if (had_nuls && change->inserted_length > 0) {
+        GtkTextIter from;
+        gtk_text_buffer_get_iter_at_offset(window->text_buffer, &from, (gint)change->offset);
+        buffer_text_mark_nuls(window->text_buffer, &from, &start, window->nul_tag);
+    }
 
-    gtk_css_provider_load_from_data(window->css_provider, css, -1, NULL);
+    gtk_text_buffer_place_cursor(window->text_buffer, &start);
+}
 
-    /* Update style scheme based on theme */
-    GtkSourceBuffer* source_buffer = GTK_SOURCE_BUFFER(window->text_buffer);
-    GtkSourceStyleSchemeManager* scheme_manager = gtk_source_style_scheme_manager_get_default();
+/**
+ * @brief Applies an edit read back from a journal
+ */
+static void apply_recovered_edit(const JournalEdit* edit, void* user_data) {
+    HistoryChange change = {
+        .offset = (size_t)edit->offset,
+        .removed_span = (size_t)edit->removed_span,
+        .inserted = edit->inserted,
+        .inserted_length = edit->inserted_length,
+        .inserted_span = (size_t)edit->inserted_span
+    };
+    apply_history_change(&change, user_data);
+}
 
-    const char* scheme_name = (current_theme == THEME_DARK) ? "notebook-dark" : "notebook-light";
-    GtkSourceStyleScheme* scheme = gtk_source_style_scheme_manager_get_scheme(scheme_manager, scheme_name);
+/**
+ * @brief Forgets a pending recovery
+ * @param remove true to delete the old journal, false to offer it again next start
+ */
+static void drop_recovery(MainWindow* window, bool remove) {
+    if (!window->recovery) {
+        return;
+    }
 
-    if (scheme) {
-        gtk_source_buffer_set_style_scheme(source_buffer, scheme);
+    if (remove) {
+        g_unlink(window->recovery_path);
     }
+    journal_recovery_close(window->recovery);
+    g_free(window->recovery_path);
+    window->recovery = NULL;
+    window->recovery_path = NULL;
 }
 
-void main_window_show_error(MainWindow* window, const char* message) {
-    if (!window || !message) {
-        return;
-    }
+/**
+ * @brief Replays the recovered edits onto the freshly loaded base
+ *
+ * The replayed edits go into the new journal like any other edit, so the
+ * old journal can be deleted. They are not undo steps.
+ */
+static void finish_recovery(MainWindow* window) {
+    window->applying_history = true;
+    journal_recovery_replay(window->recovery, apply_recovered_edit, window);
+    window->applying_history = false;
 
-    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
-                                               GTK_DIALOG_MODAL,
-                                               GTK_MESSAGE_ERROR,
-                                               GTK_BUTTONS_OK,
-                                               "%s", message);
-    gtk_dialog_run(GTK_DIALOG(dialog));
-    gtk_widget_destroy(dialog);
+    drop_recovery(window, true);
 }
 
-bool main_window_confirm(MainWindow* window, const char* message) {
-    if (!window || !message) {
-        return false;
-    }
+static gboolean on_worker_job_done(gpointer job) {
+    worker_pool_deliver((WorkerJob*)job);
+    return G_SOURCE_REMOVE;
+}
 
-    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
-                                               GTK_DIALOG_MODAL,
-                                               GTK_MESSAGE_QUESTION,
-                                               GTK_BUTTONS_YES_NO,
-                                               "%s", message);
-    gint result = gtk_dialog_run(GTK_DIALOG(dialog));
-    gtk_widget_destroy(dialog);
+/**
+ * @brief Hands a finished pool job to the main loop (called on a worker)
+ *
+ * Always through an idle source: g_main_context_invoke() would run the
+ * delivery on the worker whenever the main thread is outside the loop.
+ */
+static void dispatch_worker_job(WorkerJob* job, void* dispatch_data) {
+    (void)dispatch_data;
+    g_idle_add_full(G_PRIORITY_DEFAULT, on_worker_job_done, job, NULL);
+}
 
-    return result == GTK_RESPONSE_YES;
+/**
+ * @brief Removes the idle source of a job the pool frees undelivered
+ */
+static void withdraw_worker_job(WorkerJob* job, void* dispatch_data) {
+    (void)dispatch_data;
+    g_idle_remove_by_data(job);
 }
 
-char* main_window_choose_file_open(MainWindow* window) {
-    if (!window) {
-        return NULL;
+/**
+ * @brief (Re)arms the loader callback as an idle or a poll timeout
+ */
+static void schedule_loader_tick(MainWindow* window, bool starved) {
+    window->loader_starved = starved;
+    if (starved) {
+        window->loader_source = g_timeout_add(LOADER_POLL_INTERVAL_MS, on_loader_tick, window);
+    } else {
+        window->loader_source = g_idle_add(on_loader_tick, window);
     }
+}
 
-    GtkWidget* dialog = gtk_file_chooser_dialog_new("Open File",
-                                                     GTK_WINDOW(window->window),
-                                                     GTK_FILE_CHOOSER_ACTION_OPEN,
-                                                     "_Cancel", GTK_RESPONSE_CANCEL,
-                                                     "_Open", GTK_RESPONSE_ACCEPT,
+/**
+ * @brief Updates the progress bar from the loader counters
+ */
+static void update_load_progress(MainWindow* window) {
+    size_t total = file_loader_get_total_size(window->loader);
+    size_t done = file_loader_get_bytes_read(window->loader);
+    const char* path = file_loader_get_path(window->loader);
+    const char* last_slash = strrchr(path, '/');
+    const char* filename = last_slash ? last_slash + 1 : path;
+
+    char text[512];
+    if (total > 0) {
+        double fraction = (double)done / (double)total;
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(window->progress_bar), fraction);
+        snprintf(text, sizeof(text), "Loading %s... %d%%", filename, (int)(fraction * 100.0));
+    } else {
+        gtk_progress_bar_pulse(GTK_PROGRESS_BAR(window->progress_bar));
+        snprintf(text, sizeof(text), "Loading %s... %zu KB", filename, done / 1024);
+    }
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(window->progress_bar), text);
+}
+
+/**
+ * @brief Stops the current load and restores the editor to an editable state
+ * @return Result reported by the loader
+ */
+static FileOperationResult stop_loading(MainWindow* window) {
+    if (window->loader_source) {
+        g_source_remove(window->loader_source);
+        window->loader_source = 0;
+    }
+
+    FileOperationResult result = file_loader_get_result(window->loader);
+    file_loader_destroy(window->loader);
+    window->loader = NULL;
+
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(window->text_view), TRUE);
+    gtk_widget_hide(window->progress_box);
+
+    return result;
+}
+
+/**
+ * @brief Completes a load: updates the document or reports the failure
+ */
+static void finish_loading(MainWindow* window) {
+    char* path = g_strdup(file_loader_get_path(window->loader));
+    TextEncoding encoding = file_loader_get_encoding(window->loader);
+    bool lossy = file_loader_is_lossy(window->loader);
+    FileOperationResult result = stop_loading(window);
+
+    if (result != FILE_OP_SUCCESS) {
+        drop_recovery(window, false);
+        application_new_document(window->app);
+        main_window_show_error(window, file_operations_get_error_message(result));
+        g_free(path);
+        return;
+    }
+
+    /* The buffer is the source of truth; the document only tracks file state */
+    Document* doc = application_get_document(window->app);
+    document_set_file_path(doc, path);
+    document_mark_saved(doc);
+    rebase_journal(window, path);
+    record_edit_base(window);
+
+    set_file_encoding(window, encoding);
+    main_window_update_title(window, path, false);
+
+    if (window->recovery) {
+        finish_recovery(window);
+    }
+
+    trace_end("open", window->open_span);
+    window->open_span = 0;
+
+    if (lossy) {
+        gchar* message = g_strdup_printf("%s is not valid %s. Invalid bytes are shown as U+FFFD "
+                                         "and will be saved that way.", path, encoding_get_name(encoding));
+        main_window_show_error(window, message);
+        g_free(message);
+    }
+    g_free(path);
+}
+
+/**
+ * @brief Drops the buffer snapshot used by find
+ */
+static void release_search_text(MainWindow* window) {
+    if (!window->search_bytes) {
+        return;
+    }
+
+    g_bytes_unref(window->search_bytes);
+    line_index_destroy(window->search_lines);
+    window->search_bytes = NULL;
+    window->search_lines = NULL;
+    window->find_count_stale = true;
+}
+
+/**
+ * @brief Stops a running regex search and forgets its matches
+ */
+static void stop_regex_search(MainWindow* window) {
+    if (window->regex_poll_source) {
+        g_source_remove(window->regex_poll_source);
+        window->regex_poll_source = 0;
+    }
+
+    regex_search_destroy(window->regex_search);
+    window->regex_search = NULL;
+
+    if (window->regex_matches) {
+        g_array_free(window->regex_matches, TRUE);
+        window->regex_matches = NULL;
+    }
+
+    window->regex_pending = FIND_PENDING_NONE;
+}
+
+/**
+ * @brief Literal match count spread over frames by the task scheduler
+ */
+typedef struct {
+    MainWindow* window;
+    guint id;
+    GBytes* text;       /* Snapshot being counted */
+    size_t position;    /* Where the next slice resumes */
+    size_t counted_to;  /* End of the slices counted so far */
+    size_t count;
+} MatchCount;
+
+static void free_match_count(gpointer data) {
+    MatchCount* count = (MatchCount*)data;
+
+    if (count->id != 0 && count->window->count_task == count->id) {
+        count->window->count_task = 0;
+    }
+    g_bytes_unref(count->text);
+    g_free(count);
+}
+
+/**
+ * @brief Stops counting literal matches
+ */
+static void stop_find_count(MainWindow* window) {
+    if (window->count_task) {
+        task_scheduler_cancel(window->scheduler, window->count_task);
+        window->count_task = 0;
+    }
+}
+
+/**
+ * @brief Forgets find results that no longer describe the text
+ */
+static void invalidate_find_results(MainWindow* window) {
+    if (window->replace_job) {
+        worker_pool_cancel(window->workers, window->replace_job);
+        window->replace_job = 0;
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+    }
+
+    if (window->count_task) {
+        stop_find_count(window);
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+    }
+
+    if (window->regex_matches) {
+        stop_regex_search(window);
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+    }
+
+    release_search_text(window);
+}
+
+/**
+ * @brief Gets the bytes find operates on
+ *
+ * The viewer's mapped file is searched in place. An editable buffer is
+ * copied once per edit and the copy is shared by every query until the
+ * next change.
+ */
+static const char* get_search_text(MainWindow* window, size_t* length) {
+    if (window->viewer) {
+        const FileMapping* mapping = large_file_viewer_get_mapping(window->viewer);
+        *length = file_mapping_get_size(mapping);
+        return file_mapping_get_data(mapping);
+    }
+
+    if (!window->search_bytes) {
+        GtkTextIter start, end;
+        gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
+        char* text = gtk_text_buffer_get_text(window->text_buffer, &start, &end, TRUE);
+        size_t text_length = strlen(text);
+
+        LineIndex* lines = line_index_create();
+        if (!lines || !line_index_append(lines, text, text_length)) {
+            line_index_destroy(lines);
+            g_free(text);
+            *length = 0;
+            return NULL;
+        }
+
+        window->search_bytes = g_bytes_new_take(text, text_length);
+        window->search_lines = lines;
+    }
+
+    gsize size;
+    const char* data = (const char*)g_bytes_get_data(window->search_bytes, &size);
+    *length = size;
+    return data ? data : "";
+}
+
+/**
+ * @brief Converts a buffer position to a byte offset in the search snapshot
+ */
+static size_t iter_to_search_offset(const MainWindow* window, const GtkTextIter* iter) {
+    return line_index_get_line_start(window->search_lines, (size_t)gtk_text_iter_get_line(iter)) +
+           (size_t)gtk_text_iter_get_line_index(iter);
+}
+
+/**
+ * @brief Converts a byte offset in the search snapshot to a buffer position
+ */
+static void search_offset_to_iter(const MainWindow* window, size_t offset, GtkTextIter* iter) {
+    size_t line = line_index_get_line_at_offset(window->search_lines, offset);
+    size_t line_index = offset - line_index_get_line_start(window->search_lines, line);
+
+    gtk_text_buffer_get_iter_at_line(window->text_buffer, iter, (gint)line);
+    if (line_index > (size_t)gtk_text_iter_get_bytes_in_line(iter)) {
+        line_index = (size_t)gtk_text_iter_get_bytes_in_line(iter);
+    }
+    gtk_text_iter_set_line_index(iter, (gint)line_index);
+}
+
+/**
+ * @brief Reads the search options from the find bar
+ */
+static unsigned int get_find_flags(const MainWindow* window) {
+    unsigned int flags = SEARCH_MATCH_CASE;
+
+    if (!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(window->find_case_check))) {
+        flags |= SEARCH_IGNORE_CASE;
+    }
+    if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(window->find_word_check))) {
+        flags |= SEARCH_WHOLE_WORD;
+    }
+
+    return flags;
+}
+
+/**
+ * @brief Checks whether the find bar is in regex mode
+ */
+static bool is_regex_mode(const MainWindow* window) {
+    return gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(window->find_regex_check));
+}
+
+/**
+ * @brief Shows a match count in the find bar
+ * @param suffix Appended to the count ("+" when capped, "..." while searching)
+ */
+static void show_match_count(MainWindow* window, size_t count, const char* suffix) {
+    gchar* status;
+
+    if (count == 0 && suffix[0] == '\0') {
+        status = g_strdup("No matches");
+    } else {
+        status = g_strdup_printf("%zu%s %s", count, suffix, count == 1 ? "match" : "matches");
+    }
+
+    gtk_label_set_text(GTK_LABEL(window->find_status_label), status);
+    g_free(status);
+}
+
+/**
+ * @brief Counts the next slices of a literal match count, until the deadline
+ */
+static bool count_matches_step(gint64 deadline, gpointer user_data) {
+    MatchCount* count = (MatchCount*)user_data;
+    MainWindow* window = count->window;
+
+    gsize length;
+    const char* text = (const char*)g_bytes_get_data(count->text, &length);
+
+    while (count->counted_to < length && count->count < FIND_COUNT_LIMIT) {
+        count->counted_to = MIN(count->counted_to + FIND_COUNT_SLICE, length);
+        count->count += search_count_matches_step(window->find_pattern, text, length,
+                                                  &count->position, count->counted_to);
+        if (g_get_monotonic_time() >= deadline) {
+            break;
+        }
+    }
+
+    if (count->count >= FIND_COUNT_LIMIT) {
+        show_match_count(window, FIND_COUNT_LIMIT, "+");
+        return false;
+    }
+
+    bool finished = count->counted_to == length;
+    show_match_count(window, count->count, finished ? "" : "...");
+    return !finished;
+}
+
+/**
+ * @brief Shows the number of matches of the current literal pattern
+ *
+ * Only counted for editable buffers; a full pass over a mapped file is
+ * left to explicit searches. The count runs as a scheduler task over the
+ * search snapshot, showing the running total until it completes; an
+ * edit or a new pattern stops it.
+ */
+static void update_find_count(MainWindow* window) {
+    window->find_count_stale = false;
+    stop_find_count(window);
+
+    if (!window->find_pattern || window->viewer) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+        return;
+    }
+
+    size_t length;
+    if (!get_search_text(window, &length)) {
+        show_match_count(window, 0, "");
+        return;
+    }
+
+    MatchCount* count = g_new0(MatchCount, 1);
+    count->window = window;
+    count->text = g_bytes_ref(window->search_bytes);
+
+    /* On failure the scheduler has already freed count */
+    guint id = task_scheduler_add(window->scheduler, TASK_PRIORITY_HIGH, count_matches_step,
+                                  count, free_match_count, &window->edit_generation);
+    if (id == 0) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+        return;
+    }
+
+    count->id = id;
+    window->count_task = id;
+    show_match_count(window, 0, "...");
+}
+
+/**
+ * @brief Selects a match and scrolls it into view
+ */
+static void select_match(MainWindow* window, const SearchMatch* match) {
+    if (window->viewer) {
+        large_file_viewer_select_range(window->viewer, match->start, match->end);
+        return;
+    }
+
+    GtkTextIter start, end;
+    search_offset_to_iter(window, match->start, &start);
+    search_offset_to_iter(window, match->end, &end);
+    gtk_text_buffer_select_range(window->text_buffer, &end, &start);
+    gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(window->text_view),
+                                 gtk_text_buffer_get_insert(window->text_buffer),
+                                 0.0, TRUE, 0.0, 0.5);
+}
+
+/**
+ * @brief Selects the next literal match in a direction, wrapping around
+ * @param offset Where to search from: the selection end going forward,
+ *               its start going backward
+ */
+static void find_literal(MainWindow* window, bool forward, size_t offset) {
+    size_t length;
+    const char* text = get_search_text(window, &length);
+    SearchMatch match;
+    bool found = false;
+
+    if (text && window->find_pattern) {
+        if (forward) {
+            found = search_find_next(window->find_pattern, text, length, offset, &match) ||
+                    search_find_next(window->find_pattern, text, length, 0, &match);
+        } else {
+            found = search_find_previous(window->find_pattern, text, length, offset, &match) ||
+                    search_find_previous(window->find_pattern, text, length, length, &match);
+        }
+    }
+
+    if (!found) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "No matches");
+        return;
+    }
+
+    if (window->viewer) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+    }
+    select_match(window, &match);
+}
+
+/**
+ * @brief Drops a regex search's reference to the buffer snapshot
+ */
+static void release_regex_snapshot(void* data) {
+    g_bytes_unref((GBytes*)data);
+}
+
+/**
+ * @brief Starts a regex search of the current query in the background
+ *
+ * The search holds its own reference to the snapshot (or reads the
+ * viewer's mapping), so edits never wait for it; they cancel it instead.
+ */
+static void start_regex_search(MainWindow* window) {
+    stop_regex_search(window);
+
+    const char* query = gtk_entry_get_text(GTK_ENTRY(window->find_entry));
+    if (query[0] == '\0') {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+        return;
+    }
+
+    size_t length;
+    const char* text = get_search_text(window, &length);
+    if (!text) {
+        return;
+    }
+
+    GBytes* snapshot = window->viewer ? NULL : g_bytes_ref(window->search_bytes);
+    char error[256] = "";
+    window->regex_search = regex_search_start(window->workers, query, get_find_flags(window),
+                                              text, length,
+                                              snapshot ? release_regex_snapshot : NULL,
+                                              snapshot, REGEX_MATCH_LIMIT, error, sizeof(error));
+    if (!window->regex_search) {
+        if (snapshot) {
+            g_bytes_unref(snapshot);
+        }
+        gtk_label_set_text(GTK_LABEL(window->find_status_label),
+                           error[0] != '\0' ? error : "Search failed");
+        return;
+    }
+
+    window->regex_matches = g_array_new(FALSE, FALSE, sizeof(SearchMatch));
+    window->regex_poll_source = g_timeout_add(REGEX_POLL_INTERVAL_MS, on_regex_poll, window);
+    gtk_label_set_text(GTK_LABEL(window->find_status_label), "Searching...");
+}
+
+/**
+ * @brief Selects the regex match next to an offset if it is known yet
+ * @return true if settled (match selected or there is none), false if the
+ *         answer depends on matches that are still being searched for
+ */
+static bool find_regex(MainWindow* window, bool forward, size_t offset) {
+    GArray* matches = window->regex_matches;
+    if (!matches) {
+        return true;
+    }
+
+    /* Matches are ordered and never overlap, so starts and ends both ascend.
+     * Find the first match starting at offset (forward) or the first one
+     * ending after it (backward). */
+    size_t low = 0;
+    size_t high = matches->len;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const SearchMatch* match = &g_array_index(matches, SearchMatch, mid);
+        if (forward ? match->start < offset : match->end <= offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    bool finished = window->regex_search == NULL;
+    const SearchMatch* found = NULL;
+
+    if (forward && low < matches->len) {
+        found = &g_array_index(matches, SearchMatch, low);
+    } else if (!forward && low > 0) {
+        found = &g_array_index(matches, SearchMatch, low - 1);
+    } else if (finished && matches->len > 0) {
+        /* Wrap around */
+        found = &g_array_index(matches, SearchMatch, forward ? 0 : matches->len - 1);
+    }
+
+    if (found) {
+        select_match(window, found);
+        return true;
+    }
+
+    if (finished) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "No matches");
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Gets the selection as byte offsets into the searched text
+ */
+static bool get_search_selection(MainWindow* window, size_t* start, size_t* end) {
+    if (window->viewer) {
+        large_file_viewer_get_selection(window->viewer, start, end);
+        return true;
+    }
+
+    size_t length;
+    if (!get_search_text(window, &length)) {
+        return false;
+    }
+
+    GtkTextIter first, last;
+    gtk_text_buffer_get_selection_bounds(window->text_buffer, &first, &last);
+    *start = iter_to_search_offset(window, &first);
+    *end = iter_to_search_offset(window, &last);
+    return true;
+}
+
+/**
+ * @brief Runs a find in one direction from an offset, in the current mode
+ *
+ * A regex find whose match has not streamed in yet is parked and finished
+ * by on_regex_poll().
+ */
+static void find_from_offset(MainWindow* window, bool forward, size_t offset) {
+    if (!is_regex_mode(window)) {
+        if (window->find_count_stale) {
+            update_find_count(window);
+        }
+        find_literal(window, forward, offset);
+        return;
+    }
+
+    if (!window->regex_matches) {
+        start_regex_search(window);
+    }
+
+    if (window->regex_matches && !find_regex(window, forward, offset)) {
+        window->regex_pending = forward ? FIND_PENDING_FORWARD : FIND_PENDING_BACKWARD;
+        window->regex_pending_offset = offset;
+    }
+}
+
+/**
+ * @brief Runs a find in one direction from the current selection
+ */
+static void find_from_selection(MainWindow* window, bool forward) {
+    if (window->loader || (!window->find_pattern && !is_regex_mode(window))) {
+        return;
+    }
+
+    size_t start, end;
+    if (!get_search_selection(window, &start, &end)) {
+        return;
+    }
+
+    find_from_offset(window, forward, forward ? end : start);
+}
+
+/**
+ * @brief Leaves the read-only paged viewer, if active
+ */
+static void close_viewer(MainWindow* window) {
+    if (!window->viewer) {
+        return;
+    }
+
+    if (window->viewer_check_source) {
+        g_source_remove(window->viewer_check_source);
+        window->viewer_check_source = 0;
+    }
+
+    /* Regex workers may be reading the mapping */
+    invalidate_find_results(window);
+
+    large_file_viewer_destroy(window->viewer);
+    window->viewer = NULL;
+    gtk_source_view_set_show_line_numbers(GTK_SOURCE_VIEW(window->text_view), TRUE);
+}
+
+/**
+ * @brief Opens a file in the read-only paged viewer
+ */
+static void open_in_viewer(MainWindow* window, const char* path) {
+    FileOperationResult result;
+    FileMapping* mapping = file_mapping_open(path, &result);
+    if (!mapping) {
+        main_window_show_error(window, file_operations_get_error_message(result));
+        return;
+    }
+
+    application_new_document(window->app);
+
+    window->viewer = large_file_viewer_create(GTK_TEXT_VIEW(window->text_view), mapping,
+                                              window->workers);
+    if (!window->viewer) {
+        file_mapping_close(mapping);
+        main_window_show_error(window, file_operations_get_error_message(FILE_OP_ERROR_MEMORY));
+        return;
+    }
+
+    window->viewer_check_source = g_timeout_add(VIEWER_CHECK_INTERVAL_MS, on_viewer_check, window);
+
+    /* Buffer line numbers are relative to the window, not the file */
+    gtk_source_view_set_show_line_numbers(GTK_SOURCE_VIEW(window->text_view), FALSE);
+    gtk_box_pack_end(GTK_BOX(window->content_box),
+                     large_file_viewer_get_widget(window->viewer), FALSE, FALSE, 0);
+
+    Document* doc = application_get_document(window->app);
+    document_set_file_path(doc, path);
+    document_mark_saved(doc);
+
+    const char* last_slash = strrchr(path, '/');
+    char title[512];
+    snprintf(title, sizeof(title), "Notebook - %s [read-only]", last_slash ? last_slash + 1 : path);
+    gtk_window_set_title(GTK_WINDOW(window->window), title);
+}
+
+/**
+ * @brief Closes the viewer once its file has been truncated on disk
+ *
+ * Reads past the new end see zeros instead of crashing (see
+ * file_mapping.h), but what the viewer shows is no longer the file.
+ */
+static gboolean on_viewer_check(gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (file_mapping_is_intact(large_file_viewer_get_mapping(window->viewer))) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    window->viewer_check_source = 0;
+    close_viewer(window);
+    application_new_document(window->app);
+    main_window_show_error(window, "The file was truncated on disk while it was open, so it has been closed.");
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Checks whether the editor currently refuses edits
+ */
+static bool is_read_only(const MainWindow* window) {
+    return window->loader || window->viewer || window->paste;
+}
+
+/**
+ * @brief Inputs of a Replace All computed on the worker pool
+ */
+typedef struct {
+    MainWindow* window;
+    GBytes* text;              /* Snapshot to replace in */
+    SearchPattern* pattern;    /* Literal mode: the job's own copy */
+    SearchMatch* matches;      /* Regex mode: copy of the collected matches */
+    size_t match_count;
+    char* replacement;
+    size_t replacement_length;
+} ReplaceJob;
+
+/**
+ * @brief Text produced by a Replace All job
+ */
+typedef struct {
+    char* text;                /* NULL if building it failed */
+    size_t length;
+    size_t count;
+    bool valid;                /* Result is UTF-8 and fits a GtkTextBuffer */
+} ReplaceResult;
+
+static void free_replace_job(void* data) {
+    ReplaceJob* job = (ReplaceJob*)data;
+
+    g_bytes_unref(job->text);
+    search_pattern_destroy(job->pattern);
+    free(job->matches);
+    g_free(job->replacement);
+    g_free(job);
+}
+
+static void free_replace_result(void* data) {
+    ReplaceResult* result = (ReplaceResult*)data;
+
+    free(result->text);
+    g_free(result);
+}
+
+static void* run_replace_job(const WorkerJob* worker_job, void* data) {
+    (void)worker_job;
+    ReplaceJob* job = (ReplaceJob*)data;
+    ReplaceResult* result = g_new0(ReplaceResult, 1);
+
+    gsize length;
+    const char* text = (const char*)g_bytes_get_data(job->text, &length);
+    if (!text) {
+        text = "";
+    }
+
+    if (job->pattern) {
+        result->text = search_replace_all(job->pattern, text, length, job->replacement,
+                                          job->replacement_length, &result->length, &result->count);
+    } else {
+        result->count = job->match_count;
+        result->text = search_replace_matches(text, length, job->matches, job->match_count,
+                                              job->replacement, job->replacement_length,
+                                              &result->length);
+    }
+
+    /* A byte-oriented regex match may cut a multibyte character in half */
+    result->valid = result->text && result->length <= G_MAXINT &&
+                    g_utf8_validate(result->text, (gssize)result->length, NULL);
+
+    return result;
+}
+
+/**
+ * @brief Drops a history or journal reference to shared text
+ */
+static void release_shared_bytes(void* owner) {
+    g_bytes_unref((GBytes*)owner);
+}
+
+/**
+ * @brief Drops a history or journal reference to pasted content
+ */
+static void release_clipboard_data(void* owner) {
+    clipboard_data_unref((ClipboardData*)owner);
+}
+
+/**
+ * @brief Swaps the text built by a Replace All job into the buffer
+ *
+ * The history and the journal keep references to the snapshot and the
+ * result rather than copies, so a replace across a large document stays
+ * undoable and costs the UI thread no extra pass over it.
+ */
+static void complete_replace_job(void* data, void* job_data) {
+    ReplaceResult* result = (ReplaceResult*)data;
+    ReplaceJob* job = (ReplaceJob*)job_data;
+    MainWindow* window = job->window;
+
+    window->replace_job = 0;
+
+    if (!result->text || result->count == 0) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), result->text ? "No matches" : "Replace failed");
+        free_replace_result(result);
+        return;
+    }
+
+    if (!result->valid) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "Replace would produce invalid text");
+        free_replace_result(result);
+        return;
+    }
+
+    GtkTextIter cursor;
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &cursor,
+                                     gtk_text_buffer_get_insert(window->text_buffer));
+    gint line = gtk_text_iter_get_line(&cursor);
+
+    /* Rebuilt text loses its tags; any U+2400 is then taken as a NUL byte */
+    bool had_nuls = buffer_text_has_nuls(window->text_buffer, window->nul_tag);
+
+    GBytes* inserted = g_bytes_new_with_free_func(result->text, result->length, free, result->text);
+    result->text = NULL;
+
+    gsize removed_length;
+    const char* removed = (const char*)g_bytes_get_data(job->text, &removed_length);
+    HistoryChange change = {
+        .offset = 0,
+        .removed = removed ? removed : "",
+        .removed_length = removed_length,
+        .removed_span = (size_t)gtk_text_buffer_get_char_count(window->text_buffer),
+        .inserted = result->length > 0 ? (const char*)g_bytes_get_data(inserted, NULL) : "",
+        .inserted_length = g_bytes_get_size(inserted)
+    };
+
+    /* The snapshot and its matches are dropped by the first "changed" */
+    GtkTextIter start, end;
+    gtk_text_buffer_begin_user_action(window->text_buffer);
+    window->recording_shared = true;
+    gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
+    gtk_text_buffer_delete(window->text_buffer, &start, &end);
+    gtk_text_buffer_insert(window->text_buffer, &start, change.inserted, (gint)change.inserted_length);
+    window->recording_shared = false;
+
+    change.inserted_span = (size_t)gtk_text_buffer_get_char_count(window->text_buffer);
+    journal_record_insert_shared(window->journal, 0, change.inserted, change.inserted_length,
+                                 change.inserted_span, g_bytes_ref(inserted), release_shared_bytes);
+    history_record_shared(window->history, &change, g_bytes_ref(job->text), g_bytes_ref(inserted),
+                          release_shared_bytes);
+    g_bytes_unref(inserted);
+
+    if (had_nuls) {
+        gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
+        buffer_text_mark_nuls(window->text_buffer, &start, &end, window->nul_tag);
+    }
+    gtk_text_buffer_end_user_action(window->text_buffer);
+
+    gtk_text_buffer_get_iter_at_line(window->text_buffer, &cursor, line);
+    gtk_text_buffer_place_cursor(window->text_buffer, &cursor);
+    gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(window->text_view),
+                                 gtk_text_buffer_get_insert(window->text_buffer),
+                                 0.0, TRUE, 0.0, 0.5);
+
+    gchar* status = g_strdup_printf("Replaced %zu %s", result->count,
+                                    result->count == 1 ? "occurrence" : "occurrences");
+    gtk_label_set_text(GTK_LABEL(window->find_status_label), status);
+    g_free(status);
+    free_replace_result(result);
+}
+
+/**
+ * @brief Replaces every match of the query
+ *
+ * The new text is built from the find snapshot in one linear pass on the
+ * worker pool and swapped into the buffer as a single user action, so the
+ * whole replace is one undo step. An edit made meanwhile drops the result.
+ * A regex replace waits for its search to finish.
+ */
+static void replace_all(MainWindow* window) {
+    if (is_read_only(window)) {
+        return;
+    }
+
+    size_t length;
+    if (!get_search_text(window, &length)) {
+        return;
+    }
+
+    SearchPattern* pattern = NULL;
+    SearchMatch* matches = NULL;
+    size_t match_count = 0;
+
+    if (is_regex_mode(window)) {
+        if (!window->regex_matches) {
+            start_regex_search(window);
+        }
+        if (!window->regex_matches) {
+            return;
+        }
+        if (window->regex_search) {
+            window->regex_pending = FIND_PENDING_REPLACE_ALL;
+            return;
+        }
+        if (window->regex_matches->len >= REGEX_MATCH_LIMIT) {
+            gtk_label_set_text(GTK_LABEL(window->find_status_label), "Too many matches to replace");
+            return;
+        }
+
+        match_count = window->regex_matches->len;
+        matches = (SearchMatch*)malloc((match_count ? match_count : 1) * sizeof(SearchMatch));
+        if (!matches) {
+            gtk_label_set_text(GTK_LABEL(window->find_status_label), "Replace failed");
+            return;
+        }
+        memcpy(matches, window->regex_matches->data, match_count * sizeof(SearchMatch));
+    } else {
+        if (!window->find_pattern) {
+            return;
+        }
+
+        /* The find bar's pattern may be replaced while the job runs */
+        const char* query = gtk_entry_get_text(GTK_ENTRY(window->find_entry));
+        pattern = search_pattern_create(query, strlen(query), get_find_flags(window));
+        if (!pattern) {
+            return;
+        }
+    }
+
+    const char* replacement = gtk_entry_get_text(GTK_ENTRY(window->replace_entry));
+
+    ReplaceJob* job = g_new0(ReplaceJob, 1);
+    job->window = window;
+    job->text = g_bytes_ref(window->search_bytes);
+    job->pattern = pattern;
+    job->matches = matches;
+    job->match_count = match_count;
+    job->replacement = g_strdup(replacement);
+    job->replacement_length = strlen(replacement);
+
+    worker_pool_cancel(window->workers, window->replace_job);
+    window->replace_job = worker_pool_submit(window->workers, run_replace_job, complete_replace_job,
+                                             free_replace_result, job, free_replace_job,
+                                             WORKER_JOB_DROP_ON_CHANGE);
+    gtk_label_set_text(GTK_LABEL(window->find_status_label),
+                       window->replace_job ? "Replacing..." : "Replace failed");
+}
+
+void main_window_load_file(MainWindow* window, const char* path) {
+    if (!window || !path) {
+        return;
+    }
+
+    main_window_cancel_load(window);
+    stop_paste(window, false);
+    close_viewer(window);
+
+    /* Ended once the last chunk is in the buffer; failed and cancelled loads are left out */
+    window->open_span = trace_begin();
+
+    struct stat st;
+    if (window->large_file_threshold > 0 && stat(path, &st) == 0 &&
+        S_ISREG(st.st_mode) && (size_t)st.st_size > window->large_file_threshold) {
+        open_in_viewer(window, path);
+        trace_end("open (viewer)", window->open_span);
+        window->open_span = 0;
+        return;
+    }
+
+    window->loader = file_loader_create(path);
+    if (!window->loader) {
+        main_window_show_error(window, file_operations_get_error_message(FILE_OP_ERROR_MEMORY));
+        return;
+    }
+
+    main_window_set_text(window, "");
+    rebase_journal(window, NULL);
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(window->text_view), FALSE);
+    window->loader_placed_cursor = false;
+
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(window->progress_bar), 0.0);
+    update_load_progress(window);
+    gtk_widget_show(window->progress_box);
+
+    schedule_loader_tick(window, false);
+}
+
+void main_window_cancel_load(MainWindow* window) {
+    if (!window || !window->loader) {
+        return;
+    }
+
+    stop_loading(window);
+    drop_recovery(window, false);
+    application_new_document(window->app);
+}
+
+void main_window_recover(MainWindow* window) {
+    if (!window) {
+        return;
+    }
+
+    gchar* directory = get_journal_directory();
+    char* path = journal_find_orphan(directory);
+    g_free(directory);
+    if (!path) {
+        return;
+    }
+
+    JournalRecovery* recovery = journal_recovery_open(path);
+    size_t edits = journal_recovery_get_edit_count(recovery);
+    const char* document_path = journal_recovery_get_document_path(recovery);
+    gchar* message = NULL;
+    bool accepted = false;
+
+    if (edits > 0 && !journal_recovery_base_matches(recovery)) {
+        message = g_strdup_printf("%s changed after Notebook last exited without saving. "
+                                  "Its unsaved edits cannot be recovered.", document_path);
+        main_window_show_error(window, message);
+    } else if (edits > 0) {
+        message = g_strdup_printf("Notebook did not exit cleanly. Recover %zu unsaved %s to %s?",
+                                  edits, edits == 1 ? "edit" : "edits",
+                                  document_path ? document_path : "an untitled document");
+        accepted = main_window_confirm(window, message);
+    }
+    g_free(message);
+
+    if (!accepted) {
+        journal_recovery_close(recovery);
+        g_unlink(path);
+        free(path);
+        return;
+    }
+
+    window->recovery = recovery;
+    window->recovery_path = g_strdup(path);
+    free(path);
+
+    if (!document_path) {
+        application_new_document(window->app);
+        finish_recovery(window);
+        return;
+    }
+
+    /* Replayed by finish_loading() once the base is in the buffer */
+    main_window_load_file(window, document_path);
+    if (!window->loader) {
+        drop_recovery(window, false);
+        main_window_show_error(window, "The unsaved edits can only be recovered into an editable document.");
+    }
+}
+
+bool main_window_record_edits(MainWindow* window, const char* path) {
+    if (!window || !path) {
+        return false;
+    }
+
+    main_window_stop_recording(window);
+
+    window->edit_trace = edit_trace_writer_open(path);
+    if (!window->edit_trace) {
+        return false;
+    }
+
+    record_edit_base(window);
+    return window->edit_trace != NULL;
+}
+
+bool main_window_stop_recording(MainWindow* window) {
+    if (!window) {
+        return false;
+    }
+
+    bool written = !window->edit_trace_failed;
+    if (window->edit_trace && !close_edit_trace(window)) {
+        written = false;
+    }
+    window->edit_trace_failed = false;
+
+    return written;
+}
+
+bool main_window_is_loading(const MainWindow* window) {
+    return window && window->loader;
+}
+
+bool main_window_is_viewing(const MainWindow* window) {
+    return window && window->viewer;
+}
+
+void main_window_set_large_file_threshold(MainWindow* window, size_t bytes) {
+    if (!window) {
+        return;
+    }
+
+    window->large_file_threshold = bytes;
+}
+
+void main_window_set_sync_policy(MainWindow* window, FileSyncPolicy policy) {
+    if (!window) {
+        return;
+    }
+
+    window->sync_policy = policy;
+}
+
+bool main_window_is_saving(const MainWindow* window) {
+    return window && window->save_poll_source != 0;
+}
+
+void main_window_apply_theme(MainWindow* window) {
+    if (!window) {
+        return;
+    }
+
+    uint64_t span = trace_begin();
+    uint64_t start = metrics_now();
+
+    ThemeManager* theme_manager = application_get_theme_manager(window->app);
+    theme_cache_apply(window->theme_cache, theme_manager_get_current(theme_manager));
+
+    metrics_record_since(METRIC_THEME_SWITCH_TIME, start);
+    trace_end("theme switch", span);
+}
+
+void main_window_show_error(MainWindow* window, const char* message) {
+    if (!window || !message) {
+        return;
+    }
+
+    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
+                                               GTK_DIALOG_MODAL,
+                                               GTK_MESSAGE_ERROR,
+                                               GTK_BUTTONS_OK,
+                                               "%s", message);
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
+}
+
+bool main_window_confirm(MainWindow* window, const char* message) {
+    if (!window || !message) {
+        return false;
+    }
+
+    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
+                                               GTK_DIALOG_MODAL,
+                                               GTK_MESSAGE_QUESTION,
+                                               GTK_BUTTONS_YES_NO,
+                                               "%s", message);
+    gint result = gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
+
+    return result == GTK_RESPONSE_YES;
+}
+
+char* main_window_choose_file_open(MainWindow* window) {
+    if (!window) {
+        return NULL;
+    }
+
+    GtkWidget* dialog = gtk_file_chooser_dialog_new("Open File",
+                                                     GTK_WINDOW(window->window),
+                                                     GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                     "_Cancel", GTK_RESPONSE_CANCEL,
+                                                     "_Open", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+
+    char* filename = NULL;
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    }
+
+    gtk_widget_destroy(dialog);
+    return filename;
+}
+
+char* main_window_choose_file_save(MainWindow* window) {
+    if (!window) {
+        return NULL;
+    }
+
+    GtkWidget* dialog = gtk_file_chooser_dialog_new("Save File",
+                                                     GTK_WINDOW(window->window),
+                                                     GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                     "_Cancel", GTK_RESPONSE_CANCEL,
+                                                     "_Save", GTK_RESPONSE_ACCEPT,
                                                      NULL);
 
-    char* filename = NULL;
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
-        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+
+    char* filename = NULL;
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    }
+
+    gtk_widget_destroy(dialog);
+    return filename;
+}
+
+/* Callback implementations */
+
+static void on_new_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (application_has_unsaved_changes(window->app)) {
+        if (!main_window_confirm(window, "You have unsaved changes. Continue?")) {
+            return;
+        }
+    }
+
+    application_new_document(window->app);
+}
+
+static void on_open_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (application_has_unsaved_changes(window->app)) {
+        if (!main_window_confirm(window, "You have unsaved changes. Continue?")) {
+            return;
+        }
+    }
+
+    char* filename = main_window_choose_file_open(window);
+    if (filename) {
+        main_window_load_file(window, filename);
+        g_free(filename);
+    }
+}
+
+/**
+ * @brief Hands a snapshot of the editor text to the background saver
+ *
+ * The snapshot is tagged with the current edit generation, so the
+ * completion handler can tell whether the user kept typing meanwhile.
+ */
+static void start_save(MainWindow* window, const char* path) {
+    uint64_t span = trace_begin();
+
+    size_t length;
+    char* text = buffer_text_get_bytes(window->text_buffer, window->nul_tag, &length);
+    if (!text) {
+        main_window_show_error(window, file_operations_get_error_message(FILE_OP_ERROR_MEMORY));
+        return;
+    }
+
+    if (!file_saver_submit(window->saver, path, text, length, g_free,
+                           window->sync_policy, window->file_encoding, window->edit_generation)) {
+        g_free(text);
+        main_window_show_error(window, file_operations_get_error_message(FILE_OP_ERROR_MEMORY));
+        return;
+    }
+
+    /* Edits journalled after this point are not in the snapshot */
+    guint64 mark = journal_get_position(window->journal);
+    g_array_append_val(window->save_journal_marks, mark);
+
+    if (!window->save_poll_source) {
+        window->save_poll_source = g_timeout_add(SAVE_POLL_INTERVAL_MS, on_save_poll, window);
+    }
+
+    /* Only the snapshot; the write shows up on the saver thread's track */
+    trace_end("save", span);
+}
+
+void main_window_save_to(MainWindow* window, const char* path) {
+    if (!window || !path || is_read_only(window)) {
+        return;
+    }
+
+    start_save(window, path);
+}
+
+/**
+ * @brief Runs the Save As flow
+ */
+static void save_document_as(MainWindow* window) {
+    char* filename = main_window_choose_file_save(window);
+    if (filename) {
+        start_save(window, filename);
+        g_free(filename);
+    }
+}
+
+static void on_save_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (is_read_only(window)) {
+        return;
+    }
+
+    const char* file_path = application_get_file_path(window->app);
+    if (!file_path) {
+        save_document_as(window);
+        return;
+    }
+
+    start_save(window, file_path);
+}
+
+static void on_save_as_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (is_read_only(window)) {
+        return;
+    }
+
+    save_document_as(window);
+}
+
+static void on_quit_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (application_has_unsaved_changes(window->app)) {
+        if (!main_window_confirm(window, "You have unsaved changes. Quit anyway?")) {
+            return;
+        }
+    }
+
+    gtk_main_quit();
+}
+
+static void release_buffer_text(const char* data, size_t length, void* user_data) {
+    (void)length;
+    (void)user_data;
+    g_free((gchar*)data);
+}
+
+/**
+ * @brief Renders our clipboard content for whoever asks, in the format asked
+ */
+static void on_clipboard_get(GtkClipboard* clipboard, GtkSelectionData* selection_data,
+                             guint info, gpointer user_data) {
+    (void)clipboard;
+    (void)info;
+    MainWindow* window = (MainWindow*)user_data;
+
+    size_t length;
+    const char* text = clipboard_data_get_bytes(window->clipboard_data, &length);
+    if (text && length <= G_MAXINT) {
+        gtk_selection_data_set_text(selection_data, text, (gint)length);
+    }
+}
+
+/**
+ * @brief Drops our content once another owner takes the clipboard
+ */
+static void on_clipboard_clear(GtkClipboard* clipboard, gpointer user_data) {
+    (void)clipboard;
+    MainWindow* window = (MainWindow*)user_data;
+
+    clipboard_data_unref(window->clipboard_data);
+    window->clipboard_data = NULL;
+}
+
+/**
+ * @brief Copies the selection to the system clipboard
+ * @return The selected text, shared with the clipboard, or NULL if nothing
+ *         is selected (release with clipboard_data_unref())
+ *
+ * The text is taken from the buffer once and offered by reference; other
+ * applications get it rendered on request and paste reads it directly.
+ */
+static ClipboardData* copy_selection(MainWindow* window, GtkTextIter* start, GtkTextIter* end) {
+    if (!gtk_text_buffer_get_selection_bounds(window->text_buffer, start, end)) {
+        return NULL;
+    }
+
+    char* text = gtk_text_buffer_get_text(window->text_buffer, start, end, FALSE);
+    if (!text) {
+        return NULL;
+    }
+
+    ClipboardData* content = clipboard_data_create_adopt(text, strlen(text), release_buffer_text, NULL);
+    if (!content) {
+        g_free(text);
+        return NULL;
+    }
+
+    GtkTargetList* list = gtk_target_list_new(NULL, 0);
+    gtk_target_list_add_text_targets(list, 0);
+    gint target_count;
+    GtkTargetEntry* targets = gtk_target_table_new_from_list(list, &target_count);
+    gtk_target_list_unref(list);
+
+    /* Replacing our own offer clears the previous content first */
+    GtkClipboard* clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
+    if (gtk_clipboard_set_with_data(clipboard, targets, (guint)target_count,
+                                    on_clipboard_get, on_clipboard_clear, window)) {
+        window->clipboard_data = clipboard_data_ref(content);
+        gtk_clipboard_set_can_store(clipboard, NULL, 0);
+    }
+    gtk_target_table_free(targets, target_count);
+
+    return content;
+}
+
+static void on_cut_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (is_read_only(window)) {
+        return;
+    }
+
+    GtkTextIter start, end;
+    ClipboardData* content = copy_selection(window, &start, &end);
+    if (content) {
+        application_cut(window->app, clipboard_data_get_bytes(content, NULL));
+        gtk_text_buffer_delete(window->text_buffer, &start, &end);
+        clipboard_data_unref(content);
+    }
+}
+
+static void on_copy_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    GtkTextIter start, end;
+    ClipboardData* content = copy_selection(window, &start, &end);
+    if (content) {
+        application_copy(window->app, clipboard_data_get_bytes(content, NULL));
+        clipboard_data_unref(content);
+    }
+}
+
+/**
+ * @brief Updates the progress bar from a sliced paste
+ */
+static void update_paste_progress(MainWindow* window) {
+    size_t length;
+    clipboard_data_get_bytes(window->paste->content, &length);
+    double fraction = (double)window->paste->inserted / (double)length;
+
+    char text[64];
+    snprintf(text, sizeof(text), "Pasting %zu MB... %d%%", length / (1024 * 1024), (int)(fraction * 100.0));
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(window->progress_bar), fraction);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(window->progress_bar), text);
+}
+
+/**
+ * @brief Gets the length of the next paste slice, ending on a character boundary
+ */
+static size_t get_paste_slice_length(const char* text, size_t length) {
+    if (length <= PASTE_SLICE_SIZE) {
+        return length;
+    }
+
+    size_t slice = PASTE_SLICE_SIZE;
+    while (slice > 1 && ((unsigned char)text[slice] & 0xC0) == 0x80) {
+        slice--;
+    }
+
+    /* A CRLF split across two inserts would become two line breaks */
+    if (text[slice - 1] == '\r' && text[slice] == '\n') {
+        slice++;
+    }
+
+    return slice;
+}
+
+/**
+ * @brief Records a finished paste in the history and replaces the selection
+ *
+ * The slices were journalled as they went in; the history gets one entry
+ * holding a reference to the content, so it costs nothing against the
+ * undo budget.
+ */
+static void finish_paste(MainWindow* window, PasteJob* job) {
+    size_t length;
+    const char* text = clipboard_data_get_bytes(job->content, &length);
+
+    GtkTextIter start, end;
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &start, job->start);
+    HistoryChange change = {
+        .offset = (size_t)gtk_text_iter_get_offset(&start),
+        .inserted = text,
+        .inserted_length = length,
+        .inserted_span = job->inserted_chars
+    };
+    history_record_shared(window->history, &change, NULL, clipboard_data_ref(job->content),
+                          release_clipboard_data);
+
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &start, job->selection);
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &end, job->start);
+    if (!gtk_text_iter_equal(&start, &end)) {
+        gtk_text_buffer_delete(window->text_buffer, &start, &end);
+    }
+}
+
+/**
+ * @brief Ends a sliced paste and gives the editor back
+ * @param remove_text Take out what was inserted so far and give the
+ *        selection back (the user cancelled)
+ */
+static void stop_paste(MainWindow* window, bool remove_text) {
+    PasteJob* job = window->paste;
+    if (!job) {
+        return;
+    }
+
+    window->paste = NULL;
+    if (job->task) {
+        task_scheduler_cancel(window->scheduler, job->task);
+    }
+
+    GtkTextIter start, end;
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &start, job->start);
+    gtk_text_buffer_get_iter_at_mark(window->text_buffer, &end, job->end);
+
+    size_t length;
+    clipboard_data_get_bytes(job->content, &length);
+    if (remove_text) {
+        /* The slices never reached the history, so neither does their removal */
+        window->recording_shared = true;
+        gtk_text_buffer_delete(window->text_buffer, &start, &end);
+        window->recording_shared = false;
+
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &start, job->selection);
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &end, job->start);
+        gtk_text_buffer_select_range(window->text_buffer, &end, &start);
+    } else if (job->inserted == length) {
+        finish_paste(window, job);
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &end, job->end);
+        gtk_text_buffer_place_cursor(window->text_buffer, &end);
+        gtk_text_view_scroll_mark_onscreen(GTK_TEXT_VIEW(window->text_view),
+                                           gtk_text_buffer_get_insert(window->text_buffer));
+        metrics_record_since(METRIC_PASTE_TIME, job->start_time);
+        trace_end("paste", job->span);
+    }
+    gtk_text_buffer_end_user_action(window->text_buffer);
+
+    gtk_text_buffer_delete_mark(window->text_buffer, job->selection);
+    gtk_text_buffer_delete_mark(window->text_buffer, job->start);
+    gtk_text_buffer_delete_mark(window->text_buffer, job->end);
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(window->text_view), TRUE);
+    gtk_widget_hide(window->progress_box);
+
+    clipboard_data_unref(job->content);
+    g_free(job);
+}
+
+/**
+ * @brief Inserts paste slices until the frame's task budget is spent
+ */
+static bool paste_step(gint64 deadline, gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+    PasteJob* job = window->paste;
+
+    size_t length;
+    const char* text = clipboard_data_get_bytes(job->content, &length);
+
+    do {
+        size_t slice = get_paste_slice_length(text + job->inserted, length - job->inserted);
+        size_t chars = (size_t)g_utf8_strlen(text + job->inserted, (gssize)slice);
+        GtkTextIter end;
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &end, job->end);
+        size_t offset = (size_t)gtk_text_iter_get_offset(&end);
+
+        /* The journal points into the content instead of copying the slice */
+        window->recording_shared = true;
+        gtk_text_buffer_insert(window->text_buffer, &end, text + job->inserted, (gint)slice);
+        window->recording_shared = false;
+        journal_record_insert_shared(window->journal, offset, text + job->inserted, slice, chars,
+                                     clipboard_data_ref(job->content), release_clipboard_data);
+
+        job->inserted += slice;
+        job->inserted_chars += chars;
+    } while (job->inserted < length && g_get_monotonic_time() < deadline);
+
+    if (job->inserted < length) {
+        update_paste_progress(window);
+        return true;
+    }
+
+    job->task = 0;
+    stop_paste(window, false);
+    return false;
+}
+
+/**
+ * @brief Replaces the selection with clipboard content
+ *
+ * Small content goes in at once. Larger content is inserted a slice per
+ * frame by the task scheduler, with a progress bar and Cancel, so the
+ * window keeps drawing and handling input. The slices go in after the
+ * selection, which is deleted once the last one is in (so Cancel leaves
+ * it as it was); the whole paste undoes as one step.
+ */
+static void start_paste(MainWindow* window, ClipboardData* content, uint64_t span, uint64_t start_time) {
+    size_t length;
+    const char* text = clipboard_data_get_bytes(content, &length);
+    if (!text || length == 0) {
+        trace_end("paste", span);
+        return;
+    }
+
+    metrics_record(METRIC_PASTE_SIZE, length);
+
+    /* Both edits undo as one step */
+    gtk_text_buffer_begin_user_action(window->text_buffer);
+    GtkTextIter start, end;
+    bool selected = gtk_text_buffer_get_selection_bounds(window->text_buffer, &start, &end);
+
+    if (length <= PASTE_SYNC_MAX) {
+        if (selected) {
+            gtk_text_buffer_delete(window->text_buffer, &start, &end);
+        }
+        gtk_text_buffer_insert_at_cursor(window->text_buffer, text, (gint)length);
+        gtk_text_buffer_end_user_action(window->text_buffer);
+        metrics_record_since(METRIC_PASTE_TIME, start_time);
+        trace_end("paste", span);
+        return;
+    }
+
+    /* The user action stays open until the last slice is in */
+    PasteJob* job = g_new0(PasteJob, 1);
+    job->content = clipboard_data_ref(content);
+    job->span = span;
+    job->start_time = start_time;
+    if (!selected) {
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &start, gtk_text_buffer_get_insert(window->text_buffer));
+        end = start;
+    }
+    job->selection = gtk_text_buffer_create_mark(window->text_buffer, NULL, &start, TRUE);
+    job->start = gtk_text_buffer_create_mark(window->text_buffer, NULL, &end, TRUE);
+    job->end = gtk_text_buffer_create_mark(window->text_buffer, NULL, &end, FALSE);
+    window->paste = job;
+
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(window->text_view), FALSE);
+    update_paste_progress(window);
+    gtk_widget_show(window->progress_box);
+
+    job->task = task_scheduler_add(window->scheduler, TASK_PRIORITY_HIGH, paste_step, window, NULL, NULL);
+    if (!job->task) {
+        stop_paste(window, true);
+    }
+}
+
+static void on_paste_text_received(GtkClipboard* clipboard, const gchar* text, gpointer data) {
+    (void)clipboard;
+    PasteRequest* request = (PasteRequest*)data;
+    MainWindow* window = request->window;
+    uint64_t span = request->span;
+    uint64_t start_time = request->start_time;
+    g_free(request);
+
+    if (!window) {
+        return;
+    }
+    window->paste_request = NULL;
+
+    /* A load may have started while the clipboard owner was answering */
+    ClipboardData* content = text && !is_read_only(window) ? clipboard_data_create(text, strlen(text)) : NULL;
+    if (!content) {
+        trace_end("paste", span);
+        return;
+    }
+
+    start_paste(window, content, span, start_time);
+    clipboard_data_unref(content);
+}
+
+static void on_paste_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (is_read_only(window) || window->paste_request) {
+        return;
+    }
+
+    uint64_t span = trace_begin();
+    uint64_t start_time = metrics_now();
+
+    /* Our own copy is pasted straight from the shared content */
+    if (window->clipboard_data) {
+        start_paste(window, window->clipboard_data, span, start_time);
+        return;
+    }
+
+    /* Anything else is read without blocking; the reply starts the paste */
+    PasteRequest* request = g_new0(PasteRequest, 1);
+    request->window = window;
+    request->span = span;
+    request->start_time = start_time;
+    window->paste_request = request;
+    gtk_clipboard_request_text(gtk_clipboard_get(GDK_SELECTION_CLIPBOARD), on_paste_text_received, request);
+}
+
+/**
+ * @brief Undoes or redoes one step and brings the cursor into view
+ */
+static void step_history(MainWindow* window, bool redo) {
+    if (is_read_only(window)) {
+        return;
+    }
+
+    record_edit(window, redo ? EDIT_TRACE_REDO : EDIT_TRACE_UNDO, 0, NULL, 0);
+
+    window->applying_history = true;
+    bool stepped = redo ? history_redo(window->history, apply_history_change, window)
+                        : history_undo(window->history, apply_history_change, window);
+    window->applying_history = false;
+
+    if (stepped) {
+        gtk_text_view_scroll_mark_onscreen(GTK_TEXT_VIEW(window->text_view),
+                                           gtk_text_buffer_get_insert(window->text_buffer));
+    }
+}
+
+static void on_undo_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    step_history((MainWindow*)user_data, false);
+}
+
+static void on_redo_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    step_history((MainWindow*)user_data, true);
+}
+
+static void on_select_all_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    GtkTextIter start, end;
+    gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
+    gtk_text_buffer_select_range(window->text_buffer, &start, &end);
+}
+
+/**
+ * @brief Shows the find bar and focuses one of its entries
+ */
+static void show_find_bar(MainWindow* window, GtkWidget* focus) {
+    /* Seed the query with a short single-line selection */
+    GtkTextIter start, end;
+    if (gtk_text_buffer_get_selection_bounds(window->text_buffer, &start, &end) &&
+        gtk_text_iter_get_line(&start) == gtk_text_iter_get_line(&end)) {
+        gchar* selected = gtk_text_buffer_get_text(window->text_buffer, &start, &end, FALSE);
+        if (strlen(selected) <= FIND_PREFILL_MAX) {
+            gtk_entry_set_text(GTK_ENTRY(window->find_entry), selected);
+        }
+        g_free(selected);
+    }
+
+    gtk_widget_show(window->find_bar);
+    gtk_widget_grab_focus(focus);
+}
+
+static void on_find_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+    show_find_bar(window, window->find_entry);
+}
+
+static void on_replace_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+    show_find_bar(window, window->replace_entry);
+}
+
+static void on_replace_all_clicked(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+    replace_all(window);
+}
+
+static void on_find_next_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+    find_from_selection(window, true);
+}
+
+static void on_find_previous_activated(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+    find_from_selection(window, false);
+}
+
+static void on_find_changed(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    /* The count task reads the pattern */
+    stop_find_count(window);
+    search_pattern_destroy(window->find_pattern);
+    window->find_pattern = NULL;
+
+    stop_regex_search(window);
+
+    if (is_regex_mode(window)) {
+        gtk_label_set_text(GTK_LABEL(window->find_status_label), "");
+    } else {
+        const char* query = gtk_entry_get_text(GTK_ENTRY(window->find_entry));
+        window->find_pattern = search_pattern_create(query, strlen(query), get_find_flags(window));
+        update_find_count(window);
+
+        if (!window->find_pattern) {
+            return;
+        }
+    }
+
+    if (window->loader) {
+        return;
     }
 
-    gtk_widget_destroy(dialog);
-    return filename;
+    /* Search as you type: keep the current match if it still fits */
+    size_t start, end;
+    if (get_search_selection(window, &start, &end)) {
+        find_from_offset(window, true, start);
+    }
 }
 
-char* main_window_choose_file_save(MainWindow* window) {
-    if (!window) {
-        return NULL;
+static void on_find_close(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    gtk_widget_hide(window->find_bar);
+    gtk_widget_grab_focus(window->text_view);
+}
+
+static gboolean on_regex_poll(gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+    SearchMatch batch[REGEX_TAKE_BATCH];
+    size_t taken;
+
+    while ((taken = regex_search_take_matches(window->regex_search, batch, REGEX_TAKE_BATCH)) > 0) {
+        g_array_append_vals(window->regex_matches, batch, (guint)taken);
     }
 
-    GtkWidget* dialog = gtk_file_chooser_dialog_new("Save File",
-                                                     GTK_WINDOW(window->window),
-                                                     GTK_FILE_CHOOSER_ACTION_SAVE,
-                                                     "_Cancel", GTK_RESPONSE_CANCEL,
-                                                     "_Save", GTK_RESPONSE_ACCEPT,
-                                                     NULL);
+    /* Finished only once every match has been taken, so none are lost */
+    bool finished = regex_search_is_finished(window->regex_search);
+    bool truncated = finished && regex_search_is_truncated(window->regex_search);
 
-    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+    if (finished) {
+        /* Releases the snapshot; the collected matches stay for find next */
+        regex_search_destroy(window->regex_search);
+        window->regex_search = NULL;
+        window->regex_poll_source = 0;
+    }
 
-    char* filename = NULL;
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
-        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    show_match_count(window, window->regex_matches->len,
+                     !finished ? "..." : truncated ? "+" : "");
+
+    if (window->regex_pending == FIND_PENDING_REPLACE_ALL) {
+        if (finished) {
+            window->regex_pending = FIND_PENDING_NONE;
+            replace_all(window);
+        }
+    } else if (window->regex_pending != FIND_PENDING_NONE &&
+               find_regex(window, window->regex_pending == FIND_PENDING_FORWARD,
+                          window->regex_pending_offset)) {
+        window->regex_pending = FIND_PENDING_NONE;
     }
 
-    gtk_widget_destroy(dialog);
-    return filename;
+    return finished ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
 }
 
-/* Callback implementations */
-
-static void on_new_activated(GtkWidget* widget, gpointer user_data) {
+static void on_goto_line_activated(GtkWidget* widget, gpointer user_data) {
     (void)widget;
     MainWindow* window = (MainWindow*)user_data;
 
-    if (application_has_unsaved_changes(window->app)) {
-        if (!main_window_confirm(window, "You have unsaved changes. Continue?")) {
-            return;
+    if (window->loader) {
+        return;
+    }
+
+    size_t line_count = window->viewer
+                        ? large_file_viewer_get_line_count(window->viewer)
+                        : (size_t)gtk_text_buffer_get_line_count(window->text_buffer);
+    if (line_count == 0) {
+        main_window_show_error(window, "Line numbers are still being indexed. Try again shortly.");
+        return;
+    }
+
+    size_t current = 0;
+    size_t column = 0;
+    if (window->viewer) {
+        large_file_viewer_get_cursor_position(window->viewer, &current, &column);
+    } else {
+        GtkTextIter iter;
+        gtk_text_buffer_get_iter_at_mark(window->text_buffer, &iter,
+                                         gtk_text_buffer_get_insert(window->text_buffer));
+        current = (size_t)gtk_text_iter_get_line(&iter);
+    }
+
+    GtkWidget* dialog = gtk_dialog_new_with_buttons("Go to Line",
+                                                    GTK_WINDOW(window->window),
+                                                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                    "_Cancel", GTK_RESPONSE_CANCEL,
+                                                    "_Go", GTK_RESPONSE_OK,
+                                                    NULL);
+    gtk_dialog_set_default_response(GTK_DIALOG(dialog), GTK_RESPONSE_OK);
+
+    GtkWidget* spin = gtk_spin_button_new_with_range(1.0, (gdouble)line_count, 1.0);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(spin), (gdouble)(current + 1));
+    gtk_entry_set_activates_default(GTK_ENTRY(spin), TRUE);
+
+    gchar* label_text = g_strdup_printf("Line (1 - %zu):", line_count);
+    GtkWidget* label = gtk_label_new(label_text);
+    g_free(label_text);
+
+    GtkWidget* box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_container_set_border_width(GTK_CONTAINER(box), 6);
+    gtk_box_pack_start(GTK_BOX(box), label, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(box), spin, TRUE, TRUE, 0);
+    gtk_container_add(GTK_CONTAINER(gtk_dialog_get_content_area(GTK_DIALOG(dialog))), box);
+    gtk_widget_show_all(box);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        size_t line = (size_t)gtk_spin_button_get_value(GTK_SPIN_BUTTON(spin)) - 1;
+        if (window->viewer) {
+            large_file_viewer_goto_line(window->viewer, line);
+        } else {
+            GtkTextIter iter;
+            gtk_text_buffer_get_iter_at_line(window->text_buffer, &iter, (gint)line);
+            gtk_text_buffer_place_cursor(window->text_buffer, &iter);
+            gtk_text_view_scroll_to_mark(GTK_TEXT_VIEW(window->text_view),
+                                         gtk_text_buffer_get_insert(window->text_buffer),
+                                         0.0, TRUE, 0.0, 0.5);
         }
+        update_cursor_position(window);
     }
 
-    application_new_document(window->app);
+    gtk_widget_destroy(dialog);
 }
 
-static void on_open_activated(GtkWidget* widget, gpointer user_data) {
+static void on_toggle_theme_activated(GtkWidget* widget, gpointer user_data) {
     (void)widget;
     MainWindow* window = (MainWindow*)user_data;
 
-    if (application_has_unsaved_changes(window->app)) {
-        if (!main_window_confirm(window, "You have unsaved changes. Continue?")) {
-            return;
-        }
-    }
+    ThemeManager* theme_manager = application_get_theme_manager(window->app);
+    theme_manager_toggle(theme_manager);
+}
 
-    char* filename = main_window_choose_file_open(window);
-    if (filename) {
-        application_open_document(window->app, filename);
-        g_free(filename);
+/**
+ * @brief Shows the latest metrics in the debug overlay
+ */
+static gboolean on_debug_overlay_refresh(gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+
+    static const MetricHistogram timings[] = {
+        METRIC_FRAME_TIME,
+        METRIC_BUFFER_CHANGED_TIME,
+        METRIC_PASTE_TIME,
+        METRIC_THEME_SWITCH_TIME,
+        METRIC_FILE_READ_TIME,
+        METRIC_FILE_WRITE_TIME
+    };
+
+    GString* text = g_string_new("ms                    count     p50     p99     max");
+    for (size_t i = 0; i < G_N_ELEMENTS(timings); i++) {
+        MetricSummary summary;
+        metrics_summarize(timings[i], &summary);
+        g_string_append_printf(text, "\n%-18s %8" G_GUINT64_FORMAT " %7.2f %7.2f %7.2f",
+                               metrics_get_histogram_name(timings[i]), summary.count,
+                               summary.p50 / 1e6, summary.p99 / 1e6, summary.max / 1e6);
     }
+
+    MetricSummary paste;
+    metrics_summarize(METRIC_PASTE_SIZE, &paste);
+    g_string_append_printf(text, "\npaste KiB p50 %.1f, p99 %.1f, max %.1f",
+                           paste.p50 / 1024.0, paste.p99 / 1024.0, paste.max / 1024.0);
+
+    gchar* markup = g_markup_printf_escaped("<tt>%s</tt>", text->str);
+    gtk_label_set_markup(GTK_LABEL(window->debug_overlay), markup);
+    g_free(markup);
+    g_string_free(text, TRUE);
+
+    return G_SOURCE_CONTINUE;
 }
 
-static void on_save_activated(GtkWidget* widget, gpointer user_data) {
+static void on_debug_overlay_toggled(GtkCheckMenuItem* item, gpointer user_data) {
     MainWindow* window = (MainWindow*)user_data;
 
-    /* Update document content from text buffer */
-    char* text = main_window_get_text(window);
-    if (text) {
-        Document* doc = application_get_document(window->app);
-        document_set_content(doc, text);
-        g_free(text);
+    if (gtk_check_menu_item_get_active(item)) {
+        on_debug_overlay_refresh(window);
+        gtk_widget_show(window->debug_overlay);
+        if (!window->debug_overlay_source) {
+            window->debug_overlay_source = g_timeout_add(DEBUG_OVERLAY_INTERVAL_MS,
+                                                         on_debug_overlay_refresh, window);
+        }
+        return;
     }
 
-    if (!application_save_document(window->app)) {
-        /* No file path - trigger Save As */
-        on_save_as_activated(widget, user_data);
+    gtk_widget_hide(window->debug_overlay);
+    if (window->debug_overlay_source) {
+        g_source_remove(window->debug_overlay_source);
+        window->debug_overlay_source = 0;
     }
 }
 
-static void on_save_as_activated(GtkWidget* widget, gpointer user_data) {
+static void on_about_activated(GtkWidget* widget, gpointer user_data) {
     (void)widget;
     MainWindow* window = (MainWindow*)user_data;
 
-    /* Update document content from text buffer */
-    char* text = main_window_get_text(window);
-    if (text) {
-        Document* doc = application_get_document(window->app);
-        document_set_content(doc, text);
-        g_free(text);
+    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
+                                               GTK_DIALOG_MODAL,
+                                               GTK_MESSAGE_INFO,
+                                               GTK_BUTTONS_OK,
+                                               "Notebook\n\nA minimalistic text editor.\n\nluizparente.com");
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
+}
+
+static void on_buffer_changed(GtkTextBuffer* buffer, gpointer user_data) {
+    (void)buffer;
+    MainWindow* window = (MainWindow*)user_data;
+
+    uint64_t start = metrics_now();
+
+    window->edit_generation++;
+
+    /* Viewer paging swaps the buffer text, but the mapped file stays put */
+    if (!window->viewer) {
+        worker_pool_advance_generation(window->workers);
+        invalidate_find_results(window);
     }
 
-    char* filename = main_window_choose_file_save(window);
-    if (filename) {
-        application_save_document_as(window->app, filename);
-        g_free(filename);
+    if (!window->ignore_buffer_changes && !window->viewer) {
+        Document* doc = application_get_document(window->app);
+        document_mark_modified(doc);
+
+        /* Update title */
+        const char* file_path = application_get_file_path(window->app);
+        main_window_update_title(window, file_path, true);
     }
+
+    metrics_record_since(METRIC_BUFFER_CHANGED_TIME, start);
 }
 
-static void on_quit_activated(GtkWidget* widget, gpointer user_data) {
-    (void)widget;
+static void on_mark_set(GtkTextBuffer* buffer, GtkTextIter* location,
+                        GtkTextMark* mark, gpointer user_data) {
+    (void)location;
     MainWindow* window = (MainWindow*)user_data;
 
-    if (application_has_unsaved_changes(window->app)) {
-        if (!main_window_confirm(window, "You have unsaved changes. Quit anyway?")) {
-            return;
-        }
+    if (mark == gtk_text_buffer_get_insert(buffer)) {
+        update_cursor_position(window);
     }
+}
 
-    gtk_main_quit();
+/**
+ * @brief Checks whether buffer edits are document edits (not loading or paging)
+ *
+ * A large paste's slices count, even though the editor refuses other edits
+ * while they go in.
+ */
+static bool is_document_edit(const MainWindow* window) {
+    return !window->ignore_buffer_changes && !window->loader && !window->viewer;
 }
 
-static void on_cut_activated(GtkWidget* widget, gpointer user_data) {
-    (void)widget;
+static void on_insert_text(GtkTextBuffer* buffer, GtkTextIter* location,
+                           gchar* text, gint length, gpointer user_data) {
+    (void)buffer;
     MainWindow* window = (MainWindow*)user_data;
 
-    GtkTextIter start, end;
-    if (gtk_text_buffer_get_selection_bounds(window->text_buffer, &start, &end)) {
-        char* text = gtk_text_buffer_get_text(window->text_buffer, &start, &end, FALSE);
-        if (text) {
-            application_cut(window->app, text);
+    if (!is_document_edit(window) || length <= 0) {
+        return;
+    }
 
-            /* Also use GTK clipboard for system integration */
-            GtkClipboard* clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
-            gtk_clipboard_set_text(clipboard, text, -1);
+    HistoryChange change = {
+        .offset = (size_t)gtk_text_iter_get_offset(location),
+        .inserted = text,
+        .inserted_length = (size_t)length,
+        .inserted_span = window->recording_shared ? 0 : (size_t)g_utf8_strlen(text, length)
+    };
+    if (!window->recording_shared) {
+        journal_record_insert(window->journal, change.offset, text, change.inserted_length, change.inserted_span);
+    }
 
-            gtk_text_buffer_delete(window->text_buffer, &start, &end);
-            g_free(text);
+    if (window->edit_trace) {
+        size_t offset = get_edit_trace_offset(window, location);
+        record_edit(window, EDIT_TRACE_INSERT, offset, text, change.inserted_length);
+        if (window->edit_trace_lines &&
+            !line_index_insert(window->edit_trace_lines, offset, text, change.inserted_length)) {
+            abandon_edit_trace(window);
         }
     }
+
+    /* Undo and redo are journalled but not recorded again */
+    if (!window->applying_history && !window->recording_shared) {
+        history_record(window->history, &change);
+    }
 }
 
-static void on_copy_activated(GtkWidget* widget, gpointer user_data) {
-    (void)widget;
+static void on_delete_range(GtkTextBuffer* buffer, GtkTextIter* start,
+                            GtkTextIter* end, gpointer user_data) {
     MainWindow* window = (MainWindow*)user_data;
 
-    GtkTextIter start, end;
-    if (gtk_text_buffer_get_selection_bounds(window->text_buffer, &start, &end)) {
-        char* text = gtk_text_buffer_get_text(window->text_buffer, &start, &end, FALSE);
-        if (text) {
-            application_copy(window->app, text);
-
-            /* Also use GTK clipboard for system integration */
-            GtkClipboard* clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
-            gtk_clipboard_set_text(clipboard, text, -1);
+    if (!is_document_edit(window)) {
+        return;
+    }
 
-            g_free(text);
+    size_t from = (size_t)gtk_text_iter_get_offset(start);
+    size_t to = (size_t)gtk_text_iter_get_offset(end);
+    journal_record_delete(window->journal, from, to - from);
+
+    if (window->edit_trace) {
+        size_t offset = get_edit_trace_offset(window, start);
+        gchar* removed = gtk_text_buffer_get_slice(buffer, start, end, TRUE);
+        size_t removed_length = strlen(removed);
+        record_edit(window, EDIT_TRACE_DELETE, offset, removed, removed_length);
+        if (window->edit_trace_lines &&
+            !line_index_delete(window->edit_trace_lines, offset, removed_length)) {
+            abandon_edit_trace(window);
         }
+        g_free(removed);
+    }
+
+    if (window->applying_history || window->recording_shared) {
+        return;
+    }
+
+    /* Too many characters to fit the budget: skip copying them out */
+    if (to - from > history_get_budget(window->history)) {
+        history_discard(window->history);
+        return;
     }
+
+    gchar* text = gtk_text_buffer_get_text(buffer, start, end, FALSE);
+    HistoryChange change = {
+        .offset = from,
+        .removed = text,
+        .removed_length = strlen(text),
+        .removed_span = to - from
+    };
+    history_record(window->history, &change);
+    g_free(text);
 }
 
-static void on_paste_activated(GtkWidget* widget, gpointer user_data) {
-    (void)widget;
+/**
+ * @brief Queues a change notification, flushed on the next frame
+ */
+static void push_text_change(MainWindow* window, size_t offset,
+                             size_t removed_length, size_t inserted_length) {
+    change_notifier_push(window->change_notifier, offset, removed_length, inserted_length);
+
+    if (window->change_tick == 0) {
+        window->change_tick = gtk_widget_add_tick_callback(window->text_view, on_change_tick,
+                                                           window, NULL);
+    }
+}
+
+static void on_text_inserted(GtkTextBuffer* buffer, GtkTextIter* location,
+                             gchar* text, gint length, gpointer user_data) {
+    (void)text;
+    (void)length;
     MainWindow* window = (MainWindow*)user_data;
 
-    /* Use GTK clipboard for system integration */
-    GtkClipboard* clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
-    gchar* text = gtk_clipboard_wait_for_text(clipboard);
+    /* location now sits after the insertion; the length change gives its start */
+    glong count = gtk_text_buffer_get_char_count(buffer);
+    glong inserted = count - window->char_count;
+    window->char_count = count;
 
-    if (text) {
-        /* Delete selection if any */
-        GtkTextIter start, end;
-        if (gtk_text_buffer_get_selection_bounds(window->text_buffer, &start, &end)) {
-            gtk_text_buffer_delete(window->text_buffer, &start, &end);
-        }
+    size_t offset = (size_t)(gtk_text_iter_get_offset(location) - inserted);
+    push_text_change(window, offset, 0, (size_t)inserted);
+}
 
-        /* Insert at cursor */
-        gtk_text_buffer_insert_at_cursor(window->text_buffer, text, -1);
-        g_free(text);
-    }
+static void on_range_deleted(GtkTextBuffer* buffer, GtkTextIter* start,
+                             GtkTextIter* end, gpointer user_data) {
+    (void)end;
+    MainWindow* window = (MainWindow*)user_data;
+
+    glong count = gtk_text_buffer_get_char_count(buffer);
+    glong removed = window->char_count - count;
+    window->char_count = count;
+
+    push_text_change(window, (size_t)gtk_text_iter_get_offset(start), (size_t)removed, 0);
 }
 
-static void on_select_all_activated(GtkWidget* widget, gpointer user_data) {
+static gboolean on_change_tick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data) {
     (void)widget;
+    (void)clock;
     MainWindow* window = (MainWindow*)user_data;
 
-    GtkTextIter start, end;
-    gtk_text_buffer_get_bounds(window->text_buffer, &start, &end);
-    gtk_text_buffer_select_range(window->text_buffer, &start, &end);
+    window->change_tick = 0;
+    change_notifier_flush(window->change_notifier);
+    return G_SOURCE_REMOVE;
 }
 
-static void on_toggle_theme_activated(GtkWidget* widget, gpointer user_data) {
-    (void)widget;
+static void on_text_changes(const TextChange* changes, size_t count, void* user_data) {
+    (void)changes;
+    (void)count;
     MainWindow* window = (MainWindow*)user_data;
 
-    ThemeManager* theme_manager = application_get_theme_manager(window->app);
-    theme_manager_toggle(theme_manager);
+    /* The insert mark moves with inserted text without emitting mark-set */
+    update_cursor_position(window);
 }
 
-static void on_about_activated(GtkWidget* widget, gpointer user_data) {
+static void on_begin_user_action(GtkTextBuffer* buffer, gpointer user_data) {
+    (void)buffer;
+    MainWindow* window = (MainWindow*)user_data;
+    history_begin_group(window->history);
+    record_edit(window, EDIT_TRACE_BEGIN_GROUP, 0, NULL, 0);
+}
+
+static void on_end_user_action(GtkTextBuffer* buffer, gpointer user_data) {
+    (void)buffer;
+    MainWindow* window = (MainWindow*)user_data;
+    history_end_group(window->history);
+    record_edit(window, EDIT_TRACE_END_GROUP, 0, NULL, 0);
+}
+
+static void on_cancel_progress_clicked(GtkWidget* widget, gpointer user_data) {
     (void)widget;
     MainWindow* window = (MainWindow*)user_data;
 
-    GtkWidget* dialog = gtk_message_dialog_new(GTK_WINDOW(window->window),
-                                               GTK_DIALOG_MODAL,
-                                               GTK_MESSAGE_INFO,
-                                               GTK_BUTTONS_OK,
-                                               "Notebook\n\nA minimalistic text editor.\n\nluizparente.com");
-    gtk_dialog_run(GTK_DIALOG(dialog));
-    gtk_widget_destroy(dialog);
+    if (window->paste) {
+        stop_paste(window, true);
+    } else {
+        main_window_cancel_load(window);
+    }
 }
 
-static void on_buffer_changed(GtkTextBuffer* buffer, gpointer user_data) {
-    (void)buffer;
+static gboolean on_loader_tick(gpointer user_data) {
     MainWindow* window = (MainWindow*)user_data;
 
-    if (window->ignore_buffer_changes) {
+    gint64 deadline = g_get_monotonic_time() + LOADER_FRAME_BUDGET_US;
+    bool inserted = false;
+
+    window->ignore_buffer_changes = true;
+    do {
+        size_t length = 0;
+        char* chunk = file_loader_take_chunk(window->loader, &length);
+        if (!chunk) {
+            break;
+        }
+
+        GtkTextIter end;
+        gtk_text_buffer_get_end_iter(window->text_buffer, &end);
+        buffer_text_insert(window->text_buffer, &end, chunk, length, window->nul_tag);
+        free(chunk);
+        inserted = true;
+
+        /* Pin the cursor to the top so later appends do not drag the view */
+        if (!window->loader_placed_cursor) {
+            GtkTextIter start;
+            gtk_text_buffer_get_start_iter(window->text_buffer, &start);
+            gtk_text_buffer_place_cursor(window->text_buffer, &start);
+            window->loader_placed_cursor = true;
+        }
+    } while (g_get_monotonic_time() < deadline);
+    window->ignore_buffer_changes = false;
+
+    if (file_loader_is_finished(window->loader)) {
+        window->loader_source = 0;
+        finish_loading(window);
+        return G_SOURCE_REMOVE;
+    }
+
+    update_load_progress(window);
+
+    /* Switch between idle (chunks flowing) and polling (waiting on disk) */
+    bool starved = !inserted;
+    if (starved != window->loader_starved) {
+        schedule_loader_tick(window, starved);
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * @brief Applies the outcome of one background save
+ */
+static void complete_save(MainWindow* window, const FileSaveResult* save) {
+    /* Saves complete in the order they were queued */
+    guint64 mark = g_array_index(window->save_journal_marks, guint64, 0);
+    g_array_remove_index(window->save_journal_marks, 0);
+
+    /* Text typed or pasted since the load may not fit the file's encoding */
+    if (save->result == FILE_OP_ERROR_ENCODING) {
+        bool switched = window->file_encoding == TEXT_ENCODING_UTF8;
+        if (!switched) {
+            char message[256];
+            snprintf(message, sizeof(message),
+                     "The text contains characters %s cannot represent. Save it as UTF-8 instead?",
+                     encoding_get_name(window->file_encoding));
+            switched = main_window_confirm(window, message);
+        }
+        if (switched) {
+            set_file_encoding(window, TEXT_ENCODING_UTF8);
+            start_save(window, save->path);
+        }
+        return;
+    }
+
+    if (save->result != FILE_OP_SUCCESS) {
+        main_window_show_error(window, file_operations_get_error_message(save->result));
         return;
     }
 
     Document* doc = application_get_document(window->app);
-    document_mark_modified(doc);
+    const char* current_path = document_get_file_path(doc);
+    if (!current_path || strcmp(current_path, save->path) != 0) {
+        document_set_file_path(doc, save->path);
+    }
+    journal_rebase(window->journal, save->path, mark);
 
-    /* Update title */
-    const char* file_path = application_get_file_path(window->app);
-    main_window_update_title(window, file_path, true);
+    /* Edits made while the snapshot was being written are still unsaved */
+    if (save->tag == window->edit_generation) {
+        document_mark_saved(doc);
+        on_document_saved(window);
+    } else {
+        main_window_update_title(window, save->path, true);
+    }
+}
+
+static gboolean on_save_poll(gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+
+    FileSaveResult save;
+    while (file_saver_take_result(window->saver, &save)) {
+        complete_save(window, &save);
+        free(save.path);
+    }
+
+    if (file_saver_is_idle(window->saver)) {
+        window->save_poll_source = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
 }
 
 static gboolean on_window_delete(GtkWidget* widget, GdkEvent* event, gpointer user_data) {
@@ -613,6 +3415,79 @@ static gboolean on_window_delete(GtkWidget* widget, GdkEvent* event, gpointer us
     return FALSE; /* Allow the delete */
 }
 
+static void on_window_destroy(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    /* Children are still alive here, so the viewer can restore the buffer */
+    close_viewer(window);
+    stop_find_count(window);
+    stop_paste(window, false);
+
+    if (window->change_tick != 0) {
+        gtk_widget_remove_tick_callback(window->text_view, window->change_tick);
+        window->change_tick = 0;
+    }
+
+    if (window->debug_overlay_source) {
+        g_source_remove(window->debug_overlay_source);
+        window->debug_overlay_source = 0;
+    }
+}
+
+static void on_before_paint(GdkFrameClock* clock, gpointer user_data) {
+    (void)clock;
+    MainWindow* window = (MainWindow*)user_data;
+
+    window->paint_start = metrics_now();
+}
+
+/**
+ * @brief Times the frame (update, layout and paint) and marks the first one
+ */
+static void on_after_paint(GdkFrameClock* clock, gpointer user_data) {
+    (void)clock;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (window->paint_start) {
+        metrics_record_since(METRIC_FRAME_TIME, window->paint_start);
+        window->paint_start = 0;
+    }
+
+    if (!window->first_frame_drawn) {
+        window->first_frame_drawn = true;
+        trace_instant("first frame");
+    }
+}
+
+static void on_window_realize(GtkWidget* widget, gpointer user_data) {
+    MainWindow* window = (MainWindow*)user_data;
+
+    window->frame_clock = gtk_widget_get_frame_clock(widget);
+    if (!window->frame_clock) {
+        return;
+    }
+
+    window->before_paint_handler = g_signal_connect(window->frame_clock, "before-paint",
+                                                    G_CALLBACK(on_before_paint), window);
+    window->after_paint_handler = g_signal_connect(window->frame_clock, "after-paint",
+                                                   G_CALLBACK(on_after_paint), window);
+}
+
+static void on_window_unrealize(GtkWidget* widget, gpointer user_data) {
+    (void)widget;
+    MainWindow* window = (MainWindow*)user_data;
+
+    if (!window->frame_clock) {
+        return;
+    }
+
+    g_signal_handler_disconnect(window->frame_clock, window->before_paint_handler);
+    g_signal_handler_disconnect(window->frame_clock, window->after_paint_handler);
+    window->frame_clock = NULL;
+    window->paint_start = 0;
+}
+
 static void on_theme_changed(ThemeType theme, void* user_data) {
     (void)theme;
     MainWindow* window = (MainWindow*)user_data;
@@ -633,7 +3508,10 @@ static void on_document_saved(void* user_data) {
 
 static void on_new_document(void* user_data) {
     MainWindow* window = (MainWindow*)user_data;
+    close_viewer(window);
     main_window_set_text(window, "");
+    rebase_journal(window, NULL);
+    set_file_encoding(window, TEXT_ENCODING_UTF8);
     main_window_update_title(window, NULL, false);
 }
 
@@ -645,6 +3523,10 @@ static void on_document_loaded(void* user_data) {
     const char* file_path = document_get_file_path(doc);
 
     main_window_set_text(window, content ? content : "");
+    rebase_journal(window, file_path);
+
+    /* The document holds converted text but not its source encoding */
+    set_file_encoding(window, TEXT_ENCODING_UTF8);
     main_window_update_title(window, file_path, false);
 }
 
@@ -0,0 +1,467 @@
+#include "ui/regex_search.h"
+#include <glib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Nominal size of one chunk of the snapshot
+ *
+ * Small enough that the first chunk finishes quickly, large enough that
+ * per-job overhead stays negligible.
+ */
+#define REGEX_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * @brief How far past a nominal chunk boundary to look for a line end
+ */
+#define REGEX_MAX_SNAP_DISTANCE (4 * 1024 * 1024)
+
+/**
+ * @brief Characters that make a match part of a longer word
+ *
+ * The same set as search.h: ASCII letters, digits, '_' and everything
+ * outside ASCII. Raw (byte) patterns see non-ASCII bytes instead.
+ */
+#define REGEX_WORD_CLASS "[\\w\\x{80}-\\x{10ffff}]"
+#define REGEX_WORD_CLASS_RAW "[\\w\\x80-\\xff]"
+
+typedef struct RegexChunk RegexChunk;
+
+/**
+ * @brief One line-aligned range of the snapshot, scanned by one pool job
+ */
+struct RegexChunk {
+    RegexSearch* search;
+    size_t start;
+    size_t end;
+    SearchMatch* matches;
+    size_t count;
+    size_t capacity;
+    bool done;
+    uint64_t job;          /* Pool job id until the job is over */
+};
+
+/**
+ * @brief Regex search structure
+ */
+struct RegexSearch {
+    WorkerPool* pool;
+    GRegex* regex;         /* For chunks of valid UTF-8 */
+    GRegex* raw_regex;     /* For other chunks; NULL if the pattern needs UTF-8 */
+    const char* text;
+    size_t length;
+    RegexSearchRelease release;
+    void* release_data;
+
+    RegexChunk* chunks;
+    size_t chunk_count;
+    atomic_size_t found;
+    size_t limit;
+    atomic_bool cancelled;
+
+    pthread_mutex_t lock;  /* Guards chunk results and running */
+    pthread_cond_t idle;   /* Signalled when running drops to zero */
+    size_t running;        /* Chunks being scanned right now */
+
+    /* Owning thread only */
+    size_t jobs;           /* Submitted and not yet over */
+    bool destroyed;
+    size_t deliver_chunk;
+    size_t deliver_index;
+};
+
+/**
+ * @brief Moves a nominal chunk boundary to the next line start
+ *
+ * Falls back to a character boundary inside very long lines.
+ */
+static size_t snap_boundary(const char* text, size_t length, size_t offset) {
+    if (offset >= length) {
+        return length;
+    }
+
+    size_t limit = length - offset < REGEX_MAX_SNAP_DISTANCE ? length - offset : REGEX_MAX_SNAP_DISTANCE;
+    const char* newline = (const char*)memchr(text + offset, '\n', limit);
+    if (newline) {
+        return (size_t)(newline - text) + 1;
+    }
+
+    while (offset < length && ((unsigned char)text[offset] & 0xC0) == 0x80) {
+        offset++;
+    }
+    return offset;
+}
+
+/**
+ * @brief Splits the snapshot into line-aligned chunks
+ */
+static bool create_chunks(RegexSearch* search) {
+    size_t capacity = search->length / REGEX_CHUNK_SIZE + 1;
+    search->chunks = (RegexChunk*)calloc(capacity, sizeof(RegexChunk));
+    if (!search->chunks) {
+        return false;
+    }
+
+    size_t start = 0;
+    do {
+        size_t end = snap_boundary(search->text, search->length, start + REGEX_CHUNK_SIZE);
+        if (search->chunk_count == capacity) {
+            RegexChunk* grown = (RegexChunk*)realloc(search->chunks, capacity * 2 * sizeof(RegexChunk));
+            if (!grown) {
+                return false;
+            }
+            memset(grown + capacity, 0, capacity * sizeof(RegexChunk));
+            search->chunks = grown;
+            capacity *= 2;
+        }
+
+        search->chunks[search->chunk_count].search = search;
+        search->chunks[search->chunk_count].start = start;
+        search->chunks[search->chunk_count].end = end;
+        search->chunk_count++;
+        start = end;
+    } while (start < search->length);
+
+    return true;
+}
+
+/**
+ * @brief Records a match found in a chunk
+ */
+static bool add_match(RegexSearch* search, RegexChunk* chunk, size_t start, size_t end) {
+    pthread_mutex_lock(&search->lock);
+
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : 16;
+        SearchMatch* matches = (SearchMatch*)realloc(chunk->matches, capacity * sizeof(SearchMatch));
+        if (!matches) {
+            pthread_mutex_unlock(&search->lock);
+            return false;
+        }
+        chunk->matches = matches;
+        chunk->capacity = capacity;
+    }
+
+    chunk->matches[chunk->count].start = start;
+    chunk->matches[chunk->count].end = end;
+    chunk->count++;
+
+    pthread_mutex_unlock(&search->lock);
+
+    atomic_fetch_add(&search->found, 1);
+    return true;
+}
+
+/**
+ * @brief Checks whether the scan should stop early
+ */
+static bool should_stop(RegexSearch* search, const WorkerJob* job) {
+    return atomic_load(&search->cancelled) || worker_job_is_cancelled(job) ||
+           (search->limit > 0 && atomic_load(&search->found) >= search->limit);
+}
+
+/**
+ * @brief Finds every match in one chunk
+ *
+ * The chunk is passed as its own string so offsets stay small (GRegex
+ * positions are ints) and '^' matches at its first line.
+ * g_match_info_next() steps over empty matches and checks the UTF-8 only
+ * once per chunk.
+ */
+static void search_chunk(RegexSearch* search, const WorkerJob* job, RegexChunk* chunk) {
+    const char* base = search->text + chunk->start;
+    gssize size = (gssize)(chunk->end - chunk->start);
+    GRegex* regex = g_utf8_validate(base, size, NULL) ? search->regex : search->raw_regex;
+
+    GMatchInfo* info = NULL;
+    if (regex) {
+        g_regex_match_full(regex, base, size, 0, 0, &info, NULL);
+    }
+
+    bool complete = true;
+    while (info && g_match_info_matches(info)) {
+        if (should_stop(search, job)) {
+            complete = false;
+            break;
+        }
+
+        gint start;
+        gint end;
+        g_match_info_fetch_pos(info, 0, &start, &end);
+
+        /* Empty matches are useless for find */
+        if (end > start && !add_match(search, chunk, chunk->start + (size_t)start, chunk->start + (size_t)end)) {
+            atomic_store(&search->cancelled, true);
+            complete = false;
+            break;
+        }
+
+        g_match_info_next(info, NULL);
+    }
+    g_match_info_free(info);
+
+    if (complete) {
+        pthread_mutex_lock(&search->lock);
+        chunk->done = true;
+        pthread_mutex_unlock(&search->lock);
+    }
+}
+
+/**
+ * @brief Pool job: scans one chunk
+ *
+ * Registers as running first, so regex_search_destroy() either sees the
+ * scan and waits for it or the scan sees the cancellation and never
+ * touches the snapshot.
+ */
+static void* run_chunk(const WorkerJob* job, void* data) {
+    RegexChunk* chunk = (RegexChunk*)data;
+    RegexSearch* search = chunk->search;
+
+    pthread_mutex_lock(&search->lock);
+    bool cancelled = atomic_load(&search->cancelled);
+    if (!cancelled) {
+        search->running++;
+    }
+    pthread_mutex_unlock(&search->lock);
+
+    if (cancelled) {
+        return NULL;
+    }
+
+    if (!should_stop(search, job)) {
+        search_chunk(search, job, chunk);
+    }
+
+    pthread_mutex_lock(&search->lock);
+    if (--search->running == 0) {
+        pthread_cond_broadcast(&search->idle);
+    }
+    pthread_mutex_unlock(&search->lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Frees a search whose jobs are all over
+ */
+static void free_search(RegexSearch* search) {
+    for (size_t i = 0; i < search->chunk_count; i++) {
+        free(search->chunks[i].matches);
+    }
+
+    free(search->chunks);
+    if (search->regex) {
+        g_regex_unref(search->regex);
+    }
+    if (search->raw_regex) {
+        g_regex_unref(search->raw_regex);
+    }
+    pthread_cond_destroy(&search->idle);
+    pthread_mutex_destroy(&search->lock);
+    free(search);
+}
+
+/**
+ * @brief Ends a chunk's job on the owning thread, run or dropped
+ */
+static void finish_chunk_job(void* data) {
+    RegexChunk* chunk = (RegexChunk*)data;
+    RegexSearch* search = chunk->search;
+
+    chunk->job = 0;
+    search->jobs--;
+    if (search->destroyed && search->jobs == 0) {
+        free_search(search);
+    }
+}
+
+/**
+ * @brief Compiles a pattern, wrapped in word boundaries for whole-word search
+ */
+static GRegex* compile(const char* pattern, unsigned int flags, bool raw, GError** error) {
+    GRegexCompileFlags options = G_REGEX_MULTILINE | G_REGEX_OPTIMIZE;
+    if (flags & SEARCH_IGNORE_CASE) {
+        options |= G_REGEX_CASELESS;
+    }
+    if (raw) {
+        options |= G_REGEX_RAW;
+    }
+
+    if (!(flags & SEARCH_WHOLE_WORD)) {
+        return g_regex_new(pattern, options, 0, error);
+    }
+
+    const char* word = raw ? REGEX_WORD_CLASS_RAW : REGEX_WORD_CLASS;
+    gchar* wrapped = g_strdup_printf("(?<!%s)(?:%s)(?!%s)", word, pattern, word);
+    GRegex* regex = g_regex_new(wrapped, options, 0, error);
+    g_free(wrapped);
+
+    return regex;
+}
+
+RegexSearch* regex_search_start(WorkerPool* pool, const char* pattern, unsigned int flags,
+                                const char* text, size_t length,
+                                RegexSearchRelease release, void* release_data,
+                                size_t limit, char* error, size_t error_size) {
+    if (error && error_size > 0) {
+        error[0] = '\0';
+    }
+
+    if (!pool || !pattern || pattern[0] == '\0' || (!text && length > 0)) {
+        return NULL;
+    }
+
+    /* Compile the pattern as typed first so its errors are the ones reported */
+    GError* compile_error = NULL;
+    GRegex* regex = g_regex_new(pattern, 0, 0, &compile_error);
+    if (!regex) {
+        if (error && error_size > 0) {
+            g_strlcpy(error, compile_error->message, error_size);
+        }
+        g_error_free(compile_error);
+        return NULL;
+    }
+    g_regex_unref(regex);
+
+    RegexSearch* search = (RegexSearch*)calloc(1, sizeof(RegexSearch));
+    if (!search) {
+        return NULL;
+    }
+
+    search->pool = pool;
+    search->regex = compile(pattern, flags, false, NULL);
+    search->raw_regex = compile(pattern, flags, true, NULL);
+    search->text = text ? text : "";
+    search->length = length;
+    search->limit = limit;
+    atomic_init(&search->found, 0);
+    atomic_init(&search->cancelled, false);
+    pthread_mutex_init(&search->lock, NULL);
+    pthread_cond_init(&search->idle, NULL);
+
+    if (!search->regex || !create_chunks(search)) {
+        free_search(search);
+        return NULL;
+    }
+
+    /* Chunks are queued in document order, so matches arrive front to back */
+    for (size_t i = 0; i < search->chunk_count; i++) {
+        RegexChunk* chunk = &search->chunks[i];
+        search->jobs++;
+        chunk->job = worker_pool_submit(pool, run_chunk, NULL, NULL, chunk, finish_chunk_job,
+                                        WORKER_JOB_DROP_ON_CHANGE);
+        if (chunk->job == 0) {
+            /* finish_chunk_job() has run; the rest of the text goes unsearched */
+            atomic_store(&search->cancelled, true);
+            break;
+        }
+    }
+
+    if (search->jobs == 0) {
+        free_search(search);
+        return NULL;
+    }
+
+    search->release = release;
+    search->release_data = release_data;
+    return search;
+}
+
+void regex_search_cancel(RegexSearch* search) {
+    if (!search) {
+        return;
+    }
+
+    atomic_store(&search->cancelled, true);
+    for (size_t i = 0; i < search->chunk_count; i++) {
+        if (search->chunks[i].job != 0) {
+            worker_pool_cancel(search->pool, search->chunks[i].job);
+        }
+    }
+}
+
+void regex_search_destroy(RegexSearch* search) {
+    if (!search) {
+        return;
+    }
+
+    regex_search_cancel(search);
+
+    /* Scans in progress stop at their next match; none start after this */
+    pthread_mutex_lock(&search->lock);
+    while (search->running > 0) {
+        pthread_cond_wait(&search->idle, &search->lock);
+    }
+    pthread_mutex_unlock(&search->lock);
+
+    if (search->release) {
+        search->release(search->release_data);
+    }
+
+    search->destroyed = true;
+    if (search->jobs == 0) {
+        free_search(search);
+    }
+}
+
+size_t regex_search_take_matches(RegexSearch* search, SearchMatch* matches, size_t capacity) {
+    if (!search || !matches) {
+        return 0;
+    }
+
+    size_t taken = 0;
+    pthread_mutex_lock(&search->lock);
+
+    /* Matches of the first unfinished chunk are already final and ordered */
+    while (taken < capacity && search->deliver_chunk < search->chunk_count) {
+        RegexChunk* chunk = &search->chunks[search->deliver_chunk];
+        while (taken < capacity && search->deliver_index < chunk->count) {
+            matches[taken++] = chunk->matches[search->deliver_index++];
+        }
+
+        if (search->deliver_index < chunk->count || !chunk->done) {
+            break;
+        }
+
+        free(chunk->matches);
+        chunk->matches = NULL;
+        chunk->count = 0;
+        chunk->capacity = 0;
+        search->deliver_chunk++;
+        search->deliver_index = 0;
+    }
+
+    pthread_mutex_unlock(&search->lock);
+    return taken;
+}
+
+bool regex_search_is_finished(RegexSearch* search) {
+    if (!search) {
+        return true;
+    }
+
+    /* Jobs are over once the pool has delivered them to this thread */
+    if (search->jobs > 0) {
+        return false;
+    }
+
+    /* Finished once nothing deliverable is left */
+    pthread_mutex_lock(&search->lock);
+    bool finished = search->deliver_chunk == search->chunk_count ||
+                    (!search->chunks[search->deliver_chunk].done &&
+                     search->deliver_index == search->chunks[search->deliver_chunk].count);
+    pthread_mutex_unlock(&search->lock);
+
+    return finished;
+}
+
+bool regex_search_is_truncated(RegexSearch* search) {
+    if (!search) {
+        return false;
+    }
+
+    return search->deliver_chunk < search->chunk_count;
+}
@@ -0,0 +1,339 @@
+#include "ui/task_scheduler.h"
+#include <stdlib.h>
+
+/**
+ * @brief Frame length assumed while the widget has no running frame clock
+ */
+#define FALLBACK_FRAME_US 16667
+
+/**
+ * @brief One queued task
+ */
+typedef struct {
+    guint id;
+    TaskStep step;
+    gpointer user_data;
+    GDestroyNotify destroy;
+    const unsigned long* generation;
+    unsigned long generation_value;
+    bool cancelled;
+} Task;
+
+/**
+ * @brief Task scheduler structure
+ */
+struct TaskScheduler {
+    GtkWidget* widget;
+    gulong unmap_handler;
+    gulong destroy_handler;
+    gint64 frame_budget;
+    GQueue queues[TASK_PRIORITY_COUNT];
+    Task* running;
+    guint next_id;
+
+    guint idle_source;   /* Runs tasks while the frame has budget left */
+    guint tick_id;       /* Resumes them on the next frame clock tick */
+    guint wait_source;   /* Stands in for the tick while the widget is not mapped */
+
+    gint64 frame;        /* Frame the budget in use belongs to */
+    gint64 frame_used;
+    TaskSchedulerStats stats;
+};
+
+static gboolean on_idle(gpointer user_data);
+
+/**
+ * @brief Identifies the current frame
+ *
+ * Frame clock counters are non-negative; fallback frames are numbered
+ * below zero so the two never collide.
+ */
+static gint64 get_current_frame(const TaskScheduler* scheduler) {
+    if (scheduler->widget && gtk_widget_get_mapped(scheduler->widget)) {
+        GdkFrameClock* clock = gtk_widget_get_frame_clock(scheduler->widget);
+        if (clock) {
+            return gdk_frame_clock_get_frame_counter(clock);
+        }
+    }
+
+    return -1 - g_get_monotonic_time() / FALLBACK_FRAME_US;
+}
+
+/**
+ * @brief Starts a new frame's budget, closing the books on the last one
+ */
+static void begin_frame(TaskScheduler* scheduler) {
+    gint64 frame = get_current_frame(scheduler);
+    if (frame == scheduler->frame) {
+        return;
+    }
+
+    if (scheduler->frame_used > 0) {
+        TaskSchedulerStats* stats = &scheduler->stats;
+        stats->last_frame = scheduler->frame_used;
+        if (scheduler->frame_used > stats->peak_frame) {
+            stats->peak_frame = scheduler->frame_used;
+        }
+        stats->total += scheduler->frame_used;
+        stats->frames++;
+    }
+
+    scheduler->frame = frame;
+    scheduler->frame_used = 0;
+}
+
+static void free_task(Task* task) {
+    if (task->destroy) {
+        task->destroy(task->user_data);
+    }
+    free(task);
+}
+
+/**
+ * @brief Gets the queue holding the most urgent task
+ * @return Queue, or NULL if no task is waiting
+ */
+static GQueue* get_next_queue(TaskScheduler* scheduler) {
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        if (!g_queue_is_empty(&scheduler->queues[priority])) {
+            return &scheduler->queues[priority];
+        }
+    }
+
+    return NULL;
+}
+
+static bool is_stale(const Task* task) {
+    return task->generation && *task->generation != task->generation_value;
+}
+
+static void start_idle(TaskScheduler* scheduler) {
+    if (scheduler->idle_source || scheduler->tick_id || scheduler->wait_source) {
+        return;
+    }
+
+    /* Below redraws (GDK_PRIORITY_REDRAW) and input, so a frame is never held up */
+    scheduler->idle_source = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_idle, scheduler, NULL);
+}
+
+static gboolean on_tick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data) {
+    (void)widget;
+    (void)clock;
+    TaskScheduler* scheduler = (TaskScheduler*)user_data;
+
+    scheduler->tick_id = 0;
+    start_idle(scheduler);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_wait_elapsed(gpointer user_data) {
+    TaskScheduler* scheduler = (TaskScheduler*)user_data;
+
+    scheduler->wait_source = 0;
+    start_idle(scheduler);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Parks the tasks until the next frame
+ */
+static void wait_for_next_frame(TaskScheduler* scheduler) {
+    if (scheduler->widget && gtk_widget_get_mapped(scheduler->widget)) {
+        scheduler->tick_id = gtk_widget_add_tick_callback(scheduler->widget, on_tick, scheduler, NULL);
+        return;
+    }
+
+    gint64 remaining_us = FALLBACK_FRAME_US - g_get_monotonic_time() % FALLBACK_FRAME_US;
+    scheduler->wait_source = g_timeout_add((guint)(remaining_us / 1000) + 1, on_wait_elapsed, scheduler);
+}
+
+static gboolean on_idle(gpointer user_data) {
+    TaskScheduler* scheduler = (TaskScheduler*)user_data;
+
+    begin_frame(scheduler);
+
+    gint64 start = g_get_monotonic_time();
+    gint64 deadline = start + scheduler->frame_budget - scheduler->frame_used;
+
+    GQueue* queue;
+    while ((queue = get_next_queue(scheduler)) && g_get_monotonic_time() < deadline) {
+        Task* task = (Task*)g_queue_pop_head(queue);
+        if (is_stale(task)) {
+            free_task(task);
+            continue;
+        }
+
+        scheduler->running = task;
+        bool more = task->step(deadline, task->user_data);
+        scheduler->running = NULL;
+
+        /* Tasks of the same priority take turns */
+        if (more && !task->cancelled) {
+            g_queue_push_tail(queue, task);
+        } else {
+            free_task(task);
+        }
+    }
+
+    scheduler->frame_used += g_get_monotonic_time() - start;
+
+    if (!get_next_queue(scheduler)) {
+        scheduler->idle_source = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    if (scheduler->frame_used >= scheduler->frame_budget) {
+        scheduler->idle_source = 0;
+        wait_for_next_frame(scheduler);
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * @brief Stops waiting on a frame clock that no longer ticks
+ */
+static void on_widget_unmap(GtkWidget* widget, gpointer user_data) {
+    TaskScheduler* scheduler = (TaskScheduler*)user_data;
+
+    if (scheduler->tick_id) {
+        gtk_widget_remove_tick_callback(widget, scheduler->tick_id);
+        scheduler->tick_id = 0;
+        wait_for_next_frame(scheduler);
+    }
+}
+
+static void on_widget_destroy(GtkWidget* widget, gpointer user_data) {
+    TaskScheduler* scheduler = (TaskScheduler*)user_data;
+
+    on_widget_unmap(widget, scheduler);
+    g_signal_handler_disconnect(widget, scheduler->unmap_handler);
+    g_signal_handler_disconnect(widget, scheduler->destroy_handler);
+    scheduler->widget = NULL;
+}
+
+TaskScheduler* task_scheduler_create(GtkWidget* widget, gint64 frame_budget_us) {
+    if (!widget || frame_budget_us <= 0) {
+        return NULL;
+    }
+
+    TaskScheduler* scheduler = (TaskScheduler*)calloc(1, sizeof(TaskScheduler));
+    if (!scheduler) {
+        return NULL;
+    }
+
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        g_queue_init(&scheduler->queues[priority]);
+    }
+
+    scheduler->widget = widget;
+    scheduler->frame_budget = frame_budget_us;
+    scheduler->stats.frame_budget = frame_budget_us;
+    scheduler->next_id = 1;
+    scheduler->frame = G_MININT64;
+    scheduler->unmap_handler = g_signal_connect(widget, "unmap", G_CALLBACK(on_widget_unmap), scheduler);
+    scheduler->destroy_handler = g_signal_connect(widget, "destroy", G_CALLBACK(on_widget_destroy), scheduler);
+
+    return scheduler;
+}
+
+void task_scheduler_destroy(TaskScheduler* scheduler) {
+    if (!scheduler) {
+        return;
+    }
+
+    if (scheduler->widget) {
+        if (scheduler->tick_id) {
+            gtk_widget_remove_tick_callback(scheduler->widget, scheduler->tick_id);
+        }
+        g_signal_handler_disconnect(scheduler->widget, scheduler->unmap_handler);
+        g_signal_handler_disconnect(scheduler->widget, scheduler->destroy_handler);
+    }
+    if (scheduler->idle_source) {
+        g_source_remove(scheduler->idle_source);
+    }
+    if (scheduler->wait_source) {
+        g_source_remove(scheduler->wait_source);
+    }
+
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        Task* task;
+        while ((task = (Task*)g_queue_pop_head(&scheduler->queues[priority]))) {
+            free_task(task);
+        }
+    }
+
+    free(scheduler);
+}
+
+guint task_scheduler_add(TaskScheduler* scheduler, TaskPriority priority,
+                         TaskStep step, gpointer user_data, GDestroyNotify destroy,
+                         const unsigned long* generation) {
+    Task* task = NULL;
+    if (scheduler && step && (unsigned int)priority < TASK_PRIORITY_COUNT) {
+        task = (Task*)malloc(sizeof(Task));
+    }
+
+    if (!task) {
+        if (destroy) {
+            destroy(user_data);
+        }
+        return 0;
+    }
+
+    task->id = scheduler->next_id++;
+    if (scheduler->next_id == 0) {
+        scheduler->next_id = 1;
+    }
+    task->step = step;
+    task->user_data = user_data;
+    task->destroy = destroy;
+    task->generation = generation;
+    task->generation_value = generation ? *generation : 0;
+    task->cancelled = false;
+
+    g_queue_push_tail(&scheduler->queues[priority], task);
+    start_idle(scheduler);
+
+    return task->id;
+}
+
+static gint compare_task_id(gconstpointer task, gconstpointer id) {
+    return ((const Task*)task)->id == *(const guint*)id ? 0 : 1;
+}
+
+void task_scheduler_cancel(TaskScheduler* scheduler, guint id) {
+    if (!scheduler || id == 0) {
+        return;
+    }
+
+    /* A running task is freed by on_idle() once its step returns */
+    if (scheduler->running && scheduler->running->id == id) {
+        scheduler->running->cancelled = true;
+        return;
+    }
+
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        GQueue* queue = &scheduler->queues[priority];
+        GList* link = g_queue_find_custom(queue, &id, compare_task_id);
+        if (link) {
+            Task* task = (Task*)link->data;
+            g_queue_delete_link(queue, link);
+            free_task(task);
+            return;
+        }
+    }
+}
+
+void task_scheduler_get_stats(const TaskScheduler* scheduler, TaskSchedulerStats* stats) {
+    if (!scheduler || !stats) {
+        return;
+    }
+
+    *stats = scheduler->stats;
+    stats->pending = 0;
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        stats->pending += g_queue_get_length((GQueue*)&scheduler->queues[priority]);
+    }
+}
\ No newline at end of file
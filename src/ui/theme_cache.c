@@ -0,0 +1,173 @@
+#include "ui/theme_cache.h"
+#include <stdlib.h>
+
+/**
+ * @brief Resources of one theme
+ */
+typedef struct {
+    GtkCssProvider* provider;       /* NULL until built */
+    GtkSourceStyleScheme* scheme;   /* NULL if the scheme was not found */
+} ThemeEntry;
+
+/**
+ * @brief Theme cache structure
+ */
+struct ThemeCache {
+    const ThemeManager* manager;
+    GtkSourceStyleSchemeManager* scheme_manager;
+    GdkScreen* screen;
+    ThemeEntry* entries;            /* Indexed by ThemeType */
+    size_t entry_count;
+    GtkCssProvider* active_provider;
+    GtkSourceStyleScheme* active_scheme;
+    GSList* buffers;                /* GtkSourceBuffer, weakly referenced */
+    gint64 last_apply_time;
+};
+
+/**
+ * @brief Gets a theme's resources, building them on first use
+ * @return Entry, or NULL if there is no such theme
+ */
+static ThemeEntry* get_entry(ThemeCache* cache, ThemeType theme) {
+    const char* css = theme_manager_get_theme_css(cache->manager, theme);
+    if (!css) {
+        return NULL;
+    }
+
+    size_t index = (size_t)theme;
+    if (index >= cache->entry_count) {
+        size_t count = theme_manager_get_count(cache->manager);
+        ThemeEntry* entries = (ThemeEntry*)realloc(cache->entries, count * sizeof(ThemeEntry));
+        if (!entries) {
+            return NULL;
+        }
+        for (size_t i = cache->entry_count; i < count; i++) {
+            entries[i].provider = NULL;
+            entries[i].scheme = NULL;
+        }
+        cache->entries = entries;
+        cache->entry_count = count;
+    }
+
+    ThemeEntry* entry = &cache->entries[index];
+    if (!entry->provider) {
+        entry->provider = gtk_css_provider_new();
+        gtk_css_provider_load_from_data(entry->provider, css, -1, NULL);
+
+        const char* scheme_id = theme_manager_get_scheme_id(cache->manager, theme);
+        entry->scheme = gtk_source_style_scheme_manager_get_scheme(cache->scheme_manager, scheme_id);
+        if (entry->scheme) {
+            g_object_ref(entry->scheme);
+        }
+    }
+
+    return entry;
+}
+
+static void on_buffer_finalized(gpointer user_data, GObject* buffer) {
+    ThemeCache* cache = (ThemeCache*)user_data;
+    cache->buffers = g_slist_remove(cache->buffers, buffer);
+}
+
+ThemeCache* theme_cache_create(const ThemeManager* manager,
+                               GtkSourceStyleSchemeManager* scheme_manager,
+                               GdkScreen* screen) {
+    if (!manager || !scheme_manager || !screen) {
+        return NULL;
+    }
+
+    ThemeCache* cache = (ThemeCache*)calloc(1, sizeof(ThemeCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->manager = manager;
+    cache->scheme_manager = g_object_ref(scheme_manager);
+    cache->screen = screen;
+
+    size_t count = theme_manager_get_count(manager);
+    for (size_t i = 0; i < count; i++) {
+        get_entry(cache, (ThemeType)i);
+    }
+
+    return cache;
+}
+
+void theme_cache_destroy(ThemeCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    if (cache->active_provider) {
+        gtk_style_context_remove_provider_for_screen(cache->screen,
+                                                     GTK_STYLE_PROVIDER(cache->active_provider));
+    }
+
+    for (GSList* link = cache->buffers; link; link = link->next) {
+        g_object_weak_unref(G_OBJECT(link->data), on_buffer_finalized, cache);
+    }
+    g_slist_free(cache->buffers);
+
+    for (size_t i = 0; i < cache->entry_count; i++) {
+        if (cache->entries[i].provider) {
+            g_object_unref(cache->entries[i].provider);
+        }
+        if (cache->entries[i].scheme) {
+            g_object_unref(cache->entries[i].scheme);
+        }
+    }
+    free(cache->entries);
+    g_object_unref(cache->scheme_manager);
+    free(cache);
+}
+
+void theme_cache_add_buffer(ThemeCache* cache, GtkSourceBuffer* buffer) {
+    if (!cache || !buffer || g_slist_find(cache->buffers, buffer)) {
+        return;
+    }
+
+    cache->buffers = g_slist_prepend(cache->buffers, buffer);
+    g_object_weak_ref(G_OBJECT(buffer), on_buffer_finalized, cache);
+
+    if (cache->active_scheme) {
+        gtk_source_buffer_set_style_scheme(buffer, cache->active_scheme);
+    }
+}
+
+void theme_cache_apply(ThemeCache* cache, ThemeType theme) {
+    if (!cache) {
+        return;
+    }
+
+    gint64 start = g_get_monotonic_time();
+
+    ThemeEntry* entry = get_entry(cache, theme);
+    if (!entry) {
+        return;
+    }
+
+    if (entry->provider != cache->active_provider) {
+        if (cache->active_provider) {
+            gtk_style_context_remove_provider_for_screen(cache->screen,
+                                                         GTK_STYLE_PROVIDER(cache->active_provider));
+        }
+        gtk_style_context_add_provider_for_screen(cache->screen,
+                                                  GTK_STYLE_PROVIDER(entry->provider),
+                                                  GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+        cache->active_provider = entry->provider;
+    }
+
+    /* Keep the previous scheme if this theme's could not be found */
+    if (entry->scheme && entry->scheme != cache->active_scheme) {
+        cache->active_scheme = entry->scheme;
+        for (GSList* link = cache->buffers; link; link = link->next) {
+            gtk_source_buffer_set_style_scheme(GTK_SOURCE_BUFFER(link->data), entry->scheme);
+        }
+    }
+
+    cache->last_apply_time = g_get_monotonic_time() - start;
+}
+
+gint64 theme_cache_get_last_apply_time(const ThemeCache* cache) {
+    return cache ? cache->last_apply_time : 0;
+}
\ No newline at end of file